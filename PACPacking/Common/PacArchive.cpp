@@ -0,0 +1,148 @@
+#define _FILE_OFFSET_BITS 64
+
+#include "PacArchive.h"
+
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <share.h>
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+using namespace std;
+
+FILE* FileUtil::Open(const string& path, const char* pMode)
+{
+#ifdef _WIN32
+    // Shared, unlike _wfopen_s: the tools open the same archive once per worker thread
+    wstring mode(pMode, pMode + strlen(pMode));
+    return _wfsopen(filesystem::u8path(path).c_str(), mode.c_str(), _SH_DENYNO);
+#else
+    return fopen(path.c_str(), pMode);
+#endif
+}
+
+bool FileUtil::GetSize(FILE* pFile, uint64_t& size)
+{
+    if (fseek64(pFile, 0, SEEK_END) != 0)
+        return false;
+
+    int64_t end = ftell64(pFile);
+    if (end < 0)
+        return false;
+
+    size = (uint64_t)end;
+    return true;
+}
+
+bool FileUtil::ReadAt(FILE* pFile, uint64_t offset, void* pBuffer, size_t size)
+{
+    return fseek64(pFile, (int64_t)offset, SEEK_SET) == 0 && fread(pBuffer, 1, size, pFile) == size;
+}
+
+bool FileUtil::WriteAt(FILE* pFile, uint64_t offset, const void* pData, size_t size)
+{
+    return fseek64(pFile, (int64_t)offset, SEEK_SET) == 0 && fwrite(pData, 1, size, pFile) == size;
+}
+
+bool FileUtil::Create(const string& path, uint64_t size)
+{
+    FILE* pFile = Open(path, "wb");
+    if (pFile == nullptr)
+        return false;
+
+    fclose(pFile);
+    error_code error;
+    filesystem::resize_file(filesystem::u8path(path), size, error);
+    return !error;
+}
+
+bool FileUtil::ReadAll(const string& path, vector<uint8_t>& data)
+{
+    FILE* pFile = Open(path, "rb");
+    if (pFile == nullptr)
+        return false;
+
+    uint64_t size;
+    bool success = GetSize(pFile, size) && size <= SIZE_MAX;
+    if (success)
+    {
+        data.resize((size_t)size);
+        success = ReadAt(pFile, 0, data.data(), data.size());
+    }
+    fclose(pFile);
+    return success;
+}
+
+bool FileUtil::WriteAll(const string& path, const void* pData, size_t size)
+{
+    FILE* pFile = Open(path, "wb");
+    if (pFile == nullptr)
+        return false;
+
+    bool success = fwrite(pData, 1, size, pFile) == size;
+    return fclose(pFile) == 0 && success;
+}
+
+bool PacArchive::Open(const string& path)
+{
+    _path = path;
+    _header.clear();
+    _entries.clear();
+
+    FILE* pFile = FileUtil::Open(path, "rb");
+    if (pFile == nullptr)
+        return false;
+
+    uint8_t start[12];
+    bool success = FileUtil::GetSize(pFile, _fileSize) && _fileSize >= sizeof(start) && FileUtil::ReadAt(pFile, 0, start, sizeof(start));
+    if (success)
+    {
+        bool newFormat = memcmp(start, "PAC ", 4) == 0;
+        uint32_t count;
+        memcpy(&count, start + (newFormat ? 8 : 0), 4);
+        _directoryOffset = newFormat ? 0x804 : 0x3FE;
+
+        success = _directoryOffset <= _fileSize && count <= (_fileSize - _directoryOffset) / EntrySize;
+        if (success)
+        {
+            _header.resize(_directoryOffset + (size_t)count * EntrySize);
+            success = FileUtil::ReadAt(pFile, 0, _header.data(), _header.size());
+        }
+        for (uint32_t i = 0; success && i < count; i++)
+        {
+            const uint8_t* pRecord = _header.data() + _directoryOffset + (size_t)i * EntrySize;
+            Entry entry;
+            entry.Name.assign((const char*)pRecord, strnlen((const char*)pRecord, NameSize));
+            memcpy(&entry.Size, pRecord + NameSize, 4);
+            memcpy(&entry.Offset, pRecord + NameSize + 4, 4);
+            success = (uint64_t)entry.Offset + entry.Size <= _fileSize;
+            _entries.push_back(move(entry));
+        }
+    }
+
+    fclose(pFile);
+    return success;
+}
+
+void PacArchive::Encrypt(uint8_t* pData, size_t size, uint64_t position)
+{
+    static constexpr uint32_t Key = 0x084DF873 ^ 0xFF987DEE;
+    size_t i = position < 0x10 ? (size_t)(0x10 - position) : 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        uint64_t index = (position + i - 0x10) / 4;
+        int rotation = (int)((index + 4) & 7);
+        uint8_t* p = pData + i;
+        p[0] ^= (uint8_t)Key;
+        p[1] ^= (uint8_t)(Key >> 8);
+        p[2] ^= (uint8_t)(Key >> 16);
+        p[3] ^= (uint8_t)(Key >> 24);
+        p[0] = (uint8_t)(p[0] >> rotation | p[0] << ((8 - rotation) & 7));
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Positional file I/O for the PAC tools. Paths are UTF-8 (wide on Windows, so non-ASCII names survive).
+// Each call seeks first, so threads that each have their own FILE can work on different parts of a file.
+class FileUtil
+{
+public:
+    static FILE*            Open                (const std::string& path, const char* pMode);
+    static bool             GetSize             (FILE* pFile, uint64_t& size);
+    static bool             ReadAt              (FILE* pFile, uint64_t offset, void* pBuffer, size_t size);
+    static bool             WriteAt             (FILE* pFile, uint64_t offset, const void* pData, size_t size);
+    // Creates (or truncates) the file and extends it to the given size
+    static bool             Create              (const std::string& path, uint64_t size);
+    // Whole small files, such as single pictures
+    static bool             ReadAll             (const std::string& path, std::vector<uint8_t>& data);
+    static bool             WriteAll            (const std::string& path, const void* pData, size_t size);
+};
+
+// Reads the header and directory of a SoftPal PAC archive; the entries' data stays on disk.
+// Same layout as unipack.c: archives starting with "PAC " have the file count at 0x8 and the directory at
+// 0x804, older ones (Flyable Heart) the count at 0 and the directory at 0x3FE. Each 0x28-byte directory
+// record is a 0x20-byte name (not always terminated), the size and the offset. The data ends with "EOF ".
+class PacArchive
+{
+public:
+    static constexpr uint32_t EntrySize = 0x28;
+    static constexpr uint32_t NameSize = 0x20;
+
+    struct Entry
+    {
+        std::string     Name;
+        uint32_t        Size;
+        uint32_t        Offset;
+    };
+
+    // Returns false if the file can't be read, isn't a PAC archive, or has an entry outside the file
+    bool Open(const std::string& path);
+
+    // Entries whose data starts with '$' are stored encrypted, as unipack.c does it: each whole dword from offset
+    // 0x10 on is xor'ed with a key and has its first byte rotated. Encrypts the part of an entry that starts at the
+    // given position, which has to be a multiple of 4.
+    static void Encrypt(uint8_t* pData, size_t size, uint64_t position);
+
+    const std::string& GetPath() const { return _path; }
+    uint64_t GetFileSize() const { return _fileSize; }
+    uint32_t GetDirectoryOffset() const { return _directoryOffset; }
+
+    // Everything up to the end of the directory, including the unknown data before it
+    const std::vector<uint8_t>& GetHeader() const { return _header; }
+
+    int GetCount() const { return (int)_entries.size(); }
+    const Entry& GetEntry(int index) const { return _entries[index]; }
+
+private:
+    std::string _path;
+    uint64_t _fileSize = 0;
+    uint32_t _directoryOffset = 0;
+    std::vector<uint8_t> _header;
+    std::vector<Entry> _entries;
+};
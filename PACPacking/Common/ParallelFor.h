@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Calls work(index) for every index below count, spread over numThreads threads. Each thread calls makeWork once
+// to get its work function, which can hold the thread's own files and buffer.
+template<typename MakeWork>
+static void ParallelFor(int count, int numThreads, MakeWork makeWork)
+{
+    std::atomic<int> nextIndex = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::min(numThreads, count); i++)
+    {
+        threads.emplace_back([&]()
+        {
+            auto work = makeWork();
+            for (int index = nextIndex++; index < count; index = nextIndex++)
+            {
+                work(index);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
@@ -0,0 +1,748 @@
+#include "PgdCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)) && !defined(PGD_NO_SIMD)
+#define PGD_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows any intrinsics in any function; GCC and Clang need the function to be compiled for the instruction set
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TARGET_SSE2
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace std;
+
+static uint16_t Read16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t Read32(const uint8_t* p) { uint32_t value; memcpy(&value, p, 4); return value; }
+
+static uint8_t Clamp(int value)
+{
+    return (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+#ifdef PGD_X86_SIMD
+enum class SimdLevel
+{
+    None,
+    Sse2,
+    Ssse3,
+    Avx2
+};
+
+static SimdLevel DetectSimd()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    if ((info[3] & (1 << 26)) == 0)
+        return SimdLevel::None;
+
+    if ((info[2] & (1 << 9)) == 0)
+        return SimdLevel::Sse2;
+
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (maxLeaf < 7 || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return SimdLevel::Ssse3;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0 ? SimdLevel::Avx2 : SimdLevel::Ssse3;
+#else
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::Avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return SimdLevel::Ssse3;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::Sse2;
+    return SimdLevel::None;
+#endif
+}
+
+static SimdLevel GetSimdLevel()
+{
+    static const SimdLevel level = DetectSimd();
+    return level;
+}
+#endif
+
+// Copies count bytes from offset bytes back. The source may overlap the destination, in which case the
+// copied bytes repeat, so bigger blocks are only used when the offset allows them.
+static void CopyMatch(uint8_t* pDst, size_t offset, size_t count)
+{
+    const uint8_t* pSrc = pDst - offset;
+    if (offset == 1)
+    {
+        memset(pDst, *pSrc, count);
+        return;
+    }
+
+    if (offset >= 16)
+    {
+        for (; count >= 16; pDst += 16, pSrc += 16, count -= 16)
+        {
+            memcpy(pDst, pSrc, 16);
+        }
+    }
+    else if (offset >= 8)
+    {
+        for (; count >= 8; pDst += 8, pSrc += 8, count -= 8)
+        {
+            memcpy(pDst, pSrc, 8);
+        }
+    }
+
+    for (; count != 0; count--)
+    {
+        *pDst++ = *pSrc++;
+    }
+}
+
+bool PgdCodec::DecompressGeLz(const uint8_t* pInput, size_t inputSize, uint8_t* pOutput, size_t outputSize)
+{
+    const uint8_t* pIn = pInput;
+    const uint8_t* pInEnd = pInput + inputSize;
+    size_t dst = 0;
+    uint32_t control = 2;
+    while (dst < outputSize)
+    {
+        control >>= 1;
+        if (control == 1)
+        {
+            if (pIn == pInEnd)
+                return false;
+
+            control = *pIn++ | 0x100;
+        }
+
+        if (control & 1)
+        {
+            // Offset in the top 12 bits; bit 3 set means a 3-bit count, clear means an 11-bit count
+            if (pInEnd - pIn < 2)
+                return false;
+
+            uint32_t word = Read16(pIn);
+            pIn += 2;
+            size_t count = word & 7;
+            if ((word & 8) == 0)
+            {
+                if (pIn == pInEnd)
+                    return false;
+
+                count = count << 8 | *pIn++;
+            }
+            count += 4;
+
+            size_t offset = word >> 4;
+            if (offset > dst || count > outputSize - dst)
+                return false;
+
+            CopyMatch(pOutput + dst, offset, count);
+            dst += count;
+        }
+        else
+        {
+            if (pIn == pInEnd)
+                return false;
+
+            size_t count = *pIn++;
+            if (count > (size_t)(pInEnd - pIn))
+                return false;
+
+            // The last run can go past the end of the output; the extra bytes are dropped
+            memcpy(pOutput + dst, pIn, min(count, outputSize - dst));
+            pIn += count;
+            dst += count;
+        }
+    }
+    return true;
+}
+
+bool PgdCodec::UnpackLookBehind(const uint8_t* pInput, size_t inputSize, uint8_t* pOutput, size_t outputSize,
+                                size_t lookBehind)
+{
+    const uint8_t* pIn = pInput;
+    const uint8_t* pInEnd = pInput + inputSize;
+    size_t dst = 0;
+    uint32_t control = 2;
+    while (dst < outputSize)
+    {
+        control >>= 1;
+        if (control == 1)
+        {
+            if (pIn == pInEnd)
+                return false;
+
+            control = *pIn++ | 0x100;
+        }
+
+        if (control & 1)
+        {
+            // The position is relative to the start of a window that follows the output once it's full
+            if (pInEnd - pIn < 3)
+                return false;
+
+            size_t src = Read16(pIn);
+            size_t count = pIn[2];
+            pIn += 3;
+            if (dst > lookBehind)
+                src += dst - lookBehind;
+
+            if (src + count > outputSize || count > outputSize - dst)
+                return false;
+
+            if (src < dst)
+            {
+                CopyMatch(pOutput + dst, dst - src, count);
+            }
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    pOutput[dst + i] = pOutput[src + i];
+                }
+            }
+            dst += count;
+        }
+        else
+        {
+            if (pIn == pInEnd)
+                return false;
+
+            size_t count = *pIn++;
+            if (count > (size_t)(pInEnd - pIn))
+                return false;
+
+            memcpy(pOutput + dst, pIn, min(count, outputSize - dst));
+            pIn += count;
+            dst += count;
+        }
+    }
+    return true;
+}
+
+// Planes to BGRA pixels
+
+static void InterleaveScalar(const uint8_t* pB, const uint8_t* pG, const uint8_t* pR, const uint8_t* pA,
+                             uint8_t* pDst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        pDst[i * 4 + 0] = pB[i];
+        pDst[i * 4 + 1] = pG[i];
+        pDst[i * 4 + 2] = pR[i];
+        pDst[i * 4 + 3] = pA[i];
+    }
+}
+
+#ifdef PGD_X86_SIMD
+TARGET_SSE2 static void InterleaveSse2(const uint8_t* pB, const uint8_t* pG, const uint8_t* pR, const uint8_t* pA,
+                                       uint8_t* pDst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i b = _mm_loadu_si128((const __m128i*)(pB + i));
+        __m128i g = _mm_loadu_si128((const __m128i*)(pG + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(pR + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(pA + i));
+        __m128i bgLow = _mm_unpacklo_epi8(b, g);
+        __m128i bgHigh = _mm_unpackhi_epi8(b, g);
+        __m128i raLow = _mm_unpacklo_epi8(r, a);
+        __m128i raHigh = _mm_unpackhi_epi8(r, a);
+        _mm_storeu_si128((__m128i*)(pDst + i * 4), _mm_unpacklo_epi16(bgLow, raLow));
+        _mm_storeu_si128((__m128i*)(pDst + i * 4 + 16), _mm_unpackhi_epi16(bgLow, raLow));
+        _mm_storeu_si128((__m128i*)(pDst + i * 4 + 32), _mm_unpacklo_epi16(bgHigh, raHigh));
+        _mm_storeu_si128((__m128i*)(pDst + i * 4 + 48), _mm_unpackhi_epi16(bgHigh, raHigh));
+    }
+
+    InterleaveScalar(pB + i, pG + i, pR + i, pA + i, pDst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void InterleaveAvx2(const uint8_t* pB, const uint8_t* pG, const uint8_t* pR, const uint8_t* pA,
+                                       uint8_t* pDst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(pB + i));
+        __m256i g = _mm256_loadu_si256((const __m256i*)(pG + i));
+        __m256i r = _mm256_loadu_si256((const __m256i*)(pR + i));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(pA + i));
+        __m256i bgLow = _mm256_unpacklo_epi8(b, g);
+        __m256i bgHigh = _mm256_unpackhi_epi8(b, g);
+        __m256i raLow = _mm256_unpacklo_epi8(r, a);
+        __m256i raHigh = _mm256_unpackhi_epi8(r, a);
+
+        // The unpacks work within 128-bit lanes: these hold pixels 0-3 and 16-19, 4-7 and 20-23, and so on
+        __m256i pixels0 = _mm256_unpacklo_epi16(bgLow, raLow);
+        __m256i pixels1 = _mm256_unpackhi_epi16(bgLow, raLow);
+        __m256i pixels2 = _mm256_unpacklo_epi16(bgHigh, raHigh);
+        __m256i pixels3 = _mm256_unpackhi_epi16(bgHigh, raHigh);
+        _mm256_storeu_si256((__m256i*)(pDst + i * 4), _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+        _mm256_storeu_si256((__m256i*)(pDst + i * 4 + 32), _mm256_permute2x128_si256(pixels2, pixels3, 0x20));
+        _mm256_storeu_si256((__m256i*)(pDst + i * 4 + 64), _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+        _mm256_storeu_si256((__m256i*)(pDst + i * 4 + 96), _mm256_permute2x128_si256(pixels2, pixels3, 0x31));
+    }
+
+    InterleaveSse2(pB + i, pG + i, pR + i, pA + i, pDst + i * 4, count - i);
+}
+#endif
+
+static void Interleave(const uint8_t* pB, const uint8_t* pG, const uint8_t* pR, const uint8_t* pA,
+                       uint8_t* pDst, size_t count)
+{
+#ifdef PGD_X86_SIMD
+    SimdLevel level = GetSimdLevel();
+    if (level == SimdLevel::Avx2)
+        return InterleaveAvx2(pB, pG, pR, pA, pDst, count);
+    if (level >= SimdLevel::Sse2)
+        return InterleaveSse2(pB, pG, pR, pA, pDst, count);
+#endif
+    InterleaveScalar(pB, pG, pR, pA, pDst, count);
+}
+
+// YUV 4:2:0 to BGR, one pair of rows at a time. Each 2x2 block shares a U and V value; the color offsets are
+// (226 U) >> 7 for blue, (-43 U - 89 V) >> 7 for green and (179 V) >> 7 for red, added to each pixel's Y.
+
+static void YuvRowPairScalar(const int8_t* pU, const int8_t* pV, const uint8_t* pY0, const uint8_t* pY1,
+                             uint8_t* pDst0, uint8_t* pDst1, int blocks)
+{
+    for (int x = 0; x < blocks; x++)
+    {
+        int b = 226 * pU[x];
+        int g = -43 * pU[x] - 89 * pV[x];
+        int r = 179 * pV[x];
+        for (int i = 0; i < 2; i++)
+        {
+            int y0 = pY0[x * 2 + i] << 7;
+            int y1 = pY1[x * 2 + i] << 7;
+            uint8_t* pPixel0 = pDst0 + (x * 2 + i) * 3;
+            uint8_t* pPixel1 = pDst1 + (x * 2 + i) * 3;
+            pPixel0[0] = Clamp((y0 + b) >> 7);
+            pPixel0[1] = Clamp((y0 + g) >> 7);
+            pPixel0[2] = Clamp((y0 + r) >> 7);
+            pPixel1[0] = Clamp((y1 + b) >> 7);
+            pPixel1[1] = Clamp((y1 + g) >> 7);
+            pPixel1[2] = Clamp((y1 + r) >> 7);
+        }
+    }
+}
+
+#ifdef PGD_X86_SIMD
+// pshufb masks that pick the bytes of each of the three 16-byte pieces of 16 BGR pixels from the B, G and R vectors
+struct BgrShuffle
+{
+    alignas(16) int8_t Masks[3][3][16];
+
+    BgrShuffle()
+    {
+        for (int piece = 0; piece < 3; piece++)
+        {
+            for (int channel = 0; channel < 3; channel++)
+            {
+                for (int i = 0; i < 16; i++)
+                {
+                    int position = piece * 16 + i;
+                    Masks[piece][channel][i] = (int8_t)(position % 3 == channel ? position / 3 : -128);
+                }
+            }
+        }
+    }
+};
+
+TARGET_SSSE3 static void StoreBgr(uint8_t* pDst, __m128i b, __m128i g, __m128i r)
+{
+    static const BgrShuffle shuffle;
+    for (int piece = 0; piece < 3; piece++)
+    {
+        __m128i bytes = _mm_shuffle_epi8(b, _mm_load_si128((const __m128i*)shuffle.Masks[piece][0]));
+        bytes = _mm_or_si128(bytes, _mm_shuffle_epi8(g, _mm_load_si128((const __m128i*)shuffle.Masks[piece][1])));
+        bytes = _mm_or_si128(bytes, _mm_shuffle_epi8(r, _mm_load_si128((const __m128i*)shuffle.Masks[piece][2])));
+        _mm_storeu_si128((__m128i*)(pDst + piece * 16), bytes);
+    }
+}
+
+// Y + offset for 16 pixels, where the offsets are given per pair of pixels
+TARGET_SSSE3 static __m128i AddOffsets(__m128i y, __m128i offsets)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi16(offsets, offsets));
+    __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi16(offsets, offsets));
+    return _mm_packus_epi16(low, high);
+}
+
+TARGET_SSSE3 static void YuvRowPairSsse3(const int8_t* pU, const int8_t* pV, const uint8_t* pY0, const uint8_t* pY1,
+                                         uint8_t* pDst0, uint8_t* pDst1, int blocks)
+{
+    int x = 0;
+    for (; x + 8 <= blocks; x += 8)
+    {
+        // Sign extend to 16 bits; the products fit, and an arithmetic shift rounds down like the scalar code
+        __m128i u = _mm_loadl_epi64((const __m128i*)(pU + x));
+        __m128i v = _mm_loadl_epi64((const __m128i*)(pV + x));
+        u = _mm_srai_epi16(_mm_unpacklo_epi8(u, u), 8);
+        v = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+        __m128i b = _mm_srai_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(226)), 7);
+        __m128i g = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(-43)),
+                                                 _mm_mullo_epi16(v, _mm_set1_epi16(-89))), 7);
+        __m128i r = _mm_srai_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(179)), 7);
+
+        __m128i y0 = _mm_loadu_si128((const __m128i*)(pY0 + x * 2));
+        __m128i y1 = _mm_loadu_si128((const __m128i*)(pY1 + x * 2));
+        StoreBgr(pDst0 + x * 6, AddOffsets(y0, b), AddOffsets(y0, g), AddOffsets(y0, r));
+        StoreBgr(pDst1 + x * 6, AddOffsets(y1, b), AddOffsets(y1, g), AddOffsets(y1, r));
+    }
+
+    YuvRowPairScalar(pU + x, pV + x, pY0 + x * 2, pY1 + x * 2, pDst0 + x * 6, pDst1 + x * 6, blocks - x);
+}
+#endif
+
+static void YuvRowPair(const int8_t* pU, const int8_t* pV, const uint8_t* pY0, const uint8_t* pY1,
+                       uint8_t* pDst0, uint8_t* pDst1, int blocks)
+{
+#ifdef PGD_X86_SIMD
+    if (GetSimdLevel() >= SimdLevel::Ssse3)
+        return YuvRowPairSsse3(pU, pV, pY0, pY1, pDst0, pDst1, blocks);
+#endif
+    YuvRowPairScalar(pU, pV, pY0, pY1, pDst0, pDst1, blocks);
+}
+
+// A row predicted from the row above: each byte is the byte above minus the stored difference
+
+static void SubtractRowScalar(const uint8_t* pAbove, const uint8_t* pDiff, uint8_t* pDst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        pDst[i] = (uint8_t)(pAbove[i] - pDiff[i]);
+    }
+}
+
+#ifdef PGD_X86_SIMD
+TARGET_SSE2 static void SubtractRowSse2(const uint8_t* pAbove, const uint8_t* pDiff, uint8_t* pDst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i above = _mm_loadu_si128((const __m128i*)(pAbove + i));
+        __m128i diff = _mm_loadu_si128((const __m128i*)(pDiff + i));
+        _mm_storeu_si128((__m128i*)(pDst + i), _mm_sub_epi8(above, diff));
+    }
+
+    SubtractRowScalar(pAbove + i, pDiff + i, pDst + i, count - i);
+}
+#endif
+
+static void SubtractRow(const uint8_t* pAbove, const uint8_t* pDiff, uint8_t* pDst, size_t count)
+{
+#ifdef PGD_X86_SIMD
+    if (GetSimdLevel() >= SimdLevel::Sse2)
+        return SubtractRowSse2(pAbove, pDiff, pDst, count);
+#endif
+    SubtractRowScalar(pAbove, pDiff, pDst, count);
+}
+
+bool PgdCodec::DecodeType1(const uint8_t* pUnpacked, size_t size, int width, int height, PgdImage& image)
+{
+    if (width <= 0 || height <= 0 || (uint64_t)width * height > size / 4)
+        return false;
+
+    size_t planeSize = (size_t)width * height;
+    image.Width = width;
+    image.Height = height;
+    image.Channels = 4;
+    image.Pixels.resize(planeSize * 4);
+    Interleave(pUnpacked + planeSize * 3, pUnpacked + planeSize * 2, pUnpacked + planeSize, pUnpacked,
+               image.Pixels.data(), planeSize);
+    return true;
+}
+
+bool PgdCodec::DecodeType2(const uint8_t* pUnpacked, size_t size, int width, int height, PgdImage& image)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+
+    // For odd widths, the Y and output positions fall behind by a pixel every pair of rows, as they do in the
+    // Python script; the last row and column stay black for odd sizes.
+    uint64_t segment = (uint64_t)width * height / 4;
+    int blocks = width / 2;
+    uint64_t yStep = (uint64_t)blocks * 2 + width;
+    int rowPairs = height / 2;
+    if (rowPairs != 0 && (segment + (uint64_t)rowPairs * blocks > size ||
+                          segment * 2 + (rowPairs - 1) * yStep + width + blocks * 2 > size))
+    {
+        return false;
+    }
+
+    size_t stride = (size_t)width * 3;
+    size_t dstStep = (size_t)blocks * 6 + stride;
+
+    image.Width = width;
+    image.Height = height;
+    image.Channels = 3;
+    image.Pixels.assign(stride * height, 0);
+    const int8_t* pU = (const int8_t*)pUnpacked;
+    const int8_t* pV = (const int8_t*)pUnpacked + (size_t)segment;
+    const uint8_t* pY = pUnpacked + (size_t)segment * 2;
+    uint8_t* pDst = image.Pixels.data();
+    for (int y = 0; y < rowPairs; y++)
+    {
+        YuvRowPair(pU, pV, pY, pY + width, pDst, pDst + stride, blocks);
+        pU += blocks;
+        pV += blocks;
+        pY += (size_t)yStep;
+        pDst += dstStep;
+    }
+    return true;
+}
+
+bool PgdCodec::DecodeRows(const uint8_t* pInput, size_t size, int width, int height, int pixelSize, uint8_t* pOutput)
+{
+    if (width <= 0 || height <= 0 || (uint64_t)height * (1 + (uint64_t)width * pixelSize) > size)
+        return false;
+
+    size_t stride = (size_t)width * pixelSize;
+    // The first row's "above" reads as zeros
+    vector<uint8_t> zeros(stride);
+    const uint8_t* pControl = pInput;
+    const uint8_t* pSrc = pInput + height;
+    for (int y = 0; y < height; y++, pSrc += stride)
+    {
+        uint8_t* pDst = pOutput + y * stride;
+        const uint8_t* pAbove = y == 0 ? zeros.data() : pDst - stride;
+        uint8_t control = pControl[y];
+        if (control & 2 && !(control & 1))
+        {
+            SubtractRow(pAbove, pSrc, pDst, stride);
+            continue;
+        }
+
+        memcpy(pDst, pSrc, pixelSize);
+        if (control & 1)
+        {
+            for (size_t i = pixelSize; i < stride; i++)
+            {
+                pDst[i] = (uint8_t)(pDst[i - pixelSize] - pSrc[i]);
+            }
+        }
+        else
+        {
+            for (size_t i = pixelSize; i < stride; i++)
+            {
+                pDst[i] = (uint8_t)((pAbove[i] + pDst[i - pixelSize]) / 2 - pSrc[i]);
+            }
+        }
+    }
+    return true;
+}
+
+bool PgdCodec::DecodeType3(const uint8_t* pUnpacked, size_t size, PgdImage& image)
+{
+    if (size < 8)
+        return false;
+
+    int bitsPerPixel = Read16(pUnpacked + 2);
+    int width = Read16(pUnpacked + 4);
+    int height = Read16(pUnpacked + 6);
+    if (bitsPerPixel != 24 && bitsPerPixel != 32)
+        return false;
+
+    int pixelSize = bitsPerPixel / 8;
+    if ((uint64_t)height * (1 + (uint64_t)width * pixelSize) > size - 8)
+        return false;
+
+    vector<uint8_t> pixels((size_t)width * height * pixelSize);
+    if (!DecodeRows(pUnpacked + 8, size - 8, width, height, pixelSize, pixels.data()))
+        return false;
+
+    image.Width = width;
+    image.Height = height;
+    image.Channels = pixelSize;
+    image.Pixels = move(pixels);
+    return true;
+}
+
+// Neither LZ variant can produce more than about 700 bytes per input byte, so a bigger unpacked size is corrupt
+// and not worth allocating
+static bool CheckSizes(size_t unpackedSize, size_t packedSize)
+{
+    return unpackedSize <= (uint64_t)packedSize * 1024 + 1024;
+}
+
+bool PgdCodec::Decode(const uint8_t* pData, size_t size, PgdImage& image, string& error)
+{
+    if (size < 0x28 || memcmp(pData, "GE", 2) != 0)
+    {
+        error = "not a GE PGD file";
+        return false;
+    }
+
+    if (memcmp(pData + 0x1C, "11_C", 4) == 0)
+    {
+        int width = (int)Read32(pData + 0xC);
+        int height = (int)Read32(pData + 0x10);
+        size_t unpackedSize = Read32(pData + 0x20);
+        size_t packedSize = min<size_t>(Read32(pData + 0x24), size - 0x28);
+        if (width <= 0 || height <= 0 || (uint64_t)width * height > unpackedSize / 4 ||
+            !CheckSizes(unpackedSize, packedSize))
+        {
+            error = "bad 11_C header";
+            return false;
+        }
+
+        vector<uint8_t> planes(unpackedSize);
+        if (!UnpackLookBehind(pData + 0x28, packedSize, planes.data(), unpackedSize, 0xFFC))
+        {
+            error = "corrupt 11_C data";
+            return false;
+        }
+
+        size_t planeSize = (size_t)width * height;
+        image.Width = width;
+        image.Height = height;
+        image.Channels = 4;
+        image.OffsetX = 0;
+        image.OffsetY = 0;
+        image.Pixels.resize(planeSize * 4);
+        Interleave(planes.data(), planes.data() + planeSize, planes.data() + planeSize * 2, planes.data() + planeSize * 3,
+                   image.Pixels.data(), planeSize);
+        return true;
+    }
+
+    if (Read16(pData + 2) != 0x20)
+    {
+        error = "unsupported header size";
+        return false;
+    }
+
+    int width = (int)Read32(pData + 0xC);
+    int height = (int)Read32(pData + 0x10);
+    int method = Read16(pData + 0x1C);
+    size_t unpackedSize = Read32(pData + 0x20);
+    size_t packedSize = Read32(pData + 0x24);
+    if (packedSize > size - 0x28 || !CheckSizes(unpackedSize, packedSize))
+    {
+        error = "packed data doesn't match the header";
+        return false;
+    }
+
+    vector<uint8_t> unpacked(unpackedSize);
+    if (!DecompressGeLz(pData + 0x28, packedSize, unpacked.data(), unpackedSize))
+    {
+        error = "corrupt GE-LZ data";
+        return false;
+    }
+
+    bool success;
+    switch (method)
+    {
+    case 1:
+        success = DecodeType1(unpacked.data(), unpackedSize, width, height, image);
+        break;
+
+    case 2:
+        success = DecodeType2(unpacked.data(), unpackedSize, width, height, image);
+        break;
+
+    case 3:
+        success = DecodeType3(unpacked.data(), unpackedSize, image);
+        break;
+
+    default:
+        error = "unsupported GE compression type " + to_string(method);
+        return false;
+    }
+
+    if (!success)
+    {
+        error = "unpacked data doesn't match the picture size";
+        return false;
+    }
+
+    image.OffsetX = (int)Read32(pData + 4);
+    image.OffsetY = (int)Read32(pData + 8);
+    return true;
+}
+
+bool PgdCodec::IsOverlay(const uint8_t* pData, size_t size)
+{
+    return size >= 0x38 && (memcmp(pData, "PGD3", 4) == 0 || memcmp(pData, "PGD2", 4) == 0);
+}
+
+string PgdCodec::GetOverlayBaseName(const uint8_t* pData, size_t size)
+{
+    if (!IsOverlay(pData, size))
+        return string();
+
+    const char* pName = (const char*)pData + 0xE;
+    return string(pName, strnlen(pName, 0x22));
+}
+
+bool PgdCodec::ApplyOverlay(const uint8_t* pData, size_t size, PgdImage& base, string& error)
+{
+    if (!IsOverlay(pData, size))
+    {
+        error = "not a PGD3 file";
+        return false;
+    }
+
+    int offsetX = Read16(pData + 4);
+    int offsetY = Read16(pData + 6);
+    int width = Read16(pData + 8);
+    int height = Read16(pData + 0xA);
+    int pixelSize = Read16(pData + 0xC) / 8;
+    size_t unpackedSize = Read32(pData + 0x30);
+    size_t packedSize = Read32(pData + 0x34);
+    if (pixelSize != base.Channels || packedSize > size - 0x38 || !CheckSizes(unpackedSize, packedSize))
+    {
+        error = "overlay header doesn't match the base picture";
+        return false;
+    }
+
+    vector<uint8_t> unpacked(unpackedSize);
+    if (!DecompressGeLz(pData + 0x38, packedSize, unpacked.data(), unpackedSize) ||
+        (uint64_t)height * (1 + (uint64_t)width * pixelSize) > unpackedSize)
+    {
+        error = "corrupt overlay data";
+        return false;
+    }
+
+    if (width == 0 || height == 0)
+        return true;
+
+    vector<uint8_t> overlay((size_t)width * height * pixelSize);
+    DecodeRows(unpacked.data(), unpackedSize, width, height, pixelSize, overlay.data());
+
+    size_t baseStride = (size_t)base.Width * pixelSize;
+    size_t start = ((size_t)offsetY * base.Width + offsetX) * pixelSize;
+    if (start + (height - 1) * baseStride + (size_t)width * pixelSize > base.Pixels.size())
+    {
+        error = "overlay goes outside the base picture";
+        return false;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t* pDst = base.Pixels.data() + start + y * baseStride;
+        const uint8_t* pSrc = overlay.data() + (size_t)y * width * pixelSize;
+        for (size_t i = 0; i < (size_t)width * pixelSize; i++)
+        {
+            pDst[i] ^= pSrc[i];
+        }
+    }
+    return true;
+}
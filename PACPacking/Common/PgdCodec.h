@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A decoded picture, top row first, without padding between rows
+struct PgdImage
+{
+    int                     Width = 0;
+    int                     Height = 0;
+    int                     Channels = 0;       // 3 for BGR, 4 for BGRA
+    int                     OffsetX = 0;        // Where the engine draws the picture, from the PGD header
+    int                     OffsetY = 0;
+    std::vector<uint8_t>    Pixels;
+};
+
+// Decoder for SoftPal's PGD pictures. Gives the same pixels as the Python scripts in Softpal_PGD_Toolkit
+// (pgd2png_ge.py and pgd2png_others.py), including for odd sizes where their loops leave pixels black.
+//
+// GE files start with a 0x20-byte header ("GE", header size 0x20, int32 x and y at 4, uint32 width and height at 0xC,
+// uint16 compression type at 0x1C), followed by the unpacked and packed size and the GE-LZ data. The unpacked data is
+//   type 1: planes of A, R, G and B
+//   type 2: YUV 4:2:0, planes of signed U and V (one value per 2x2 block) followed by the Y plane
+//   type 3: a header with the bits per pixel (24 or 32), width and height, then a control byte per row and the
+//           rows, each one a difference from the pixel to the left, the pixel above, or the average of both
+// "11_C" files (the tag at 0x1C) hold planes of B, G, R and A packed with the look-behind LZ variant. PGD3 files are
+// a type 3 overlay that is XOR'ed onto a GE base picture named in their header.
+class PgdCodec
+{
+public:
+    // The packed formats. Both return false if the data runs out, or a copy refers to bytes outside the output.
+    static bool DecompressGeLz(const uint8_t* pInput, size_t inputSize, uint8_t* pOutput, size_t outputSize);
+    static bool UnpackLookBehind(const uint8_t* pInput, size_t inputSize, uint8_t* pOutput, size_t outputSize,
+                                 size_t lookBehind);
+
+    // Decodes a GE (type 1, 2 or 3) or 11_C file
+    static bool Decode(const uint8_t* pData, size_t size, PgdImage& image, std::string& error);
+
+    // PGD3 files: the file name of the base picture, and the XOR of the overlay onto the decoded base
+    static bool IsOverlay(const uint8_t* pData, size_t size);
+    static std::string GetOverlayBaseName(const uint8_t* pData, size_t size);
+    static bool ApplyOverlay(const uint8_t* pData, size_t size, PgdImage& base, std::string& error);
+
+    // The post-processing steps on unpacked data, exposed for the encoder's round trip checks
+    static bool DecodeType1(const uint8_t* pUnpacked, size_t size, int width, int height, PgdImage& image);
+    static bool DecodeType2(const uint8_t* pUnpacked, size_t size, int width, int height, PgdImage& image);
+    static bool DecodeType3(const uint8_t* pUnpacked, size_t size, PgdImage& image);
+    static bool DecodeRows(const uint8_t* pInput, size_t size, int width, int height, int pixelSize, uint8_t* pOutput);
+};
@@ -0,0 +1,575 @@
+#include "PgdEncoder.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+static constexpr size_t WindowSize = 4095;          // The 12-bit offset of a copy
+static constexpr size_t MinMatch = 4;
+static constexpr size_t MaxMatch = 2051;            // The 11-bit count of a long copy, plus 4
+static constexpr size_t MaxShortMatch = 11;         // The 3-bit count of a short copy, plus 4
+static constexpr size_t MaxLiteralRun = 255;
+static constexpr int HashBits = 15;
+static constexpr size_t BandSize = 128 * 1024;
+
+static void Write16(uint8_t* p, uint16_t value) { p[0] = (uint8_t)value; p[1] = (uint8_t)(value >> 8); }
+static void Write32(uint8_t* p, uint32_t value) { memcpy(p, &value, 4); }
+
+namespace
+{
+    // How many candidates the matcher looks at, and the length at which it stops looking for a longer match. There's
+    // no lazy matching: a copy costs 2 or 3 bytes whatever its length, so putting one off for a slightly longer one at
+    // the next byte rarely makes up for the literal in between.
+    struct PresetSettings
+    {
+        int MaxChain;
+        size_t NiceLength;
+    };
+
+    const PresetSettings& GetSettings(PgdPreset preset)
+    {
+        static const PresetSettings Fast = { 8, 32 };
+        static const PresetSettings Normal = { 48, 256 };
+        static const PresetSettings Max = { 1024, MaxMatch };
+        return preset == PgdPreset::Fast ? Fast : preset == PgdPreset::Max ? Max : Normal;
+    }
+
+    struct GeLzMatch
+    {
+        size_t Length = 0;
+        size_t Offset = 0;
+    };
+
+    // A copy (Offset != 0) or a run of Length literal bytes
+    struct Token
+    {
+        uint16_t Length;
+        uint16_t Offset;
+    };
+
+    // Finds earlier occurrences of the data at a position through chains of positions with the same 4-byte hash.
+    // The window is short enough that the chains fit in a ring of 4096 entries.
+    class GeLzMatcher
+    {
+    public:
+        GeLzMatcher(const PresetSettings& settings)
+            : _settings(settings), _heads((size_t)1 << HashBits), _previous(WindowSize + 1)
+        {
+        }
+
+        // Starts on new data; positions from start on can be inserted and searched
+        void Reset(const uint8_t* pData, size_t start, size_t end)
+        {
+            _pData = pData;
+            _end = end;
+            fill(_heads.begin(), _heads.end(), -1);
+            _start = (int64_t)start;
+        }
+
+        void Insert(size_t position)
+        {
+            if (position + MinMatch > _end)
+                return;
+
+            uint32_t hash = Hash(position);
+            _previous[position % _previous.size()] = _heads[hash];
+            _heads[hash] = (int64_t)position;
+        }
+
+        GeLzMatch Find(size_t position) const
+        {
+            GeLzMatch best;
+            if (position + MinMatch > _end)
+                return best;
+
+            const uint8_t* pCurrent = _pData + position;
+            size_t maxLength = min(MaxMatch, _end - position);
+            int64_t candidate = _heads[Hash(position)];
+            for (int chain = _settings.MaxChain; candidate >= _start && chain > 0; chain--)
+            {
+                size_t offset = position - (size_t)candidate;
+                if (offset > WindowSize)
+                    break;
+
+                const uint8_t* pCandidate = _pData + candidate;
+                if (pCandidate[best.Length] == pCurrent[best.Length])
+                {
+                    size_t length = GetMatchLength(pCandidate, pCurrent, maxLength);
+                    if (length > best.Length)
+                    {
+                        best.Length = length;
+                        best.Offset = offset;
+                        if (length >= _settings.NiceLength || length == maxLength)
+                            break;
+                    }
+                }
+
+                int64_t next = _previous[candidate % _previous.size()];
+                if (next >= candidate)
+                    break;
+
+                candidate = next;
+            }
+            return best.Length >= MinMatch ? best : GeLzMatch();
+        }
+
+    private:
+        uint32_t Hash(size_t position) const
+        {
+            uint32_t value;
+            memcpy(&value, _pData + position, 4);
+            return (value * 2654435761u) >> (32 - HashBits);
+        }
+
+        static size_t GetMatchLength(const uint8_t* pA, const uint8_t* pB, size_t maxLength)
+        {
+            size_t length = 0;
+            for (; length + 8 <= maxLength; length += 8)
+            {
+                uint64_t a;
+                uint64_t b;
+                memcpy(&a, pA + length, 8);
+                memcpy(&b, pB + length, 8);
+                if (a != b)
+                    break;
+            }
+            while (length < maxLength && pA[length] == pB[length])
+                length++;
+
+            return length;
+        }
+
+        const PresetSettings& _settings;
+        const uint8_t* _pData = nullptr;
+        size_t _end = 0;
+        int64_t _start = 0;
+        vector<int64_t> _heads;
+        vector<int64_t> _previous;
+    };
+}
+
+// Parses the data from start to end into tokens. Copies can reach back to before start (the previous band),
+// but not past end.
+static void ParseBand(GeLzMatcher& matcher, const uint8_t* pData, size_t start, size_t end, vector<Token>& tokens)
+{
+    size_t windowStart = start > WindowSize ? start - WindowSize : 0;
+    matcher.Reset(pData, windowStart, end);
+    for (size_t position = windowStart; position < start; position++)
+    {
+        matcher.Insert(position);
+    }
+
+    size_t literalStart = start;
+    auto flushLiterals = [&](size_t position)
+    {
+        while (literalStart < position)
+        {
+            size_t count = min(position - literalStart, MaxLiteralRun);
+            tokens.push_back({ (uint16_t)count, 0 });
+            literalStart += count;
+        }
+    };
+
+    for (size_t position = start; position < end; )
+    {
+        GeLzMatch match = matcher.Find(position);
+        matcher.Insert(position);
+        if (match.Length == 0)
+        {
+            position++;
+            continue;
+        }
+
+        flushLiterals(position);
+        tokens.push_back({ (uint16_t)match.Length, (uint16_t)match.Offset });
+        for (size_t i = 1; i < match.Length; i++)
+        {
+            matcher.Insert(position + i);
+        }
+        position += match.Length;
+        literalStart = position;
+    }
+    flushLiterals(end);
+}
+
+vector<uint8_t> PgdEncoder::CompressGeLz(const uint8_t* pData, size_t size, PgdPreset preset, int numThreads)
+{
+    // An empty stream still gets a control byte, like the Python script writes
+    if (size == 0)
+        return vector<uint8_t>(1, 0);
+
+    const PresetSettings& settings = GetSettings(preset);
+    int numBands = (int)((size + BandSize - 1) / BandSize);
+    vector<vector<Token>> bandTokens(numBands);
+    ParallelFor(numBands, numThreads, [&]()
+    {
+        return [&, matcher = GeLzMatcher(settings)](int index) mutable
+        {
+            size_t start = (size_t)index * BandSize;
+            ParseBand(matcher, pData, start, min(start + BandSize, size), bandTokens[index]);
+        };
+    });
+
+    // Every control byte covers the next 8 tokens, whichever band they came from
+    vector<uint8_t> output;
+    output.reserve(size / 2 + 64);
+    size_t controlPosition = 0;
+    int numInGroup = 8;
+    size_t position = 0;
+    for (const vector<Token>& tokens : bandTokens)
+    {
+        for (const Token& token : tokens)
+        {
+            if (numInGroup == 8)
+            {
+                controlPosition = output.size();
+                output.push_back(0);
+                numInGroup = 0;
+            }
+
+            if (token.Offset == 0)
+            {
+                output.push_back((uint8_t)token.Length);
+                output.insert(output.end(), pData + position, pData + position + token.Length);
+            }
+            else
+            {
+                output[controlPosition] |= (uint8_t)(1 << numInGroup);
+                size_t count = token.Length - MinMatch;
+                uint8_t word[2];
+                if (token.Length <= MaxShortMatch)
+                {
+                    Write16(word, (uint16_t)(token.Offset << 4 | 8 | count));
+                    output.insert(output.end(), word, word + 2);
+                }
+                else
+                {
+                    Write16(word, (uint16_t)(token.Offset << 4 | count >> 8));
+                    output.insert(output.end(), word, word + 2);
+                    output.push_back((uint8_t)count);
+                }
+            }
+            position += token.Length;
+            numInGroup++;
+        }
+    }
+    return output;
+}
+
+vector<uint8_t> PgdEncoder::EncodeType1(const PgdImage& image)
+{
+    size_t planeSize = (size_t)image.Width * image.Height;
+    vector<uint8_t> output(planeSize * 4);
+    uint8_t* pA = output.data();
+    uint8_t* pR = pA + planeSize;
+    uint8_t* pG = pR + planeSize;
+    uint8_t* pB = pG + planeSize;
+    const uint8_t* pSrc = image.Pixels.data();
+    for (size_t i = 0; i < planeSize; i++, pSrc += image.Channels)
+    {
+        pB[i] = pSrc[0];
+        pG[i] = pSrc[1];
+        pR[i] = pSrc[2];
+        pA[i] = image.Channels == 4 ? pSrc[3] : 0xFF;
+    }
+    return output;
+}
+
+vector<uint8_t> PgdEncoder::EncodeType2(const PgdImage& image, const uint8_t* pFillColor, int& width, int& height)
+{
+    // Odd sizes are padded to even by repeating the last row and column. The arithmetic follows
+    // ge2_encode_from_bgr() in single precision like its numpy version, so the output matches except for the odd
+    // value that lands exactly on a rounding boundary.
+    static const float Kb = 226 / 128.0f;
+    static const float Kr = 179 / 128.0f;
+    static const float KgU = -43 / 128.0f;
+    static const float KgV = -89 / 128.0f;
+
+    width = (image.Width + 1) & ~1;
+    height = (image.Height + 1) & ~1;
+    size_t planeSize = (size_t)width * height;
+    vector<float> b(planeSize);
+    vector<float> g(planeSize);
+    vector<float> r(planeSize);
+    vector<float> y(planeSize);
+    for (int row = 0; row < height; row++)
+    {
+        const uint8_t* pSrcRow = image.Pixels.data() + (size_t)min(row, image.Height - 1) * image.Width * image.Channels;
+        for (int column = 0; column < width; column++)
+        {
+            const uint8_t* pSrc = pSrcRow + (size_t)min(column, image.Width - 1) * image.Channels;
+            float color[3] = { (float)pSrc[0], (float)pSrc[1], (float)pSrc[2] };
+            if (image.Channels == 4)
+            {
+                // Blended with the fill color and truncated, as alpha_blend_with_color() does
+                float alpha = pSrc[3] / 255.0f;
+                for (int i = 0; i < 3; i++)
+                {
+                    color[i] = (float)(uint8_t)(color[i] * alpha + pFillColor[i] * (1.0f - alpha));
+                }
+            }
+
+            size_t index = (size_t)row * width + column;
+            b[index] = color[0];
+            g[index] = color[1];
+            r[index] = color[2];
+            y[index] = nearbyintf(0.114f * color[0] + 0.587f * color[1] + 0.299f * color[2]);
+        }
+    }
+
+    size_t blockPlaneSize = planeSize / 4;
+    vector<uint8_t> output(blockPlaneSize * 2 + planeSize);
+    uint8_t* pU = output.data();
+    uint8_t* pV = pU + blockPlaneSize;
+    uint8_t* pY = pV + blockPlaneSize;
+    for (int blockRow = 0; blockRow < height / 2; blockRow++)
+    {
+        for (int blockColumn = 0; blockColumn < width / 2; blockColumn++)
+        {
+            size_t indexes[4];
+            indexes[0] = (size_t)blockRow * 2 * width + blockColumn * 2;
+            indexes[1] = indexes[0] + 1;
+            indexes[2] = indexes[0] + width;
+            indexes[3] = indexes[2] + 1;
+
+            float uSum = 0;
+            float vSum = 0;
+            for (size_t index : indexes)
+            {
+                uSum += (b[index] - y[index]) / Kb;
+                vSum += (r[index] - y[index]) / Kr;
+            }
+            float u = uSum / 4;
+            float v = vSum / 4;
+
+            size_t block = (size_t)blockRow * (width / 2) + blockColumn;
+            pU[block] = (uint8_t)(int8_t)min(max(nearbyintf(u), -128.0f), 127.0f);
+            pV[block] = (uint8_t)(int8_t)min(max(nearbyintf(v), -128.0f), 127.0f);
+            for (size_t index : indexes)
+            {
+                float predictedG = y[index] + (KgU * u + KgV * v);
+                float value = y[index] + (g[index] - predictedG) * 0.25f;
+                pY[index] = (uint8_t)min(max(value, 0.0f), 255.0f);
+            }
+        }
+    }
+    return output;
+}
+
+// The difference of a row from its prediction, as PgdCodec::DecodeRows() reverses it: the prediction minus the
+// pixel. Only the above and average predictions use pAbove, which is all zeros for the first row.
+static void PredictRow(int mode, const uint8_t* pRow, const uint8_t* pAbove, size_t stride, int pixelSize,
+                       uint8_t* pOutput)
+{
+    if (mode == 2)
+    {
+        for (size_t i = 0; i < stride; i++)
+        {
+            pOutput[i] = (uint8_t)(pAbove[i] - pRow[i]);
+        }
+        return;
+    }
+
+    memcpy(pOutput, pRow, pixelSize);
+    if (mode == 1)
+    {
+        for (size_t i = pixelSize; i < stride; i++)
+        {
+            pOutput[i] = (uint8_t)(pRow[i - pixelSize] - pRow[i]);
+        }
+    }
+    else
+    {
+        for (size_t i = pixelSize; i < stride; i++)
+        {
+            pOutput[i] = (uint8_t)((pAbove[i] + pRow[i - pixelSize]) / 2 - pRow[i]);
+        }
+    }
+}
+
+// Estimates the compressed size of a row's differences, in sixteenths of a bit: zeros are free and other values
+// cost about as many bits as their magnitude takes. The LZ compressor doesn't code values by frequency, but small
+// differences repeat more often, which gives it more copies.
+static uint32_t EstimateRowCost(const uint8_t* pDiff, size_t stride)
+{
+    struct Table
+    {
+        uint16_t Costs[256];
+
+        Table()
+        {
+            for (int value = 0; value < 256; value++)
+            {
+                int magnitude = value < 128 ? value : 256 - value;
+                Costs[value] = magnitude == 0 ? 0 : (uint16_t)(16 + 16 * log2(magnitude + 1.0));
+            }
+        }
+    };
+    static const Table table;
+
+    uint32_t cost = 0;
+    for (size_t i = 0; i < stride; i++)
+    {
+        cost += table.Costs[pDiff[i]];
+    }
+    return cost;
+}
+
+vector<uint8_t> PgdEncoder::SelectRowModes(const uint8_t* pPixels, int width, int height, int pixelSize,
+                                           int numThreads)
+{
+    // The cost of each row with each prediction; rows only depend on the original pixels, so bands of rows are
+    // estimated on separate threads
+    static const int Modes[3] = { 1, 2, 0 };
+    size_t stride = (size_t)width * pixelSize;
+    vector<uint32_t> costs((size_t)height * 3);
+    int rowsPerBand = max(1, (int)(BandSize / max<size_t>(stride, 1)));
+    int numBands = (height + rowsPerBand - 1) / rowsPerBand;
+    ParallelFor(numBands, numThreads, [&]()
+    {
+        return [&, diff = vector<uint8_t>(stride), zeros = vector<uint8_t>(stride)](int band) mutable
+        {
+            for (int y = band * rowsPerBand; y < min(height, (band + 1) * rowsPerBand); y++)
+            {
+                const uint8_t* pRow = pPixels + y * stride;
+                const uint8_t* pAbove = y == 0 ? zeros.data() : pRow - stride;
+                for (int i = 0; i < 3; i++)
+                {
+                    PredictRow(Modes[i], pRow, pAbove, stride, pixelSize, diff.data());
+                    costs[(size_t)y * 3 + i] = EstimateRowCost(diff.data(), stride);
+                }
+            }
+        };
+    });
+
+    // Dynamic programming over the rows: switching prediction between rows costs a little extra, since rows
+    // predicted the same way tend to give differences the compressor can copy from the row before
+    static const uint32_t SwitchCost = 1024;
+    vector<uint8_t> choices((size_t)height * 3);
+    uint64_t totals[3] = {};
+    for (int y = 0; y < height; y++)
+    {
+        uint64_t newTotals[3];
+        for (int i = 0; i < 3; i++)
+        {
+            int best = i;
+            for (int previous = 0; previous < 3; previous++)
+            {
+                if (totals[previous] + (previous == i ? 0 : SwitchCost) < totals[best] + (best == i ? 0 : SwitchCost))
+                    best = previous;
+            }
+            choices[(size_t)y * 3 + i] = (uint8_t)best;
+            newTotals[i] = totals[best] + (best == i ? 0 : SwitchCost) + costs[(size_t)y * 3 + i];
+        }
+        memcpy(totals, newTotals, sizeof(totals));
+    }
+
+    vector<uint8_t> modes(height);
+    int mode = (int)(min_element(totals, totals + 3) - totals);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        modes[y] = (uint8_t)Modes[mode];
+        mode = choices[(size_t)y * 3 + mode];
+    }
+    return modes;
+}
+
+vector<uint8_t> PgdEncoder::EncodeType3(const PgdImage& image, int numThreads)
+{
+    int pixelSize = image.Channels;
+    size_t stride = (size_t)image.Width * pixelSize;
+    vector<uint8_t> modes = SelectRowModes(image.Pixels.data(), image.Width, image.Height, pixelSize, numThreads);
+
+    // Header (7, bits per pixel, width, height), the control bytes, then the rows
+    vector<uint8_t> output(8 + image.Height + stride * image.Height);
+    Write16(output.data(), 7);
+    Write16(output.data() + 2, (uint16_t)(pixelSize * 8));
+    Write16(output.data() + 4, (uint16_t)image.Width);
+    Write16(output.data() + 6, (uint16_t)image.Height);
+    memcpy(output.data() + 8, modes.data(), image.Height);
+
+    uint8_t* pRows = output.data() + 8 + image.Height;
+    int rowsPerBand = max(1, (int)(BandSize / max<size_t>(stride, 1)));
+    int numBands = (image.Height + rowsPerBand - 1) / rowsPerBand;
+    ParallelFor(numBands, numThreads, [&]()
+    {
+        return [&, zeros = vector<uint8_t>(stride)](int band)
+        {
+            for (int y = band * rowsPerBand; y < min(image.Height, (band + 1) * rowsPerBand); y++)
+            {
+                const uint8_t* pRow = image.Pixels.data() + y * stride;
+                const uint8_t* pAbove = y == 0 ? zeros.data() : pRow - stride;
+                PredictRow(modes[y], pRow, pAbove, stride, pixelSize, pRows + y * stride);
+            }
+        };
+    });
+    return output;
+}
+
+bool PgdEncoder::Encode(const PgdImage& image, const PgdEncodeOptions& options, vector<uint8_t>& output,
+                        string& error)
+{
+    if (image.Width <= 0 || image.Height <= 0 || (image.Channels != 3 && image.Channels != 4) ||
+        image.Pixels.size() != (size_t)image.Width * image.Height * image.Channels)
+    {
+        error = "invalid picture";
+        return false;
+    }
+
+    // Type 3 stores the size in 16 bits
+    if (options.Method == 3 && (image.Width > 0xFFFF || image.Height > 0xFFFF))
+    {
+        error = "the picture is too big for compression type 3";
+        return false;
+    }
+
+    int width = image.Width;
+    int height = image.Height;
+    vector<uint8_t> unpacked;
+    switch (options.Method)
+    {
+    case 1:
+        unpacked = EncodeType1(image);
+        break;
+
+    case 2:
+        unpacked = EncodeType2(image, options.FillColor, width, height);
+        break;
+
+    case 3:
+        unpacked = EncodeType3(image, options.NumThreads);
+        break;
+
+    default:
+        error = "unsupported GE compression type " + to_string(options.Method);
+        return false;
+    }
+
+    vector<uint8_t> packed = CompressGeLz(unpacked.data(), unpacked.size(), options.Preset, options.NumThreads);
+
+    // The header: "GE", header size, x and y, width and height, original width and height, compression type and
+    // an unknown field, then the unpacked and packed sizes
+    output.assign(0x28, 0);
+    memcpy(output.data(), "GE", 2);
+    Write16(output.data() + 2, 0x20);
+    Write32(output.data() + 4, (uint32_t)image.OffsetX);
+    Write32(output.data() + 8, (uint32_t)image.OffsetY);
+    Write32(output.data() + 0xC, (uint32_t)width);
+    Write32(output.data() + 0x10, (uint32_t)height);
+    Write32(output.data() + 0x14, (uint32_t)width);
+    Write32(output.data() + 0x18, (uint32_t)height);
+    if (options.pTemplate != nullptr)
+    {
+        memcpy(output.data() + 4, options.pTemplate + 4, 8);
+        memcpy(output.data() + 0x14, options.pTemplate + 0x14, 8);
+        memcpy(output.data() + 0x1E, options.pTemplate + 0x1E, 2);
+    }
+    Write16(output.data() + 0x1C, (uint16_t)options.Method);
+    Write32(output.data() + 0x20, (uint32_t)unpacked.size());
+    Write32(output.data() + 0x24, (uint32_t)packed.size());
+    output.insert(output.end(), packed.begin(), packed.end());
+    return true;
+}
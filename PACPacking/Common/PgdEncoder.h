@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PgdCodec.h"
+
+enum class PgdPreset
+{
+    Fast,
+    Normal,
+    Max
+};
+
+struct PgdEncodeOptions
+{
+    int                     Method = 3;                 // GE compression type 1, 2 or 3
+    PgdPreset               Preset = PgdPreset::Normal;
+    uint8_t                 FillColor[3] = { 255, 255, 255 };     // BGR that type 2 blends transparent pixels with
+    int                     NumThreads = 1;             // For the bands of one picture
+    const uint8_t*          pTemplate = nullptr;        // An existing GE file whose position, original size and
+                                                        // unknown field the new header keeps
+};
+
+// Encoder for GE pictures, the counterpart of PgdCodec::Decode and a native replacement for png2pgd_ge.py.
+// Types 1 and 2 are laid out like the Python script does; type 3 picks the prediction of each row (left, above
+// or their average) by an estimate of how well its differences compress, where the script always predicts from the
+// left. The GE-LZ compressor finds matches through hash chains; bigger pictures are cut into bands that are
+// searched on separate threads, each one able to refer back into the band before it, so the output doesn't depend
+// on the number of threads.
+class PgdEncoder
+{
+public:
+    // Encodes BGR or BGRA pixels to a complete GE file
+    static bool Encode(const PgdImage& image, const PgdEncodeOptions& options, std::vector<uint8_t>& output,
+                       std::string& error);
+
+    static std::vector<uint8_t> CompressGeLz(const uint8_t* pData, size_t size, PgdPreset preset, int numThreads);
+
+    // The unpacked data for each type, before compression
+    static std::vector<uint8_t> EncodeType1(const PgdImage& image);
+    static std::vector<uint8_t> EncodeType2(const PgdImage& image, const uint8_t* pFillColor, int& width, int& height);
+    static std::vector<uint8_t> EncodeType3(const PgdImage& image, int numThreads);
+
+    // The control byte of each row for type 3 (1 = left, 2 = above, 0 = average)
+    static std::vector<uint8_t> SelectRowModes(const uint8_t* pPixels, int width, int height, int pixelSize,
+                                               int numThreads);
+};
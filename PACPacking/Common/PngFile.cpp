@@ -0,0 +1,415 @@
+#include "PngFile.h"
+#include "Zlib.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+static const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static void WriteBigEndian32(vector<uint8_t>& output, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        output.push_back((uint8_t)(value >> shift));
+    }
+}
+
+static void WriteChunk(vector<uint8_t>& output, const char* pType, const uint8_t* pData, size_t size)
+{
+    WriteBigEndian32(output, (uint32_t)size);
+    size_t start = output.size();
+    output.insert(output.end(), pType, pType + 4);
+    output.insert(output.end(), pData, pData + size);
+    WriteBigEndian32(output, Zlib::Crc32(output.data() + start, size + 4));
+}
+
+static uint8_t Paeth(uint8_t left, uint8_t above, uint8_t aboveLeft)
+{
+    int estimate = left + above - aboveLeft;
+    int leftDistance = abs(estimate - left);
+    int aboveDistance = abs(estimate - above);
+    int aboveLeftDistance = abs(estimate - aboveLeft);
+    if (leftDistance <= aboveDistance && leftDistance <= aboveLeftDistance)
+        return left;
+
+    return aboveDistance <= aboveLeftDistance ? above : aboveLeft;
+}
+
+// Applies PNG filter type 0-4 to a row; pAbove is all zeros for the first row
+static void FilterRow(int type, const uint8_t* pRow, const uint8_t* pAbove, size_t size, int pixelSize, uint8_t* pOutput)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t left = i >= (size_t)pixelSize ? pRow[i - pixelSize] : 0;
+        uint8_t aboveLeft = i >= (size_t)pixelSize ? pAbove[i - pixelSize] : 0;
+        uint8_t prediction;
+        switch (type)
+        {
+        case 1:  prediction = left; break;
+        case 2:  prediction = pAbove[i]; break;
+        case 3:  prediction = (uint8_t)((left + pAbove[i]) / 2); break;
+        case 4:  prediction = Paeth(left, pAbove[i], aboveLeft); break;
+        default: prediction = 0; break;
+        }
+        pOutput[i] = (uint8_t)(pRow[i] - prediction);
+    }
+}
+
+vector<uint8_t> PngFile::Encode(const uint8_t* pPixels, int width, int height, int channels, int level)
+{
+    // PNG stores RGB(A); the filtered rows start with their filter type
+    size_t stride = (size_t)width * channels;
+    vector<uint8_t> row(stride);
+    vector<uint8_t> above(stride);
+    vector<uint8_t> candidate(stride);
+    vector<uint8_t> filtered;
+    filtered.reserve((stride + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* pSrc = pPixels + y * stride;
+        for (size_t i = 0; i < stride; i += channels)
+        {
+            row[i + 0] = pSrc[i + 2];
+            row[i + 1] = pSrc[i + 1];
+            row[i + 2] = pSrc[i + 0];
+            if (channels == 4)
+                row[i + 3] = pSrc[i + 3];
+        }
+
+        int bestType = 0;
+        uint64_t bestSum = UINT64_MAX;
+        for (int type = 0; type < 5; type++)
+        {
+            FilterRow(type, row.data(), above.data(), stride, channels, candidate.data());
+            uint64_t sum = 0;
+            for (uint8_t value : candidate)
+            {
+                sum += value < 128 ? value : 256 - value;
+            }
+            if (sum < bestSum)
+            {
+                bestSum = sum;
+                bestType = type;
+            }
+        }
+
+        filtered.push_back((uint8_t)bestType);
+        size_t start = filtered.size();
+        filtered.resize(start + stride);
+        FilterRow(bestType, row.data(), above.data(), stride, channels, filtered.data() + start);
+        swap(row, above);
+    }
+
+    // Bit depth 8, color type 6 (RGBA) or 2 (RGB), default compression and filtering, no interlacing
+    vector<uint8_t> header;
+    WriteBigEndian32(header, (uint32_t)width);
+    WriteBigEndian32(header, (uint32_t)height);
+    header.insert(header.end(), { 8, (uint8_t)(channels == 4 ? 6 : 2), 0, 0, 0 });
+
+    vector<uint8_t> compressed = Zlib::Compress(filtered.data(), filtered.size(), level);
+    vector<uint8_t> output(Signature, Signature + sizeof(Signature));
+    WriteChunk(output, "IHDR", header.data(), header.size());
+    WriteChunk(output, "IDAT", compressed.data(), compressed.size());
+    WriteChunk(output, "IEND", nullptr, 0);
+    return output;
+}
+
+static uint32_t ReadBigEndian32(const uint8_t* p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+// Reverses FilterRow in place; pAbove is all zeros for the first row of each pass
+static bool UnfilterRow(int type, uint8_t* pRow, const uint8_t* pAbove, size_t size, int pixelSize)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t left = i >= (size_t)pixelSize ? pRow[i - pixelSize] : 0;
+        uint8_t aboveLeft = i >= (size_t)pixelSize ? pAbove[i - pixelSize] : 0;
+        switch (type)
+        {
+        case 0:  break;
+        case 1:  pRow[i] += left; break;
+        case 2:  pRow[i] += pAbove[i]; break;
+        case 3:  pRow[i] += (uint8_t)((left + pAbove[i]) / 2); break;
+        case 4:  pRow[i] += Paeth(left, pAbove[i], aboveLeft); break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+// Where the seven passes of Adam7 interlacing start and how far apart their pixels are; non-interlaced images
+// are a single pass that covers everything
+struct Pass
+{
+    int StartX;
+    int StartY;
+    int StepX;
+    int StepY;
+};
+static const Pass Adam7Passes[7] =
+{
+    { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+static const Pass SinglePass = { 0, 0, 1, 1 };
+
+bool PngFile::Decode(const uint8_t* pData, size_t size, int& width, int& height, int& channels,
+                     vector<uint8_t>& pixels, string& error)
+{
+    if (size < sizeof(Signature) || memcmp(pData, Signature, sizeof(Signature)) != 0)
+    {
+        error = "not a PNG file";
+        return false;
+    }
+
+    uint32_t pngWidth = 0;
+    uint32_t pngHeight = 0;
+    int bitDepth = 0;
+    int colorType = -1;
+    int interlace = 0;
+    uint8_t palette[256][4] = {};
+    int paletteSize = 0;
+    bool haveTransparency = false;
+    uint16_t transparentColor[3] = {};
+    vector<uint8_t> compressed;
+    bool ended = false;
+    for (size_t position = sizeof(Signature); !ended; )
+    {
+        if (size - position < 12 || ReadBigEndian32(pData + position) > size - position - 12)
+        {
+            error = "the file is truncated";
+            return false;
+        }
+
+        size_t length = ReadBigEndian32(pData + position);
+        const uint8_t* pType = pData + position + 4;
+        const uint8_t* pChunk = pType + 4;
+        if (ReadBigEndian32(pChunk + length) != Zlib::Crc32(pType, length + 4))
+        {
+            error = "bad checksum in the " + string((const char*)pType, 4) + " chunk";
+            return false;
+        }
+        position += length + 12;
+
+        if (memcmp(pType, "IHDR", 4) == 0 && length >= 13)
+        {
+            pngWidth = ReadBigEndian32(pChunk);
+            pngHeight = ReadBigEndian32(pChunk + 4);
+            bitDepth = pChunk[8];
+            colorType = pChunk[9];
+            interlace = pChunk[12];
+            if (pChunk[10] != 0 || pChunk[11] != 0 || interlace > 1)
+            {
+                error = "unsupported compression, filter or interlace method";
+                return false;
+            }
+        }
+        else if (memcmp(pType, "PLTE", 4) == 0)
+        {
+            paletteSize = (int)min<size_t>(length / 3, 256);
+            for (int i = 0; i < paletteSize; i++)
+            {
+                palette[i][0] = pChunk[i * 3 + 2];
+                palette[i][1] = pChunk[i * 3 + 1];
+                palette[i][2] = pChunk[i * 3];
+                palette[i][3] = 0xFF;
+            }
+        }
+        else if (memcmp(pType, "tRNS", 4) == 0)
+        {
+            haveTransparency = true;
+            if (colorType == 3)
+            {
+                for (size_t i = 0; i < length && i < 256; i++)
+                {
+                    palette[i][3] = pChunk[i];
+                }
+            }
+            else if (colorType == 0 && length >= 2)
+            {
+                transparentColor[0] = (uint16_t)(pChunk[0] << 8 | pChunk[1]);
+            }
+            else if (colorType == 2 && length >= 6)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    transparentColor[i] = (uint16_t)(pChunk[i * 2] << 8 | pChunk[i * 2 + 1]);
+                }
+            }
+            else
+            {
+                haveTransparency = false;
+            }
+        }
+        else if (memcmp(pType, "IDAT", 4) == 0)
+        {
+            compressed.insert(compressed.end(), pChunk, pChunk + length);
+        }
+        else if (memcmp(pType, "IEND", 4) == 0)
+        {
+            ended = true;
+        }
+    }
+
+    // Samples per pixel by color type: gray, -, RGB, palette index, gray and alpha, -, RGBA
+    static const int SampleCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    bool validDepth;
+    switch (colorType)
+    {
+    case 0:  validDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16; break;
+    case 3:  validDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8; break;
+    case 2:
+    case 4:
+    case 6:  validDepth = bitDepth == 8 || bitDepth == 16; break;
+    default: validDepth = false; break;
+    }
+    if (!validDepth || pngWidth == 0 || pngHeight == 0 || pngWidth > 0x100000 || pngHeight > 0x100000 ||
+        (uint64_t)pngWidth * pngHeight > 0x10000000 || (colorType == 3 && paletteSize == 0))
+    {
+        error = "unsupported or invalid image header";
+        return false;
+    }
+
+    int numSamples = SampleCounts[colorType];
+    int bitsPerPixel = numSamples * bitDepth;
+    int filterPixelSize = max(1, bitsPerPixel / 8);
+    int numPasses = interlace ? 7 : 1;
+    const Pass* pPasses = interlace ? Adam7Passes : &SinglePass;
+
+    // The filtered rows of all passes follow each other; a pass can be empty for small images
+    auto getPassSize = [&](const Pass& pass, uint32_t& passWidth, uint32_t& passHeight)
+    {
+        passWidth = pngWidth > (uint32_t)pass.StartX ? (pngWidth - pass.StartX + pass.StepX - 1) / pass.StepX : 0;
+        passHeight = pngHeight > (uint32_t)pass.StartY ? (pngHeight - pass.StartY + pass.StepY - 1) / pass.StepY : 0;
+    };
+    size_t rawSize = 0;
+    for (int i = 0; i < numPasses; i++)
+    {
+        uint32_t passWidth;
+        uint32_t passHeight;
+        getPassSize(pPasses[i], passWidth, passHeight);
+        if (passWidth != 0 && passHeight != 0)
+            rawSize += (1 + ((size_t)passWidth * bitsPerPixel + 7) / 8) * passHeight;
+    }
+
+    vector<uint8_t> raw;
+    raw.reserve(rawSize);
+    if (!Zlib::Decompress(compressed.data(), compressed.size(), raw, rawSize) || raw.size() != rawSize)
+    {
+        error = "corrupt image data";
+        return false;
+    }
+
+    width = (int)pngWidth;
+    height = (int)pngHeight;
+    channels = colorType == 4 || colorType == 6 || haveTransparency ? 4 : 3;
+    pixels.assign((size_t)width * height * channels, 0);
+
+    uint8_t* pRaw = raw.data();
+    for (int passIndex = 0; passIndex < numPasses; passIndex++)
+    {
+        const Pass& pass = pPasses[passIndex];
+        uint32_t passWidth;
+        uint32_t passHeight;
+        getPassSize(pass, passWidth, passHeight);
+        if (passWidth == 0 || passHeight == 0)
+            continue;
+
+        size_t stride = ((size_t)passWidth * bitsPerPixel + 7) / 8;
+        vector<uint8_t> zeros(stride);
+        const uint8_t* pAbove = zeros.data();
+        for (uint32_t row = 0; row < passHeight; row++)
+        {
+            uint8_t* pRow = pRaw + 1;
+            if (!UnfilterRow(pRaw[0], pRow, pAbove, stride, filterPixelSize))
+            {
+                error = "bad filter type";
+                return false;
+            }
+            pAbove = pRow;
+            pRaw += stride + 1;
+
+            uint8_t* pDst = pixels.data() + ((size_t)(pass.StartY + row * pass.StepY) * width + pass.StartX) * channels;
+            size_t dstStep = (size_t)pass.StepX * channels;
+
+            // The common case, 8-bit RGB(A) without a tRNS chunk, skips the general sample reading
+            if (bitDepth == 8 && (colorType == 6 || (colorType == 2 && channels == 3)))
+            {
+                for (uint32_t x = 0; x < passWidth; x++, pRow += numSamples, pDst += dstStep)
+                {
+                    pDst[0] = pRow[2];
+                    pDst[1] = pRow[1];
+                    pDst[2] = pRow[0];
+                    if (channels == 4)
+                        pDst[3] = colorType == 6 ? pRow[3] : 0xFF;
+                }
+                continue;
+            }
+
+            for (uint32_t x = 0; x < passWidth; x++, pDst += dstStep)
+            {
+                uint16_t samples[4];
+                for (int i = 0; i < numSamples; i++)
+                {
+                    size_t index = (size_t)x * numSamples + i;
+                    if (bitDepth == 16)
+                        samples[i] = (uint16_t)(pRow[index * 2] << 8 | pRow[index * 2 + 1]);
+                    else if (bitDepth == 8)
+                        samples[i] = pRow[index];
+                    else
+                        samples[i] = (pRow[index * bitDepth / 8] >> (8 - bitDepth - index * bitDepth % 8)) & ((1 << bitDepth) - 1);
+                }
+
+                // Gray values below 8 bits are scaled up to the full range
+                auto toByte = [&](uint16_t sample) -> uint8_t
+                {
+                    return bitDepth == 16 ? (uint8_t)(sample >> 8) : (uint8_t)(sample * 255 / ((1 << bitDepth) - 1));
+                };
+                uint8_t alpha = 0xFF;
+                switch (colorType)
+                {
+                case 0:
+                    pDst[0] = pDst[1] = pDst[2] = toByte(samples[0]);
+                    alpha = haveTransparency && samples[0] == transparentColor[0] ? 0 : 0xFF;
+                    break;
+
+                case 2:
+                    pDst[0] = toByte(samples[2]);
+                    pDst[1] = toByte(samples[1]);
+                    pDst[2] = toByte(samples[0]);
+                    alpha = haveTransparency && samples[0] == transparentColor[0] && samples[1] == transparentColor[1] &&
+                            samples[2] == transparentColor[2] ? 0 : 0xFF;
+                    break;
+
+                case 3:
+                    // Indexes past the end of the palette are black, as libpng makes them
+                    if (samples[0] < paletteSize)
+                    {
+                        memcpy(pDst, palette[samples[0]], 3);
+                        alpha = palette[samples[0]][3];
+                    }
+                    break;
+
+                case 4:
+                    pDst[0] = pDst[1] = pDst[2] = toByte(samples[0]);
+                    alpha = toByte(samples[1]);
+                    break;
+
+                case 6:
+                    pDst[0] = toByte(samples[2]);
+                    pDst[1] = toByte(samples[1]);
+                    pDst[2] = toByte(samples[0]);
+                    alpha = toByte(samples[3]);
+                    break;
+                }
+                if (channels == 4)
+                    pDst[3] = alpha;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// PNG files for the PGD tools: 8-bit truecolor, with or without alpha, which covers everything PGD holds. Other PNG
+// formats can be read and are converted to that.
+class PngFile
+{
+public:
+    // Encodes BGR (3 channels) or BGRA (4 channels) pixels, rows without padding. Each row gets the filter
+    // with the smallest sum of absolute differences, like libpng's default heuristic. Level is zlib's 1 to 9.
+    static std::vector<uint8_t> Encode(const uint8_t* pPixels, int width, int height, int channels, int level = 6);
+
+    // Decodes any standard PNG (all color types and bit depths, interlaced or not) to BGR or BGRA, like OpenCV's
+    // imread does for the Python scripts: BGRA if the file has an alpha channel or transparency (tRNS), BGR
+    // otherwise, gray copied to all three colors and 16-bit samples cut to their high byte
+    static bool Decode(const uint8_t* pData, size_t size, int& width, int& height, int& channels,
+                       std::vector<uint8_t>& pixels, std::string& error);
+};
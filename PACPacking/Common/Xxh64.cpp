@@ -0,0 +1,134 @@
+#include "Xxh64.h"
+
+#include <cstring>
+
+static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87;
+static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4F;
+static constexpr uint64_t Prime3 = 0x165667B19E3779F9;
+static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63;
+static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5;
+
+static uint64_t RotateLeft(uint64_t value, int count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+static uint64_t Read64(const uint8_t* p)
+{
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return value;
+}
+
+static uint32_t Read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+static uint64_t Round(uint64_t acc, uint64_t input)
+{
+    acc += input * Prime2;
+    acc = RotateLeft(acc, 31);
+    return acc * Prime1;
+}
+
+static uint64_t Merge(uint64_t acc, uint64_t value)
+{
+    acc ^= Round(0, value);
+    return acc * Prime1 + Prime4;
+}
+
+Xxh64::Xxh64()
+    : _acc{ Prime1 + Prime2, Prime2, 0, 0 - Prime1 }, _buffer{}, _buffered(0), _totalSize(0)
+{
+}
+
+void Xxh64::Update(const void* pData, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)pData;
+    _totalSize += size;
+
+    if (_buffered != 0)
+    {
+        size_t count = size < 32 - _buffered ? size : 32 - _buffered;
+        memcpy(_buffer + _buffered, p, count);
+        _buffered += count;
+        p += count;
+        size -= count;
+        if (_buffered < 32)
+            return;
+
+        for (int i = 0; i < 4; i++)
+        {
+            _acc[i] = Round(_acc[i], Read64(_buffer + 8 * i));
+        }
+        _buffered = 0;
+    }
+
+    for (; size >= 32; p += 32, size -= 32)
+    {
+        _acc[0] = Round(_acc[0], Read64(p));
+        _acc[1] = Round(_acc[1], Read64(p + 8));
+        _acc[2] = Round(_acc[2], Read64(p + 16));
+        _acc[3] = Round(_acc[3], Read64(p + 24));
+    }
+
+    if (size != 0)
+        memcpy(_buffer, p, size);
+
+    _buffered = size;
+}
+
+uint64_t Xxh64::Final() const
+{
+    uint64_t hash;
+    if (_totalSize >= 32)
+    {
+        hash = RotateLeft(_acc[0], 1) + RotateLeft(_acc[1], 7) + RotateLeft(_acc[2], 12) + RotateLeft(_acc[3], 18);
+        for (int i = 0; i < 4; i++)
+        {
+            hash = Merge(hash, _acc[i]);
+        }
+    }
+    else
+    {
+        hash = _acc[2] + Prime5;
+    }
+    hash += _totalSize;
+
+    const uint8_t* p = _buffer;
+    size_t size = _buffered;
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+    }
+    if (size >= 4)
+    {
+        hash ^= Read32(p) * Prime1;
+        hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+        p += 4;
+        size -= 4;
+    }
+    for (; size != 0; p++, size--)
+    {
+        hash ^= *p * Prime5;
+        hash = RotateLeft(hash, 11) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t Xxh64::Hash(const void* pData, size_t size)
+{
+    Xxh64 hasher;
+    hasher.Update(pData, size);
+    return hasher.Final();
+}
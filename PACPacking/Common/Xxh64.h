@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Streaming XXH64 (seed 0), for checking PAC entries and files written by the PAC tools.
+// Feeding data in pieces of any size gives the same result as hashing it in one go.
+class Xxh64
+{
+public:
+    Xxh64();
+
+    void Update(const void* pData, size_t size);
+    uint64_t Final() const;
+
+    static uint64_t Hash(const void* pData, size_t size);
+
+private:
+    uint64_t _acc[4];
+    uint8_t _buffer[32];
+    size_t _buffered;
+    uint64_t _totalSize;
+};
@@ -0,0 +1,938 @@
+#include "Zlib.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static constexpr int64_t WindowSize = 32768;
+static constexpr size_t MinMatch = 3;
+static constexpr size_t MaxMatch = 258;
+static constexpr int HashBits = 15;
+static constexpr size_t BlockSymbols = 65536;
+
+static const uint16_t LengthBase[29] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LengthExtra[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DistanceBase[30] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+    6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DistanceExtra[30] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+namespace
+{
+    // Maps match lengths and distances to their codes
+    struct CodeTables
+    {
+        uint8_t LengthCodes[MaxMatch + 1];
+        uint8_t NearDistanceCodes[256];         // Distances 1 to 256
+        uint8_t FarDistanceCodes[256];          // By (distance - 1) >> 7
+
+        CodeTables()
+        {
+            for (int code = 0; code < 29; code++)
+            {
+                int end = min(LengthBase[code] + (1 << LengthExtra[code]), (int)MaxMatch + 1);
+                for (int length = LengthBase[code]; length < end; length++)
+                    LengthCodes[length] = (uint8_t)code;
+            }
+            for (int code = 0; code < 30; code++)
+            {
+                int end = DistanceBase[code] + (1 << DistanceExtra[code]);
+                for (int distance = DistanceBase[code]; distance < end; distance++)
+                {
+                    if (distance <= 256)
+                        NearDistanceCodes[distance - 1] = (uint8_t)code;
+                    else
+                        FarDistanceCodes[(distance - 1) >> 7] = (uint8_t)code;
+                }
+            }
+        }
+
+        int GetDistanceCode(int distance) const
+        {
+            return distance <= 256 ? NearDistanceCodes[distance - 1] : FarDistanceCodes[(distance - 1) >> 7];
+        }
+    };
+
+    const CodeTables Tables;
+
+    class BitWriter
+    {
+    public:
+        BitWriter(vector<uint8_t>& output)
+            : _output(output)
+        {
+        }
+
+        void Write(uint32_t bits, int count)
+        {
+            _buffer |= (uint64_t)bits << _count;
+            _count += count;
+            for (; _count >= 8; _count -= 8)
+            {
+                _output.push_back((uint8_t)_buffer);
+                _buffer >>= 8;
+            }
+        }
+
+        void Flush()
+        {
+            if (_count > 0)
+                _output.push_back((uint8_t)_buffer);
+
+            _buffer = 0;
+            _count = 0;
+        }
+
+    private:
+        vector<uint8_t>& _output;
+        uint64_t _buffer = 0;
+        int _count = 0;
+    };
+
+    // A length-limited canonical Huffman code, with the codes bit-reversed since deflate sends them high bit first
+    struct HuffmanCode
+    {
+        vector<uint8_t> Lengths;
+        vector<uint16_t> Codes;
+
+        void Build(const uint32_t* pFrequencies, int count, int maxBits)
+        {
+            // At least two symbols get a code, so every symbol takes at least one bit (zlib does the same)
+            vector<uint32_t> frequencies(pFrequencies, pFrequencies + count);
+            int numUsed = (int)count_if(frequencies.begin(), frequencies.end(),
+                                        [](uint32_t frequency) { return frequency != 0; });
+            for (int i = 0; numUsed < 2 && i < count; i++)
+            {
+                if (frequencies[i] == 0)
+                {
+                    frequencies[i] = 1;
+                    numUsed++;
+                }
+            }
+
+            vector<int> symbols;
+            for (int i = 0; i < count; i++)
+            {
+                if (frequencies[i] != 0)
+                    symbols.push_back(i);
+            }
+            stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) { return frequencies[a] < frequencies[b]; });
+
+            // Two-queue Huffman construction: leaves are 0 to n-1 in order of frequency, internal nodes follow
+            // and are created in order of weight too
+            int n = (int)symbols.size();
+            vector<uint64_t> weights(n * 2 - 1);
+            vector<int> parents(n * 2 - 1);
+            for (int i = 0; i < n; i++)
+            {
+                weights[i] = frequencies[symbols[i]];
+            }
+
+            int nextLeaf = 0;
+            int nextInternal = n;
+            for (int node = n; node < n * 2 - 1; node++)
+            {
+                int children[2];
+                for (int& child : children)
+                {
+                    if (nextLeaf < n && (nextInternal == node || weights[nextLeaf] <= weights[nextInternal]))
+                        child = nextLeaf++;
+                    else
+                        child = nextInternal++;
+                }
+                weights[node] = weights[children[0]] + weights[children[1]];
+                parents[children[0]] = node;
+                parents[children[1]] = node;
+            }
+
+            vector<int> depths(n * 2 - 1);
+            vector<int> lengthCounts(maxBits + 1);
+            for (int node = n * 2 - 3; node >= 0; node--)
+            {
+                depths[node] = depths[parents[node]] + 1;
+                if (node < n)
+                    lengthCounts[min(depths[node], maxBits)]++;
+            }
+
+            // Moving the leaves that were too deep up to maxBits oversubscribes the code; lengthen other codes until
+            // it's complete again
+            int64_t total = 0;
+            for (int length = 1; length <= maxBits; length++)
+            {
+                total += (int64_t)lengthCounts[length] << (maxBits - length);
+            }
+            for (; total > (int64_t)1 << maxBits; total--)
+            {
+                lengthCounts[maxBits]--;
+                for (int length = maxBits - 1; length > 0; length--)
+                {
+                    if (lengthCounts[length] != 0)
+                    {
+                        lengthCounts[length]--;
+                        lengthCounts[length + 1] += 2;
+                        break;
+                    }
+                }
+            }
+
+            // The least frequent symbols get the longest codes
+            Lengths.assign(count, 0);
+            int index = 0;
+            for (int length = maxBits; length > 0; length--)
+            {
+                for (int i = 0; i < lengthCounts[length]; i++)
+                {
+                    Lengths[symbols[index++]] = (uint8_t)length;
+                }
+            }
+
+            vector<uint32_t> nextCodes(maxBits + 2);
+            for (int length = 1; length <= maxBits; length++)
+            {
+                nextCodes[length + 1] = (nextCodes[length] + lengthCounts[length]) << 1;
+            }
+
+            Codes.assign(count, 0);
+            for (int symbol = 0; symbol < count; symbol++)
+            {
+                int length = Lengths[symbol];
+                if (length == 0)
+                    continue;
+
+                uint32_t code = nextCodes[length]++;
+                uint32_t reversed = 0;
+                for (int bit = 0; bit < length; bit++)
+                {
+                    reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+                }
+                Codes[symbol] = (uint16_t)reversed;
+            }
+        }
+
+        void Write(BitWriter& writer, int symbol) const
+        {
+            writer.Write(Codes[symbol], Lengths[symbol]);
+        }
+    };
+
+    // A literal (Distance 0) or a match
+    struct Symbol
+    {
+        uint16_t LengthOrLiteral;
+        uint16_t Distance;
+    };
+}
+
+static void WriteBlock(BitWriter& writer, const vector<Symbol>& symbols, bool last)
+{
+    uint32_t literalFrequencies[286] = {};
+    uint32_t distanceFrequencies[30] = {};
+    for (const Symbol& symbol : symbols)
+    {
+        if (symbol.Distance == 0)
+        {
+            literalFrequencies[symbol.LengthOrLiteral]++;
+        }
+        else
+        {
+            literalFrequencies[257 + Tables.LengthCodes[symbol.LengthOrLiteral]]++;
+            distanceFrequencies[Tables.GetDistanceCode(symbol.Distance)]++;
+        }
+    }
+    literalFrequencies[256] = 1;
+
+    HuffmanCode literalCode;
+    HuffmanCode distanceCode;
+    literalCode.Build(literalFrequencies, 286, 15);
+    distanceCode.Build(distanceFrequencies, 30, 15);
+
+    int numLiteralCodes = 286;
+    while (numLiteralCodes > 257 && literalCode.Lengths[numLiteralCodes - 1] == 0)
+        numLiteralCodes--;
+
+    int numDistanceCodes = 30;
+    while (numDistanceCodes > 1 && distanceCode.Lengths[numDistanceCodes - 1] == 0)
+        numDistanceCodes--;
+
+    // Both code lengths tables, run-length coded: 16 repeats the previous length 3-6 times, 17 and 18 are
+    // runs of 3-10 and 11-138 zeros
+    vector<uint8_t> lengths(literalCode.Lengths.begin(), literalCode.Lengths.begin() + numLiteralCodes);
+    lengths.insert(lengths.end(), distanceCode.Lengths.begin(), distanceCode.Lengths.begin() + numDistanceCodes);
+
+    vector<pair<uint8_t, uint8_t>> lengthSymbols;
+    uint32_t lengthFrequencies[19] = {};
+    auto addLengthSymbol = [&](int symbol, int extra)
+    {
+        lengthSymbols.emplace_back((uint8_t)symbol, (uint8_t)extra);
+        lengthFrequencies[symbol]++;
+    };
+    for (size_t i = 0; i < lengths.size(); )
+    {
+        uint8_t value = lengths[i];
+        size_t run = 1;
+        while (i + run < lengths.size() && lengths[i + run] == value)
+            run++;
+
+        i += run;
+        if (value == 0)
+        {
+            while (run >= 11)
+            {
+                size_t count = min<size_t>(run, 138);
+                addLengthSymbol(18, (int)count - 11);
+                run -= count;
+            }
+            if (run >= 3)
+            {
+                addLengthSymbol(17, (int)run - 3);
+                run = 0;
+            }
+        }
+        else
+        {
+            addLengthSymbol(value, 0);
+            run--;
+            while (run >= 3)
+            {
+                size_t count = min<size_t>(run, 6);
+                addLengthSymbol(16, (int)count - 3);
+                run -= count;
+            }
+        }
+
+        for (; run > 0; run--)
+        {
+            addLengthSymbol(value, 0);
+        }
+    }
+
+    HuffmanCode lengthCode;
+    lengthCode.Build(lengthFrequencies, 19, 7);
+    int numLengthCodes = 19;
+    while (numLengthCodes > 4 && lengthCode.Lengths[CodeLengthOrder[numLengthCodes - 1]] == 0)
+        numLengthCodes--;
+
+    writer.Write(last ? 1 : 0, 1);
+    writer.Write(2, 2);
+    writer.Write(numLiteralCodes - 257, 5);
+    writer.Write(numDistanceCodes - 1, 5);
+    writer.Write(numLengthCodes - 4, 4);
+    for (int i = 0; i < numLengthCodes; i++)
+    {
+        writer.Write(lengthCode.Lengths[CodeLengthOrder[i]], 3);
+    }
+
+    static const int RepeatBits[3] = { 2, 3, 7 };
+    for (const auto& [symbol, extra] : lengthSymbols)
+    {
+        lengthCode.Write(writer, symbol);
+        if (symbol >= 16)
+            writer.Write(extra, RepeatBits[symbol - 16]);
+    }
+
+    for (const Symbol& symbol : symbols)
+    {
+        if (symbol.Distance == 0)
+        {
+            literalCode.Write(writer, symbol.LengthOrLiteral);
+            continue;
+        }
+
+        int lengthIndex = Tables.LengthCodes[symbol.LengthOrLiteral];
+        literalCode.Write(writer, 257 + lengthIndex);
+        writer.Write(symbol.LengthOrLiteral - LengthBase[lengthIndex], LengthExtra[lengthIndex]);
+
+        int distanceIndex = Tables.GetDistanceCode(symbol.Distance);
+        distanceCode.Write(writer, distanceIndex);
+        writer.Write(symbol.Distance - DistanceBase[distanceIndex], DistanceExtra[distanceIndex]);
+    }
+    literalCode.Write(writer, 256);
+}
+
+namespace
+{
+    struct Match
+    {
+        size_t Length = 0;
+        size_t Distance = 0;
+    };
+
+    // Finds earlier occurrences of the data at a position through chains of positions with the same 3-byte hash
+    class Matcher
+    {
+    public:
+        Matcher(const uint8_t* pData, size_t size, int maxChain, size_t niceLength)
+            : _pData(pData), _size(size), _maxChain(maxChain), _niceLength(niceLength),
+              _heads((size_t)1 << HashBits, -1), _previous(WindowSize, -1)
+        {
+        }
+
+        void Insert(size_t position)
+        {
+            if (position + MinMatch > _size)
+                return;
+
+            uint32_t hash = Hash(position);
+            _previous[position & (WindowSize - 1)] = _heads[hash];
+            _heads[hash] = (int64_t)position;
+        }
+
+        Match Find(size_t position) const
+        {
+            Match best;
+            if (position + MinMatch > _size)
+                return best;
+
+            const uint8_t* pCurrent = _pData + position;
+            size_t maxLength = min(MaxMatch, _size - position);
+            int64_t candidate = _heads[Hash(position)];
+            for (int chain = _maxChain; candidate >= 0 && chain > 0; chain--)
+            {
+                int64_t distance = (int64_t)position - candidate;
+                if (distance > WindowSize)
+                    break;
+
+                const uint8_t* pCandidate = _pData + candidate;
+                if (pCandidate[best.Length] == pCurrent[best.Length])
+                {
+                    size_t length = GetMatchLength(pCandidate, pCurrent, maxLength);
+                    if (length > best.Length)
+                    {
+                        best.Length = length;
+                        best.Distance = (size_t)distance;
+                        if (length >= _niceLength || length == maxLength)
+                            break;
+                    }
+                }
+
+                int64_t next = _previous[candidate & (WindowSize - 1)];
+                if (next >= candidate)
+                    break;
+
+                candidate = next;
+            }
+
+            // A 3-byte match far away usually costs more bits than the literals
+            if (best.Length < MinMatch || (best.Length == MinMatch && best.Distance > 4096))
+                return Match();
+
+            return best;
+        }
+
+    private:
+        uint32_t Hash(size_t position) const
+        {
+            const uint8_t* p = _pData + position;
+            uint32_t value = p[0] | p[1] << 8 | p[2] << 16;
+            return (value * 2654435761u) >> (32 - HashBits);
+        }
+
+        static size_t GetMatchLength(const uint8_t* pA, const uint8_t* pB, size_t maxLength)
+        {
+            size_t length = 0;
+            for (; length + 8 <= maxLength; length += 8)
+            {
+                uint64_t a;
+                uint64_t b;
+                memcpy(&a, pA + length, 8);
+                memcpy(&b, pB + length, 8);
+                if (a != b)
+                    break;
+            }
+            while (length < maxLength && pA[length] == pB[length])
+                length++;
+
+            return length;
+        }
+
+        const uint8_t* _pData;
+        size_t _size;
+        int _maxChain;
+        size_t _niceLength;
+        vector<int64_t> _heads;
+        vector<int64_t> _previous;
+    };
+}
+
+vector<uint8_t> Zlib::Compress(const uint8_t* pData, size_t size, int level)
+{
+    struct Settings
+    {
+        int MaxChain;
+        size_t NiceLength;
+        bool Lazy;
+    };
+    static const Settings LevelSettings[9] =
+    {
+        { 4, 16, false }, { 8, 32, false }, { 16, 32, false }, { 16, 64, true }, { 32, 128, true },
+        { 64, 128, true }, { 128, 258, true }, { 512, 258, true }, { 2048, 258, true }
+    };
+    const Settings& settings = LevelSettings[min(max(level, 1), 9) - 1];
+
+    vector<uint8_t> output = { 0x78, 0x9C };
+    BitWriter writer(output);
+    Matcher matcher(pData, size, settings.MaxChain, settings.NiceLength);
+    vector<Symbol> symbols;
+    symbols.reserve(BlockSymbols);
+
+    // With lazy matching, a match is put off by a byte if the next position has a longer one
+    Match pending;
+    bool havePending = false;
+    for (size_t position = 0; position < size; )
+    {
+        Match match = havePending ? pending : matcher.Find(position);
+        havePending = false;
+        matcher.Insert(position);
+        if (settings.Lazy && match.Length != 0 && match.Length < settings.NiceLength)
+        {
+            pending = matcher.Find(position + 1);
+            if (pending.Length > match.Length)
+            {
+                havePending = true;
+                match = Match();
+            }
+        }
+
+        if (match.Length != 0)
+        {
+            symbols.push_back({ (uint16_t)match.Length, (uint16_t)match.Distance });
+            for (size_t i = 1; i < match.Length; i++)
+            {
+                matcher.Insert(position + i);
+            }
+            position += match.Length;
+        }
+        else
+        {
+            symbols.push_back({ pData[position], 0 });
+            position++;
+        }
+
+        if (symbols.size() == BlockSymbols)
+        {
+            WriteBlock(writer, symbols, false);
+            symbols.clear();
+        }
+    }
+    WriteBlock(writer, symbols, true);
+    writer.Flush();
+
+    uint32_t adler = Adler32(pData, size);
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        output.push_back((uint8_t)(adler >> shift));
+    }
+    return output;
+}
+
+namespace
+{
+    // Reads the bits of a deflate stream, low bit first. Reading past the end gives zeros and sets the overrun flag.
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* pData, size_t size)
+            : _pData(pData), _pEnd(pData + size)
+        {
+        }
+
+        uint32_t Peek(int count)
+        {
+            if (_count < count)
+                Refill();
+
+            return (uint32_t)(_buffer & (((uint64_t)1 << count) - 1));
+        }
+
+        void Consume(int count)
+        {
+            if (_count < count)
+            {
+                Refill();
+                if (_count < count)
+                {
+                    _overrun = true;
+                    _count = count;
+                }
+            }
+            _buffer >>= count;
+            _count -= count;
+        }
+
+        uint32_t Read(int count)
+        {
+            uint32_t bits = Peek(count);
+            Consume(count);
+            return bits;
+        }
+
+        // For stored blocks: drops the bits up to the next byte and hands out the bytes that follow
+        const uint8_t* ReadAlignedBytes(size_t count)
+        {
+            Consume(_count & 7);
+            // Give back the whole bytes still in the buffer
+            _pData -= _count / 8;
+            _buffer = 0;
+            _count = 0;
+            if ((size_t)(_pEnd - _pData) < count)
+            {
+                _overrun = true;
+                return nullptr;
+            }
+
+            const uint8_t* pBytes = _pData;
+            _pData += count;
+            return pBytes;
+        }
+
+        bool Overrun() const
+        {
+            return _overrun;
+        }
+
+    private:
+        void Refill()
+        {
+            while (_count <= 56 && _pData != _pEnd)
+            {
+                _buffer |= (uint64_t)*_pData++ << _count;
+                _count += 8;
+            }
+        }
+
+        const uint8_t* _pData;
+        const uint8_t* _pEnd;
+        uint64_t _buffer = 0;
+        int _count = 0;
+        bool _overrun = false;
+    };
+
+    // Decodes the codes of a canonical Huffman code: a table for codes of up to FastBits bits, and a walk over the
+    // code lengths for longer ones
+    class HuffmanDecoder
+    {
+    public:
+        static constexpr int FastBits = 10;
+
+        bool Build(const uint8_t* pLengths, int count)
+        {
+            memset(_counts, 0, sizeof(_counts));
+            for (int symbol = 0; symbol < count; symbol++)
+            {
+                _counts[pLengths[symbol]]++;
+            }
+            _counts[0] = 0;
+
+            // An oversubscribed code can't be decoded; incomplete ones are allowed, as zlib does for single codes
+            int left = 1;
+            uint16_t offsets[16];
+            offsets[1] = 0;
+            for (int length = 1; length <= 15; length++)
+            {
+                left = (left << 1) - _counts[length];
+                if (left < 0)
+                    return false;
+
+                if (length < 15)
+                    offsets[length + 1] = offsets[length] + _counts[length];
+            }
+
+            for (int symbol = 0; symbol < count; symbol++)
+            {
+                if (pLengths[symbol] != 0)
+                    _symbols[offsets[pLengths[symbol]]++] = (uint16_t)symbol;
+            }
+
+            // Entries are symbol << 4 | length, or 0 where the code is longer than FastBits
+            memset(_fast, 0, sizeof(_fast));
+            uint32_t code = 0;
+            int index = 0;
+            for (int length = 1; length <= FastBits; length++)
+            {
+                for (int i = 0; i < _counts[length]; i++, index++, code++)
+                {
+                    uint32_t reversed = 0;
+                    for (int bit = 0; bit < length; bit++)
+                    {
+                        reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+                    }
+                    for (uint32_t entry = reversed; entry < (1u << FastBits); entry += 1u << length)
+                    {
+                        _fast[entry] = (uint16_t)(_symbols[index] << 4 | length);
+                    }
+                }
+                code <<= 1;
+            }
+            return true;
+        }
+
+        // Returns -1 for bits that aren't a code
+        int Decode(BitReader& reader) const
+        {
+            uint16_t entry = _fast[reader.Peek(FastBits)];
+            if (entry != 0)
+            {
+                reader.Consume(entry & 15);
+                return entry >> 4;
+            }
+
+            uint32_t bits = reader.Peek(15);
+            int code = 0;
+            int first = 0;
+            int index = 0;
+            for (int length = 1; length <= 15; length++)
+            {
+                code |= (bits >> (length - 1)) & 1;
+                int count = _counts[length];
+                if (code - first < count)
+                {
+                    reader.Consume(length);
+                    return _symbols[index + code - first];
+                }
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+
+    private:
+        uint16_t _counts[16];
+        uint16_t _symbols[288];
+        uint16_t _fast[1 << FastBits];
+    };
+}
+
+static bool InflateBlock(BitReader& reader, const HuffmanDecoder& literalCode, const HuffmanDecoder& distanceCode,
+                         vector<uint8_t>& output, size_t maxSize)
+{
+    while (true)
+    {
+        int symbol = literalCode.Decode(reader);
+        if (symbol < 0 || reader.Overrun())
+            return false;
+
+        if (symbol < 256)
+        {
+            if (output.size() == maxSize)
+                return false;
+
+            output.push_back((uint8_t)symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+
+        size_t length = LengthBase[symbol] + reader.Read(LengthExtra[symbol]);
+        int distanceSymbol = distanceCode.Decode(reader);
+        if (distanceSymbol < 0 || distanceSymbol >= 30)
+            return false;
+
+        size_t distance = DistanceBase[distanceSymbol] + reader.Read(DistanceExtra[distanceSymbol]);
+        if (reader.Overrun() || distance > output.size() || length > maxSize - output.size())
+            return false;
+
+        // The copy can overlap what it writes
+        size_t start = output.size();
+        output.resize(start + length);
+        uint8_t* pDst = output.data() + start;
+        const uint8_t* pSrc = pDst - distance;
+        for (size_t i = 0; i < length; i++)
+        {
+            pDst[i] = pSrc[i];
+        }
+    }
+}
+
+bool Zlib::Decompress(const uint8_t* pData, size_t size, vector<uint8_t>& output, size_t maxSize)
+{
+    output.clear();
+
+    // Deflate with a window of at most 32K and no preset dictionary
+    if (size < 6 || (pData[0] & 0x0F) != 8 || (pData[0] >> 4) > 7 || (pData[0] << 8 | pData[1]) % 31 != 0 ||
+        (pData[1] & 0x20) != 0)
+    {
+        return false;
+    }
+
+    BitReader reader(pData + 2, size - 2);
+    HuffmanDecoder literalCode;
+    HuffmanDecoder distanceCode;
+    bool last;
+    do
+    {
+        last = reader.Read(1) != 0;
+        int type = reader.Read(2);
+        if (type == 0)
+        {
+            const uint8_t* pHeader = reader.ReadAlignedBytes(4);
+            if (pHeader == nullptr || (pHeader[0] ^ pHeader[2]) != 0xFF || (pHeader[1] ^ pHeader[3]) != 0xFF)
+                return false;
+
+            size_t length = pHeader[0] | pHeader[1] << 8;
+            const uint8_t* pBytes = reader.ReadAlignedBytes(length);
+            if (pBytes == nullptr || length > maxSize - output.size())
+                return false;
+
+            output.insert(output.end(), pBytes, pBytes + length);
+            continue;
+        }
+
+        uint8_t lengths[286 + 30] = {};
+        int numLiteralCodes = 288;
+        int numDistanceCodes = 30;
+        if (type == 1)
+        {
+            // The fixed codes
+            uint8_t fixedLengths[288];
+            memset(fixedLengths, 8, 144);
+            memset(fixedLengths + 144, 9, 112);
+            memset(fixedLengths + 256, 7, 24);
+            memset(fixedLengths + 280, 8, 8);
+            literalCode.Build(fixedLengths, 288);
+            memset(lengths, 5, 30);
+            distanceCode.Build(lengths, 30);
+        }
+        else if (type == 2)
+        {
+            numLiteralCodes = reader.Read(5) + 257;
+            numDistanceCodes = reader.Read(5) + 1;
+            int numLengthCodes = reader.Read(4) + 4;
+            if (numLiteralCodes > 286 || numDistanceCodes > 30)
+                return false;
+
+            uint8_t lengthLengths[19] = {};
+            for (int i = 0; i < numLengthCodes; i++)
+            {
+                lengthLengths[CodeLengthOrder[i]] = (uint8_t)reader.Read(3);
+            }
+            HuffmanDecoder lengthCode;
+            if (!lengthCode.Build(lengthLengths, 19))
+                return false;
+
+            int total = numLiteralCodes + numDistanceCodes;
+            for (int i = 0; i < total; )
+            {
+                int symbol = lengthCode.Decode(reader);
+                if (symbol < 0 || reader.Overrun())
+                    return false;
+
+                if (symbol < 16)
+                {
+                    lengths[i++] = (uint8_t)symbol;
+                    continue;
+                }
+
+                uint8_t value = 0;
+                int run;
+                if (symbol == 16)
+                {
+                    if (i == 0)
+                        return false;
+
+                    value = lengths[i - 1];
+                    run = 3 + reader.Read(2);
+                }
+                else if (symbol == 17)
+                {
+                    run = 3 + reader.Read(3);
+                }
+                else
+                {
+                    run = 11 + reader.Read(7);
+                }
+                if (run > total - i)
+                    return false;
+
+                memset(lengths + i, value, run);
+                i += run;
+            }
+
+            if (lengths[256] == 0 || !literalCode.Build(lengths, numLiteralCodes) ||
+                !distanceCode.Build(lengths + numLiteralCodes, numDistanceCodes))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        if (!InflateBlock(reader, literalCode, distanceCode, output, maxSize))
+            return false;
+    } while (!last);
+
+    const uint8_t* pAdler = reader.ReadAlignedBytes(4);
+    if (pAdler == nullptr || reader.Overrun())
+        return false;
+
+    uint32_t adler = (uint32_t)pAdler[0] << 24 | pAdler[1] << 16 | pAdler[2] << 8 | pAdler[3];
+    return adler == Adler32(output.data(), output.size());
+}
+
+uint32_t Zlib::Adler32(const uint8_t* pData, size_t size, uint32_t adler)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size != 0)
+    {
+        // The largest count for which b can't overflow before the modulo
+        size_t count = min<size_t>(size, 5552);
+        size -= count;
+        for (; count != 0; count--)
+        {
+            a += *pData++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+uint32_t Zlib::Crc32(const uint8_t* pData, size_t size, uint32_t crc)
+{
+    struct Table
+    {
+        uint32_t Values[256];
+
+        Table()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+                }
+                Values[i] = value;
+            }
+        }
+    };
+    static const Table table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table.Values[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// zlib streams (RFC 1950/1951) for the PNG files the PGD tools read and write, so they don't need zlib itself.
+// The compressor uses hash chains with lazy matching and one dynamic Huffman block per 64K symbols.
+// The decompressor reads all three block types and checks the Adler-32 at the end.
+class Zlib
+{
+public:
+    // Level 1 (fastest) to 9 (smallest), like zlib's
+    static std::vector<uint8_t> Compress(const uint8_t* pData, size_t size, int level);
+
+    // Replaces the contents of output with the unpacked data. Returns false for corrupt streams and for streams that
+    // would unpack to more than maxSize bytes.
+    static bool Decompress(const uint8_t* pData, size_t size, std::vector<uint8_t>& output, size_t maxSize);
+
+    static uint32_t Adler32(const uint8_t* pData, size_t size, uint32_t adler = 1);
+    static uint32_t Crc32(const uint8_t* pData, size_t size, uint32_t crc = 0);
+};
@@ -0,0 +1,702 @@
+// PacBuild: builds the pac archives of a translation patch in one process, replacing the release script's chain of
+// PgdConvert, temporary PGD files and unipack runs. Each PGD entry of each archive comes from the data folder if it
+// has a PNG with the same base name, which is encoded to a GE picture in memory, keeping the original's position when
+// the size is the same. Other entries of data.pac come from the data folder if it has a file with the entry's name
+// (such as TEXT.DAT or script.src), as the script's unipack run on data.pac did. All other entries are copied from
+// the archive. Pictures are encoded on a pool of threads in the order the archives need them, at most a few per
+// thread ahead of the entry being written, so memory doesn't grow with the number of pictures. Only archives with a
+// replaced entry are written; a PNG that no archive has a PGD for is an error.
+//
+// With --dedup, entries with the same bytes (whether replaced or copied) are stored once and their directory records
+// point at the same data. The engine reads entries through the directory only, but whether it minds two records
+// sharing an offset hasn't been confirmed on every game, so this is opt-in; each archive is read back through its
+// directory afterwards to check that every entry still has the right bytes.
+//
+// Build (Windows or Linux):
+//   g++ -O2 -std=c++17 -pthread -o PacBuild PacBuild.cpp ../Common/PacArchive.cpp ../Common/PgdCodec.cpp
+//       ../Common/PgdEncoder.cpp ../Common/PngFile.cpp ../Common/Xxh64.cpp ../Common/Zlib.cpp
+//
+// Usage:
+//   PacBuild <data folder> <output folder> <archive.pac>... [-m 1|2|3] [--preset fast|normal|max] [--threads N]
+//            [--dedup]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "../Common/PacArchive.h"
+#include "../Common/PgdCodec.h"
+#include "../Common/PgdEncoder.h"
+#include "../Common/PngFile.h"
+#include "../Common/Xxh64.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static constexpr size_t ChunkSize = 1 << 20;
+
+// Pictures each encoding thread may have finished ahead of the writer
+static constexpr int PicturesPerThread = 2;
+
+using FilePtr = unique_ptr<FILE, int(*)(FILE*)>;
+
+static FilePtr OpenFile(const string& path, const char* pMode)
+{
+    return FilePtr(FileUtil::Open(path, pMode), fclose);
+}
+
+static void Write32(uint8_t* p, uint32_t value) { memcpy(p, &value, 4); }
+static uint32_t Read32(const uint8_t* p) { uint32_t value; memcpy(&value, p, 4); return value; }
+
+static string ToLower(string text)
+{
+    transform(text.begin(), text.end(), text.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+    return text;
+}
+
+struct Picture
+{
+    fs::path                Path;
+    vector<uint8_t>         Template;       // Header of the entry it replaces, if that is a GE picture
+    vector<uint8_t>         Pgd;
+    string                  Error;
+    bool                    Done = false;
+};
+
+enum class SourceType
+{
+    Archive,        // Copied from the original archive
+    File,           // A file from the data folder
+    Picture         // A PNG from the data folder, encoded
+};
+
+struct EntrySource
+{
+    SourceType              Type = SourceType::Archive;
+    fs::path                Path;
+    int                     Picture = -1;
+};
+
+struct ArchivePlan
+{
+    PacArchive              Archive;
+    vector<EntrySource>     Sources;
+    int                     NumFiles = 0;
+    int                     NumPictures = 0;
+};
+
+// Encodes the pictures on a pool of threads. Threads take the pictures in order and only start one while fewer
+// than PicturesPerThread per thread are done but not yet taken by the writer.
+class PictureEncoder
+{
+public:
+    PictureEncoder(vector<Picture>& pictures, const PgdEncodeOptions& options, int numThreads)
+        : _pictures(pictures), _options(options), _window(numThreads * PicturesPerThread)
+    {
+        _options.NumThreads = max(1, numThreads / max((int)pictures.size(), 1));
+        for (int i = 0; i < min(numThreads, (int)pictures.size()); i++)
+            _threads.emplace_back([this]() { Run(); });
+    }
+
+    ~PictureEncoder()
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stop = true;
+        }
+        _changed.notify_all();
+        for (thread& thread : _threads)
+            thread.join();
+    }
+
+    // Waits for the picture to be encoded and hands over its data. Pictures have to be taken in order.
+    bool Take(int index, vector<uint8_t>& pgd, string& error)
+    {
+        unique_lock<mutex> lock(_mutex);
+        _changed.wait(lock, [&]() { return _pictures[index].Done; });
+        Picture& picture = _pictures[index];
+        pgd = move(picture.Pgd);
+        picture.Pgd = vector<uint8_t>();
+        error = picture.Error;
+        _numTaken = index + 1;
+        lock.unlock();
+        _changed.notify_all();
+        return error.empty();
+    }
+
+private:
+    void Run()
+    {
+        while (true)
+        {
+            int index;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _changed.wait(lock, [&]()
+                {
+                    return _stop || _next >= (int)_pictures.size() || _next < _numTaken + _window;
+                });
+                if (_stop || _next >= (int)_pictures.size())
+                    return;
+
+                index = _next++;
+            }
+
+            vector<uint8_t> pgd;
+            string error;
+            Encode(_pictures[index], pgd, error);
+            {
+                lock_guard<mutex> lock(_mutex);
+                _pictures[index].Pgd = move(pgd);
+                _pictures[index].Error = error;
+                _pictures[index].Done = true;
+            }
+            _changed.notify_all();
+        }
+    }
+
+    bool Encode(const Picture& picture, vector<uint8_t>& pgd, string& error) const
+    {
+        vector<uint8_t> png;
+        if (!FileUtil::ReadAll(picture.Path.u8string(), png))
+        {
+            error = "can't read the file";
+            return false;
+        }
+
+        PgdImage image;
+        if (!PngFile::Decode(png.data(), png.size(), image.Width, image.Height, image.Channels, image.Pixels, error))
+            return false;
+
+        png = vector<uint8_t>();
+
+        // The original's position only applies to a picture of the same size
+        PgdEncodeOptions options = _options;
+        if (!picture.Template.empty() && Read32(picture.Template.data() + 0xC) == (uint32_t)image.Width &&
+            Read32(picture.Template.data() + 0x10) == (uint32_t)image.Height)
+        {
+            options.pTemplate = picture.Template.data();
+        }
+        return PgdEncoder::Encode(image, options, pgd, error);
+    }
+
+    vector<Picture>&        _pictures;
+    PgdEncodeOptions        _options;
+    int                     _window;
+
+    mutex                   _mutex;
+    condition_variable      _changed;
+    int                     _next = 0;
+    int                     _numTaken = 0;
+    bool                    _stop = false;
+    vector<thread>          _threads;
+};
+
+// Maps the lower case name of each file in the data folder to its path
+static bool ListDataFolder(const fs::path& folder, map<string, fs::path>& files)
+{
+    error_code error;
+    for (fs::directory_iterator it(folder, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file())
+            files[ToLower(it->path().filename().u8string())] = it->path();
+    }
+    return !error;
+}
+
+// Decides where each entry of the archive comes from, adding the pictures to encode. Files other than PNGs only
+// replace entries of data.pac, like the release script did; other archives can have entries with the same names.
+static bool PlanArchive(ArchivePlan& plan, const map<string, fs::path>& dataFiles, vector<Picture>& pictures,
+                        map<string, bool>& usedPngs)
+{
+    const PacArchive& archive = plan.Archive;
+    FilePtr pInput = OpenFile(archive.GetPath(), "rb");
+    if (pInput == nullptr)
+        return false;
+
+    bool replaceFiles = ToLower(fs::u8path(archive.GetPath()).filename().u8string()) == "data.pac";
+
+    plan.Sources.resize(archive.GetCount());
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        const PacArchive::Entry& entry = archive.GetEntry(i);
+        string name = ToLower(entry.Name);
+        auto file = replaceFiles ? dataFiles.find(name) : dataFiles.end();
+        if (file != dataFiles.end())
+        {
+            plan.Sources[i].Type = SourceType::File;
+            plan.Sources[i].Path = file->second;
+            plan.NumFiles++;
+            continue;
+        }
+
+        if (name.size() <= 4 || name.compare(name.size() - 4, 4, ".pgd") != 0)
+            continue;
+
+        string pngName = name.substr(0, name.size() - 4) + ".png";
+        auto png = dataFiles.find(pngName);
+        if (png == dataFiles.end())
+            continue;
+
+        Picture picture;
+        picture.Path = png->second;
+        if (entry.Size >= 0x20)
+        {
+            picture.Template.resize(0x20);
+            if (!FileUtil::ReadAt(pInput.get(), entry.Offset, picture.Template.data(), 0x20))
+                return false;
+
+            if (memcmp(picture.Template.data(), "GE", 2) != 0)
+                picture.Template.clear();
+        }
+
+        plan.Sources[i].Type = SourceType::Picture;
+        plan.Sources[i].Path = png->second;
+        plan.Sources[i].Picture = (int)pictures.size();
+        pictures.push_back(move(picture));
+        usedPngs[pngName] = true;
+        plan.NumPictures++;
+    }
+    return true;
+}
+
+// Copies an entry of the original archive to the given position. With a hasher, the data goes through the buffer
+// to be hashed; otherwise Linux lets the kernel copy it (or share extents), like unipack does.
+static bool CopyRange(FILE* pInput, uint64_t offset, uint32_t size, FILE* pOutput, uint64_t position,
+                      vector<uint8_t>& buffer, Xxh64* pHasher)
+{
+#ifdef __linux__
+    if (pHasher == nullptr)
+    {
+        // Whatever the kernel can't copy, such as across file systems that don't support it, goes through the buffer
+        off_t inputOffset = (off_t)offset;
+        off_t outputOffset = (off_t)position;
+        if (fflush(pOutput) != 0)
+            return false;
+
+        while (size > 0)
+        {
+            ssize_t count = copy_file_range(fileno(pInput), &inputOffset, fileno(pOutput), &outputOffset, size, 0);
+            if (count <= 0)
+                break;
+
+            size -= (uint32_t)count;
+        }
+        offset = (uint64_t)inputOffset;
+        position = (uint64_t)outputOffset;
+    }
+#endif
+
+    for (uint32_t done = 0; done < size; )
+    {
+        size_t count = min<size_t>(size - done, buffer.size());
+        if (!FileUtil::ReadAt(pInput, offset + done, buffer.data(), count) ||
+            !FileUtil::WriteAt(pOutput, position + done, buffer.data(), count))
+        {
+            return false;
+        }
+
+        if (pHasher != nullptr)
+            pHasher->Update(buffer.data(), count);
+
+        done += count;
+    }
+    return true;
+}
+
+// Streams a file from the data folder into the archive, encrypting it if it starts with '$' like unipack does
+static bool CopyDataFile(const fs::path& path, FILE* pOutput, uint64_t position, vector<uint8_t>& buffer,
+                         Xxh64* pHasher, uint64_t& size, string& error)
+{
+    FilePtr pFile = OpenFile(path.u8string(), "rb");
+    if (pFile == nullptr || !FileUtil::GetSize(pFile.get(), size))
+    {
+        error = "can't read " + path.u8string();
+        return false;
+    }
+
+    bool encrypt = false;
+    for (uint64_t done = 0; done < size; )
+    {
+        size_t count = (size_t)min<uint64_t>(size - done, buffer.size());
+        if (!FileUtil::ReadAt(pFile.get(), done, buffer.data(), count))
+        {
+            error = "can't read " + path.u8string();
+            return false;
+        }
+
+        if (done == 0)
+            encrypt = buffer[0] == '$';
+
+        if (encrypt)
+            PacArchive::Encrypt(buffer.data(), count, done);
+
+        if (!FileUtil::WriteAt(pOutput, position + done, buffer.data(), count))
+        {
+            error = "can't write the archive";
+            return false;
+        }
+
+        if (pHasher != nullptr)
+            pHasher->Update(buffer.data(), count);
+
+        done += count;
+    }
+    return true;
+}
+
+static bool RangesEqual(FILE* pFile, uint64_t offset1, uint64_t offset2, uint64_t size, vector<uint8_t>& buffer1,
+                        vector<uint8_t>& buffer2)
+{
+    for (uint64_t done = 0; done < size; )
+    {
+        size_t count = (size_t)min<uint64_t>(size - done, buffer1.size());
+        if (!FileUtil::ReadAt(pFile, offset1 + done, buffer1.data(), count) ||
+            !FileUtil::ReadAt(pFile, offset2 + done, buffer2.data(), count) ||
+            memcmp(buffer1.data(), buffer2.data(), count) != 0)
+        {
+            return false;
+        }
+        done += count;
+    }
+    return true;
+}
+
+struct ArchiveStats
+{
+    uint64_t    Size = 0;
+    int         NumShared = 0;          // Entries that point at the data of an earlier one
+    uint64_t    BytesSaved = 0;
+};
+
+// Writes the new archive in directory order. The directory is written last, once the size of every entry is known.
+// With deduplication, each entry is hashed as it's written; if an earlier entry has the same size, hash and bytes,
+// the new copy is dropped (the next entry overwrites it) and the directory record points at the earlier data.
+static bool WriteArchive(const ArchivePlan& plan, PictureEncoder& encoder, const string& outputPath, bool deduplicate,
+                         vector<uint64_t>& hashes, ArchiveStats& stats, string& error)
+{
+    const PacArchive& archive = plan.Archive;
+    FilePtr pInput = OpenFile(archive.GetPath(), "rb");
+    FilePtr pOutput = OpenFile(outputPath, deduplicate ? "w+b" : "wb");
+    if (pInput == nullptr || pOutput == nullptr)
+    {
+        error = pInput == nullptr ? "can't read the archive" : "can't create " + outputPath;
+        return false;
+    }
+
+    vector<uint8_t> header = archive.GetHeader();
+    vector<uint8_t> buffer(ChunkSize);
+    vector<uint8_t> compareBuffer(deduplicate ? ChunkSize : 0);
+    map<pair<uint64_t, uint64_t>, uint32_t> offsetsByContent;     // (hash, size) to offset
+    hashes.assign(archive.GetCount(), 0);
+    if (!FileUtil::WriteAt(pOutput.get(), 0, header.data(), header.size()))
+    {
+        error = "can't write the archive";
+        return false;
+    }
+
+    uint64_t position = header.size();
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        const PacArchive::Entry& entry = archive.GetEntry(i);
+        const EntrySource& source = plan.Sources[i];
+        uint64_t entrySize = entry.Size;
+        Xxh64 hasher;
+        Xxh64* pHasher = deduplicate ? &hasher : nullptr;
+        if (source.Type == SourceType::Archive)
+        {
+            if (!CopyRange(pInput.get(), entry.Offset, entry.Size, pOutput.get(), position, buffer, pHasher))
+            {
+                error = "can't copy " + entry.Name;
+                return false;
+            }
+        }
+        else if (source.Type == SourceType::File)
+        {
+            if (!CopyDataFile(source.Path, pOutput.get(), position, buffer, pHasher, entrySize, error))
+                return false;
+        }
+        else
+        {
+            vector<uint8_t> pgd;
+            if (!encoder.Take(source.Picture, pgd, error))
+            {
+                error = source.Path.u8string() + ": " + error;
+                return false;
+            }
+            if (!FileUtil::WriteAt(pOutput.get(), position, pgd.data(), pgd.size()))
+            {
+                error = "can't write the archive";
+                return false;
+            }
+            if (deduplicate)
+                hasher.Update(pgd.data(), pgd.size());
+
+            entrySize = pgd.size();
+        }
+
+        if (position + entrySize + 4 > UINT32_MAX)
+        {
+            error = "the archive would be larger than 4 GB";
+            return false;
+        }
+
+        uint64_t offset = position;
+        if (deduplicate)
+        {
+            hashes[i] = hasher.Final();
+            auto [it, added] = offsetsByContent.emplace(make_pair(hashes[i], entrySize), (uint32_t)position);
+            if (!added && entrySize != 0 &&
+                RangesEqual(pOutput.get(), it->second, position, entrySize, buffer, compareBuffer))
+            {
+                offset = it->second;
+                stats.NumShared++;
+                stats.BytesSaved += entrySize;
+            }
+        }
+
+        uint8_t* pRecord = header.data() + archive.GetDirectoryOffset() + (size_t)i * PacArchive::EntrySize;
+        Write32(pRecord + PacArchive::NameSize, (uint32_t)entrySize);
+        Write32(pRecord + PacArchive::NameSize + 4, (uint32_t)offset);
+        if (offset == position)
+            position += entrySize;
+    }
+
+    if (!FileUtil::WriteAt(pOutput.get(), position, "EOF ", 4) ||
+        !FileUtil::WriteAt(pOutput.get(), 0, header.data(), header.size()) || fclose(pOutput.release()) != 0)
+    {
+        error = "can't write the archive";
+        return false;
+    }
+
+    // Dropped copies at the end leave data past the EOF marker
+    stats.Size = position + 4;
+    error_code errorCode;
+    if (deduplicate)
+        fs::resize_file(fs::u8path(outputPath), stats.Size, errorCode);
+
+    if (errorCode)
+    {
+        error = "can't write the archive";
+        return false;
+    }
+    return true;
+}
+
+// Reads the written archive back the way the game would, through its directory, and checks that every entry has the
+// bytes it was written with, shared or not
+static bool VerifyArchive(const string& path, const vector<uint64_t>& hashes, string& error)
+{
+    PacArchive archive;
+    FilePtr pFile = OpenFile(path, "rb");
+    char eof[4];
+    uint64_t size;
+    if (!archive.Open(path) || archive.GetCount() != (int)hashes.size() || pFile == nullptr ||
+        !FileUtil::GetSize(pFile.get(), size) || size < 4 || !FileUtil::ReadAt(pFile.get(), size - 4, eof, 4) ||
+        memcmp(eof, "EOF ", 4) != 0)
+    {
+        error = "verification failed: the archive can't be read back";
+        return false;
+    }
+
+    vector<uint8_t> buffer(ChunkSize);
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        const PacArchive::Entry& entry = archive.GetEntry(i);
+        Xxh64 hasher;
+        for (uint32_t done = 0; done < entry.Size; )
+        {
+            size_t count = min<size_t>(entry.Size - done, buffer.size());
+            if (!FileUtil::ReadAt(pFile.get(), entry.Offset + done, buffer.data(), count))
+            {
+                error = "verification failed: can't read " + entry.Name;
+                return false;
+            }
+            hasher.Update(buffer.data(), count);
+            done += count;
+        }
+
+        if (hasher.Final() != hashes[i])
+        {
+            error = "verification failed: " + entry.Name + " reads back different data";
+            return false;
+        }
+    }
+    return true;
+}
+
+static int Build(const fs::path& dataFolder, const fs::path& outputFolder, const vector<fs::path>& archivePaths,
+                 const PgdEncodeOptions& options, int numThreads, bool deduplicate)
+{
+    auto start = chrono::steady_clock::now();
+    map<string, fs::path> dataFiles;
+    if (!ListDataFolder(dataFolder, dataFiles))
+    {
+        fprintf(stderr, "Can't list the files in %s\n", dataFolder.u8string().c_str());
+        return 1;
+    }
+
+    vector<ArchivePlan> plans(archivePaths.size());
+    vector<Picture> pictures;
+    map<string, bool> usedPngs;
+    for (size_t i = 0; i < archivePaths.size(); i++)
+    {
+        error_code errorCode;
+        fs::path outputPath = outputFolder / archivePaths[i].filename();
+        if (fs::exists(outputPath, errorCode) && fs::equivalent(outputPath, archivePaths[i], errorCode))
+        {
+            fprintf(stderr, "%s: the output would overwrite the archive\n", archivePaths[i].u8string().c_str());
+            return 1;
+        }
+
+        if (!plans[i].Archive.Open(archivePaths[i].u8string()) ||
+            !PlanArchive(plans[i], dataFiles, pictures, usedPngs))
+        {
+            fprintf(stderr, "%s: can't read the archive\n", archivePaths[i].u8string().c_str());
+            return 1;
+        }
+    }
+
+    // Same check as the release script used to make after inserting: every PNG has to replace something
+    string missing;
+    for (const auto& [name, path] : dataFiles)
+    {
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0 && !usedPngs[name])
+            missing += (missing.empty() ? "" : ", ") + path.filename().u8string();
+    }
+    if (!missing.empty())
+    {
+        fprintf(stderr, "These PNG files have no PGD in any of the archives: %s\n", missing.c_str());
+        return 1;
+    }
+
+    error_code errorCode;
+    fs::create_directories(outputFolder, errorCode);
+
+    PictureEncoder encoder(pictures, options, numThreads);
+    int numWritten = 0;
+    int numShared = 0;
+    uint64_t bytesSaved = 0;
+    for (const ArchivePlan& plan : plans)
+    {
+        if (plan.NumFiles == 0 && plan.NumPictures == 0)
+            continue;
+
+        fs::path archivePath = fs::u8path(plan.Archive.GetPath());
+        string outputPath = (outputFolder / archivePath.filename()).u8string();
+        vector<uint64_t> hashes;
+        ArchiveStats stats;
+        string error;
+        if (!WriteArchive(plan, encoder, outputPath, deduplicate, hashes, stats, error) ||
+            (deduplicate && !VerifyArchive(outputPath, hashes, error)))
+        {
+            fprintf(stderr, "%s: %s\n", archivePath.u8string().c_str(), error.c_str());
+            fs::remove(fs::u8path(outputPath), errorCode);
+            return 1;
+        }
+
+        printf("%s: %d files and %d pictures replaced, %.1f MB\n", archivePath.filename().u8string().c_str(),
+            plan.NumFiles, plan.NumPictures, stats.Size / 1048576.0);
+        if (stats.NumShared > 0)
+        {
+            printf("    %d entries share data with an earlier one, %.1f MB saved\n", stats.NumShared,
+                stats.BytesSaved / 1048576.0);
+        }
+
+        numShared += stats.NumShared;
+        bytesSaved += stats.BytesSaved;
+        numWritten++;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%d of %d archives written, %d pictures encoded in %.2f s, %d at a time\n", numWritten,
+        (int)plans.size(), (int)pictures.size(), seconds, min(numThreads, max((int)pictures.size(), 1)));
+    if (deduplicate)
+    {
+        printf("%d duplicate entries stored once, %llu bytes (%.1f MB) saved\n", numShared,
+            (unsigned long long)bytesSaved, bytesSaved / 1048576.0);
+    }
+
+    return 0;
+}
+
+static bool ParsePreset(const string& text, PgdPreset& preset)
+{
+    if (text == "fast")
+        preset = PgdPreset::Fast;
+    else if (text == "normal")
+        preset = PgdPreset::Normal;
+    else if (text == "max")
+        preset = PgdPreset::Max;
+    else
+        return false;
+
+    return true;
+}
+
+static void PrintUsage()
+{
+    printf("Usage: PacBuild <data folder> <output folder> <archive.pac>... [-m 1|2|3] [--preset fast|normal|max]\n");
+    printf("                [--threads N] [--dedup]\n");
+}
+
+int main(int argc, char** argv)
+{
+    vector<string> args;
+    int numThreads = max(1, (int)thread::hardware_concurrency());
+    PgdEncodeOptions options;
+    bool deduplicate = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            numThreads = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--dedup") == 0)
+        {
+            deduplicate = true;
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            options.Method = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--preset") == 0 && i + 1 < argc)
+        {
+            if (!ParsePreset(argv[++i], options.Preset))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() < 3 || options.Method < 1 || options.Method > 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    vector<fs::path> archivePaths;
+    for (size_t i = 2; i < args.size(); i++)
+        archivePaths.push_back(fs::u8path(args[i]));
+
+    return Build(fs::u8path(args[0]), fs::u8path(args[1]), archivePaths, options, numThreads, deduplicate);
+}
@@ -0,0 +1 @@
+g++ -o PacBuild.exe PacBuild.cpp ../Common/PacArchive.cpp ../Common/PgdCodec.cpp ../Common/PgdEncoder.cpp ../Common/PngFile.cpp ../Common/Xxh64.cpp ../Common/Zlib.cpp -O2 -std=c++17 -Wall -pthread -static
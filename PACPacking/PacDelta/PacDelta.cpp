@@ -0,0 +1,538 @@
+// PacDelta: makes and applies patches that turn an original PAC archive into a rebuilt one, so a translation can
+// ship the entries it changed instead of whole archives. "diff" hashes the entries of both archives and stores
+// each entry of the rebuilt archive either as a reference to an identical entry in the original, or as new data.
+// Everything between entries (the header and directory, the EOF marker, any unused space) is stored as new data.
+// "apply" rebuilds the archive from the player's copy of the original, checking every piece it copies or writes
+// against the hash in the patch, so a modified original or a damaged patch fails instead of giving a bad archive.
+// Both work on several entries at once, one thread each, streaming the data in chunks.
+//
+// Build (Windows or Linux):
+//   g++ -O2 -std=c++17 -pthread -o PacDelta PacDelta.cpp ../Common/PacArchive.cpp ../Common/Xxh64.cpp
+//
+// Usage:
+//   PacDelta diff <original.pac> <rebuilt.pac> <patch.pacdelta> [threads]
+//   PacDelta apply <original.pac> <patch.pacdelta> <output.pac> [threads]
+//   PacDelta info <patch.pacdelta>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Common/PacArchive.h"
+#include "../Common/ParallelFor.h"
+#include "../Common/Xxh64.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Patch layout (little-endian):
+//   char[4] magic, uint32 version, uint64 original size, uint64 rebuilt size, uint32 piece count, uint32 reserved,
+//   uint64 new data size
+//   pieces, which together make up the rebuilt archive in order: uint32 type, uint32 reserved, uint64 size,
+//          uint64 source offset (in the original, or in the new data), uint64 XXH64 of the piece's bytes
+//   uint64 XXH64 of everything above, then the new data
+static constexpr char Magic[4] = { 'P', 'D', 'L', 'T' };
+static constexpr uint32_t Version = 1;
+static constexpr size_t HeaderSize = 40;
+static constexpr size_t PieceSize = 32;
+static constexpr size_t ChunkSize = 1 << 20;
+
+enum class PieceType : uint32_t
+{
+    Copy = 0,       // From the original archive
+    New = 1         // From the patch
+};
+
+struct Piece
+{
+    PieceType   Type;
+    uint64_t    Size;
+    uint64_t    Source;
+    uint64_t    Hash;
+};
+
+struct Patch
+{
+    uint64_t        OriginalSize;
+    uint64_t        RebuiltSize;
+    uint64_t        NewDataSize;
+    uint64_t        NewDataOffset;
+    vector<Piece>   Pieces;
+};
+
+using FilePtr = unique_ptr<FILE, int(*)(FILE*)>;
+
+static FilePtr OpenFile(const string& path, const char* pMode)
+{
+    return FilePtr(FileUtil::Open(path, pMode), fclose);
+}
+
+static void Write32(uint8_t* p, uint32_t value) { memcpy(p, &value, 4); }
+static void Write64(uint8_t* p, uint64_t value) { memcpy(p, &value, 8); }
+static uint32_t Read32(const uint8_t* p) { uint32_t value; memcpy(&value, p, 4); return value; }
+static uint64_t Read64(const uint8_t* p) { uint64_t value; memcpy(&value, p, 8); return value; }
+
+static bool HashRange(FILE* pFile, uint64_t offset, uint64_t size, vector<uint8_t>& buffer, uint64_t& hash)
+{
+    Xxh64 hasher;
+    for (uint64_t done = 0; done < size; )
+    {
+        size_t count = (size_t)min<uint64_t>(size - done, buffer.size());
+        if (!FileUtil::ReadAt(pFile, offset + done, buffer.data(), count))
+            return false;
+
+        hasher.Update(buffer.data(), count);
+        done += count;
+    }
+    hash = hasher.Final();
+    return true;
+}
+
+static bool RangesEqual(FILE* pFile1, uint64_t offset1, FILE* pFile2, uint64_t offset2, uint64_t size,
+    vector<uint8_t>& buffer1, vector<uint8_t>& buffer2)
+{
+    for (uint64_t done = 0; done < size; )
+    {
+        size_t count = (size_t)min<uint64_t>(size - done, buffer1.size());
+        if (!FileUtil::ReadAt(pFile1, offset1 + done, buffer1.data(), count) ||
+            !FileUtil::ReadAt(pFile2, offset2 + done, buffer2.data(), count) ||
+            memcmp(buffer1.data(), buffer2.data(), count) != 0)
+        {
+            return false;
+        }
+        done += count;
+    }
+    return true;
+}
+
+// Where each piece goes in the rebuilt archive
+static vector<uint64_t> GetOffsets(const Patch& patch)
+{
+    vector<uint64_t> offsets;
+    uint64_t offset = 0;
+    for (const Piece& piece : patch.Pieces)
+    {
+        offsets.push_back(offset);
+        offset += piece.Size;
+    }
+    return offsets;
+}
+
+// Hashes every entry of the archive, several at a time. Returns false if the archive can't be read.
+static bool HashEntries(const PacArchive& archive, int numThreads, vector<uint64_t>& hashes)
+{
+    hashes.assign(archive.GetCount(), 0);
+    atomic<bool> success = true;
+    ParallelFor(archive.GetCount(), numThreads, [&]()
+    {
+        return [&, pFile = OpenFile(archive.GetPath(), "rb"), buffer = vector<uint8_t>(ChunkSize)](int index) mutable
+        {
+            const PacArchive::Entry& entry = archive.GetEntry(index);
+            if (pFile == nullptr || !HashRange(pFile.get(), entry.Offset, entry.Size, buffer, hashes[index]))
+                success = false;
+        };
+    });
+    return success;
+}
+
+static bool WritePatch(const string& path, const Patch& patch, const string& rebuiltPath)
+{
+    vector<uint8_t> header(HeaderSize + patch.Pieces.size() * PieceSize + 8);
+    uint8_t* p = header.data();
+    memcpy(p, Magic, 4);
+    Write32(p + 4, Version);
+    Write64(p + 8, patch.OriginalSize);
+    Write64(p + 16, patch.RebuiltSize);
+    Write32(p + 24, (uint32_t)patch.Pieces.size());
+    Write32(p + 28, 0);
+    Write64(p + 32, patch.NewDataSize);
+    p += HeaderSize;
+    for (const Piece& piece : patch.Pieces)
+    {
+        Write32(p, (uint32_t)piece.Type);
+        Write32(p + 4, 0);
+        Write64(p + 8, piece.Size);
+        Write64(p + 16, piece.Source);
+        Write64(p + 24, piece.Hash);
+        p += PieceSize;
+    }
+    Write64(p, Xxh64::Hash(header.data(), header.size() - 8));
+
+    FilePtr pPatch = OpenFile(path, "wb");
+    FilePtr pRebuilt = OpenFile(rebuiltPath, "rb");
+    if (pPatch == nullptr || pRebuilt == nullptr || fwrite(header.data(), 1, header.size(), pPatch.get()) != header.size())
+        return false;
+
+    // The new data is in the same order as the pieces that use it
+    vector<uint8_t> buffer(ChunkSize);
+    uint64_t rebuiltOffset = 0;
+    for (const Piece& piece : patch.Pieces)
+    {
+        for (uint64_t done = 0; piece.Type == PieceType::New && done < piece.Size; )
+        {
+            size_t count = (size_t)min<uint64_t>(piece.Size - done, buffer.size());
+            if (!FileUtil::ReadAt(pRebuilt.get(), rebuiltOffset + done, buffer.data(), count) ||
+                fwrite(buffer.data(), 1, count, pPatch.get()) != count)
+            {
+                return false;
+            }
+            done += count;
+        }
+        rebuiltOffset += piece.Size;
+    }
+    return fclose(pPatch.release()) == 0;
+}
+
+static int Diff(const string& originalPath, const string& rebuiltPath, const string& patchPath, int numThreads)
+{
+    PacArchive original;
+    PacArchive rebuilt;
+    for (auto [pArchive, pPath] : { make_pair(&original, &originalPath), make_pair(&rebuilt, &rebuiltPath) })
+    {
+        if (!pArchive->Open(*pPath))
+        {
+            fprintf(stderr, "Not a valid PAC archive: %s\n", pPath->c_str());
+            return 1;
+        }
+    }
+
+    vector<uint64_t> originalHashes;
+    vector<uint64_t> rebuiltHashes;
+    if (!HashEntries(original, numThreads, originalHashes) || !HashEntries(rebuilt, numThreads, rebuiltHashes))
+    {
+        fprintf(stderr, "Can't read the archives\n");
+        return 1;
+    }
+
+    // Candidate source for each rebuilt entry: an original entry with the same size and hash, preferably the same name
+    multimap<pair<uint32_t, uint64_t>, int> originalEntries;
+    for (int i = 0; i < original.GetCount(); i++)
+    {
+        originalEntries.emplace(make_pair(original.GetEntry(i).Size, originalHashes[i]), i);
+    }
+
+    vector<int> sources(rebuilt.GetCount(), -1);
+    for (int i = 0; i < rebuilt.GetCount(); i++)
+    {
+        const PacArchive::Entry& entry = rebuilt.GetEntry(i);
+        auto range = originalEntries.equal_range(make_pair(entry.Size, rebuiltHashes[i]));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (sources[i] < 0 || original.GetEntry(it->second).Name == entry.Name)
+                sources[i] = it->second;
+        }
+    }
+
+    // Make sure the candidates really are identical, so a hash collision can't make it into a patch
+    atomic<bool> success = true;
+    ParallelFor(rebuilt.GetCount(), numThreads, [&]()
+    {
+        return [&, pOriginal = OpenFile(originalPath, "rb"), pRebuilt = OpenFile(rebuiltPath, "rb"),
+            buffer1 = vector<uint8_t>(ChunkSize), buffer2 = vector<uint8_t>(ChunkSize)](int index) mutable
+        {
+            if (sources[index] < 0 || rebuilt.GetEntry(index).Size == 0)
+                return;
+
+            if (pOriginal == nullptr || pRebuilt == nullptr)
+            {
+                success = false;
+                return;
+            }
+
+            const PacArchive::Entry& entry = rebuilt.GetEntry(index);
+            if (!RangesEqual(pOriginal.get(), original.GetEntry(sources[index]).Offset, pRebuilt.get(), entry.Offset, entry.Size, buffer1, buffer2))
+                sources[index] = -1;
+        };
+    });
+    if (!success)
+    {
+        fprintf(stderr, "Can't read the archives\n");
+        return 1;
+    }
+
+    // Cut the rebuilt archive into pieces, going through the entries by offset. Entries that share data (or
+    // overlap) are covered by the piece of the first one; anything not covered by an entry is new data.
+    vector<int> order;
+    for (int i = 0; i < rebuilt.GetCount(); i++)
+    {
+        if (rebuilt.GetEntry(i).Size != 0)
+            order.push_back(i);
+    }
+    sort(order.begin(), order.end(), [&](int i1, int i2) { return rebuilt.GetEntry(i1).Offset < rebuilt.GetEntry(i2).Offset; });
+
+    Patch patch{ original.GetFileSize(), rebuilt.GetFileSize(), 0, 0, {} };
+    auto addNew = [&](uint64_t size)
+    {
+        if (size == 0)
+            return;
+
+        if (!patch.Pieces.empty() && patch.Pieces.back().Type == PieceType::New)
+            patch.Pieces.back().Size += size;
+        else
+            patch.Pieces.push_back({ PieceType::New, size, patch.NewDataSize, 0 });
+
+        patch.NewDataSize += size;
+    };
+
+    uint64_t position = 0;
+    int numCopied = 0;
+    for (int index : order)
+    {
+        const PacArchive::Entry& entry = rebuilt.GetEntry(index);
+        uint64_t end = (uint64_t)entry.Offset + entry.Size;
+        if (end <= position)
+            continue;
+
+        if (entry.Offset < position || sources[index] < 0)
+        {
+            addNew(end - position);
+        }
+        else
+        {
+            addNew(entry.Offset - position);
+            patch.Pieces.push_back({ PieceType::Copy, entry.Size, original.GetEntry(sources[index]).Offset, rebuiltHashes[index] });
+            numCopied++;
+        }
+        position = end;
+    }
+    addNew(rebuilt.GetFileSize() - position);
+
+    // Hash the new data pieces
+    vector<uint64_t> rebuiltOffsets = GetOffsets(patch);
+    ParallelFor((int)patch.Pieces.size(), numThreads, [&]()
+    {
+        return [&, pRebuilt = OpenFile(rebuiltPath, "rb"), buffer = vector<uint8_t>(ChunkSize)](int index) mutable
+        {
+            Piece& piece = patch.Pieces[index];
+            if (piece.Type == PieceType::New && (pRebuilt == nullptr || !HashRange(pRebuilt.get(), rebuiltOffsets[index], piece.Size, buffer, piece.Hash)))
+                success = false;
+        };
+    });
+    if (!success || !WritePatch(patchPath, patch, rebuiltPath))
+    {
+        fprintf(stderr, "Can't write %s\n", patchPath.c_str());
+        return 1;
+    }
+
+    uint64_t patchSize = HeaderSize + patch.Pieces.size() * PieceSize + 8 + patch.NewDataSize;
+    printf("%d of %d entries taken from %s, %llu bytes of new data; %s is %llu bytes (rebuilt archive %llu)\n",
+        numCopied, rebuilt.GetCount(), originalPath.c_str(), (unsigned long long)patch.NewDataSize, patchPath.c_str(),
+        (unsigned long long)patchSize, (unsigned long long)rebuilt.GetFileSize());
+    return 0;
+}
+
+static bool ReadPatch(const string& path, Patch& patch)
+{
+    FilePtr pFile = OpenFile(path, "rb");
+    uint64_t fileSize;
+    uint8_t header[HeaderSize];
+    if (pFile == nullptr || !FileUtil::GetSize(pFile.get(), fileSize) || !FileUtil::ReadAt(pFile.get(), 0, header, HeaderSize) ||
+        memcmp(header, Magic, 4) != 0 || Read32(header + 4) != Version)
+    {
+        return false;
+    }
+
+    uint32_t numPieces = Read32(header + 24);
+    if (numPieces > (fileSize - HeaderSize) / PieceSize)
+        return false;
+
+    vector<uint8_t> table(HeaderSize + (size_t)numPieces * PieceSize + 8);
+    if (!FileUtil::ReadAt(pFile.get(), 0, table.data(), table.size()) ||
+        Read64(table.data() + table.size() - 8) != Xxh64::Hash(table.data(), table.size() - 8))
+    {
+        return false;
+    }
+
+    patch.OriginalSize = Read64(header + 8);
+    patch.RebuiltSize = Read64(header + 16);
+    patch.NewDataSize = Read64(header + 32);
+    patch.NewDataOffset = table.size();
+    if (patch.NewDataSize != fileSize - patch.NewDataOffset)
+        return false;
+
+    uint64_t total = 0;
+    patch.Pieces.clear();
+    for (uint32_t i = 0; i < numPieces; i++)
+    {
+        const uint8_t* p = table.data() + HeaderSize + (size_t)i * PieceSize;
+        Piece piece{ (PieceType)Read32(p), Read64(p + 8), Read64(p + 16), Read64(p + 24) };
+        uint64_t limit = piece.Type == PieceType::Copy ? patch.OriginalSize : piece.Type == PieceType::New ? patch.NewDataSize : 0;
+        if (piece.Size > limit || piece.Source > limit - piece.Size)
+            return false;
+
+        total += piece.Size;
+        patch.Pieces.push_back(piece);
+    }
+    return total == patch.RebuiltSize;
+}
+
+static int Apply(const string& originalPath, const string& patchPath, const string& outputPath, int numThreads)
+{
+    Patch patch;
+    if (!ReadPatch(patchPath, patch))
+    {
+        fprintf(stderr, "Not a valid patch: %s\n", patchPath.c_str());
+        return 1;
+    }
+
+    uint64_t originalSize;
+    FilePtr pOriginal = OpenFile(originalPath, "rb");
+    if (pOriginal == nullptr || !FileUtil::GetSize(pOriginal.get(), originalSize))
+    {
+        fprintf(stderr, "Can't read %s\n", originalPath.c_str());
+        return 1;
+    }
+    pOriginal.reset();
+    if (originalSize != patch.OriginalSize)
+    {
+        fprintf(stderr, "%s is not the archive this patch was made for (size %llu instead of %llu)\n",
+            originalPath.c_str(), (unsigned long long)originalSize, (unsigned long long)patch.OriginalSize);
+        return 1;
+    }
+
+    error_code error;
+    if (fs::equivalent(fs::u8path(originalPath), fs::u8path(outputPath), error))
+    {
+        fprintf(stderr, "The output can't be the original archive\n");
+        return 1;
+    }
+
+    if (!FileUtil::Create(outputPath, patch.RebuiltSize))
+    {
+        fprintf(stderr, "Can't create %s\n", outputPath.c_str());
+        return 1;
+    }
+
+    vector<uint64_t> outputOffsets = GetOffsets(patch);
+
+    mutex errorMutex;
+    string errorMessage;
+    auto setError = [&](const string& message)
+    {
+        lock_guard lock(errorMutex);
+        if (errorMessage.empty())
+            errorMessage = message;
+    };
+
+    ParallelFor((int)patch.Pieces.size(), numThreads, [&]()
+    {
+        FilePtr pOriginal = OpenFile(originalPath, "rb");
+        FilePtr pPatch = OpenFile(patchPath, "rb");
+        FilePtr pOutput = OpenFile(outputPath, "r+b");
+        if (pOriginal == nullptr || pPatch == nullptr || pOutput == nullptr)
+            setError("Can't open the files");
+
+        return [&, pOriginal = move(pOriginal), pPatch = move(pPatch), pOutput = move(pOutput), buffer = vector<uint8_t>(ChunkSize)](int index) mutable
+        {
+            if (pOriginal == nullptr || pPatch == nullptr || pOutput == nullptr)
+                return;
+
+            const Piece& piece = patch.Pieces[index];
+            FILE* pSource = piece.Type == PieceType::Copy ? pOriginal.get() : pPatch.get();
+            uint64_t sourceOffset = piece.Type == PieceType::Copy ? piece.Source : patch.NewDataOffset + piece.Source;
+            Xxh64 hasher;
+            for (uint64_t done = 0; done < piece.Size; )
+            {
+                size_t count = (size_t)min<uint64_t>(piece.Size - done, buffer.size());
+                if (!FileUtil::ReadAt(pSource, sourceOffset + done, buffer.data(), count))
+                    return setError("Can't read " + (piece.Type == PieceType::Copy ? originalPath : patchPath));
+
+                hasher.Update(buffer.data(), count);
+                if (!FileUtil::WriteAt(pOutput.get(), outputOffsets[index] + done, buffer.data(), count))
+                    return setError("Can't write " + outputPath);
+
+                done += count;
+            }
+
+            if (hasher.Final() != piece.Hash)
+            {
+                if (piece.Type == PieceType::Copy)
+                    return setError(originalPath + " is not the archive this patch was made for (data at offset " + to_string(piece.Source) + " differs)");
+
+                return setError(patchPath + " is damaged");
+            }
+
+            if (fflush(pOutput.get()) != 0)
+                setError("Can't write " + outputPath);
+        };
+    });
+
+    if (!errorMessage.empty())
+    {
+        fprintf(stderr, "%s\n", errorMessage.c_str());
+        fs::remove(fs::u8path(outputPath), error);
+        return 1;
+    }
+
+    printf("Wrote %s (%llu bytes) from %s and %s\n", outputPath.c_str(), (unsigned long long)patch.RebuiltSize,
+        originalPath.c_str(), patchPath.c_str());
+    return 0;
+}
+
+static int Info(const string& patchPath)
+{
+    Patch patch;
+    if (!ReadPatch(patchPath, patch))
+    {
+        fprintf(stderr, "Not a valid patch: %s\n", patchPath.c_str());
+        return 1;
+    }
+
+    int numCopied = 0;
+    uint64_t copiedSize = 0;
+    for (const Piece& piece : patch.Pieces)
+    {
+        if (piece.Type == PieceType::Copy)
+        {
+            numCopied++;
+            copiedSize += piece.Size;
+        }
+    }
+
+    printf("Original archive: %llu bytes\n", (unsigned long long)patch.OriginalSize);
+    printf("Rebuilt archive:  %llu bytes\n", (unsigned long long)patch.RebuiltSize);
+    printf("%d entries (%llu bytes) copied from the original, %d pieces (%llu bytes) of new data\n",
+        numCopied, (unsigned long long)copiedSize, (int)patch.Pieces.size() - numCopied, (unsigned long long)patch.NewDataSize);
+    return 0;
+}
+
+static void PrintUsage()
+{
+    printf("Usage: PacDelta diff <original.pac> <rebuilt.pac> <patch.pacdelta> [threads]\n");
+    printf("       PacDelta apply <original.pac> <patch.pacdelta> <output.pac> [threads]\n");
+    printf("       PacDelta info <patch.pacdelta>\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    int numThreads = max(1, (int)thread::hardware_concurrency());
+    if (argc == 6)
+        numThreads = max(1, atoi(argv[5]));
+
+    string command = argv[1];
+    if (command == "diff" && (argc == 5 || argc == 6))
+        return Diff(argv[2], argv[3], argv[4], numThreads);
+
+    if (command == "apply" && (argc == 5 || argc == 6))
+        return Apply(argv[2], argv[3], argv[4], numThreads);
+
+    if (command == "info" && argc == 3)
+        return Info(argv[2]);
+
+    PrintUsage();
+    return 1;
+}
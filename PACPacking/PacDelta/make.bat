@@ -0,0 +1 @@
+g++ -o PacDelta.exe PacDelta.cpp ../Common/PacArchive.cpp ../Common/Xxh64.cpp -O2 -std=c++17 -Wall -pthread -static
@@ -0,0 +1,458 @@
+// PgdConvert: converts SoftPal PGD pictures to PNG and back, a native replacement for pgd2png_ge.py, png2pgd_ge.py
+// and the 11_C and PGD3 parts of pgd2png_others.py. Decoding gives the same pixels as the scripts. Encoding writes GE
+// pictures of compression type 1, 2 or 3, spreading each picture over several threads, or several pictures at a time
+// for folders; the output folder gets the same subfolders as the input.
+//
+// Build (Windows or Linux):
+//   g++ -O2 -std=c++17 -pthread -o PgdConvert PgdConvert.cpp ../Common/PgdCodec.cpp ../Common/PgdEncoder.cpp
+//       ../Common/PngFile.cpp ../Common/Zlib.cpp ../Common/PacArchive.cpp
+//
+// Usage:
+//   PgdConvert decode <input.pgd> [output.png]
+//   PgdConvert decode <input folder> <output folder> [--recursive] [--threads N]
+//   PgdConvert encode <input.png> [output.pgd] [options]
+//   PgdConvert encode <input folder> <output folder> [options] [--recursive] [--threads N]
+//
+// Encoding options:
+//   -m 1|2|3             GE compression type (default 3): 1 = BGRA planes, 2 = lossy YUV 4:2:0 without alpha,
+//                        3 = row differences
+//   --preset P           fast, normal (default) or max; slower presets search longer for matches
+//   -t <template>        Keeps the position and original size from an existing PGD file, or from the PGD with the
+//                        same name in a template folder
+//   --fill-color R,G,B   The color type 2 blends transparent pixels with (default 255,255,255)
+//   --verify             Decodes every new file again and checks that types 1 and 3 give the PNG's pixels back
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Common/PacArchive.h"
+#include "../Common/ParallelFor.h"
+#include "../Common/PgdCodec.h"
+#include "../Common/PgdEncoder.h"
+#include "../Common/PngFile.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static mutex OutputMutex;
+
+static void PrintError(const string& path, const string& message)
+{
+    lock_guard<mutex> lock(OutputMutex);
+    fprintf(stderr, "%s: %s\n", path.c_str(), message.c_str());
+}
+
+static bool HasExtension(const fs::path& path, const char* pExtension)
+{
+    string extension = path.extension().u8string();
+    transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+    return extension == pExtension;
+}
+
+// Lists the files with the given extension, sorted, relative to the folder
+static bool FindFiles(const fs::path& folder, const char* pExtension, bool recursive, vector<fs::path>& files)
+{
+    error_code error;
+    if (recursive)
+    {
+        for (fs::recursive_directory_iterator it(folder, error), end; !error && it != end; it.increment(error))
+        {
+            if (it->is_regular_file() && HasExtension(it->path(), pExtension))
+                files.push_back(it->path().lexically_relative(folder));
+        }
+    }
+    else
+    {
+        for (fs::directory_iterator it(folder, error), end; !error && it != end; it.increment(error))
+        {
+            if (it->is_regular_file() && HasExtension(it->path(), pExtension))
+                files.push_back(it->path().lexically_relative(folder));
+        }
+    }
+    sort(files.begin(), files.end());
+    return !error;
+}
+
+// Decodes a PGD file; PGD3 overlays are applied to their base picture, which has to be in the same folder
+static bool DecodeFile(const fs::path& path, PgdImage& image, string& error)
+{
+    vector<uint8_t> data;
+    if (!FileUtil::ReadAll(path.u8string(), data))
+    {
+        error = "can't read the file";
+        return false;
+    }
+
+    if (!PgdCodec::IsOverlay(data.data(), data.size()))
+        return PgdCodec::Decode(data.data(), data.size(), image, error);
+
+    fs::path basePath = path.parent_path() / fs::u8path(PgdCodec::GetOverlayBaseName(data.data(), data.size()));
+    vector<uint8_t> baseData;
+    if (!FileUtil::ReadAll(basePath.u8string(), baseData))
+    {
+        error = "can't read the base picture " + basePath.u8string();
+        return false;
+    }
+
+    return PgdCodec::Decode(baseData.data(), baseData.size(), image, error) &&
+           PgdCodec::ApplyOverlay(data.data(), data.size(), image, error);
+}
+
+static bool ConvertFile(const fs::path& inputPath, const fs::path& outputPath)
+{
+    PgdImage image;
+    string error;
+    if (!DecodeFile(inputPath, image, error))
+    {
+        PrintError(inputPath.u8string(), error);
+        return false;
+    }
+
+    vector<uint8_t> png = PngFile::Encode(image.Pixels.data(), image.Width, image.Height, image.Channels);
+    if (!FileUtil::WriteAll(outputPath.u8string(), png.data(), png.size()))
+    {
+        PrintError(outputPath.u8string(), "can't write the file");
+        return false;
+    }
+    return true;
+}
+
+static int Decode(const fs::path& input, fs::path output, bool recursive, int numThreads)
+{
+    auto start = chrono::steady_clock::now();
+    error_code error;
+    if (!fs::is_directory(input, error))
+    {
+        if (output.empty())
+            output = fs::path(input).replace_extension(".png");
+
+        return ConvertFile(input, output) ? 0 : 1;
+    }
+
+    if (output.empty())
+    {
+        fprintf(stderr, "Converting a folder needs an output folder\n");
+        return 1;
+    }
+
+    vector<fs::path> files;
+    if (!FindFiles(input, ".pgd", recursive, files))
+    {
+        fprintf(stderr, "Can't list the files in %s\n", input.u8string().c_str());
+        return 1;
+    }
+
+    atomic<int> numFailed = 0;
+    ParallelFor((int)files.size(), numThreads, [&]()
+    {
+        return [&](int index)
+        {
+            fs::path outputPath = output / fs::path(files[index]).replace_extension(".png");
+            error_code error;
+            fs::create_directories(outputPath.parent_path(), error);
+            if (!ConvertFile(input / files[index], outputPath))
+                numFailed++;
+        };
+    });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%d of %d files converted in %.2f s, %d at a time\n", (int)files.size() - numFailed, (int)files.size(),
+        seconds, min(numThreads, max((int)files.size(), 1)));
+    return numFailed == 0 ? 0 : 1;
+}
+
+struct EncodeSettings
+{
+    PgdEncodeOptions    Options;
+    fs::path            Template;       // A PGD file, or a folder with a PGD for each PNG
+    bool                Verify = false;
+};
+
+// Reads the template header for a PNG. Without a template, or without a matching file in a template folder, the
+// header gets the picture's own size.
+static bool ReadTemplate(const EncodeSettings& settings, const fs::path& inputPath, vector<uint8_t>& data, string& error)
+{
+    if (settings.Template.empty())
+        return true;
+
+    fs::path path = settings.Template;
+    error_code errorCode;
+    if (fs::is_directory(path, errorCode))
+    {
+        fs::path stem = inputPath.stem();
+        path = path / fs::path(stem).concat(".pgd");
+        if (!fs::exists(path, errorCode))
+            path = settings.Template / fs::path(stem).concat(".PGD");
+        if (!fs::exists(path, errorCode))
+            return true;
+    }
+
+    if (!FileUtil::ReadAll(path.u8string(), data) || data.size() < 0x20 || memcmp(data.data(), "GE", 2) != 0)
+    {
+        error = "can't read the template " + path.u8string();
+        return false;
+    }
+    return true;
+}
+
+// Decodes a new file and compares it to the picture it was made from. Type 2 is lossy, so only its size is checked.
+static bool VerifyFile(const vector<uint8_t>& pgd, const PgdImage& image, int method, string& error)
+{
+    PgdImage decoded;
+    if (!PgdCodec::Decode(pgd.data(), pgd.size(), decoded, error))
+        return false;
+
+    if (method == 2)
+    {
+        if (decoded.Width != ((image.Width + 1) & ~1) || decoded.Height != ((image.Height + 1) & ~1))
+        {
+            error = "the decoded picture has the wrong size";
+            return false;
+        }
+        return true;
+    }
+
+    if (decoded.Width != image.Width || decoded.Height != image.Height)
+    {
+        error = "the decoded picture has the wrong size";
+        return false;
+    }
+
+    // Type 1 always has alpha, which is opaque for BGR pictures
+    size_t numPixels = (size_t)image.Width * image.Height;
+    for (size_t i = 0; i < numPixels; i++)
+    {
+        const uint8_t* pExpected = image.Pixels.data() + i * image.Channels;
+        const uint8_t* pDecoded = decoded.Pixels.data() + i * decoded.Channels;
+        if (memcmp(pExpected, pDecoded, 3) != 0 ||
+            (decoded.Channels == 4 && pDecoded[3] != (image.Channels == 4 ? pExpected[3] : 0xFF)))
+        {
+            error = "the decoded picture differs from the PNG at pixel " + to_string(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool EncodeFile(const fs::path& inputPath, const fs::path& outputPath, const EncodeSettings& settings,
+                       int numThreads)
+{
+    vector<uint8_t> png;
+    if (!FileUtil::ReadAll(inputPath.u8string(), png))
+    {
+        PrintError(inputPath.u8string(), "can't read the file");
+        return false;
+    }
+
+    PgdImage image;
+    string error;
+    if (!PngFile::Decode(png.data(), png.size(), image.Width, image.Height, image.Channels, image.Pixels, error))
+    {
+        PrintError(inputPath.u8string(), error);
+        return false;
+    }
+    png = vector<uint8_t>();
+
+    vector<uint8_t> templateData;
+    if (!ReadTemplate(settings, inputPath, templateData, error))
+    {
+        PrintError(inputPath.u8string(), error);
+        return false;
+    }
+
+    // png2pgd_ge.py resizes the picture to the template's size; here the sizes have to match
+    PgdEncodeOptions options = settings.Options;
+    options.NumThreads = numThreads;
+    if (!templateData.empty())
+    {
+        uint32_t templateWidth;
+        uint32_t templateHeight;
+        memcpy(&templateWidth, templateData.data() + 0xC, 4);
+        memcpy(&templateHeight, templateData.data() + 0x10, 4);
+        if (templateWidth != (uint32_t)image.Width || templateHeight != (uint32_t)image.Height)
+        {
+            PrintError(inputPath.u8string(), "the picture is " + to_string(image.Width) + "x" + to_string(image.Height) +
+                       " but the template is " + to_string(templateWidth) + "x" + to_string(templateHeight));
+            return false;
+        }
+        options.pTemplate = templateData.data();
+    }
+
+    vector<uint8_t> pgd;
+    if (!PgdEncoder::Encode(image, options, pgd, error))
+    {
+        PrintError(inputPath.u8string(), error);
+        return false;
+    }
+
+    if (settings.Verify && !VerifyFile(pgd, image, options.Method, error))
+    {
+        PrintError(outputPath.u8string(), "verification failed: " + error);
+        return false;
+    }
+
+    if (!FileUtil::WriteAll(outputPath.u8string(), pgd.data(), pgd.size()))
+    {
+        PrintError(outputPath.u8string(), "can't write the file");
+        return false;
+    }
+    return true;
+}
+
+static int Encode(const fs::path& input, fs::path output, const EncodeSettings& settings, bool recursive, int numThreads)
+{
+    auto start = chrono::steady_clock::now();
+    error_code error;
+    if (!fs::is_directory(input, error))
+    {
+        if (output.empty())
+            output = fs::path(input).replace_extension(".pgd");
+
+        return EncodeFile(input, output, settings, numThreads) ? 0 : 1;
+    }
+
+    if (output.empty())
+    {
+        fprintf(stderr, "Converting a folder needs an output folder\n");
+        return 1;
+    }
+
+    vector<fs::path> files;
+    if (!FindFiles(input, ".png", recursive, files))
+    {
+        fprintf(stderr, "Can't list the files in %s\n", input.u8string().c_str());
+        return 1;
+    }
+
+    // Pictures are encoded several at a time; threads left over when there are fewer pictures than threads go to
+    // the bands of each picture. The names get the upper case extension of the files in the pac archives.
+    int threadsPerFile = max(1, numThreads / max((int)files.size(), 1));
+    atomic<int> numFailed = 0;
+    ParallelFor((int)files.size(), numThreads, [&]()
+    {
+        return [&](int index)
+        {
+            fs::path outputPath = output / fs::path(files[index]).replace_extension(".PGD");
+            error_code error;
+            fs::create_directories(outputPath.parent_path(), error);
+            if (!EncodeFile(input / files[index], outputPath, settings, threadsPerFile))
+                numFailed++;
+        };
+    });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%d of %d files converted in %.2f s, %d at a time\n", (int)files.size() - numFailed, (int)files.size(),
+        seconds, min(numThreads, max((int)files.size(), 1)));
+    return numFailed == 0 ? 0 : 1;
+}
+
+static bool ParsePreset(const string& text, PgdPreset& preset)
+{
+    if (text == "fast")
+        preset = PgdPreset::Fast;
+    else if (text == "normal")
+        preset = PgdPreset::Normal;
+    else if (text == "max")
+        preset = PgdPreset::Max;
+    else
+        return false;
+
+    return true;
+}
+
+static bool ParseFillColor(const char* pText, uint8_t* pColor)
+{
+    int r;
+    int g;
+    int b;
+    if (sscanf(pText, "%d,%d,%d", &r, &g, &b) != 3 || r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)
+        return false;
+
+    pColor[0] = (uint8_t)b;
+    pColor[1] = (uint8_t)g;
+    pColor[2] = (uint8_t)r;
+    return true;
+}
+
+static void PrintUsage()
+{
+    printf("Usage: PgdConvert decode <input.pgd> [output.png]\n");
+    printf("       PgdConvert decode <input folder> <output folder> [--recursive] [--threads N]\n");
+    printf("       PgdConvert encode <input.png> [output.pgd] [options]\n");
+    printf("       PgdConvert encode <input folder> <output folder> [options] [--recursive] [--threads N]\n");
+    printf("Encoding options: -m 1|2|3, --preset fast|normal|max, -t <template.pgd or folder>,\n");
+    printf("                  --fill-color R,G,B, --verify\n");
+}
+
+int main(int argc, char** argv)
+{
+    vector<string> args;
+    bool recursive = false;
+    int numThreads = max(1, (int)thread::hardware_concurrency());
+    EncodeSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--recursive") == 0)
+        {
+            recursive = true;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            numThreads = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            settings.Options.Method = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--preset") == 0 && i + 1 < argc)
+        {
+            if (!ParsePreset(argv[++i], settings.Options.Preset))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            settings.Template = fs::u8path(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fill-color") == 0 && i + 1 < argc)
+        {
+            if (!ParseFillColor(argv[++i], settings.Options.FillColor))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--verify") == 0)
+        {
+            settings.Verify = true;
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() >= 2 && args.size() <= 3 && args[0] == "decode")
+        return Decode(fs::u8path(args[1]), args.size() == 3 ? fs::u8path(args[2]) : fs::path(), recursive, numThreads);
+
+    if (args.size() >= 2 && args.size() <= 3 && args[0] == "encode" && settings.Options.Method >= 1 &&
+        settings.Options.Method <= 3)
+    {
+        return Encode(fs::u8path(args[1]), args.size() == 3 ? fs::u8path(args[2]) : fs::path(), settings, recursive,
+                      numThreads);
+    }
+
+    PrintUsage();
+    return 1;
+}
@@ -0,0 +1 @@
+g++ -o PgdConvert.exe PgdConvert.cpp ../Common/PgdCodec.cpp ../Common/PgdEncoder.cpp ../Common/PngFile.cpp ../Common/Zlib.cpp ../Common/PacArchive.cpp -O2 -std=c++17 -Wall -pthread -static
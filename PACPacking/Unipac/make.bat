@@ -1,2 +1,2 @@
-gcc -o unipack.exe unipack.c -O3 -Wall
+gcc -o unipack.exe unipack.c -O3 -Wall -pthread -static
 copy unipack.exe c:\apps\vnutils
@@ -5,32 +5,101 @@
    with the following functionality:
    - support for flyable heart (old format) and new format (signature "PAC ")
    - can update existing archive with only a few files
+   - can list and extract (decrypting) the files in an archive
+   - can update an archive in place, writing only the files that changed (see update)
 
-   doesn't support extracting from archives (use garbro or fuckpac), or creating new
-   archives from scratch, or adding (not replacing) a new file to an existing archive
+   doesn't support creating new archives from scratch, or adding (not replacing) a new
+   file to an existing archive
 
    in other words, the set of files inside an archive never changes (just the contents)
+
+   the archive is streamed: only the header and directory are held in memory. the new
+   directory is computed from the file sizes first, then unchanged entries are copied
+   straight from the old archive (copy_file_range/sendfile on linux, chunked reads
+   elsewhere) and replacements are read and encrypted chunk by chunk. on x86 the cipher
+   runs on 32 bytes at a time with avx2 or sse2, picked at runtime. replacements are read
+   on a second thread, so reading them overlaps with writing the archive.
+
+   a manifest lists several archives with their directories; these are packed in parallel
+   on a pool of worker threads, and each archive's output is printed when it's done,
+   followed by its throughput.
+
+   builds on windows (mingw) and linux.
 */
 
+#define _FILE_OFFSET_BITS 64
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#define makedir(name) _mkdir(name)
+#define syncfd(fd) _commit(fd)
+#define truncatefd(fd,len) _chsize_s(fd,len)
+#else
+#include <sys/stat.h>
+#define makedir(name) mkdir(name,0777)
+#define syncfd(fd) fsync(fd)
+#define truncatefd(fd,len) ftruncate(fd,len)
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#define PATHSEP '\\'
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#define PATHSEP '/'
+#endif
 
 #define LARGE 1000
+#define CHUNK (1<<20)	// multiple of 4, so chunks stay aligned to the cipher's dwords
+
+typedef long long i64;
 
 void usage() {
 	puts("usage: unipack pac-file directory-with-files-to-pack");
+	puts("       unipack unpack pac-file [output-directory]");
+	puts("       unipack manifest manifest-file [threads]");
+	puts("       unipack update pac-file directory-with-files-to-pack [--compact]");
 	puts("example: unipack data.pac data\\");
 	puts("writes to {outfile}.new, so data.pac => data.pac.new");
+	puts("unpack lists the files in the archive, or extracts them if given a directory");
+	puts("manifest packs several archives at once: one line per archive, pac-file<tab>directory");
+	puts("update changes the archive in place, writing only the files that differ; --compact then");
+	puts("rewrites it without the space left behind by files that moved or shrank");
 	exit(0);
 }
 
-char *a;		// infile (.pac)
-char *anew;	// outfile (.pac)
+#define fail(...) (printf(__VA_ARGS__),exit(1))
 
 unsigned getint4(char *b,int i) {
 	unsigned char *a=(unsigned char *)b;
-  return a[i]+(a[i+1]<<8)+(a[i+2]<<16)+(a[i+3]<<24);
+  return a[i]+(a[i+1]<<8)+(a[i+2]<<16)+((unsigned)a[i+3]<<24);
 }
 
 void writeint4(char *b,int i,unsigned val) {
@@ -41,23 +110,35 @@ void writeint4(char *b,int i,unsigned val) {
 	a[i+3]=(val>>24);
 }
 
-void readfile(char *name,unsigned *len,char **b) {
-	FILE *f=fopen(name,"rb");
-	if(!f) printf("file %s couldn't be opened\n",name),exit(0);
-	fseek(f,0,SEEK_END);
-	*len=ftell(f);
-	fseek(f,0,SEEK_SET);
-	*b=malloc(*len);
-	if(!*b) printf("out of memory\n"),exit(0);
-	if(*len!=fread(*b,1,*len,f)) printf("didn't read enough bytes\n"),exit(0);
-	fclose(f);	
+FILE *openfile(char *name,char *mode) {
+	FILE *f=fopen(name,mode);
+	if(!f) fail("file %s couldn't be opened\n",name);
+	return f;
 }
 
-void writefile(char *name,unsigned len,char *b) {
-	FILE *f=fopen(name,"wb");
-	if(!f) printf("file %s couldn't be opened for writing\n",name),exit(0);
-	if(len!=fwrite(b,1,len,f)) printf("didn't write enough bytes\n"),exit(0);
-	fclose(f);
+i64 filesize(FILE *f) {
+	fseek64(f,0,SEEK_END);
+	i64 len=ftell64(f);
+	fseek64(f,0,SEEK_SET);
+	return len;
+}
+
+void readat(FILE *f,i64 pos,char *b,unsigned len) {
+	if(fseek64(f,pos,SEEK_SET) || len!=fread(b,1,len,f)) fail("didn't read enough bytes\n");
+}
+
+void writeall(FILE *f,char *b,unsigned len) {
+	if(len!=fwrite(b,1,len,f)) fail("didn't write enough bytes\n");
+}
+
+void writeat(FILE *f,i64 pos,char *b,unsigned len) {
+	if(fseek64(f,pos,SEEK_SET)) fail("didn't write enough bytes\n");
+	writeall(f,b,len);
+}
+
+/* flushes the file all the way to disk */
+void syncfile(FILE *f) {
+	if(fflush(f) || syncfd(fileno(f))) fail("couldn't flush to disk\n");
 }
 
 unsigned char ror(int val,int n) {
@@ -65,86 +146,748 @@ unsigned char ror(int val,int n) {
 	return (val >> n) | (val << (8 - n));
 }
 
-void encrypt(char *a,int len) {
-	int count=(len-0x10)/4;
-	unsigned char *p=(unsigned char *)a+0x10;
-	unsigned key1=0x084DF873;
-	unsigned key2=0xFF987DEE;
-	unsigned c=0x04;
-	for(int i=0;i<count;i++) {
-		unsigned *dp=(unsigned *)p;
-		*dp^=key1^key2;
-		p=(unsigned char*)dp;
-		*p=ror(*p,c++);
-		c&=0xff;
-		p+=4;
+/* the cipher works on the whole dwords from offset 0x10 on: encryption xors each with key1^key2, then
+   rotates its first byte right by 4, 5, 6, ... (mod 8). a dword's rotation only depends on its offset,
+   so any part of a file can be processed on its own, and every 8 dwords the pattern repeats */
+#define KEY (0x084DF873^0xFF987DEE)
+
+void cryptdword(unsigned char *p,unsigned index,int dec) {
+	int n=(index+4)&7;
+	if(dec) p[0]=ror(p[0],8-n);
+	p[0]^=KEY&255;
+	p[1]^=(KEY>>8)&255;
+	p[2]^=(KEY>>16)&255;
+	p[3]^=(unsigned)KEY>>24;
+	if(!dec) p[0]=ror(p[0],n);
+}
+
+#ifdef X86SIMD
+/* vector versions for blocks of 8 dwords starting at a dword index that's a multiple of 8. the rotation
+   of the low byte of each dword is done with a 16-bit multiply by a per-lane power of two: x<<m puts
+   ror(x,8-m) in bits 0-15 split across the two bytes, which are then or'ed together.
+   return the number of bytes processed */
+__attribute__((target("sse2")))
+unsigned cipher_sse2(unsigned char *p,unsigned len,int dec) {
+	__m128i key=_mm_set1_epi32(KEY),low=_mm_set1_epi32(0xff);
+	__m128i m0=dec?_mm_setr_epi32(16,32,64,128):_mm_setr_epi32(16,8,4,2);
+	__m128i m1=dec?_mm_setr_epi32(1,2,4,8):_mm_setr_epi32(256,128,64,32);
+	unsigned i=0;
+	for(;i+32<=len;i+=32) {
+		for(int h=0;h<2;h++) {
+			__m128i v=_mm_loadu_si128((__m128i *)(p+i+16*h));
+			if(!dec) v=_mm_xor_si128(v,key);
+			__m128i y=_mm_mullo_epi16(_mm_and_si128(v,low),h?m1:m0);
+			y=_mm_and_si128(_mm_or_si128(y,_mm_srli_epi16(y,8)),low);
+			v=_mm_or_si128(_mm_andnot_si128(low,v),y);
+			if(dec) v=_mm_xor_si128(v,key);
+			_mm_storeu_si128((__m128i *)(p+i+16*h),v);
+		}
 	}
+	return i;
 }
 
-int main(int argc,char **argv) {
-	if(argc<3) usage();
-	if(strlen(argv[2])>LARGE-40) printf("directory too long\n"),exit(0);
-	unsigned alen,alen2;
-	readfile(argv[1],&alen,&a);
-	alen2=alen+10000000; // magic constant, increase if we run out of memory
-	anew=malloc(alen2);
-	if(!anew) printf("out of memory\n"),exit(0);
-	unsigned filesaddr,diraddr;
-	if(a[0]=='P' && a[1]=='A' && a[2]=='C' && a[3]==' ') {
+__attribute__((target("avx2")))
+unsigned cipher_avx2(unsigned char *p,unsigned len,int dec) {
+	__m256i key=_mm256_set1_epi32(KEY),low=_mm256_set1_epi32(0xff);
+	__m256i m=dec?_mm256_setr_epi32(16,32,64,128,1,2,4,8):_mm256_setr_epi32(16,8,4,2,256,128,64,32);
+	unsigned i=0;
+	for(;i+32<=len;i+=32) {
+		__m256i v=_mm256_loadu_si256((__m256i *)(p+i));
+		if(!dec) v=_mm256_xor_si256(v,key);
+		__m256i y=_mm256_mullo_epi16(_mm256_and_si256(v,low),m);
+		y=_mm256_and_si256(_mm256_or_si256(y,_mm256_srli_epi16(y,8)),low);
+		v=_mm256_or_si256(_mm256_andnot_si256(low,v),y);
+		if(dec) v=_mm256_xor_si256(v,key);
+		_mm256_storeu_si256((__m256i *)(p+i),v);
+	}
+	return i;
+}
+#endif
+
+int simd;	// set by pickcipher before any threads start
+
+void pickcipher() {
+#ifdef X86SIMD
+	simd=__builtin_cpu_supports("avx2")?2:__builtin_cpu_supports("sse2")?1:0;
+#endif
+}
+
+/* encrypts or decrypts len bytes of a file, starting at offset pos (a multiple of 4) */
+void cipher(char *a,unsigned len,unsigned pos,int dec) {
+	unsigned char *p=(unsigned char *)a;
+	unsigned i=pos<0x10?0x10-pos:0;
+	if(i>=len) return;
+	for(;i+4<=len && (pos+i-0x10)/4%8;i+=4) cryptdword(p+i,(pos+i-0x10)/4,dec);
+#ifdef X86SIMD
+	if(simd==2) i+=cipher_avx2(p+i,len-i,dec);
+	else if(simd==1) i+=cipher_sse2(p+i,len-i,dec);
+#endif
+	for(;i+4<=len;i+=4) cryptdword(p+i,(pos+i-0x10)/4,dec);
+}
+
+/* copies len bytes at pos in the old archive to the current end of the new one */
+void copyrange(FILE *in,i64 pos,FILE *out,unsigned len,char *buf) {
+#ifdef __linux__
+	// let the kernel copy (or share extents) without going through our buffer
+	if(fflush(out)) fail("didn't write enough bytes\n");
+	i64 outpos=ftell64(out);
+	off_t inoff=pos,outoff=outpos;
+	unsigned left=len;
+	while(left) {
+		ssize_t n=copy_file_range(fileno(in),&inoff,fileno(out),&outoff,left,0);
+		if(n<=0) break;
+		left-=n;
+	}
+	if(left && lseek(fileno(out),outoff,SEEK_SET)==outoff) {
+		while(left) {
+			ssize_t n=sendfile(fileno(out),fileno(in),&inoff,left);
+			if(n<=0) break;
+			left-=n;
+			outoff+=n;
+		}
+	}
+	fseek64(out,outoff,SEEK_SET);
+	pos=inoff;
+	len=left;
+#endif
+	while(len) {
+		unsigned n=len<CHUNK?len:CHUNK;
+		readat(in,pos,buf,n);
+		writeall(out,buf,n);
+		pos+=n;
+		len-=n;
+	}
+}
+
+/* path of the replacement for an archive entry; the name field is 0x20 bytes, not always terminated */
+void entrypath(char *s,char *dir,char *entry) {
+	strcpy(s,dir);
+	int n=strlen(s);
+	if(n && s[n-1]!='\\' && s[n-1]!='/') s[n++]=PATHSEP;
+	memcpy(s+n,entry,0x20);
+	s[n+0x20]=0;
+}
+
+/* the header and directory of an archive; everything else stays on disk */
+typedef struct {
+	FILE *f;
+	i64 len;
+	unsigned diraddr,numfiles;
+	unsigned at;	// end of the directory
+	char *dir;	// the first at bytes of the archive
+} pac;
+
+void openpac(pac *p,char *name,char *mode) {
+	char s[LARGE];
+	sprintf(s,"%s.journal",name);
+	FILE *j=fopen(s,"rb");
+	if(j) fail("%s exists: an update of %s was interrupted. run unipack update on it to roll the update back\n",s,name);
+	p->f=openfile(name,mode);
+	p->len=filesize(p->f);
+	char sig[4];
+	if(p->len<4) fail("not a pac file\n");
+	readat(p->f,0,sig,4);
+	unsigned filesaddr;
+	if(sig[0]=='P' && sig[1]=='A' && sig[2]=='C' && sig[3]==' ') {
 		filesaddr=0x8;
-		diraddr=0x804;
+		p->diraddr=0x804;
 	} else {
 		filesaddr=0;
-		diraddr=0x3fe;
+		p->diraddr=0x3fe;
+	}
+	if(p->len<p->diraddr) fail("not a pac file\n");
+	char n4[4];
+	readat(p->f,filesaddr,n4,4);
+	p->numfiles=getint4(n4,0);
+	if(p->numfiles>(p->len-p->diraddr)/0x28) fail("not a pac file\n");
+	p->at=p->diraddr+0x28*p->numfiles;
+	p->dir=malloc(p->at);
+	if(!p->dir) fail("out of memory\n");
+	readat(p->f,0,p->dir,p->at);
+}
+
+/* one archive to pack. output is collected in log and printed in one piece when the archive is done,
+   so archives packed at the same time don't interleave their lines */
+typedef struct {
+	char *pacname,*dirname;
+	char *prefix;	// put before each line, 0 to print lines right away
+	char *log;
+	unsigned loglen,logsize;
+} job;
+
+void say(job *j,char *fmt,...) {
+	va_list va;
+	char line[LARGE*2];
+	va_start(va,fmt);
+	vsnprintf(line,sizeof(line),fmt,va);
+	va_end(va);
+	if(!j->prefix) {
+		fputs(line,stdout);
+		return;
+	}
+	unsigned n=strlen(j->prefix)+2+strlen(line);
+	if(j->loglen+n+1>j->logsize) {
+		j->logsize=(j->loglen+n+1)*2;
+		j->log=realloc(j->log,j->logsize);
+		if(!j->log) fail("out of memory\n");
+	}
+	j->loglen+=sprintf(j->log+j->loglen,"%s: %s",j->prefix,line);
+}
+
+double now() {
+#ifdef _WIN32
+	LARGE_INTEGER t,f;
+	QueryPerformanceCounter(&t);
+	QueryPerformanceFrequency(&f);
+	return (double)t.QuadPart/f.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC,&t);
+	return t.tv_sec+t.tv_nsec/1e9;
+#endif
+}
+
+/* the replacement files are read (and encrypted) by a second thread into a ring of chunks, in
+   directory order, while the packing thread copies the unchanged entries and writes the chunks out.
+   each file is a whole number of chunks, the last one possibly short */
+#define RING 4
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	char *buf[RING];
+	unsigned len[RING];
+	unsigned head,tail;	// chunks read, chunks written
+	char *dirname,*olddir,*dir,*replaced;
+	unsigned diraddr,numfiles;
+} ring;
+
+void *readreplacements(void *arg) {
+	ring *r=arg;
+	char s[LARGE];
+	for(unsigned fileno=0;fileno<r->numfiles;fileno++) {
+		if(!r->replaced[fileno]) continue;
+		unsigned e=r->diraddr+0x28*fileno,len=getint4(r->dir,e+0x20);
+		entrypath(s,r->dirname,r->olddir+e);
+		FILE *f=openfile(s,"rb");
+		if(filesize(f)!=len) fail("file %s changed size while packing\n",s);
+		int enc=0;
+		for(unsigned pos=0;pos<len;) {
+			pthread_mutex_lock(&r->lock);
+			while(r->head-r->tail==RING) pthread_cond_wait(&r->cond,&r->lock);
+			pthread_mutex_unlock(&r->lock);
+			char *buf=r->buf[r->head%RING];
+			unsigned n=len-pos<CHUNK?len-pos:CHUNK;
+			if(n!=fread(buf,1,n,f)) fail("didn't read enough bytes\n");
+			if(pos==0) enc=buf[0]=='$';
+			if(enc) cipher(buf,n,pos,0);
+			pthread_mutex_lock(&r->lock);
+			r->len[r->head%RING]=n;
+			r->head++;
+			pthread_cond_signal(&r->cond);
+			pthread_mutex_unlock(&r->lock);
+			pos+=n;
+		}
+		fclose(f);
 	}
-	int numfiles=getint4(a,filesaddr);
-	unsigned at=diraddr+0x28*numfiles;
+	return 0;
+}
+
+/* writes the next len bytes the reader produced to the new archive */
+void writereplacement(ring *r,unsigned len,FILE *out) {
+	while(len) {
+		pthread_mutex_lock(&r->lock);
+		while(r->head==r->tail) pthread_cond_wait(&r->cond,&r->lock);
+		pthread_mutex_unlock(&r->lock);
+		unsigned n=r->len[r->tail%RING];
+		writeall(out,r->buf[r->tail%RING],n);
+		len-=n;
+		pthread_mutex_lock(&r->lock);
+		r->tail++;
+		pthread_cond_signal(&r->cond);
+		pthread_mutex_unlock(&r->lock);
+	}
+}
+
+void pack(job *j) {
+	double start=now();
+	pac a;
+	openpac(&a,j->pacname,"rb");
+	unsigned diraddr=a.diraddr,numfiles=a.numfiles,at=a.at;
 	// i have no idea what the stuff before the directory entries is, just copy it verbatim
 	// it looks like a number that gradually increases towards the number of files
-	memcpy(anew,a,at);
+	char *dir=malloc(at),*olddir=a.dir,*replaced=calloc(numfiles+1,1);
+	char *buf=malloc(CHUNK);
+	if(!dir || !replaced || !buf) fail("out of memory\n");
+	memcpy(dir,olddir,at);
 
+	// first pass: lay out the new archive. at is the address where the next file is to be written
 	char s[LARGE];
-	// loop over each file in archive directory, try to read file, update archive if it exists
-	// at is the address where the next file is to be written
-	for(int fileno=0;fileno<numfiles;fileno++) {
-		char *curfile;
-		unsigned curlen;
-		// check if file exists
-		strcpy(s,argv[2]);
-		if(s[strlen(s)-1]!='\\') strcat(s,"\\");
-		strcat(s,a+diraddr);
-		FILE *f=fopen(s,"rb");
+	i64 end=at;
+	unsigned numreplaced=0;
+	for(unsigned fileno=0;fileno<numfiles;fileno++) {
+		unsigned e=diraddr+0x28*fileno;
+		unsigned curlen=getint4(olddir,e+0x20);
+		FILE *f=0;
+		if(j->dirname) {
+			entrypath(s,j->dirname,olddir+e);
+			f=fopen(s,"rb");
+		}
 		if(!f) {
 			// file doesn't exist, keep file in old .pac file
-			if(at+getint4(a,diraddr+0x20)>alen2) printf("out of memory, new archive too large\n"),exit(0);
-			memcpy(anew+at,a+getint4(a,diraddr+0x24),getint4(a,diraddr+0x20));
-			writeint4(anew,diraddr+0x24,at);
-			at+=getint4(a,diraddr+0x20);
+			if((i64)getint4(olddir,e+0x24)+curlen>a.len) fail("entry %u lies outside the archive\n",fileno);
 		} else {
-			// file exists, read it and add to new .pac file
-			printf("update archive with %s\n",a+diraddr);
+			i64 len=filesize(f);
 			fclose(f);
-			readfile(s,&curlen,&curfile);
-			if(at+curlen>alen2) printf("out of memory, new archive too large\n"),exit(0);
-			// encrypt
-			if(curfile[0]=='$') encrypt(curfile,curlen);
-			memcpy(anew+at,curfile,curlen);
-			writeint4(anew,diraddr+0x20,curlen);
-			writeint4(anew,diraddr+0x24,at);
-			at+=curlen;
-			free(curfile);
-		}
-		diraddr+=0x28;
-	}
-	if(at+4>alen2) printf("out of memory, new archive too large\n"),exit(0);
-	anew[at++]='E';
-	anew[at++]='O';
-	anew[at++]='F';
-	anew[at++]=' ';
-	if(strlen(argv[1])>LARGE-5) printf("archive filename too long\n"),exit(0);
-	strcpy(s,argv[1]);
+			if(len>0xffffffffLL) fail("file %s too large\n",s);
+			curlen=(unsigned)len;
+			replaced[fileno]=1;
+			numreplaced++;
+		}
+		writeint4(dir,e+0x20,curlen);
+		writeint4(dir,e+0x24,(unsigned)end);
+		end+=curlen;
+		if(end+4>0xffffffffLL) fail("new archive too large, offsets are 32-bit\n");
+	}
+
+	// second pass: stream the entries in directory order
+	ring r={.dirname=j->dirname,.olddir=olddir,.dir=dir,.replaced=replaced,.diraddr=diraddr,.numfiles=numfiles};
+	pthread_t reader;
+	if(numreplaced) {
+		pthread_mutex_init(&r.lock,0);
+		pthread_cond_init(&r.cond,0);
+		for(int i=0;i<RING;i++) if(!(r.buf[i]=malloc(CHUNK))) fail("out of memory\n");
+		if(pthread_create(&reader,0,readreplacements,&r)) fail("can't start thread\n");
+	}
+	strcpy(s,j->pacname);
 	strcat(s,".new");
-	writefile(s,at,anew);
-	puts("archive updated");
+	FILE *out=openfile(s,"wb");
+	writeall(out,dir,at);
+	for(unsigned fileno=0;fileno<numfiles;fileno++) {
+		unsigned e=diraddr+0x28*fileno;
+		if(replaced[fileno]) {
+			say(j,"update archive with %.32s\n",olddir+e);
+			writereplacement(&r,getint4(dir,e+0x20),out);
+		} else {
+			copyrange(a.f,getint4(olddir,e+0x24),out,getint4(olddir,e+0x20),buf);
+		}
+	}
+	writeall(out,"EOF ",4);
+	if(fclose(out)) fail("didn't write enough bytes\n");
+	if(numreplaced) {
+		pthread_join(reader,0);
+		for(int i=0;i<RING;i++) free(r.buf[i]);
+		pthread_mutex_destroy(&r.lock);
+		pthread_cond_destroy(&r.cond);
+	}
+	fclose(a.f);
+	free(a.dir);
+	free(dir);
+	free(replaced);
+	free(buf);
+	if(j->prefix) {
+		double t=now()-start,mb=(end+4)/1048576.0;
+		say(j,"%u of %u files replaced, %.1f MB written in %.2f s (%.1f MB/s)\n",numreplaced,numfiles,mb,t,t>0?mb/t:0);
+	}
+	say(j,"archive updated\n");
+}
+
+/* manifest mode: each line names an archive and its directory of replacements, separated by a tab.
+   the archives are packed by a pool of worker threads, each taking the next archive in the list */
+job *jobs;
+int numjobs,nextjob;
+pthread_mutex_t joblock=PTHREAD_MUTEX_INITIALIZER;
+
+void *worker(void *arg) {
+	(void)arg;
+	for(;;) {
+		pthread_mutex_lock(&joblock);
+		int i=nextjob++;
+		pthread_mutex_unlock(&joblock);
+		if(i>=numjobs) return 0;
+		pack(jobs+i);
+		pthread_mutex_lock(&joblock);
+		fwrite(jobs[i].log,1,jobs[i].loglen,stdout);
+		fflush(stdout);
+		pthread_mutex_unlock(&joblock);
+	}
+}
+
+int numcpus() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+int packmanifest(char *name,int numthreads) {
+	FILE *f=openfile(name,"r");
+	char line[LARGE*2];
+	int size=0;
+	while(fgets(line,sizeof(line),f)) {
+		line[strcspn(line,"\r\n")]=0;
+		if(!line[0] || line[0]=='#') continue;
+		char *tab=strchr(line,'\t');
+		if(!tab) fail("%s: expected archive<tab>directory, got %s\n",name,line);
+		*tab=0;
+		if(strlen(line)>LARGE-10) fail("archive filename too long\n");
+		if(strlen(tab+1)>LARGE-40) fail("directory too long\n");
+		for(int i=0;i<numjobs;i++) if(!strcmp(jobs[i].pacname,line)) fail("%s is in the manifest twice\n",line);
+		if(numjobs==size) {
+			size=size?size*2:16;
+			jobs=realloc(jobs,size*sizeof(job));
+			if(!jobs) fail("out of memory\n");
+		}
+		job *j=jobs+numjobs++;
+		memset(j,0,sizeof(job));
+		j->pacname=strdup(line);
+		j->dirname=strdup(tab+1);
+		j->prefix=j->pacname;
+	}
+	fclose(f);
+	if(numthreads<1) numthreads=numcpus();
+	if(numthreads>numjobs) numthreads=numjobs;
+	double start=now();
+	pthread_t *threads=malloc(numthreads*sizeof(pthread_t));
+	for(int i=0;i<numthreads;i++) if(pthread_create(threads+i,0,worker,0)) fail("can't start thread\n");
+	for(int i=0;i<numthreads;i++) pthread_join(threads[i],0);
+	printf("%d archives updated in %.2f s, %d at a time\n",numjobs,now()-start,numthreads);
+	for(int i=0;i<numjobs;i++) {
+		free(jobs[i].pacname);
+		free(jobs[i].dirname);
+		free(jobs[i].log);
+	}
+	free(jobs);
+	free(threads);
+	return 0;
+}
+
+/* incremental update: changes the archive in place instead of writing a new one. replacements that
+   are the same as the entry they replace are skipped, ones that fit in the old entry's space are
+   written over it, and larger ones go at the end, before the EOF marker. only the directory records
+   of changed entries are rewritten. the space given up by moved or shrunk entries stays in the
+   archive until --compact, which rewrites it like a normal pack and puts it in place of the old one.
+
+   before anything is changed, the bytes about to be overwritten are saved in {pac}.journal, along
+   with the archive's length. if the update is interrupted, the next one finds the journal and puts
+   the saved bytes back, leaving the archive as it was. the journal ends with a hash of its contents:
+   one that doesn't match was being written when the update stopped, before the archive changed.
+   journal: "UPJ1", archive length (8 bytes), number of regions (4), then for each region its
+   position (8), length (4) and old bytes, then the fnv-1a hash of everything before it (4) */
+#define FNVINIT 2166136261u
+
+unsigned fnv(unsigned h,char *b,unsigned len) {
+	unsigned char *a=(unsigned char *)b;
+	for(unsigned i=0;i<len;i++) h=(h^a[i])*16777619u;
+	return h;
+}
+
+typedef struct {
+	i64 pos;
+	unsigned len;
+} region;
+
+void writejournal(char *name,FILE *f,i64 len,region *r,int numregions,char *buf) {
+	FILE *j=openfile(name,"wb");
+	char hdr[16];
+	memcpy(hdr,"UPJ1",4);
+	writeint4(hdr,4,(unsigned)len);
+	writeint4(hdr,8,(unsigned)(len>>32));
+	writeint4(hdr,12,numregions);
+	writeall(j,hdr,16);
+	unsigned h=fnv(FNVINIT,hdr,16);
+	for(int i=0;i<numregions;i++) {
+		writeint4(hdr,0,(unsigned)r[i].pos);
+		writeint4(hdr,4,(unsigned)(r[i].pos>>32));
+		writeint4(hdr,8,r[i].len);
+		writeall(j,hdr,12);
+		h=fnv(h,hdr,12);
+		for(unsigned done=0;done<r[i].len;) {
+			unsigned n=r[i].len-done<CHUNK?r[i].len-done:CHUNK;
+			readat(f,r[i].pos+done,buf,n);
+			writeall(j,buf,n);
+			h=fnv(h,buf,n);
+			done+=n;
+		}
+	}
+	writeint4(hdr,0,h);
+	writeall(j,hdr,4);
+	syncfile(j);
+	if(fclose(j)) fail("didn't write enough bytes\n");
+}
+
+/* undoes an interrupted update of the archive, if there was one */
+void rollback(char *pacname) {
+	char s[LARGE];
+	sprintf(s,"%s.journal",pacname);
+	FILE *j=fopen(s,"rb");
+	if(!j) return;
+	char *buf=malloc(CHUNK);
+	if(!buf) fail("out of memory\n");
+	i64 jlen=filesize(j);
+	unsigned h=FNVINIT;
+	int ok=jlen>=20;
+	for(i64 pos=0;ok && pos<jlen-4;) {
+		unsigned n=jlen-4-pos<CHUNK?jlen-4-pos:CHUNK;
+		readat(j,pos,buf,n);
+		h=fnv(h,buf,n);
+		pos+=n;
+	}
+	char hdr[16];
+	if(ok) {
+		readat(j,jlen-4,hdr,4);
+		ok=getint4(hdr,0)==h;
+	}
+	if(ok) {
+		readat(j,0,hdr,16);
+		ok=!memcmp(hdr,"UPJ1",4);
+	}
+	if(ok) {
+		FILE *f=openfile(pacname,"r+b");
+		i64 pos=16;
+		unsigned numregions=getint4(hdr,12);
+		for(unsigned i=0;i<numregions;i++) {
+			char rec[12];
+			if(pos+12>jlen-4) fail("%s is corrupt\n",s);
+			readat(j,pos,rec,12);
+			pos+=12;
+			i64 at=getint4(rec,0)+((i64)getint4(rec,4)<<32);
+			unsigned len=getint4(rec,8);
+			if(pos+len>jlen-4) fail("%s is corrupt\n",s);
+			for(unsigned done=0;done<len;) {
+				unsigned n=len-done<CHUNK?len-done:CHUNK;
+				readat(j,pos+done,buf,n);
+				writeat(f,at+done,buf,n);
+				done+=n;
+			}
+			pos+=len;
+		}
+		i64 len=getint4(hdr,4)+((i64)getint4(hdr,8)<<32);
+		if(fflush(f) || truncatefd(fileno(f),len)) fail("couldn't restore the length of %s\n",pacname);
+		syncfile(f);
+		fclose(f);
+		printf("rolled back an interrupted update of %s\n",pacname);
+	}
+	fclose(j);
+	free(buf);
+	if(remove(s)) fail("couldn't remove %s\n",s);
+}
+
+/* streams a replacement file, encrypted if it starts with '$'. with cmp set, compares it to the len
+   bytes at pos in the archive and returns whether they're the same; otherwise writes it there */
+int putfile(char *name,unsigned len,FILE *f,i64 pos,char *buf,char *cmp) {
+	FILE *in=openfile(name,"rb");
+	if(filesize(in)!=len) fail("file %s changed size while packing\n",name);
+	int enc=0,same=1;
+	for(unsigned done=0;done<len && same;) {
+		unsigned n=len-done<CHUNK?len-done:CHUNK;
+		if(n!=fread(buf,1,n,in)) fail("didn't read enough bytes\n");
+		if(done==0) enc=buf[0]=='$';
+		if(enc) cipher(buf,n,done,0);
+		if(cmp) {
+			readat(f,pos+done,cmp,n);
+			same=!memcmp(buf,cmp,n);
+		} else writeat(f,pos+done,buf,n);
+		done+=n;
+	}
+	fclose(in);
+	return same;
+}
+
+typedef struct {
+	unsigned pos,end,fileno;
+} span;
+
+int comparespans(const void *a,const void *b) {
+	const span *x=a,*y=b;
+	return x->pos<y->pos?-1:x->pos>y->pos;
+}
+
+/* marks the entries whose data overlaps another entry's. writing over one of those would change
+   the other too, so they're never rewritten in place */
+char *sharedentries(pac *a) {
+	char *shared=calloc(a->numfiles+1,1);
+	span *spans=malloc((a->numfiles+1)*sizeof(span));
+	if(!shared || !spans) fail("out of memory\n");
+	unsigned n=0;
+	for(unsigned fileno=0;fileno<a->numfiles;fileno++) {
+		char *entry=a->dir+a->diraddr+0x28*fileno;
+		unsigned len=getint4(entry,0x20),pos=getint4(entry,0x24);
+		if(len) spans[n++]=(span){pos,pos+len,fileno};
+	}
+	qsort(spans,n,sizeof(span),comparespans);
+	unsigned maxend=0;
+	for(unsigned i=0;i<n;i++) {
+		if(i && spans[i].pos<maxend) shared[spans[i].fileno]=1;
+		if(spans[i].end>maxend) maxend=spans[i].end;
+	}
+	unsigned minpos=0xffffffff;
+	for(unsigned i=n;i-->0;) {
+		if(spans[i].end>minpos) shared[spans[i].fileno]=1;
+		if(spans[i].pos<minpos) minpos=spans[i].pos;
+	}
+	free(spans);
+	return shared;
+}
+
+int update(char *pacname,char *dirname,int compact) {
+	rollback(pacname);
+	pac a;
+	openpac(&a,pacname,"r+b");
+	char eof[4];
+	readat(a.f,a.len-4,eof,4);
+	if(memcmp(eof,"EOF ",4)) fail("%s doesn't end with an EOF marker\n",pacname);
+	unsigned diraddr=a.diraddr,numfiles=a.numfiles,at=a.at;
+	char *olddir=a.dir,*dir=malloc(at),*buf=malloc(CHUNK),*cmp=malloc(CHUNK);
+	char *changed=calloc(numfiles+1,1),*shared=sharedentries(&a);
+	region *regions=malloc((numfiles+2)*sizeof(region));
+	if(!dir || !buf || !cmp || !changed || !regions) fail("out of memory\n");
+	memcpy(dir,olddir,at);
+
+	// plan: decide where each changed file goes, and which bytes that overwrites
+	int numregions=0;
+	regions[numregions++]=(region){0,at};
+	char s[LARGE];
+	i64 end=a.len-4;
+	unsigned numsame=0,numinplace=0,numappended=0;
+	for(unsigned fileno=0;fileno<numfiles;fileno++) {
+		unsigned e=diraddr+0x28*fileno;
+		unsigned oldlen=getint4(olddir,e+0x20),oldpos=getint4(olddir,e+0x24);
+		if((i64)oldpos+oldlen>a.len-4) fail("entry %u lies outside the archive\n",fileno);
+		entrypath(s,dirname,olddir+e);
+		FILE *f=fopen(s,"rb");
+		if(!f) continue;
+		i64 len=filesize(f);
+		fclose(f);
+		if(len>0xffffffffLL) fail("file %s too large\n",s);
+		if(len==oldlen && putfile(s,oldlen,a.f,oldpos,buf,cmp)) {
+			numsame++;
+			continue;
+		}
+		changed[fileno]=1;
+		writeint4(dir,e+0x20,(unsigned)len);
+		if(len<=oldlen && !shared[fileno]) {
+			if(len) regions[numregions++]=(region){oldpos,(unsigned)len};
+			numinplace++;
+		} else {
+			writeint4(dir,e+0x24,(unsigned)end);
+			end+=len;
+			if(end+4>0xffffffffLL) fail("archive too large, offsets are 32-bit\n");
+			numappended++;
+		}
+	}
+	if(numappended) regions[numregions++]=(region){a.len-4,4};
+
+	// apply: journal the old bytes, write the files, then point the directory at them
+	if(numinplace || numappended) {
+		sprintf(s,"%s.journal",pacname);
+		writejournal(s,a.f,a.len,regions,numregions,buf);
+		for(unsigned fileno=0;fileno<numfiles;fileno++) {
+			if(!changed[fileno]) continue;
+			unsigned e=diraddr+0x28*fileno;
+			printf("update archive with %.32s\n",olddir+e);
+			char path[LARGE];
+			entrypath(path,dirname,olddir+e);
+			putfile(path,getint4(dir,e+0x20),a.f,getint4(dir,e+0x24),buf,0);
+		}
+		if(numappended) writeat(a.f,end,"EOF ",4);
+		for(unsigned fileno=0;fileno<numfiles;fileno++) {
+			unsigned e=diraddr+0x28*fileno;
+			if(changed[fileno]) writeat(a.f,e+0x20,dir+e+0x20,8);
+		}
+		syncfile(a.f);
+		if(remove(s)) fail("couldn't remove %s\n",s);
+	}
+	i64 used=at+4;
+	for(unsigned fileno=0;fileno<numfiles;fileno++) used+=getint4(dir,diraddr+0x28*fileno+0x20);
+	printf("%u unchanged, %u rewritten in place, %u appended, %lld bytes unused\n",numsame,numinplace,numappended,end+4-used);
+	fclose(a.f);
+	free(a.dir);
+	free(dir);
+	free(buf);
+	free(cmp);
+	free(changed);
+	free(shared);
+	free(regions);
+
+	if(compact) {
+		job j={.pacname=pacname};
+		pack(&j);
+		sprintf(s,"%s.new",pacname);
+#ifdef _WIN32
+		if(!MoveFileExA(s,pacname,MOVEFILE_REPLACE_EXISTING)) fail("couldn't replace %s with %s\n",pacname,s);
+#else
+		if(rename(s,pacname)) fail("couldn't replace %s with %s\n",pacname,s);
+#endif
+		puts("archive compacted");
+	}
+	return 0;
+}
+
+/* lists the entries, or with a directory, extracts them there. entries starting with '$' are encrypted */
+int unpack(char *pacname,char *dirname) {
+	pac a;
+	openpac(&a,pacname,"rb");
+	char *buf=malloc(CHUNK);
+	if(!buf) fail("out of memory\n");
+	if(dirname) makedir(dirname);
+	char s[LARGE];
+	for(unsigned fileno=0;fileno<a.numfiles;fileno++) {
+		char *entry=a.dir+a.diraddr+0x28*fileno;
+		unsigned len=getint4(entry,0x20),pos=getint4(entry,0x24);
+		if((i64)pos+len>a.len) fail("entry %u lies outside the archive\n",fileno);
+		char name[0x21];
+		memcpy(name,entry,0x20);
+		name[0x20]=0;
+		if(!dirname) {
+			printf("%10u %10u  %s\n",pos,len,name);
+			continue;
+		}
+		// names are plain file names; don't let one point outside the output directory
+		if(!name[0] || strchr(name,'/') || strchr(name,'\\') || !strcmp(name,"..")) {
+			printf("skipping entry %u with bad name %s\n",fileno,name);
+			continue;
+		}
+		entrypath(s,dirname,entry);
+		FILE *out=openfile(s,"wb");
+		int dec=0;
+		for(unsigned done=0;done<len;) {
+			unsigned n=len-done<CHUNK?len-done:CHUNK;
+			readat(a.f,(i64)pos+done,buf,n);
+			if(done==0) dec=buf[0]=='$';
+			if(dec) cipher(buf,n,done,1);
+			writeall(out,buf,n);
+			done+=n;
+		}
+		if(fclose(out)) fail("didn't write enough bytes\n");
+	}
+	printf("%u files\n",a.numfiles);
+	fclose(a.f);
+	free(a.dir);
+	free(buf);
+	return 0;
+}
+
+int main(int argc,char **argv) {
+	if(argc<3) usage();
+	pickcipher();
+	if(!strcmp(argv[1],"manifest")) return packmanifest(argv[2],argc>3?atoi(argv[3]):0);
+	if(!strcmp(argv[1],"update")) {
+		if(argc<4) usage();
+		if(strlen(argv[2])>LARGE-10) fail("archive filename too long\n");
+		if(strlen(argv[3])>LARGE-40) fail("directory too long\n");
+		return update(argv[2],argv[3],argc>4 && !strcmp(argv[4],"--compact"));
+	}
+	int unpacking=!strcmp(argv[1],"unpack");
+	char *pacname=unpacking?argv[2]:argv[1];
+	char *dirname=unpacking?(argc>3?argv[3]:0):argv[2];
+	if(dirname && strlen(dirname)>LARGE-40) fail("directory too long\n");
+	if(strlen(pacname)>LARGE-10) fail("archive filename too long\n");
+	if(unpacking) return unpack(pacname,dirname);
+	job j={.pacname=pacname,.dirname=dirname};
+	pack(&j);
 	return 0;
 }
@@ -0,0 +1,227 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/AddressCache.h"
+
+#include <cstring>
+
+using namespace std;
+
+static constexpr uint32_t ImageSize = 0x4000;
+static constexpr uint32_t NtHeadersOffset = 0x80;
+static constexpr uint32_t DataRva = 0x1000;          // A "vtable" of four pointers, then plain bytes
+static constexpr uint32_t RelocationsRva = 0x3000;
+
+template<typename T>
+static void Put(vector<uint8_t>& image, size_t offset, T value)
+{
+    memcpy(image.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+static T Get(const vector<uint8_t>& image, size_t offset)
+{
+    T value;
+    memcpy(&value, image.data() + offset, sizeof(T));
+    return value;
+}
+
+// A mapped PE32 or PE32+ image with one section and a base relocation table covering the pointers at DataRva
+static vector<uint8_t> MakeImage(bool pe32Plus, uint64_t imageBase)
+{
+    vector<uint8_t> image(ImageSize);
+    image[0] = 'M';
+    image[1] = 'Z';
+    Put<uint32_t>(image, 0x3C, NtHeadersOffset);
+    memcpy(image.data() + NtHeadersOffset, "PE\0\0", 4);
+    Put<uint16_t>(image, NtHeadersOffset + 4, pe32Plus ? 0x8664 : 0x14C);
+    Put<uint16_t>(image, NtHeadersOffset + 6, 1);
+    Put<uint32_t>(image, NtHeadersOffset + 8, 0x5F5E1000);                 // Timestamp
+    uint16_t optionalHeaderSize = pe32Plus ? 240 : 224;
+    Put<uint16_t>(image, NtHeadersOffset + 20, optionalHeaderSize);
+
+    size_t optional = NtHeadersOffset + 24;
+    Put<uint16_t>(image, optional, pe32Plus ? 0x20B : 0x10B);
+    if (pe32Plus)
+        Put<uint64_t>(image, optional + 24, imageBase);
+    else
+        Put<uint32_t>(image, optional + 28, (uint32_t)imageBase);
+
+    Put<uint32_t>(image, optional + 56, ImageSize);
+    size_t directories = optional + (pe32Plus ? 112 : 96);
+    Put<uint32_t>(image, directories - 4, 16);
+    Put<uint32_t>(image, directories + 5 * 8, RelocationsRva);
+
+    size_t section = optional + optionalHeaderSize;
+    memcpy(image.data() + section, ".text", 5);
+    Put<uint32_t>(image, section + 8, ImageSize - DataRva);
+    Put<uint32_t>(image, section + 12, DataRva);
+
+    size_t pointerSize = pe32Plus ? 8 : 4;
+    uint16_t type = pe32Plus ? 10 : 3;
+    vector<uint16_t> relocations;
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t pointer = imageBase + 0x2000 + i * 0x10;
+        memcpy(image.data() + DataRva + i * pointerSize, &pointer, pointerSize);
+        relocations.push_back((uint16_t)((type << 12) | (i * pointerSize)));
+    }
+    for (size_t i = DataRva + 4 * pointerSize; i < DataRva + 0x40; i++)
+        image[i] = (uint8_t)(i * 7);
+
+    Put<uint32_t>(image, RelocationsRva, DataRva);
+    Put<uint32_t>(image, RelocationsRva + 4, (uint32_t)(8 + relocations.size() * 2));
+    memcpy(image.data() + RelocationsRva + 8, relocations.data(), relocations.size() * 2);
+    Put<uint32_t>(image, directories + 5 * 8 + 4, (uint32_t)(8 + relocations.size() * 2));
+    return image;
+}
+
+// What the loader does when the module can't go at its preferred base
+static vector<uint8_t> Relocate(vector<uint8_t> image, bool pe32Plus, uint64_t newBase)
+{
+    size_t optional = NtHeadersOffset + 24;
+    uint64_t oldBase = pe32Plus ? Get<uint64_t>(image, optional + 24) : Get<uint32_t>(image, optional + 28);
+    size_t pointerSize = pe32Plus ? 8 : 4;
+    for (int i = 0; i < 4; i++)
+    {
+        uint64_t pointer = 0;
+        memcpy(&pointer, image.data() + DataRva + i * pointerSize, pointerSize);
+        pointer += newBase - oldBase;
+        memcpy(image.data() + DataRva + i * pointerSize, &pointer, pointerSize);
+    }
+
+    if (pe32Plus)
+        Put<uint64_t>(image, optional + 24, newBase);
+    else
+        Put<uint32_t>(image, optional + 28, (uint32_t)newBase);
+
+    return image;
+}
+
+static void TestRelocatedModule(bool pe32Plus)
+{
+    vector<uint8_t> image = MakeImage(pe32Plus, pe32Plus ? 0x140000000 : 0x400000);
+    vector<uint8_t> relocated = Relocate(image, pe32Plus, pe32Plus ? 0x7FF612340000 : 0x01230000);
+    uint64_t hash = AddressCache::HashModule(image.data(), image.size());
+    CHECK(hash != 0);
+    CHECK(AddressCache::HashModule(relocated.data(), relocated.size()) == hash);
+    CHECK(image != relocated);
+
+    // The signature starts inside the first pointer and ends inside the plain bytes
+    AddressCache cache;
+    cache.Set(hash, "VTable:Test", DataRva, 7, image.data(), image.size(), 48);
+    cache.Set(hash, "Partial", DataRva + 2, 0, image.data(), image.size(), 4);
+    const AddressCache::Entry* pEntry = cache.Find(hash, "VTable:Test", relocated.data(), relocated.size());
+    CHECK(pEntry != nullptr && pEntry->Rva == DataRva && pEntry->Value == 7 && pEntry->Signature.size() == 48);
+    CHECK(cache.Find(hash, "Partial", relocated.data(), relocated.size()) != nullptr);
+
+    // Stored relative to the image base
+    if (pEntry != nullptr)
+    {
+        uint64_t firstPointer = 0;
+        memcpy(&firstPointer, pEntry->Signature.data(), pe32Plus ? 8 : 4);
+        CHECK(firstPointer == 0x2000);
+    }
+
+    // A changed pointer target or plain byte is still caught
+    vector<uint8_t> changed = relocated;
+    changed[DataRva] ^= 0x10;
+    CHECK(cache.Find(hash, "VTable:Test", changed.data(), changed.size()) == nullptr);
+    changed = relocated;
+    changed[DataRva + 0x2F] ^= 1;
+    CHECK(cache.Find(hash, "VTable:Test", changed.data(), changed.size()) == nullptr);
+}
+
+static void TestModuleHash()
+{
+    vector<uint8_t> image = MakeImage(false, 0x400000);
+    uint64_t hash = AddressCache::HashModule(image.data(), image.size());
+
+    vector<uint8_t> rebuilt = image;
+    Put<uint32_t>(rebuilt, NtHeadersOffset + 8, 0x5F5E1001);
+    CHECK(AddressCache::HashModule(rebuilt.data(), rebuilt.size()) != hash);
+
+    // Bytes outside the headers don't take part
+    rebuilt = image;
+    rebuilt[DataRva + 0x30] ^= 1;
+    CHECK(AddressCache::HashModule(rebuilt.data(), rebuilt.size()) == hash);
+
+    vector<uint8_t> notPe = image;
+    notPe[NtHeadersOffset] = 'X';
+    CHECK(AddressCache::HashModule(notPe.data(), notPe.size()) == 0);
+    CHECK(AddressCache::HashModule(image.data(), 0x3F) == 0);
+    CHECK(AddressCache::HashModule(image.data(), NtHeadersOffset + 100) == 0);
+}
+
+static void TestEntries()
+{
+    vector<uint8_t> image = MakeImage(false, 0x400000);
+    uint64_t hash = AddressCache::HashModule(image.data(), image.size());
+    AddressCache cache;
+    CHECK(!cache.IsDirty());
+
+    cache.Set(hash, "NotFound", 0, 0, image.data(), image.size());
+    CHECK(cache.IsDirty() && cache.GetCount() == 1);
+    const AddressCache::Entry* pEntry = cache.Find(hash, "NotFound", image.data(), image.size());
+    CHECK(pEntry != nullptr && pEntry->Signature.empty());
+    CHECK(cache.Find(hash + 1, "NotFound", image.data(), image.size()) == nullptr);
+    CHECK(cache.Find(hash, "Other", image.data(), image.size()) == nullptr);
+
+    // Near the end of the image the signature gets shorter; past it there is none
+    cache.Set(hash, "End", ImageSize - 4, 1, image.data(), image.size());
+    pEntry = cache.Find(hash, "End", image.data(), image.size());
+    CHECK(pEntry != nullptr && pEntry->Signature.size() == 4);
+    CHECK(cache.Find(hash, "End", image.data(), ImageSize - 2) == nullptr);
+
+    cache.Set(hash, string(256, 'k'), DataRva, 0, image.data(), image.size());
+    CHECK(cache.GetCount() == 2);
+
+    cache.Serialize();
+    CHECK(!cache.IsDirty());
+    cache.Set(hash, "End", ImageSize - 4, 1, image.data(), image.size());
+    CHECK(!cache.IsDirty());
+    cache.Set(hash, "End", ImageSize - 4, 2, image.data(), image.size());
+    CHECK(cache.IsDirty());
+}
+
+static void TestSerialization()
+{
+    vector<uint8_t> image = MakeImage(true, 0x140000000);
+    uint64_t hash = AddressCache::HashModule(image.data(), image.size());
+    AddressCache cache;
+    cache.Set(hash, "SjisLookupTable", DataRva + 0x20, 0, image.data(), image.size());
+    cache.Set(hash, "PalTaskGetTaskData.textOffset", DataRva, 0x1544, image.data(), image.size());
+    cache.Set(hash + 1, "SjisLookupTable", 0, 0, image.data(), image.size());
+    vector<uint8_t> data = cache.Serialize();
+
+    AddressCache loaded;
+    CHECK(loaded.Deserialize(data));
+    CHECK(loaded.GetCount() == 3 && !loaded.IsDirty());
+    CHECK(loaded.Serialize() == data);
+    const AddressCache::Entry* pEntry = loaded.Find(hash, "PalTaskGetTaskData.textOffset", image.data(), image.size());
+    CHECK(pEntry != nullptr && pEntry->Rva == DataRva && pEntry->Value == 0x1544);
+
+    // Every truncation and every flipped bit is rejected, leaving the cache empty
+    for (size_t size = 0; size < data.size(); size++)
+    {
+        vector<uint8_t> truncated(data.begin(), data.begin() + size);
+        CHECK(!loaded.Deserialize(truncated) && loaded.GetCount() == 0);
+    }
+    for (size_t i = 0; i < data.size() * 8; i += 3)
+    {
+        vector<uint8_t> corrupt = data;
+        corrupt[i / 8] ^= (uint8_t)(1 << (i % 8));
+        CHECK(!loaded.Deserialize(corrupt) && loaded.GetCount() == 0);
+    }
+
+    AddressCache empty;
+    CHECK(loaded.Deserialize(empty.Serialize()) && loaded.GetCount() == 0);
+}
+
+int main()
+{
+    TestRelocatedModule(false);
+    TestRelocatedModule(true);
+    TestModuleHash();
+    TestEntries();
+    TestSerialization();
+    return TEST_RESULT();
+}
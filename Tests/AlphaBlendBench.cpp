@@ -0,0 +1,76 @@
+#include "../VNTextProxy/Subtitles/AlphaBlend.h"
+#include "../VNTextProxy/Util/CpuFeatures.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+using BlendFunction = void (*)(const uint8_t* pSrc, uint8_t* pDst, int width);
+
+// Blends a generated subtitle box of W x H pixels (1600 x 200 by default, two lines of text on a 1080p screen)
+// over a screen buffer with each kernel, as SubtitleRenderer does every frame, and reports the throughput
+int main(int argc, char** argv)
+{
+    int width = argc > 1 ? atoi(argv[1]) : 1600;
+    int height = argc > 2 ? atoi(argv[2]) : 200;
+    const int rounds = 200;
+
+    // Glyph-like coverage: mostly transparent, with opaque strokes and anti-aliased edges
+    mt19937 random(1);
+    vector<uint8_t> bitmap((size_t)width * height * 4);
+    for (size_t i = 0; i < bitmap.size(); i += 4)
+    {
+        int kind = random() % 8;
+        bitmap[i] = bitmap[i + 1] = bitmap[i + 2] = 255;
+        bitmap[i + 3] = kind < 5 ? 0 : kind < 7 ? 255 : (uint8_t)random();
+    }
+    vector<uint8_t> screen((size_t)width * height * 4);
+    for (uint8_t& value : screen)
+        value = (uint8_t)random();
+
+    // Premultiplying happens once per fade step
+    vector<uint8_t> line(bitmap.size());
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int y = 0; y < height; y++)
+            AlphaBlend::PremultiplyRow(&bitmap[(size_t)y * width * 4], &line[(size_t)y * width * 4], width, 200);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%d x %d box\n", width, height);
+    printf("  PremultiplyRow: %8.3f ms per box (%.0f Mpixel/s)\n", seconds * 1000 / rounds,
+        (double)width * height * rounds / 1e6 / seconds);
+
+    const pair<BlendFunction, const char*> kernels[] =
+    {
+        { AlphaBlend::BlendRowScalar, "scalar" }, { AlphaBlend::BlendRowSse2, "SSE2" }, { AlphaBlend::BlendRowAvx2, "AVX2" }
+    };
+    vector<uint8_t> expected;
+    for (const auto& [function, name] : kernels)
+    {
+        if (function == AlphaBlend::BlendRowAvx2 && !CpuFeatures::HasAvx2())
+            continue;
+
+        vector<uint8_t> dst;
+        start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            dst = screen;
+            for (int y = 0; y < height; y++)
+                function(&line[(size_t)y * width * 4], &dst[(size_t)y * width * 4], width);
+        }
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("  BlendRow %-6s: %8.3f ms per box (%.0f Mpixel/s)\n", name, seconds * 1000 / rounds,
+            (double)width * height * rounds / 1e6 / seconds);
+
+        if (expected.empty())
+            expected = dst;
+        else if (dst != expected)
+            printf("  MISMATCH for %s\n", name);
+    }
+    return EXIT_SUCCESS;
+}
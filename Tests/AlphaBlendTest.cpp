@@ -0,0 +1,210 @@
+#include "Test.h"
+#include "../VNTextProxy/Subtitles/AlphaBlend.h"
+#include "../VNTextProxy/Util/CpuFeatures.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+using BlendFunction = void (*)(const uint8_t* pSrc, uint8_t* pDst, int width);
+
+static uint8_t RoundDiv255(int x)
+{
+    return (uint8_t)lround(x / 255.0);
+}
+
+// Straight-alpha pixels with fully transparent runs at either end (as the text bitmaps have around each line),
+// partly transparent edges and opaque pixels in between
+static vector<uint8_t> MakeRow(int width, mt19937& random)
+{
+    vector<uint8_t> row(width * 4);
+    int first = width == 0 ? 0 : random() % (width + 1);
+    int end = first + (width == first ? 0 : random() % (width - first + 1));
+    for (int x = 0; x < width; x++)
+    {
+        for (int i = 0; i < 3; i++)
+            row[x * 4 + i] = (uint8_t)random();
+
+        int kind = random() % 4;
+        row[x * 4 + 3] = x < first || x >= end ? 0 : kind == 0 ? 255 : kind == 1 ? 0 : (uint8_t)random();
+    }
+    return row;
+}
+
+static vector<uint8_t> MakeBackground(int width, mt19937& random)
+{
+    vector<uint8_t> row(width * 4);
+    for (uint8_t& value : row)
+        value = (uint8_t)random();
+
+    return row;
+}
+
+// Straight from the formula in AlphaBlend.h, in floating point
+static vector<uint8_t> ReferencePremultiply(const vector<uint8_t>& src, int overallAlpha)
+{
+    vector<uint8_t> dst(src.size());
+    for (size_t x = 0; x < src.size() / 4; x++)
+    {
+        uint8_t alpha = RoundDiv255(src[x * 4 + 3] * overallAlpha);
+        for (int i = 0; i < 3; i++)
+            dst[x * 4 + i] = RoundDiv255(src[x * 4 + i] * alpha);
+
+        dst[x * 4 + 3] = alpha;
+    }
+    return dst;
+}
+
+static vector<uint8_t> ReferenceBlend(const vector<uint8_t>& src, vector<uint8_t> dst)
+{
+    for (size_t x = 0; x < src.size() / 4; x++)
+    {
+        for (int i = 0; i < 3; i++)
+            dst[x * 4 + i] = (uint8_t)(src[x * 4 + i] + RoundDiv255(dst[x * 4 + i] * (255 - src[x * 4 + 3])));
+    }
+    return dst;
+}
+
+static vector<BlendFunction> GetBlendFunctions()
+{
+    vector<BlendFunction> functions = { AlphaBlend::BlendRowScalar, AlphaBlend::BlendRowSse2, AlphaBlend::BlendRow };
+    if (CpuFeatures::HasAvx2())
+        functions.push_back(AlphaBlend::BlendRowAvx2);
+    else
+        printf("No AVX2 on this CPU, skipping BlendRowAvx2\n");
+
+    return functions;
+}
+
+static void TestPremultiply()
+{
+    mt19937 random(30);
+    for (int overallAlpha : { 0, 1, 128, 254, 255 })
+    {
+        for (int width = 0; width < 40; width++)
+        {
+            vector<uint8_t> src = MakeRow(width, random);
+            vector<uint8_t> dst(src.size());
+            AlphaBlend::PremultiplyRow(src.data(), dst.data(), width, overallAlpha);
+            CHECK(dst == ReferencePremultiply(src, overallAlpha));
+        }
+    }
+
+    // Every color and alpha at a partial fade
+    vector<uint8_t> src(256 * 256 * 4);
+    for (int i = 0; i < 256 * 256; i++)
+    {
+        src[i * 4] = src[i * 4 + 1] = src[i * 4 + 2] = (uint8_t)i;
+        src[i * 4 + 3] = (uint8_t)(i >> 8);
+    }
+    for (int overallAlpha : { 77, 255 })
+    {
+        vector<uint8_t> dst(src.size());
+        AlphaBlend::PremultiplyRow(src.data(), dst.data(), 256 * 256, overallAlpha);
+        CHECK(dst == ReferencePremultiply(src, overallAlpha));
+    }
+}
+
+static void TestOpaqueSpan()
+{
+    mt19937 random(31);
+    for (int iteration = 0; iteration < 2000; iteration++)
+    {
+        int width = random() % 50;
+        vector<uint8_t> row = MakeRow(width, random);
+        int first, end;
+        bool found = AlphaBlend::FindOpaqueSpan(row.data(), width, first, end);
+
+        int expectedFirst = 0;
+        while (expectedFirst < width && row[expectedFirst * 4 + 3] == 0)
+            expectedFirst++;
+
+        int expectedEnd = width;
+        while (expectedEnd > expectedFirst && row[(expectedEnd - 1) * 4 + 3] == 0)
+            expectedEnd--;
+
+        CHECK(found == (expectedFirst < width));
+        if (found)
+            CHECK(first == expectedFirst && end == expectedEnd);
+    }
+
+    // Fully transparent, a single pixel at either end, and an empty row
+    vector<uint8_t> row(16 * 4, 0);
+    int first, end;
+    CHECK(!AlphaBlend::FindOpaqueSpan(row.data(), 16, first, end));
+    row[3] = 1;
+    CHECK(AlphaBlend::FindOpaqueSpan(row.data(), 16, first, end) && first == 0 && end == 1);
+    row[3] = 0;
+    row[15 * 4 + 3] = 255;
+    CHECK(AlphaBlend::FindOpaqueSpan(row.data(), 16, first, end) && first == 15 && end == 16);
+    CHECK(!AlphaBlend::FindOpaqueSpan(nullptr, 0, first, end));
+}
+
+// Every kernel gives exactly the reference result, at every width around the SIMD block sizes and at fade 0, 255
+// and in between, and never touches the destination alpha or anything past the row
+static void TestBlend()
+{
+    mt19937 random(32);
+    vector<BlendFunction> functions = GetBlendFunctions();
+    for (int overallAlpha : { 0, 1, 100, 255 })
+    {
+        for (int width = 0; width <= 70; width++)
+        {
+            for (int repeat = 0; repeat < 4; repeat++)
+            {
+                vector<uint8_t> straight = MakeRow(width, random);
+                vector<uint8_t> src = ReferencePremultiply(straight, overallAlpha);
+                vector<uint8_t> background = MakeBackground(width, random);
+                vector<uint8_t> expected = ReferenceBlend(src, background);
+                if (overallAlpha == 0)
+                    CHECK(expected == background);
+
+                for (BlendFunction function : functions)
+                {
+                    // Exact-size buffers so the sanitizer build catches reads or writes past the end
+                    vector<uint8_t> dst = background;
+                    function(src.data(), dst.data(), width);
+                    CHECK(dst == expected);
+                }
+            }
+        }
+    }
+
+    // Fully transparent blocks are skipped, fully opaque ones replace the color
+    for (int width : { 4, 8, 13, 64 })
+    {
+        vector<uint8_t> background = MakeBackground(width, random);
+        vector<uint8_t> transparent(width * 4, 0);
+        vector<uint8_t> opaque(width * 4);
+        for (int x = 0; x < width; x++)
+        {
+            opaque[x * 4 + 0] = (uint8_t)x;
+            opaque[x * 4 + 1] = 10;
+            opaque[x * 4 + 2] = 200;
+            opaque[x * 4 + 3] = 255;
+        }
+        for (BlendFunction function : functions)
+        {
+            vector<uint8_t> dst = background;
+            function(transparent.data(), dst.data(), width);
+            CHECK(dst == background);
+
+            function(opaque.data(), dst.data(), width);
+            bool replaced = true;
+            for (int x = 0; x < width; x++)
+                replaced &= dst[x * 4] == x && dst[x * 4 + 1] == 10 && dst[x * 4 + 2] == 200 && dst[x * 4 + 3] == background[x * 4 + 3];
+
+            CHECK(replaced);
+        }
+    }
+}
+
+int main()
+{
+    TestPremultiply();
+    TestOpaqueSpan();
+    TestBlend();
+    return TEST_RESULT();
+}
@@ -0,0 +1,181 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/BackgroundTask.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using State = BackgroundTask::State;
+
+// Polls like the Present loop does, giving up after a few seconds
+static bool WaitUntil(const BackgroundTask& task, State state)
+{
+    for (int i = 0; i < 5000; i++)
+    {
+        if (task.GetState() == state)
+            return true;
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// A job that runs until it's told to stop, noting that it started and how it ended
+struct CancellableJob
+{
+    atomic<bool> Started = false;
+    atomic<bool> SawCancel = false;
+    atomic<bool> Finished = false;
+
+    BackgroundTask::Job Get()
+    {
+        return [this](const atomic<bool>& cancelRequested)
+        {
+            Started = true;
+            while (!cancelRequested)
+                this_thread::sleep_for(chrono::milliseconds(1));
+
+            SawCancel = true;
+            this_thread::sleep_for(chrono::milliseconds(20));
+            Finished = true;
+            return true;
+        };
+    }
+
+    void WaitForStart()
+    {
+        while (!Started)
+            this_thread::yield();
+    }
+};
+
+// The result is only handed off once the job has returned, and everything the job wrote is visible by then
+static void TestHandOff()
+{
+    BackgroundTask task;
+    CHECK(task.GetState() == State::Idle && !task.IsReady() && !task.IsRunning());
+
+    vector<int> result;
+    atomic<bool> release = false;
+    task.Start([&](const atomic<bool>&)
+    {
+        for (int i = 0; i < 100000; i++)
+            result.push_back(i);
+
+        while (!release)
+            this_thread::yield();
+
+        return true;
+    });
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+    CHECK(task.IsRunning() && !task.IsReady());
+    release = true;
+    CHECK(WaitUntil(task, State::Succeeded));
+    CHECK(task.IsReady() && !task.IsRunning());
+    CHECK(result.size() == 100000 && result.back() == 99999);
+
+    // The elapsed time stops at the end of the job
+    double elapsed = task.GetElapsedMilliseconds();
+    CHECK(elapsed >= 20);
+    this_thread::sleep_for(chrono::milliseconds(10));
+    CHECK(task.GetElapsedMilliseconds() == elapsed);
+
+    // Starting again goes back to Running until the new job is done
+    task.Start([](const atomic<bool>&) { this_thread::sleep_for(chrono::milliseconds(20)); return true; });
+    CHECK(!task.IsReady());
+    task.Wait();
+    CHECK(task.IsReady());
+}
+
+// Resetting while the job runs cancels it, waits for it to return, and leaves the task Idle rather than
+// Succeeded or Cancelled, even though this job returns true
+static void TestResetWhileRunning()
+{
+    BackgroundTask task;
+    CancellableJob job;
+    task.Start(job.Get());
+    job.WaitForStart();
+    CHECK(task.IsRunning());
+
+    task.Reset();
+    CHECK(job.SawCancel && job.Finished);
+    CHECK(task.GetState() == State::Idle && !task.IsReady());
+
+    // Cancel without a reset reports Cancelled
+    CancellableJob job2;
+    task.Start(job2.Get());
+    job2.WaitForStart();
+    task.Cancel();
+    CHECK(job2.Finished && task.GetState() == State::Cancelled && !task.IsReady());
+
+    // Starting a new job cancels the running one first
+    CancellableJob job3;
+    task.Start(job3.Get());
+    job3.WaitForStart();
+    task.Start([](const atomic<bool>&) { return true; });
+    CHECK(job3.SawCancel && job3.Finished);
+    CHECK(WaitUntil(task, State::Succeeded));
+
+    // Reset and Cancel with nothing running are harmless
+    task.Reset();
+    task.Reset();
+    task.Cancel();
+    CHECK(task.GetState() == State::Idle);
+}
+
+// Destroying the task mid-job cancels it and joins the worker, so nothing the job uses is touched afterwards
+static void TestDestroyWhileRunning()
+{
+    CancellableJob job;
+    {
+        BackgroundTask task;
+        task.Start(job.Get());
+        job.WaitForStart();
+    }
+    CHECK(job.SawCancel && job.Finished);
+
+    // Also before the worker got going
+    atomic<bool> ran = false;
+    {
+        BackgroundTask task;
+        task.Start([&](const atomic<bool>& cancelRequested) { ran = true; return !cancelRequested; });
+    }
+    CHECK(ran);
+}
+
+// A failed job is never reported as ready, however often it's polled, so the caller stays on its fallback
+// (as Present stays on the bicubic scaler when the CuNNy shaders fail to compile)
+static void TestFailure()
+{
+    BackgroundTask task;
+    task.Start([](const atomic<bool>&) { this_thread::sleep_for(chrono::milliseconds(10)); return false; });
+
+    int fallbackFrames = 0;
+    while (!task.IsReady() && task.IsRunning())
+    {
+        fallbackFrames++;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    CHECK(fallbackFrames > 0);
+    CHECK(task.GetState() == State::Failed);
+    bool stayedOnFallback = true;
+    for (int i = 0; i < 100; i++)
+        stayedOnFallback &= !task.IsReady() && !task.IsRunning();
+
+    CHECK(stayedOnFallback);
+
+    task.Reset();
+    CHECK(task.GetState() == State::Idle);
+}
+
+int main()
+{
+    TestHandOff();
+    TestResetWhileRunning();
+    TestDestroyWhileRunning();
+    TestFailure();
+    return TEST_RESULT();
+}
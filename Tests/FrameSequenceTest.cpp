@@ -0,0 +1,257 @@
+#include "Test.h"
+#include "../VNTextProxy/Capture/FrameSequence.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+using namespace FrameSequence;
+
+// A frame that differs from the previous one in a few rectangles, like a visual novel's text box and sprites
+static vector<uint8_t> ChangeFrame(vector<uint8_t> frame, int width, int height, mt19937& random)
+{
+    int numRects = random() % 4;
+    for (int i = 0; i < numRects; i++)
+    {
+        int x = random() % width;
+        int y = random() % height;
+        int w = 1 + random() % (width - x);
+        int h = 1 + random() % (height - y);
+        for (int row = y; row < y + h; row++)
+        {
+            for (int col = x * 4; col < (x + w) * 4; col++)
+                frame[(size_t)row * width * 4 + col] = (uint8_t)random();
+        }
+    }
+    return frame;
+}
+
+static bool RoundTrip(const vector<uint8_t>& current, const vector<uint8_t>& previous)
+{
+    vector<uint8_t> encoded;
+    EncodeXorRle(current.data(), previous.empty() ? nullptr : previous.data(), current.size(), encoded);
+    vector<uint8_t> decoded = previous.empty() ? vector<uint8_t>(current.size(), 0) : previous;
+    return DecodeXorRle(encoded.data(), encoded.size(), decoded.data(), decoded.size()) && decoded == current;
+}
+
+static void TestXorRle()
+{
+    mt19937 random(27);
+
+    // Sizes around the minimum zero run, with changes at the very start and end and gaps just shorter and just
+    // longer than the run that's worth its own pair
+    for (size_t size = 0; size < 80; size++)
+    {
+        for (int repeat = 0; repeat < 20; repeat++)
+        {
+            vector<uint8_t> previous(size);
+            for (uint8_t& byte : previous)
+                byte = (uint8_t)random();
+
+            vector<uint8_t> current = previous;
+            int numChanges = random() % 6;
+            for (int i = 0; i < numChanges && size > 0; i++)
+                current[random() % size] ^= 1 + random() % 255;
+
+            if (size > 0 && repeat % 4 == 0)
+                current[0] ^= 0x80;
+
+            if (size > 0 && repeat % 4 == 1)
+                current[size - 1] ^= 0x80;
+
+            CHECK(RoundTrip(current, previous));
+            CHECK(RoundTrip(current, {}));
+        }
+    }
+
+    // Unchanged frames cost one pair, entirely changed ones a single literal run
+    vector<uint8_t> frame(64 * 48 * 4);
+    for (uint8_t& byte : frame)
+        byte = (uint8_t)random();
+
+    vector<uint8_t> encoded;
+    EncodeXorRle(frame.data(), frame.data(), frame.size(), encoded);
+    CHECK(encoded.size() == 8);
+    vector<uint8_t> inverted = frame;
+    for (uint8_t& byte : inverted)
+        byte = (uint8_t)~byte;
+
+    EncodeXorRle(inverted.data(), frame.data(), frame.size(), encoded);
+    CHECK(encoded.size() == 8 + frame.size());
+
+    // A sequence of frames, each decoded in place over the previous one
+    vector<uint8_t> decoded(frame.size(), 0);
+    vector<uint8_t> previous;
+    for (int i = 0; i < 50; i++)
+    {
+        vector<uint8_t> next = ChangeFrame(frame, 64, 48, random);
+        EncodeXorRle(next.data(), previous.empty() ? nullptr : previous.data(), next.size(), encoded);
+        CHECK(DecodeXorRle(encoded.data(), encoded.size(), decoded.data(), decoded.size()) && decoded == next);
+        previous = frame = next;
+    }
+
+    // Runs that go past the frame or the input are refused
+    vector<uint8_t> bad(8, 0);
+    bad[0] = 0xFF;
+    CHECK(!DecodeXorRle(bad.data(), bad.size(), decoded.data(), 16));
+    bad[0] = 8;
+    bad[4] = 9;
+    bad.resize(8 + 9, 1);
+    CHECK(!DecodeXorRle(bad.data(), bad.size(), decoded.data(), 16));
+    CHECK(!DecodeXorRle(bad.data(), 8 + 8, decoded.data(), 64));
+    CHECK(!DecodeXorRle(bad.data(), 5, decoded.data(), 64));
+}
+
+struct TestFrame
+{
+    FrameHeader Header;
+    vector<uint8_t> Pixels;
+};
+
+static vector<TestFrame> MakeFrames(mt19937& random)
+{
+    vector<TestFrame> frames;
+    vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    for (uint32_t i = 0; i < 30; i++)
+    {
+        // Two size changes, which restart the XOR chain
+        if (i == 0 || i == 10 || i == 20)
+        {
+            width = 16 + random() % 40;
+            height = 8 + random() % 30;
+            pixels.assign((size_t)width * height * 4, 0);
+        }
+        pixels = ChangeFrame(pixels, width, height, random);
+
+        FrameHeader header{};
+        header.FrameIndex = i;
+        header.TimestampUs = i * 16667;
+        header.Width = (uint16_t)width;
+        header.Height = (uint16_t)height;
+        header.ScaledWidth = (uint16_t)(width * 2);
+        header.ScaledHeight = (uint16_t)(height * 2);
+        header.Mode = (ScaleMode)(i % 3);
+        frames.push_back({ header, pixels });
+    }
+    return frames;
+}
+
+static vector<uint8_t> ReadFile(const fs::path& path)
+{
+    ifstream stream(path, ios::binary);
+    return vector<uint8_t>(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+}
+
+static void WriteFile(const fs::path& path, const vector<uint8_t>& data)
+{
+    ofstream stream(path, ios::binary);
+    stream.write((const char*)data.data(), data.size());
+}
+
+// Reads the whole file, returning how it ended and how many frames matched before that
+static ReadResult ReadAll(const fs::path& path, const vector<TestFrame>& expected, size_t& numMatching)
+{
+    numMatching = 0;
+    Reader reader;
+    if (!reader.Open(path.string()))
+        return ReadResult::Error;
+
+    FrameHeader header;
+    vector<uint8_t> pixels;
+    ReadResult result;
+    while ((result = reader.ReadFrame(header, pixels)) == ReadResult::Frame)
+    {
+        if (numMatching < expected.size() && header.FrameIndex == expected[numMatching].Header.FrameIndex &&
+            header.Width == expected[numMatching].Header.Width && pixels == expected[numMatching].Pixels)
+        {
+            numMatching++;
+        }
+    }
+    return result;
+}
+
+// Written and read back, compressed or not, every frame comes back; cutting the file anywhere other than between
+// two frames, or damaging a compressed payload, is an error rather than a clean end
+static void TestFile(const fs::path& workFolder)
+{
+    mt19937 random(28);
+    vector<TestFrame> frames = MakeFrames(random);
+    for (bool compress : { false, true })
+    {
+        fs::path path = workFolder / (compress ? "compressed.vnfs" : "raw.vnfs");
+        vector<size_t> frameEnds;
+        {
+            Writer writer;
+            CHECK(writer.Open(path.string(), compress));
+            frameEnds.push_back((size_t)writer.GetBytesWritten());
+            for (const TestFrame& frame : frames)
+            {
+                CHECK(writer.WriteFrame(frame.Header, frame.Pixels.data()));
+                frameEnds.push_back((size_t)writer.GetBytesWritten());
+            }
+        }
+
+        size_t numMatching;
+        CHECK(ReadAll(path, frames, numMatching) == ReadResult::End && numMatching == frames.size());
+
+        vector<uint8_t> file = ReadFile(path);
+        CHECK(file.size() == frameEnds.back());
+        if (compress)
+            CHECK(file.size() < ReadFile(workFolder / "raw.vnfs").size());
+
+        // Cut after every frame, and a few bytes into every header and payload
+        fs::path cutPath = workFolder / "cut.vnfs";
+        for (size_t i = 0; i + 1 < frameEnds.size(); i++)
+        {
+            WriteFile(cutPath, vector<uint8_t>(file.begin(), file.begin() + frameEnds[i]));
+            CHECK(ReadAll(cutPath, frames, numMatching) == ReadResult::End && numMatching == i);
+
+            size_t start = frameEnds[i];
+            for (size_t cut : { start + 1, start + sizeof(FrameHeader) - 1, start + sizeof(FrameHeader), frameEnds[i + 1] - 1 })
+            {
+                WriteFile(cutPath, vector<uint8_t>(file.begin(), file.begin() + cut));
+                CHECK(ReadAll(cutPath, frames, numMatching) == ReadResult::Error && numMatching == i);
+            }
+        }
+
+        // An unknown codec, and (compressed) a run length that points past the frame
+        vector<uint8_t> damaged = file;
+        damaged[frameEnds[5] + offsetof(FrameHeader, Codec)] = 7;
+        WriteFile(cutPath, damaged);
+        CHECK(ReadAll(cutPath, frames, numMatching) == ReadResult::Error && numMatching == 5);
+        if (compress)
+        {
+            damaged = file;
+            damaged[frameEnds[5] + sizeof(FrameHeader) + 3] = 0x7F;
+            WriteFile(cutPath, damaged);
+            CHECK(ReadAll(cutPath, frames, numMatching) == ReadResult::Error && numMatching == 5);
+        }
+    }
+
+    // Not a frame sequence at all
+    WriteFile(workFolder / "other.vnfs", { 'V', 'N', 'F', 'X', 1, 0, 0, 0 });
+    Reader reader;
+    CHECK(!reader.Open((workFolder / "other.vnfs").string()));
+    FrameHeader header;
+    vector<uint8_t> pixels;
+    CHECK(reader.ReadFrame(header, pixels) == ReadResult::Error);
+}
+
+int main()
+{
+    fs::path workFolder = fs::temp_directory_path() / "FrameSequenceTest";
+    fs::remove_all(workFolder);
+    fs::create_directories(workFolder);
+    TestXorRle();
+    TestFile(workFolder);
+    fs::remove_all(workFolder);
+    return TEST_RESULT();
+}
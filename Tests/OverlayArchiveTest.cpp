@@ -0,0 +1,244 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/OverlayArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct TestFile
+{
+    string Name;
+    vector<uint8_t> Data;
+};
+
+static vector<uint8_t> MakeText(size_t size, mt19937& random)
+{
+    static const char* Words[] = { "\xE3\x81\x82", "msg", " ", "\r\n", "\\n", "0x", "SetText(", ");", "chara_01" };
+    vector<uint8_t> data;
+    while (data.size() < size)
+    {
+        const char* pWord = Words[random() % std::size(Words)];
+        data.insert(data.end(), pWord, pWord + strlen(pWord));
+    }
+    data.resize(size);
+    return data;
+}
+
+static vector<uint8_t> MakeNoise(size_t size, mt19937& random)
+{
+    vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+        byte = (uint8_t)random();
+
+    return data;
+}
+
+static vector<TestFile> MakeFiles()
+{
+    mt19937 random(40);
+    vector<TestFile> files;
+    files.push_back({ "script.src", MakeText(200000, random) });
+    files.push_back({ "TEXT.DAT", MakeText(5000, random) });
+    files.push_back({ "empty.txt", {} });
+    files.push_back({ "bg\\bg01.pgd", MakeNoise(30000, random) });
+    files.push_back({ "bg\\\xE8\x83\x8C\xE6\x99\xAF.pgd", MakeNoise(100, random) });
+    files.push_back({ "se\\short.wav", { 1, 2, 3 } });
+    files.push_back({ "repeat.bin", vector<uint8_t>(70000, 0x55) });
+    return files;
+}
+
+static vector<uint8_t> Extract(const OverlayArchive::Entry& entry, bool& success)
+{
+    vector<uint8_t> contents(entry.Size);
+    success = OverlayArchive::Extract(entry, contents.data());
+    return contents;
+}
+
+static void TestRoundTrip(bool compress)
+{
+    vector<TestFile> files = MakeFiles();
+    OverlayArchiveWriter writer;
+    for (const TestFile& file : files)
+        CHECK(writer.Add(file.Name, file.Data.data(), file.Data.size(), compress));
+
+    CHECK(writer.GetCount() == (int)files.size());
+    vector<uint8_t> data = writer.Serialize();
+    CHECK(writer.Serialize() == data);
+
+    OverlayArchive archive;
+    CHECK(archive.Open(data.data(), data.size()));
+    CHECK(archive.IsOpen() && archive.GetCount() == (int)files.size());
+
+    for (const TestFile& file : files)
+    {
+        OverlayArchive::Entry entry;
+        CHECK(archive.Find(file.Name, entry));
+        CHECK(entry.Name == file.Name && entry.Size == file.Data.size());
+        CHECK(entry.pData >= data.data() && entry.pData + entry.StoredSize <= data.data() + data.size());
+
+        bool success;
+        CHECK(Extract(entry, success) == file.Data && success);
+        if (entry.Method == OverlayArchive::Compression::None)
+            CHECK(entry.StoredSize == entry.Size && equal(file.Data.begin(), file.Data.end(), entry.pData));
+    }
+
+    // Text and runs compress, noise and tiny files are stored
+    OverlayArchive::Entry entry;
+    CHECK(archive.Find("script.src", entry) && entry.Method == (compress ? OverlayArchive::Compression::Lz : OverlayArchive::Compression::None));
+    CHECK(archive.Find("repeat.bin", entry) && (!compress || entry.StoredSize < 1000));
+    CHECK(archive.Find("bg\\bg01.pgd", entry) && entry.Method == OverlayArchive::Compression::None);
+    CHECK(archive.Find("se\\short.wav", entry) && entry.Method == OverlayArchive::Compression::None);
+    CHECK(archive.Find("empty.txt", entry) && entry.Size == 0);
+
+    // Iteration sees every entry once, in hash order
+    uint64_t previousHash = 0;
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        uint64_t hash = OverlayArchive::HashName(archive.GetEntry(i).Name);
+        CHECK(hash >= previousHash);
+        previousHash = hash;
+    }
+
+    archive.Close();
+    CHECK(!archive.IsOpen() && archive.GetCount() == 0);
+}
+
+static void TestNames()
+{
+    CHECK(OverlayArchive::HashName("BG/Bg01.PGD") == OverlayArchive::HashName("bg\\bg01.pgd"));
+    CHECK(OverlayArchive::HashName("bg01.pgd") != OverlayArchive::HashName("bg02.pgd"));
+
+    // Only ASCII letters are folded
+    CHECK(OverlayArchive::HashName("\xC3\x89") != OverlayArchive::HashName("\xC3\xA9"));
+
+    OverlayArchiveWriter writer;
+    uint8_t byte = 1;
+    CHECK(writer.Add("bg\\bg01.pgd", &byte, 1, false));
+    CHECK(!writer.Add("BG/BG01.pgd", &byte, 1, false));
+    CHECK(writer.Add("bg\\bg01.pgd.bak", &byte, 1, false));
+    CHECK(writer.GetCount() == 2);
+
+    vector<uint8_t> data = writer.Serialize();
+    OverlayArchive archive;
+    CHECK(archive.Open(data.data(), data.size()));
+    OverlayArchive::Entry entry;
+    CHECK(archive.Find("BG/Bg01.PGD", entry) && entry.Name == "bg\\bg01.pgd");
+    CHECK(!archive.Find("bg01.pgd", entry));
+    CHECK(!archive.Find("bg\\bg01.pg", entry));
+    CHECK(!archive.Find("", entry));
+
+    OverlayArchiveWriter emptyWriter;
+    data = emptyWriter.Serialize();
+    CHECK(archive.Open(data.data(), data.size()) && archive.GetCount() == 0 && !archive.Find("a", entry));
+}
+
+// Every truncation is rejected, as is any change to the header, index or names, which the hash covers
+static void TestCorrupt()
+{
+    vector<TestFile> files = MakeFiles();
+    OverlayArchiveWriter writer;
+    for (const TestFile& file : files)
+        writer.Add(file.Name, file.Data.data(), file.Data.size(), true);
+
+    vector<uint8_t> data = writer.Serialize();
+    size_t dataStart = 32 + files.size() * 40;
+    for (const TestFile& file : files)
+        dataStart += file.Name.size();
+
+    OverlayArchive archive;
+    for (size_t size = 0; size < data.size(); size += size < dataStart ? 1 : 997)
+    {
+        vector<uint8_t> truncated(data.begin(), data.begin() + size);
+        CHECK(!archive.Open(truncated.data(), truncated.size()) && !archive.IsOpen());
+    }
+
+    for (size_t i = 0; i < dataStart * 8; i++)
+    {
+        // The reserved header field isn't checked
+        if (i / 8 >= 24 && i / 8 < 32)
+            continue;
+
+        vector<uint8_t> corrupt = data;
+        corrupt[i / 8] ^= (uint8_t)(1 << (i % 8));
+        CHECK(!archive.Open(corrupt.data(), corrupt.size()));
+    }
+
+    // Damage in compressed data isn't caught by Open, but Extract fails or stays in bounds
+    CHECK(archive.Open(data.data(), data.size()));
+    mt19937 random(41);
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        OverlayArchive::Entry entry = archive.GetEntry(i);
+        if (entry.Method != OverlayArchive::Compression::Lz)
+            continue;
+
+        for (int iteration = 0; iteration < 300; iteration++)
+        {
+            vector<uint8_t> stored(entry.pData, entry.pData + entry.StoredSize);
+            stored[random() % stored.size()] ^= (uint8_t)(1 + random() % 255);
+            OverlayArchive::Entry damaged = entry;
+            damaged.pData = stored.data();
+
+            vector<uint8_t> output(entry.Size);
+            OverlayArchive::Extract(damaged, output.data());
+        }
+    }
+}
+
+static void TestLz()
+{
+    mt19937 random(42);
+    for (int iteration = 0; iteration < 500; iteration++)
+    {
+        size_t size = random() % 3000;
+        vector<uint8_t> data = iteration % 3 == 0 ? MakeNoise(size, random) : MakeText(size, random);
+        vector<uint8_t> compressed = OverlayArchive::CompressLz(data.data(), data.size());
+
+        // Exact-size buffers so the sanitizer build catches reads or writes past either end
+        vector<uint8_t> output(data.size());
+        CHECK(OverlayArchive::DecompressLz(compressed.data(), compressed.size(), output.data(), output.size()));
+        CHECK(output == data);
+
+        if (!data.empty())
+        {
+            vector<uint8_t> shorter(data.size() - 1);
+            CHECK(!OverlayArchive::DecompressLz(compressed.data(), compressed.size(), shorter.data(), shorter.size()));
+        }
+        vector<uint8_t> longer(data.size() + 1);
+        CHECK(!OverlayArchive::DecompressLz(compressed.data(), compressed.size(), longer.data(), longer.size()));
+
+        vector<uint8_t> truncated(compressed.begin(), compressed.end() - 1);
+        CHECK(!OverlayArchive::DecompressLz(truncated.data(), truncated.size(), output.data(), output.size()));
+    }
+
+    // Long literal runs and matches use the extra length bytes
+    vector<uint8_t> data = MakeNoise(1000, random);
+    data.insert(data.end(), 5000, 0);
+    vector<uint8_t> compressed = OverlayArchive::CompressLz(data.data(), data.size());
+    vector<uint8_t> output(data.size());
+    CHECK(compressed.size() < 1100);
+    CHECK(OverlayArchive::DecompressLz(compressed.data(), compressed.size(), output.data(), output.size()) && output == data);
+
+    // A match reaching back before the start of the output
+    const uint8_t badDistance[] = { 0x10, 'a', 0x02, 0x00 };
+    uint8_t small[5];
+    CHECK(!OverlayArchive::DecompressLz(badDistance, sizeof(badDistance), small, sizeof(small)));
+
+    vector<uint8_t> empty = OverlayArchive::CompressLz(nullptr, 0);
+    CHECK(empty.size() == 1 && OverlayArchive::DecompressLz(empty.data(), empty.size(), nullptr, 0));
+    CHECK(!OverlayArchive::DecompressLz(nullptr, 0, nullptr, 0));
+}
+
+int main()
+{
+    TestRoundTrip(false);
+    TestRoundTrip(true);
+    TestNames();
+    TestCorrupt();
+    TestLz();
+    return TEST_RESULT();
+}
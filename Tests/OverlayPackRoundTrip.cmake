@@ -0,0 +1,35 @@
+# Packs a small folder with OverlayPack, extracts it again and compares the files.
+# Run by ctest: cmake -DOVERLAY_PACK=<path to OverlayPack> -DWORK_DIR=<scratch folder> -P OverlayPackRoundTrip.cmake
+file(REMOVE_RECURSE ${WORK_DIR})
+set(input ${WORK_DIR}/data)
+set(output ${WORK_DIR}/extracted)
+
+set(script "")
+foreach(i RANGE 500)
+    string(APPEND script "SetText(\"message ${i}\");\r\n")
+endforeach()
+file(WRITE ${input}/script.src "${script}")
+file(WRITE ${input}/empty.txt "")
+file(WRITE ${input}/bg/bg01.pgd "GE not really an image")
+file(WRITE ${input}/se/nested/short.wav "RIFF")
+set(names script.src empty.txt bg/bg01.pgd se/nested/short.wav)
+
+foreach(compress "" "--compress")
+    file(REMOVE_RECURSE ${output})
+    execute_process(COMMAND ${OVERLAY_PACK} pack ${input} ${WORK_DIR}/data.overlay ${compress} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "pack ${compress} failed")
+    endif()
+
+    execute_process(COMMAND ${OVERLAY_PACK} extract ${WORK_DIR}/data.overlay ${output} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "extract failed")
+    endif()
+
+    foreach(name ${names})
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${input}/${name} ${output}/${name} RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${name} differs after pack ${compress} and extract")
+        endif()
+    endforeach()
+endforeach()
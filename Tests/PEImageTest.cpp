@@ -0,0 +1,429 @@
+#include "Test.h"
+#include "../VNTextProxy/PE/PEImage.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr uint32_t NtHeadersOffset = 0xC0;
+static constexpr uint32_t SizeOfHeaders = 0x400;
+static constexpr uint32_t SizeOfImage = 0x4000;
+static constexpr uint32_t RichKey = 0x1234ABCD;
+
+struct SectionLayout
+{
+    const char* Name;
+    uint32_t Rva;
+    uint32_t RawOffset;
+    uint32_t RawSize;
+};
+
+static constexpr SectionLayout Sections[] = {
+    { ".text",  0x1000, 0x400, 0x200 },
+    { ".rdata", 0x2000, 0x600, 0x800 },
+    { ".reloc", 0x3000, 0xE00, 0x200 }
+};
+
+template<typename T>
+static void Put(vector<uint8_t>& image, size_t offset, T value)
+{
+    memcpy(image.data() + offset, &value, sizeof(T));
+}
+
+static void PutString(vector<uint8_t>& image, size_t offset, const char* pString)
+{
+    memcpy(image.data() + offset, pString, strlen(pString) + 1);
+}
+
+static void PutThunk(vector<uint8_t>& image, size_t offset, bool is64Bit, uint64_t value)
+{
+    if (is64Bit)
+        Put<uint64_t>(image, offset, value);
+    else
+        Put<uint32_t>(image, offset, (uint32_t)value);
+}
+
+// A small DLL as the loader would lay it out: Rich header, three sections, two imported modules
+// (one without a lookup table), exports with a gap, a forwarder and sorted names, and two relocation blocks
+static vector<uint8_t> MakeMappedImage(bool is64Bit)
+{
+    vector<uint8_t> image(SizeOfImage);
+    Put<uint16_t>(image, 0, 0x5A4D);
+    Put<uint32_t>(image, 0x3C, NtHeadersOffset);
+
+    Put<uint32_t>(image, 0x80, 0x536E6144 ^ RichKey);
+    for (int i = 1; i < 4; i++)
+        Put<uint32_t>(image, 0x80 + i * 4, RichKey);
+    Put<uint32_t>(image, 0x90, ((uint32_t)0x0104 << 16 | 30319) ^ RichKey);
+    Put<uint32_t>(image, 0x94, 12 ^ RichKey);
+    Put<uint32_t>(image, 0x98, ((uint32_t)0x00FF << 16 | 40219) ^ RichKey);
+    Put<uint32_t>(image, 0x9C, 1 ^ RichKey);
+    Put<uint32_t>(image, 0xA0, 0x68636952);
+    Put<uint32_t>(image, 0xA4, RichKey);
+
+    Put<uint32_t>(image, NtHeadersOffset, 0x4550);
+    size_t fileHeader = NtHeadersOffset + 4;
+    Put<uint16_t>(image, fileHeader, is64Bit ? 0x8664 : 0x14C);
+    Put<uint16_t>(image, fileHeader + 2, 3);
+    Put<uint32_t>(image, fileHeader + 4, 0x5F5E1000);
+    uint16_t optionalHeaderSize = is64Bit ? 240 : 224;
+    Put<uint16_t>(image, fileHeader + 16, optionalHeaderSize);
+
+    size_t optional = fileHeader + 20;
+    Put<uint16_t>(image, optional, is64Bit ? 0x20B : 0x10B);
+    Put<uint32_t>(image, optional + 16, 0x1008);
+    if (is64Bit)
+        Put<uint64_t>(image, optional + 24, 0x180000000);
+    else
+        Put<uint32_t>(image, optional + 28, 0x10000000);
+    Put<uint32_t>(image, optional + 56, SizeOfImage);
+    Put<uint32_t>(image, optional + 60, SizeOfHeaders);
+
+    size_t directories = optional + (is64Bit ? 112 : 96);
+    Put<uint32_t>(image, directories - 4, 16);
+    Put<uint32_t>(image, directories + 0 * 8, 0x2600);         // Exports
+    Put<uint32_t>(image, directories + 0 * 8 + 4, 0x100);
+    Put<uint32_t>(image, directories + 1 * 8, 0x2000);         // Imports
+    Put<uint32_t>(image, directories + 1 * 8 + 4, 60);
+    Put<uint32_t>(image, directories + 5 * 8, 0x3000);         // Relocations
+    Put<uint32_t>(image, directories + 5 * 8 + 4, 28);
+
+    size_t sectionTable = optional + optionalHeaderSize;
+    for (size_t i = 0; i < size(Sections); i++)
+    {
+        size_t header = sectionTable + i * 40;
+        memcpy(image.data() + header, Sections[i].Name, strlen(Sections[i].Name));
+        Put<uint32_t>(image, header + 8, Sections[i].RawSize - 0x10);
+        Put<uint32_t>(image, header + 12, Sections[i].Rva);
+        Put<uint32_t>(image, header + 16, Sections[i].RawSize);
+        Put<uint32_t>(image, header + 20, Sections[i].RawOffset);
+        Put<uint32_t>(image, header + 36, i == 0 ? 0x60000020 : 0x40000040);
+    }
+
+    for (uint32_t i = 0; i < 0x100; i++)
+        image[0x1000 + i] = (uint8_t)(i * 13);
+
+    // Import descriptors, lookup and address tables, hint/name entries
+    uint64_t ordinalFlag = is64Bit ? 0x8000000000000000 : 0x80000000;
+    uint32_t thunkSize = is64Bit ? 8 : 4;
+    Put<uint32_t>(image, 0x2000, 0x2100);
+    Put<uint32_t>(image, 0x2000 + 12, 0x2300);
+    Put<uint32_t>(image, 0x2000 + 16, 0x2200);
+    Put<uint32_t>(image, 0x2014 + 12, 0x2310);
+    Put<uint32_t>(image, 0x2014 + 16, 0x2280);
+    PutThunk(image, 0x2100, is64Bit, 0x2400);
+    PutThunk(image, 0x2100 + thunkSize, is64Bit, ordinalFlag | 17);
+    PutThunk(image, 0x2200, is64Bit, 0x2400);
+    PutThunk(image, 0x2200 + thunkSize, is64Bit, ordinalFlag | 17);
+    PutThunk(image, 0x2280, is64Bit, 0x2420);
+    PutString(image, 0x2300, "KERNEL32.dll");
+    PutString(image, 0x2310, "USER32.dll");
+    Put<uint16_t>(image, 0x2400, 0x55);
+    PutString(image, 0x2402, "CreateFileW");
+    Put<uint16_t>(image, 0x2420, 0x1C3);
+    PutString(image, 0x2422, "MessageBoxW");
+
+    // Export directory: ordinal base 5, the second function unused, the third forwarded
+    Put<uint32_t>(image, 0x2600 + 12, 0x2680);
+    Put<uint32_t>(image, 0x2600 + 16, 5);
+    Put<uint32_t>(image, 0x2600 + 20, 4);
+    Put<uint32_t>(image, 0x2600 + 24, 3);
+    Put<uint32_t>(image, 0x2600 + 28, 0x2640);
+    Put<uint32_t>(image, 0x2600 + 32, 0x2660);
+    Put<uint32_t>(image, 0x2600 + 36, 0x2670);
+    Put<uint32_t>(image, 0x2640, 0x1010);
+    Put<uint32_t>(image, 0x2648, 0x26A0);
+    Put<uint32_t>(image, 0x264C, 0x1020);
+    Put<uint32_t>(image, 0x2660, 0x26C0);
+    Put<uint32_t>(image, 0x2664, 0x26D0);
+    Put<uint32_t>(image, 0x2668, 0x26E0);
+    Put<uint16_t>(image, 0x2670, 0);
+    Put<uint16_t>(image, 0x2672, 2);
+    Put<uint16_t>(image, 0x2674, 3);
+    PutString(image, 0x2680, "test.dll");
+    PutString(image, 0x26A0, "KERNEL32.Sleep");
+    PutString(image, 0x26C0, "Alpha");
+    PutString(image, 0x26D0, "Forwarded");
+    PutString(image, 0x26E0, "Zeta");
+
+    // Two relocation blocks, the first padded to four bytes
+    Put<uint32_t>(image, 0x3000, 0x1000);
+    Put<uint32_t>(image, 0x3004, 16);
+    Put<uint16_t>(image, 0x3008, 0x3010);
+    Put<uint16_t>(image, 0x300A, 0x3020);
+    Put<uint32_t>(image, 0x3010, 0x2000);
+    Put<uint32_t>(image, 0x3014, 12);
+    Put<uint16_t>(image, 0x3018, 0xA008);
+    Put<uint16_t>(image, 0x301A, 0xA00C);
+    return image;
+}
+
+// The same image as stored on disk, sections at their raw offsets
+static vector<uint8_t> ToFileLayout(const vector<uint8_t>& mapped)
+{
+    vector<uint8_t> file(Sections[size(Sections) - 1].RawOffset + Sections[size(Sections) - 1].RawSize);
+    memcpy(file.data(), mapped.data(), SizeOfHeaders);
+    for (const SectionLayout& section : Sections)
+        memcpy(file.data() + section.RawOffset, mapped.data() + section.Rva, section.RawSize);
+
+    return file;
+}
+
+static void CheckImage(const vector<uint8_t>& data, PEImage::Layout layout, bool is64Bit)
+{
+    PEImage image;
+    CHECK(image.Parse(data.data(), data.size(), layout));
+    CHECK(image.IsValid() && image.Is64Bit() == is64Bit);
+    CHECK(image.GetMachine() == (is64Bit ? 0x8664 : 0x14C));
+    CHECK(image.GetTimestamp() == 0x5F5E1000);
+    CHECK(image.GetImageBase() == (is64Bit ? 0x180000000 : 0x10000000));
+    CHECK(image.GetSizeOfImage() == SizeOfImage && image.GetSizeOfHeaders() == SizeOfHeaders);
+    CHECK(image.GetEntryPointRva() == 0x1008);
+    CHECK(image.GetSectionCount() == 3);
+
+    int index = 0;
+    for (const PEImage::Section& section : image.GetSections())
+    {
+        const SectionLayout& expected = Sections[index++];
+        CHECK(section.Name == expected.Name);
+        CHECK(section.Rva == expected.Rva && section.RawOffset == expected.RawOffset && section.RawSize == expected.RawSize);
+        CHECK(section.VirtualSize == expected.RawSize - 0x10);
+        if (layout == PEImage::Layout::Mapped)
+            CHECK(section.pData == data.data() + expected.Rva && section.DataSize == section.VirtualSize);
+        else
+            CHECK(section.pData == data.data() + expected.RawOffset && section.DataSize == section.RawSize);
+    }
+    CHECK(index == 3);
+
+    PEImage::Section text;
+    CHECK(image.FindSection(".text", text) && text.Characteristics == 0x60000020);
+    CHECK(!image.FindSection(".tex", text) && !image.FindSection("", text));
+
+    const uint8_t* pCode = image.GetPointer(0x1004, 4);
+    CHECK(pCode != nullptr && pCode[0] == (uint8_t)(4 * 13));
+    CHECK(image.GetString(0x2300) == "KERNEL32.dll");
+    CHECK(image.GetString(0x7FFFFFFF).empty());
+
+    // Files only have the raw data of each section, loaded images the whole buffer
+    bool pastRawData = image.GetPointer(0x11F0, 0x20) != nullptr;
+    CHECK(pastRawData == (layout == PEImage::Layout::Mapped));
+    CHECK(image.GetPointer(SizeOfImage, 1) == nullptr);
+
+    uint32_t rva;
+    uint32_t size;
+    CHECK(image.GetDataDirectory(1, rva, size) && rva == 0x2000 && size == 60);
+    CHECK(!image.GetDataDirectory(2, rva, size));
+    CHECK(!image.GetDataDirectory(-1, rva, size) && !image.GetDataDirectory(16, rva, size));
+
+    vector<PEImage::ImportedModule> modules;
+    for (const PEImage::ImportedModule& module : image.GetImports())
+        modules.push_back(module);
+
+    CHECK(modules.size() == 2);
+    if (modules.size() == 2)
+    {
+        uint32_t thunkSize = is64Bit ? 8 : 4;
+        CHECK(modules[0].Name == "KERNEL32.dll" && modules[0].LookupRva == 0x2100 && modules[0].IatRva == 0x2200);
+        vector<PEImage::ImportedFunction> functions;
+        for (const PEImage::ImportedFunction& function : image.GetImportedFunctions(modules[0]))
+            functions.push_back(function);
+
+        CHECK(functions.size() == 2);
+        if (functions.size() == 2)
+        {
+            CHECK(functions[0].Name == "CreateFileW" && functions[0].Hint == 0x55 && !functions[0].ByOrdinal);
+            CHECK(functions[0].IatRva == 0x2200);
+            CHECK(functions[1].ByOrdinal && functions[1].Ordinal == 17 && functions[1].Name.empty());
+            CHECK(functions[1].IatRva == 0x2200 + thunkSize);
+        }
+
+        // No OriginalFirstThunk: the names come from the IAT, which in this image hasn't been bound yet
+        CHECK(modules[1].Name == "USER32.dll" && modules[1].LookupRva == 0x2280 && modules[1].IatRva == 0x2280);
+        int count = 0;
+        for (const PEImage::ImportedFunction& function : image.GetImportedFunctions(modules[1]))
+        {
+            CHECK(function.Name == "MessageBoxW" && function.Hint == 0x1C3);
+            count++;
+        }
+        CHECK(count == 1);
+    }
+
+    vector<PEImage::Export> exports;
+    for (const PEImage::Export& entry : image.GetExports())
+        exports.push_back(entry);
+
+    CHECK(exports.size() == 3);
+    if (exports.size() == 3)
+    {
+        CHECK(exports[0].Name == "Alpha" && exports[0].Ordinal == 5 && exports[0].Rva == 0x1010 && exports[0].Forwarder.empty());
+        CHECK(exports[1].Name == "Forwarded" && exports[1].Ordinal == 7 && exports[1].Forwarder == "KERNEL32.Sleep");
+        CHECK(exports[2].Name == "Zeta" && exports[2].Ordinal == 8 && exports[2].Rva == 0x1020);
+    }
+
+    for (const char* pName : { "Alpha", "Forwarded", "Zeta" })
+    {
+        PEImage::Export entry;
+        CHECK(image.FindExport(pName, entry) && entry.Name == pName);
+    }
+    for (const char* pName : { "", "A", "Beta", "Zetaa", "zeta" })
+    {
+        PEImage::Export entry;
+        CHECK(!image.FindExport(pName, entry));
+    }
+
+    vector<PEImage::Relocation> relocations;
+    for (const PEImage::Relocation& relocation : image.GetRelocations())
+        relocations.push_back(relocation);
+
+    CHECK(relocations.size() == 4);
+    if (relocations.size() == 4)
+    {
+        CHECK(relocations[0].Rva == 0x1010 && relocations[0].Type == 3);
+        CHECK(relocations[1].Rva == 0x1020 && relocations[1].Type == 3);
+        CHECK(relocations[2].Rva == 0x2008 && relocations[2].Type == 10);
+        CHECK(relocations[3].Rva == 0x200C && relocations[3].Type == 10);
+    }
+
+    CHECK(image.HasRichHeader());
+    vector<PEImage::RichEntry> richEntries;
+    for (const PEImage::RichEntry& entry : image.GetRichEntries())
+        richEntries.push_back(entry);
+
+    CHECK(richEntries.size() == 2);
+    if (richEntries.size() == 2)
+    {
+        CHECK(richEntries[0].ProductId == 0x0104 && richEntries[0].Build == 30319 && richEntries[0].Count == 12);
+        CHECK(richEntries[1].ProductId == 0x00FF && richEntries[1].Build == 40219 && richEntries[1].Count == 1);
+    }
+}
+
+static void TestWellFormed()
+{
+    for (bool is64Bit : { false, true })
+    {
+        vector<uint8_t> mapped = MakeMappedImage(is64Bit);
+        CheckImage(mapped, PEImage::Layout::Mapped, is64Bit);
+        CheckImage(ToFileLayout(mapped), PEImage::Layout::File, is64Bit);
+    }
+}
+
+static void TestRejected()
+{
+    vector<uint8_t> image = MakeMappedImage(false);
+    PEImage parsed;
+    CHECK(!parsed.Parse(image.data(), 0x3F, PEImage::Layout::Mapped));
+    CHECK(!parsed.IsValid());
+
+    auto rejects = [&](size_t offset, uint8_t value)
+    {
+        vector<uint8_t> broken = image;
+        broken[offset] = value;
+        return !parsed.Parse(broken.data(), broken.size(), PEImage::Layout::Mapped) && !parsed.IsValid();
+    };
+    CHECK(rejects(0, 'X'));                                     // DOS signature
+    CHECK(rejects(0x3F, 0x80));                                 // e_lfanew past the end
+    CHECK(rejects(NtHeadersOffset + 1, 'X'));                   // PE signature
+    CHECK(rejects(NtHeadersOffset + 24, 0x0C));                 // Optional header magic
+    CHECK(rejects(NtHeadersOffset + 4 + 16, 0x20));             // Optional header too small
+    CHECK(rejects(NtHeadersOffset + 4 + 3, 0xFF));              // Section table past the end
+
+    // A failed parse leaves nothing behind from an earlier one
+    CHECK(parsed.Parse(image.data(), image.size(), PEImage::Layout::Mapped));
+    CHECK(!parsed.Parse(image.data(), 0x3F, PEImage::Layout::Mapped));
+    CHECK(!parsed.IsValid() && parsed.GetSectionCount() == 0 && !parsed.HasRichHeader());
+}
+
+// Walks everything the image offers; the sanitizer build catches any read outside the buffer
+static size_t WalkAll(const PEImage& image)
+{
+    size_t count = 0;
+    for (const PEImage::Section& section : image.GetSections())
+        count += section.Name.size() + section.DataSize;
+
+    for (const PEImage::ImportedModule& module : image.GetImports())
+    {
+        count += module.Name.size();
+        int functions = 0;
+        for (const PEImage::ImportedFunction& function : image.GetImportedFunctions(module))
+        {
+            count += function.Name.size();
+            if (++functions == 1000)
+                break;
+        }
+        if (++count > 100000)
+            break;
+    }
+
+    for (const PEImage::Export& entry : image.GetExports())
+    {
+        PEImage::Export found;
+        if (!entry.Name.empty() && image.FindExport(entry.Name, found))
+            count++;
+
+        count += entry.Forwarder.size();
+    }
+
+    for (const PEImage::Relocation& relocation : image.GetRelocations())
+        count += relocation.Type;
+
+    for (const PEImage::RichEntry& entry : image.GetRichEntries())
+        count += entry.Count;
+
+    return count;
+}
+
+static void TestTruncated()
+{
+    for (bool is64Bit : { false, true })
+    {
+        vector<uint8_t> mapped = MakeMappedImage(is64Bit);
+        for (PEImage::Layout layout : { PEImage::Layout::Mapped, PEImage::Layout::File })
+        {
+            vector<uint8_t> full = layout == PEImage::Layout::Mapped ? mapped : ToFileLayout(mapped);
+            for (size_t size = 0; size < full.size(); size += 7)
+            {
+                // An exact-size copy so reading past the end is an error, not just a read into the rest of the image
+                vector<uint8_t> truncated(full.begin(), full.begin() + size);
+                PEImage image;
+                if (image.Parse(truncated.data(), truncated.size(), layout))
+                    WalkAll(image);
+            }
+        }
+    }
+}
+
+static void TestCorrupted()
+{
+    mt19937 random(1234);
+    for (bool is64Bit : { false, true })
+    {
+        vector<uint8_t> file = ToFileLayout(MakeMappedImage(is64Bit));
+        for (int iteration = 0; iteration < 20000; iteration++)
+        {
+            vector<uint8_t> corrupt = file;
+            int changes = 1 + random() % 8;
+            for (int i = 0; i < changes; i++)
+            {
+                // Mostly the headers and the tables in .rdata and .reloc, where the offsets are
+                size_t offset = random() % 2 == 0 ? random() % SizeOfHeaders : 0x600 + random() % 0xA00;
+                corrupt[offset] = random() % 4 == 0 ? 0xFF : (uint8_t)random();
+            }
+
+            PEImage image;
+            if (image.Parse(corrupt.data(), corrupt.size(), PEImage::Layout::File))
+                WalkAll(image);
+        }
+    }
+}
+
+int main()
+{
+    TestWellFormed();
+    TestRejected();
+    TestTruncated();
+    TestCorrupted();
+    return TEST_RESULT();
+}
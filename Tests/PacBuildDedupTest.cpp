@@ -0,0 +1,203 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Built by CMakeLists.txt
+static const string PacBuild = PACBUILD_PATH;
+
+static constexpr uint32_t DirectoryOffset = 0x804;
+
+struct ArchiveEntry
+{
+    string Name;
+    vector<uint8_t> Data;
+};
+
+static vector<uint8_t> ReadFile(const fs::path& path)
+{
+    ifstream stream(path, ios::binary);
+    return vector<uint8_t>(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+}
+
+static void WriteFile(const fs::path& path, const vector<uint8_t>& data)
+{
+    ofstream stream(path, ios::binary);
+    stream.write((const char*)data.data(), data.size());
+}
+
+static uint32_t GetInt4(const vector<uint8_t>& data, size_t offset)
+{
+    uint32_t value;
+    memcpy(&value, data.data() + offset, 4);
+    return value;
+}
+
+static void PutInt4(vector<uint8_t>& data, size_t offset, uint32_t value)
+{
+    memcpy(data.data() + offset, &value, 4);
+}
+
+// Contents that never start with '$', so they're stored unencrypted
+static vector<uint8_t> MakeData(size_t size, mt19937& random)
+{
+    vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+        byte = (uint8_t)random();
+
+    if (size != 0)
+        data[0] = 'x';
+
+    return data;
+}
+
+// A "PAC " archive with every entry stored separately, duplicates included, ending with "EOF "
+static vector<uint8_t> MakeArchive(const vector<ArchiveEntry>& entries)
+{
+    vector<uint8_t> archive(DirectoryOffset + entries.size() * 0x28);
+    memcpy(archive.data(), "PAC ", 4);
+    PutInt4(archive, 8, (uint32_t)entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        size_t record = DirectoryOffset + i * 0x28;
+        memcpy(archive.data() + record, entries[i].Name.c_str(), entries[i].Name.size());
+        PutInt4(archive, record + 0x20, (uint32_t)entries[i].Data.size());
+        PutInt4(archive, record + 0x24, (uint32_t)archive.size());
+        archive.insert(archive.end(), entries[i].Data.begin(), entries[i].Data.end());
+    }
+    archive.insert(archive.end(), { 'E', 'O', 'F', ' ' });
+    return archive;
+}
+
+// Runs PacBuild with its output going to the given file and returns its exit code
+static int Run(const string& arguments, const fs::path& outputPath)
+{
+    string line = PacBuild + " " + arguments + " > '" + outputPath.string() + "' 2>&1";
+    int status = system(line.c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Reads the written archive through its directory, as the game does, and checks every entry's bytes
+static bool ReadBack(const vector<uint8_t>& archive, const vector<ArchiveEntry>& expected, vector<uint32_t>& offsets)
+{
+    if (archive.size() < DirectoryOffset || memcmp(archive.data(), "PAC ", 4) != 0 ||
+        GetInt4(archive, 8) != expected.size() || memcmp(archive.data() + archive.size() - 4, "EOF ", 4) != 0)
+    {
+        return false;
+    }
+
+    offsets.clear();
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        size_t record = DirectoryOffset + i * 0x28;
+        uint32_t size = GetInt4(archive, record + 0x20);
+        uint32_t offset = GetInt4(archive, record + 0x24);
+        if (expected[i].Name != (const char*)archive.data() + record || size != expected[i].Data.size() ||
+            (uint64_t)offset + size > archive.size() - 4 ||
+            !equal(expected[i].Data.begin(), expected[i].Data.end(), archive.begin() + offset))
+        {
+            return false;
+        }
+        offsets.push_back(offset);
+    }
+    return true;
+}
+
+static void TestDedup(const fs::path& workFolder)
+{
+    mt19937 random(50);
+    vector<uint8_t> shared = MakeData(3000, random);
+    vector<uint8_t> large = MakeData(2500000, random);              // Compared across several 1 MB chunks
+    vector<uint8_t> last = MakeData(700, random);
+    vector<uint8_t> sameSize = MakeData(3000, random);
+    sameSize.back() = (uint8_t)~shared.back();
+    vector<ArchiveEntry> original = {
+        { "first.bin", shared },
+        { "copy.bin", shared },                     // Copied duplicate of an earlier copied entry
+        { "script.src", MakeData(4000, random) },   // Replaced with the same bytes as first.bin
+        { "empty1.dat", {} },                       // Zero-size entries are never shared
+        { "empty2.dat", {} },
+        { "large1.bin", large },
+        { "samesize.bin", sameSize },               // Same size as first.bin but different bytes
+        { "large2.bin", large },
+        { "last.bin", last },
+        { "unique.bin", MakeData(123, random) },
+        { "lastcopy.bin", last }                    // Dropped from the end, so the file is truncated
+    };
+    vector<ArchiveEntry> expected = original;
+    expected[2].Data = shared;
+
+    fs::path dataFolder = workFolder / "data";
+    fs::path outputFolder = workFolder / "output";
+    fs::path plainFolder = workFolder / "plain";
+    fs::path outputPath = workFolder / "output.txt";
+    fs::create_directories(dataFolder);
+    WriteFile(dataFolder / "script.src", shared);
+    fs::path archivePath = workFolder / "data.pac";
+    WriteFile(archivePath, MakeArchive(original));
+
+    // Without --dedup every entry keeps its own copy
+    CHECK(Run("'" + dataFolder.string() + "' '" + plainFolder.string() + "' '" + archivePath.string() + "' --threads 2",
+              outputPath) == 0);
+    vector<uint8_t> plain = ReadFile(plainFolder / "data.pac");
+    vector<uint32_t> offsets;
+    CHECK(ReadBack(plain, expected, offsets));
+    CHECK(plain == MakeArchive(expected));
+
+    CHECK(Run("'" + dataFolder.string() + "' '" + outputFolder.string() + "' '" + archivePath.string() +
+              "' --threads 2 --dedup", outputPath) == 0);
+    vector<uint8_t> deduplicated = ReadFile(outputFolder / "data.pac");
+    CHECK(ReadBack(deduplicated, expected, offsets));
+    if (offsets.size() != expected.size())
+        return;
+
+    // Shared: copy.bin and script.src with first.bin, large2.bin with large1.bin, lastcopy.bin with last.bin
+    CHECK(offsets[1] == offsets[0] && offsets[2] == offsets[0]);
+    CHECK(offsets[7] == offsets[5] && offsets[10] == offsets[8]);
+    CHECK(offsets[6] != offsets[0] && offsets[9] != offsets[8]);
+
+    // Everything else is stored in order, one after the other; zero-size entries point at where the next one starts
+    CHECK(offsets[0] == DirectoryOffset + expected.size() * 0x28);
+    CHECK(offsets[3] == offsets[0] + shared.size() && offsets[4] == offsets[3] && offsets[5] == offsets[3]);
+    CHECK(offsets[6] == offsets[5] + large.size() && offsets[8] == offsets[6] + sameSize.size());
+    CHECK(offsets[9] == offsets[8] + last.size());
+
+    // The dropped copy of the last entry doesn't leave anything between the last data and the EOF marker
+    uint64_t bytesSaved = 2 * shared.size() + large.size() + last.size();
+    CHECK(deduplicated.size() == offsets[9] + expected[9].Data.size() + 4);
+    CHECK(deduplicated.size() + bytesSaved == plain.size());
+
+    vector<uint8_t> outputBytes = ReadFile(outputPath);
+    string output(outputBytes.begin(), outputBytes.end());
+    CHECK(output.find("4 entries share data with an earlier one") != string::npos);
+    CHECK(output.find("4 duplicate entries stored once, " + to_string(bytesSaved) + " bytes") != string::npos);
+
+    // Building again gives the same archive
+    CHECK(Run("'" + dataFolder.string() + "' '" + outputFolder.string() + "' '" + archivePath.string() + "' --dedup",
+              outputPath) == 0);
+    CHECK(ReadFile(outputFolder / "data.pac") == deduplicated);
+}
+
+int main()
+{
+    fs::path workFolder = fs::temp_directory_path() / ("PacBuildDedupTest." + to_string(getpid()));
+    fs::remove_all(workFolder);
+    fs::create_directories(workFolder);
+    TestDedup(workFolder);
+    fs::remove_all(workFolder);
+    return TEST_RESULT();
+}
@@ -0,0 +1,309 @@
+#include "Test.h"
+#include "../PACPacking/Common/PgdCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Byte for byte the post-processing of pgd2png_ge.py (_postprocess_method2 and _postprocess_pal). PgdReferenceTest.py
+// compares whole files against the scripts themselves; these cover what the scripts never write, such as rows
+// predicted from above or from the average, at every size around the SIMD block widths.
+
+static uint8_t ClampByte(int value)
+{
+    return (uint8_t)min(max(value, 0), 255);
+}
+
+static vector<uint8_t> ReferenceYuv(const vector<uint8_t>& unpacked, int width, int height)
+{
+    size_t stride = (size_t)width * 3;
+    vector<uint8_t> output(stride * height);
+    size_t segment = (size_t)width * height / 4;
+    size_t src0 = 0, src1 = segment, src2 = segment * 2, dst = 0;
+    const size_t points[] = { 0, 1, (size_t)width, (size_t)width + 1 };
+    for (int y = 0; y < height / 2; y++)
+    {
+        for (int x = 0; x < width / 2; x++)
+        {
+            int u = (int8_t)unpacked[src0++];
+            int v = (int8_t)unpacked[src1++];
+            int b = 226 * u, g = -43 * u - 89 * v, r = 179 * v;
+            for (size_t offset : points)
+            {
+                int base = unpacked[src2 + offset] << 7;
+                size_t pixel = dst + 3 * offset;
+                output[pixel] = ClampByte((base + b) >> 7);
+                output[pixel + 1] = ClampByte((base + g) >> 7);
+                output[pixel + 2] = ClampByte((base + r) >> 7);
+            }
+            src2 += 2;
+            dst += 6;
+        }
+        src2 += width;
+        dst += stride;
+    }
+    return output;
+}
+
+static vector<uint8_t> ReferenceRows(const vector<uint8_t>& input, int width, int height, int pixelSize)
+{
+    size_t stride = (size_t)width * pixelSize;
+    vector<uint8_t> output(stride * height);
+    size_t src = height, dst = 0;
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t control = input[y];
+        if (control & 1)
+        {
+            memcpy(&output[dst], &input[src], pixelSize);
+            src += pixelSize;
+            dst += pixelSize;
+            for (size_t i = pixelSize; i < stride; i++, dst++)
+                output[dst] = (uint8_t)(output[dst - pixelSize] - input[src++]);
+        }
+        else if (control & 2)
+        {
+            for (size_t i = 0; i < stride; i++, dst++)
+                output[dst] = (uint8_t)((dst >= stride ? output[dst - stride] : 0) - input[src++]);
+        }
+        else
+        {
+            memcpy(&output[dst], &input[src], pixelSize);
+            src += pixelSize;
+            dst += pixelSize;
+            for (size_t i = pixelSize; i < stride; i++, dst++)
+            {
+                int above = dst >= stride ? output[dst - stride] : 0;
+                output[dst] = (uint8_t)((above + output[dst - pixelSize]) / 2 - input[src++]);
+            }
+        }
+    }
+    return output;
+}
+
+static vector<uint8_t> RandomBytes(size_t size, mt19937& random)
+{
+    vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+        byte = (uint8_t)random();
+
+    return data;
+}
+
+static void TestType1()
+{
+    mt19937 random(1);
+    for (int width = 1; width <= 40; width += 3)
+    {
+        int height = 1 + width % 5;
+        size_t planeSize = (size_t)width * height;
+        vector<uint8_t> unpacked = RandomBytes(planeSize * 4, random);
+        PgdImage image;
+        CHECK(PgdCodec::DecodeType1(unpacked.data(), unpacked.size(), width, height, image));
+        CHECK(image.Width == width && image.Height == height && image.Channels == 4);
+
+        bool same = image.Pixels.size() == planeSize * 4;
+        for (size_t i = 0; same && i < planeSize; i++)
+        {
+            // Planes of A, R, G and B
+            same = image.Pixels[i * 4] == unpacked[planeSize * 3 + i] && image.Pixels[i * 4 + 1] == unpacked[planeSize * 2 + i] &&
+                   image.Pixels[i * 4 + 2] == unpacked[planeSize + i] && image.Pixels[i * 4 + 3] == unpacked[i];
+        }
+        CHECK(same);
+
+        vector<uint8_t> shorter(unpacked.begin(), unpacked.end() - 1);
+        CHECK(!PgdCodec::DecodeType1(shorter.data(), shorter.size(), width, height, image));
+    }
+}
+
+static void TestType2()
+{
+    mt19937 random(2);
+    for (int width = 1; width <= 70; width++)
+    {
+        for (int height : { 1, 2, 3, 6, 7 })
+        {
+            // Exactly as much data as the odd-width layout reads, so the sanitizer build catches a read past it
+            size_t segment = (size_t)width * height / 4;
+            size_t blocks = width / 2, rowPairs = height / 2, yStep = blocks * 2 + width;
+            size_t size = rowPairs == 0 ? 0 : max(segment + rowPairs * blocks, segment * 2 + (rowPairs - 1) * yStep + width + blocks * 2);
+            vector<uint8_t> unpacked = RandomBytes(size, random);
+
+            PgdImage image;
+            CHECK(PgdCodec::DecodeType2(unpacked.data(), unpacked.size(), width, height, image));
+            CHECK(image.Channels == 3 && image.Pixels == ReferenceYuv(unpacked, width, height));
+            if (rowPairs != 0 && blocks != 0)
+                CHECK(!PgdCodec::DecodeType2(unpacked.data(), unpacked.size() - 1, width, height, image));
+        }
+    }
+
+    // Extremes of U, V and Y, where the offsets clamp
+    for (int u : { -128, -1, 0, 127 })
+    {
+        for (int v : { -128, 0, 127 })
+        {
+            vector<uint8_t> unpacked = { (uint8_t)u, (uint8_t)v, 0, 255, 1, 254 };
+            PgdImage image;
+            CHECK(PgdCodec::DecodeType2(unpacked.data(), unpacked.size(), 2, 2, image) && image.Pixels == ReferenceYuv(unpacked, 2, 2));
+        }
+    }
+}
+
+static void TestRows()
+{
+    mt19937 random(3);
+    for (int pixelSize : { 3, 4 })
+    {
+        for (int width = 1; width <= 40; width++)
+        {
+            int height = 1 + (width * 7) % 6;
+            vector<uint8_t> input = RandomBytes(height * (1 + (size_t)width * pixelSize), random);
+            for (int y = 0; y < height; y++)
+                input[y] = (uint8_t)(random() % 3);
+
+            vector<uint8_t> output((size_t)width * height * pixelSize);
+            CHECK(PgdCodec::DecodeRows(input.data(), input.size(), width, height, pixelSize, output.data()));
+            CHECK(output == ReferenceRows(input, width, height, pixelSize));
+
+            vector<uint8_t> shorter(input.begin(), input.end() - 1);
+            CHECK(!PgdCodec::DecodeRows(shorter.data(), shorter.size(), width, height, pixelSize, output.data()));
+        }
+    }
+}
+
+// A control byte per 8 items (low bit first): 0 = literal run (count, bytes), 1 = match (offset << 4 | 8 | count - 4,
+// or offset << 4 | (count - 4) >> 8 followed by the low byte of count - 4)
+static void TestGeLz()
+{
+    const uint8_t stream[] = {
+        0x0A,                                   // literal, match, literal, match
+        5, 'a', 'b', 'c', 'd', 'e',
+        0x5B, 0x00,                             // offset 5, count 7
+        1, 'x',
+        0x10, 0x00, 0x06                        // offset 1, count 10 with the long form
+    };
+    const char expected[] = "abcdeabcdeabxxxxxxxxxxx";
+    vector<uint8_t> output(sizeof(expected) - 1);
+    CHECK(PgdCodec::DecompressGeLz(stream, sizeof(stream), output.data(), output.size()));
+    CHECK(memcmp(output.data(), expected, output.size()) == 0);
+
+    // Every truncation runs out of input, and a longer output runs out of input too
+    for (size_t size = 0; size < sizeof(stream); size++)
+    {
+        vector<uint8_t> truncated(stream, stream + size);
+        CHECK(!PgdCodec::DecompressGeLz(truncated.data(), truncated.size(), output.data(), output.size()));
+    }
+    vector<uint8_t> longer(output.size() + 1);
+    CHECK(!PgdCodec::DecompressGeLz(stream, sizeof(stream), longer.data(), longer.size()));
+
+    // A match reaching before the start, and one past the end of the output
+    const uint8_t badOffset[] = { 0x02, 1, 'a', 0x28, 0x00 };
+    uint8_t small[8];
+    CHECK(!PgdCodec::DecompressGeLz(badOffset, sizeof(badOffset), small, 5));
+    const uint8_t tooLong[] = { 0x02, 1, 'a', 0x1F, 0x00 };
+    CHECK(!PgdCodec::DecompressGeLz(tooLong, sizeof(tooLong), small, 8));
+
+    // A last literal run may go past the end of the output
+    const uint8_t overrun[] = { 0x00, 6, '1', '2', '3', '4', '5', '6' };
+    uint8_t four[4];
+    CHECK(PgdCodec::DecompressGeLz(overrun, sizeof(overrun), four, sizeof(four)) && memcmp(four, "1234", 4) == 0);
+
+    // Random input either fails or stays inside exact-size buffers
+    mt19937 random(4);
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        vector<uint8_t> input = RandomBytes(random() % 64, random);
+        vector<uint8_t> randomOutput(random() % 200);
+        PgdCodec::DecompressGeLz(input.data(), input.size(), randomOutput.data(), randomOutput.size());
+        PgdCodec::UnpackLookBehind(input.data(), input.size(), randomOutput.data(), randomOutput.size(), 0xFFC);
+    }
+}
+
+static vector<uint8_t> MakeGeFile(int type, int width, int height, const vector<uint8_t>& unpacked)
+{
+    // Stored as literal runs of up to 255 bytes, 8 to a control byte
+    vector<uint8_t> packed;
+    for (size_t i = 0, item = 0; i < unpacked.size(); item++)
+    {
+        if (item % 8 == 0)
+            packed.push_back(0);
+
+        size_t count = min<size_t>(255, unpacked.size() - i);
+        packed.push_back((uint8_t)count);
+        packed.insert(packed.end(), unpacked.begin() + i, unpacked.begin() + i + count);
+        i += count;
+    }
+
+    vector<uint8_t> file(0x28);
+    file[0] = 'G';
+    file[1] = 'E';
+    file[2] = 0x20;
+    uint32_t values[] = { 12, 34, (uint32_t)width, (uint32_t)height };
+    memcpy(&file[4], values, sizeof(values));
+    file[0x1C] = (uint8_t)type;
+    uint32_t sizes[] = { (uint32_t)unpacked.size(), (uint32_t)packed.size() };
+    memcpy(&file[0x20], sizes, sizeof(sizes));
+    file.insert(file.end(), packed.begin(), packed.end());
+    return file;
+}
+
+static void TestDecodeFiles()
+{
+    mt19937 random(5);
+    int width = 9, height = 4;
+    vector<uint8_t> type1 = RandomBytes((size_t)width * height * 4, random);
+    vector<uint8_t> rows = RandomBytes(height * (1 + (size_t)width * 4), random);
+    for (int y = 0; y < height; y++)
+        rows[y] = (uint8_t)(y % 3);
+
+    vector<uint8_t> type3 = { 7, 0, 32, 0, (uint8_t)width, 0, (uint8_t)height, 0 };
+    type3.insert(type3.end(), rows.begin(), rows.end());
+
+    for (const vector<uint8_t>& file : { MakeGeFile(1, width, height, type1), MakeGeFile(3, 0, 0, type3) })
+    {
+        PgdImage image;
+        string error;
+        CHECK(PgdCodec::Decode(file.data(), file.size(), image, error));
+        CHECK(image.Width == width && image.Height == height && image.Channels == 4);
+        CHECK(image.OffsetX == 12 && image.OffsetY == 34);
+        if (file[0x1C] == 3)
+            CHECK(image.Pixels == ReferenceRows(rows, width, height, 4));
+
+        for (size_t size = 0; size < file.size(); size++)
+        {
+            vector<uint8_t> truncated(file.begin(), file.begin() + size);
+            error.clear();
+            CHECK(!PgdCodec::Decode(truncated.data(), truncated.size(), image, error) && !error.empty());
+        }
+
+        // Damage anywhere either fails cleanly or decodes to something; never reads or writes out of bounds
+        for (int iteration = 0; iteration < 2000; iteration++)
+        {
+            vector<uint8_t> damaged = file;
+            damaged[random() % damaged.size()] ^= (uint8_t)(1 + random() % 255);
+            PgdCodec::Decode(damaged.data(), damaged.size(), image, error);
+        }
+    }
+
+    // Sizes the header can't back up
+    vector<uint8_t> huge = MakeGeFile(1, 1 << 16, 1 << 16, type1);
+    PgdImage image;
+    string error;
+    CHECK(!PgdCodec::Decode(huge.data(), huge.size(), image, error));
+    vector<uint8_t> unknown = MakeGeFile(9, width, height, type1);
+    CHECK(!PgdCodec::Decode(unknown.data(), unknown.size(), image, error));
+}
+
+int main()
+{
+    TestType1();
+    TestType2();
+    TestRows();
+    TestGeLz();
+    TestDecodeFiles();
+    return TEST_RESULT();
+}
@@ -0,0 +1,292 @@
+#include "Test.h"
+#include "../PACPacking/Common/PgdCodec.h"
+#include "../PACPacking/Common/PgdEncoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Round trips through PgdCodec. PgdReferenceTest.py checks the encoder's files against the Python scripts.
+
+static const PgdPreset Presets[] = { PgdPreset::Fast, PgdPreset::Normal, PgdPreset::Max };
+
+// Gradients, a flat block, noise and, with alpha, transparent and partly transparent areas
+static PgdImage MakeImage(int width, int height, int channels, mt19937& random)
+{
+    PgdImage image;
+    image.Width = width;
+    image.Height = height;
+    image.Channels = channels;
+    image.Pixels.resize((size_t)width * height * channels);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint8_t* pPixel = image.Pixels.data() + ((size_t)y * width + x) * channels;
+            bool flat = x < width / 2 && y < height / 2;
+            pPixel[0] = flat ? 200 : (uint8_t)(x * 7 + y * 3);
+            pPixel[1] = flat ? 30 : (uint8_t)(x * 2 + y * 11 + 40);
+            pPixel[2] = flat ? 90 : (uint8_t)random();
+            if (channels == 4)
+                pPixel[3] = y < height / 4 ? 0 : x < width / 3 ? 255 : (uint8_t)random();
+        }
+    }
+    return image;
+}
+
+static vector<uint8_t> MakeData(size_t size, int kind, mt19937& random)
+{
+    static const char* Words[] = { "SetText(", "msg", " ", "\r\n", "bg01", "0x", ");" };
+    vector<uint8_t> data;
+    while (data.size() < size)
+    {
+        switch (kind)
+        {
+        case 0:
+            data.push_back((uint8_t)random());
+            break;
+
+        case 1:
+        {
+            const char* pWord = Words[random() % std::size(Words)];
+            data.insert(data.end(), pWord, pWord + strlen(pWord));
+            break;
+        }
+
+        default:
+            data.insert(data.end(), 1 + random() % 300, (uint8_t)(random() % 4));
+            break;
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+static bool Decompress(const vector<uint8_t>& packed, const vector<uint8_t>& expected)
+{
+    // Exact-size buffer so the sanitizer build catches writes past the end
+    vector<uint8_t> output(expected.size());
+    return PgdCodec::DecompressGeLz(packed.data(), packed.size(), output.data(), output.size()) && output == expected;
+}
+
+static void TestGeLz()
+{
+    mt19937 random(47);
+    for (int iteration = 0; iteration < 60; iteration++)
+    {
+        size_t size = iteration < 10 ? iteration : random() % (iteration < 50 ? 5000 : 600000);
+        int kind = iteration % 3;
+        vector<uint8_t> data = MakeData(size, kind, random);
+        for (PgdPreset preset : Presets)
+        {
+            vector<uint8_t> packed = PgdEncoder::CompressGeLz(data.data(), data.size(), preset, 1);
+            CHECK(Decompress(packed, data));
+            if (kind == 2 && size > 1000)
+                CHECK(packed.size() < size / 4);
+
+            // Bands refer back into the band before them, so the thread count never changes the output
+            if (size > 100000)
+            {
+                for (int numThreads : { 2, 3, 8 })
+                    CHECK(PgdEncoder::CompressGeLz(data.data(), data.size(), preset, numThreads) == packed);
+            }
+        }
+    }
+
+    // Better presets never do worse on text
+    vector<uint8_t> text = MakeData(200000, 1, random);
+    size_t fast = PgdEncoder::CompressGeLz(text.data(), text.size(), PgdPreset::Fast, 1).size();
+    size_t normal = PgdEncoder::CompressGeLz(text.data(), text.size(), PgdPreset::Normal, 1).size();
+    size_t max = PgdEncoder::CompressGeLz(text.data(), text.size(), PgdPreset::Max, 1).size();
+    CHECK(max <= normal && normal <= fast);
+}
+
+static bool DecodeFile(const vector<uint8_t>& file, PgdImage& image)
+{
+    string error;
+    return PgdCodec::Decode(file.data(), file.size(), image, error) && error.empty();
+}
+
+// Types 1 and 3 are lossless; type 1 always decodes with alpha
+static void TestLossless()
+{
+    mt19937 random(48);
+    const int sizes[][2] = { { 1, 1 }, { 1, 7 }, { 7, 1 }, { 2, 2 }, { 5, 3 }, { 16, 9 }, { 33, 17 }, { 130, 65 } };
+    for (const auto& size : sizes)
+    {
+        for (int channels : { 3, 4 })
+        {
+            PgdImage image = MakeImage(size[0], size[1], channels, random);
+            image.OffsetX = 12;
+            image.OffsetY = 345;
+            for (int method : { 1, 3 })
+            {
+                PgdEncodeOptions options;
+                options.Method = method;
+                vector<uint8_t> file;
+                string error;
+                CHECK(PgdEncoder::Encode(image, options, file, error));
+
+                PgdImage decoded;
+                CHECK(DecodeFile(file, decoded));
+                CHECK(decoded.Width == image.Width && decoded.Height == image.Height);
+                CHECK(decoded.OffsetX == 12 && decoded.OffsetY == 345);
+                if (method == 3 || channels == 4)
+                {
+                    CHECK(decoded.Channels == channels && decoded.Pixels == image.Pixels);
+                }
+                else
+                {
+                    bool same = decoded.Channels == 4;
+                    for (size_t i = 0; same && i < (size_t)image.Width * image.Height; i++)
+                        same = memcmp(&decoded.Pixels[i * 4], &image.Pixels[i * 3], 3) == 0 && decoded.Pixels[i * 4 + 3] == 255;
+
+                    CHECK(same);
+                }
+
+                // The thread count doesn't change the file
+                options.NumThreads = 4;
+                vector<uint8_t> threaded;
+                CHECK(PgdEncoder::Encode(image, options, threaded, error) && threaded == file);
+            }
+        }
+    }
+}
+
+// Type 3 predicts each row from the left, from above or from their average, and decodes back either way
+static void TestRowModes()
+{
+    mt19937 random(49);
+    PgdImage image = MakeImage(64, 40, 4, random);
+
+    // Rows repeating the one above, and rows of a horizontal gradient
+    for (int y = 20; y < 30; y++)
+        memcpy(&image.Pixels[(size_t)y * 64 * 4], &image.Pixels[19 * 64 * 4], 64 * 4);
+
+    for (int y = 30; y < 40; y++)
+    {
+        for (int x = 0; x < 64; x++)
+            memset(&image.Pixels[((size_t)y * 64 + x) * 4], x * 3, 4);
+    }
+
+    vector<uint8_t> modes = PgdEncoder::SelectRowModes(image.Pixels.data(), 64, 40, 4, 1);
+    CHECK(modes.size() == 40 && modes[0] == 1);
+    CHECK(all_of(modes.begin(), modes.end(), [](uint8_t mode) { return mode <= 2; }));
+    CHECK(count(modes.begin() + 21, modes.begin() + 30, 2) == 9);
+    CHECK(PgdEncoder::SelectRowModes(image.Pixels.data(), 64, 40, 4, 3) == modes);
+
+    vector<uint8_t> unpacked = PgdEncoder::EncodeType3(image, 1);
+    PgdImage decoded;
+    CHECK(PgdCodec::DecodeType3(unpacked.data(), unpacked.size(), decoded) && decoded.Pixels == image.Pixels);
+}
+
+// Type 2 is lossy: odd sizes are padded to even ones, transparent pixels take the fill color, and the colors stay
+// close where they don't change within a 2x2 block
+static void TestType2()
+{
+    mt19937 random(50);
+    for (int width : { 1, 2, 5, 16, 33 })
+    {
+        for (int height : { 1, 2, 7, 12 })
+        {
+            PgdImage image = MakeImage(width, height, 4, random);
+            PgdEncodeOptions options;
+            options.Method = 2;
+            options.FillColor[0] = 10;
+            options.FillColor[1] = 20;
+            options.FillColor[2] = 30;
+            vector<uint8_t> file;
+            string error;
+            CHECK(PgdEncoder::Encode(image, options, file, error));
+
+            PgdImage decoded;
+            CHECK(DecodeFile(file, decoded));
+            CHECK(decoded.Width == (width + 1) / 2 * 2 && decoded.Height == (height + 1) / 2 * 2 && decoded.Channels == 3);
+
+            // A flat picture comes back within rounding, the padding included
+            PgdImage flat = image;
+            for (size_t i = 0; i < (size_t)width * height; i++)
+                memcpy(&flat.Pixels[i * 4], "\x28\x50\xA0\xFF", 4);
+
+            CHECK(PgdEncoder::Encode(flat, options, file, error) && DecodeFile(file, decoded));
+            int worst = 0;
+            for (size_t i = 0; i < decoded.Pixels.size(); i++)
+                worst = std::max(worst, abs(decoded.Pixels[i] - (uint8_t)"\x28\x50\xA0"[i % 3]));
+
+            CHECK(worst <= 2);
+
+            // Fully transparent becomes the fill color
+            for (size_t i = 0; i < (size_t)width * height; i++)
+                memcpy(&flat.Pixels[i * 4], "\x28\x50\xA0\x00", 4);
+
+            CHECK(PgdEncoder::Encode(flat, options, file, error) && DecodeFile(file, decoded));
+            worst = 0;
+            for (size_t i = 0; i < decoded.Pixels.size(); i++)
+                worst = std::max(worst, abs(decoded.Pixels[i] - options.FillColor[i % 3]));
+
+            CHECK(worst <= 2);
+        }
+    }
+}
+
+static void TestHeader()
+{
+    mt19937 random(51);
+    PgdImage image = MakeImage(20, 10, 4, random);
+    PgdEncodeOptions options;
+    vector<uint8_t> templateFile;
+    string error;
+    image.OffsetX = 100;
+    image.OffsetY = 200;
+    CHECK(PgdEncoder::Encode(image, options, templateFile, error));
+    memcpy(&templateFile[0x14], "\x40\x01\x00\x00\xF0\x00\x00\x00", 8);    // Original size 320x240
+    templateFile[0x1E] = 0x12;
+
+    // A template keeps the position, original size and unknown field, whatever the new picture says
+    PgdImage other = MakeImage(8, 6, 3, random);
+    options.pTemplate = templateFile.data();
+    options.Method = 1;
+    vector<uint8_t> file;
+    CHECK(PgdEncoder::Encode(other, options, file, error));
+    CHECK(memcmp(&file[4], &templateFile[4], 8) == 0 && memcmp(&file[0x14], &templateFile[0x14], 8) == 0);
+    CHECK(file[0x1C] == 1 && file[0x1E] == 0x12);
+
+    PgdImage decoded;
+    CHECK(DecodeFile(file, decoded) && decoded.Width == 8 && decoded.Height == 6 && decoded.OffsetX == 100);
+
+    // Unsupported types and sizes are refused with a message
+    options = PgdEncodeOptions();
+    options.Method = 4;
+    CHECK(!PgdEncoder::Encode(image, options, file, error) && !error.empty());
+
+    options.Method = 3;
+    PgdImage empty;
+    empty.Channels = 4;
+    error.clear();
+    CHECK(!PgdEncoder::Encode(empty, options, file, error) && !error.empty());
+
+    PgdImage wide;
+    wide.Width = 0x10000;
+    wide.Height = 1;
+    wide.Channels = 3;
+    wide.Pixels.resize(0x10000 * 3);
+    error.clear();
+    CHECK(!PgdEncoder::Encode(wide, options, file, error) && !error.empty());
+    options.Method = 1;
+    CHECK(PgdEncoder::Encode(wide, options, file, error) && DecodeFile(file, decoded) && decoded.Width == 0x10000);
+}
+
+int main()
+{
+    TestGeLz();
+    TestLossless();
+    TestRowModes();
+    TestType2();
+    TestHeader();
+    return TEST_RESULT();
+}
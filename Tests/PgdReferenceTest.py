@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+# Checks PgdConvert against the Python scripts in Softpal_PGD_Toolkit, which are the reference for the PGD formats:
+# pictures the scripts encode have to decode to exactly the pixels the scripts' own decoders give, and pictures
+# PgdConvert encodes have to decode through the scripts to the original pixels (types 1 and 3) or to what PgdConvert
+# decodes (the lossy type 2), with the unpacked data of types 1 and 2 laid out as the scripts lay it out.
+#   python3 PgdReferenceTest.py <PgdConvert> <Softpal_PGD_Toolkit folder> <work folder>
+# Needs numpy, pillow and opencv-python, like the scripts themselves.
+
+import contextlib
+import io
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+import numpy as np
+from PIL import Image
+
+pgd_convert, toolkit_dir, work_dir = sys.argv[1:4]
+sys.path.insert(0, toolkit_dir)
+
+import pgd2png_ge
+import pgd2png_others
+import png2pgd_ge
+import png2pgd_others
+
+failures = 0
+
+
+def check(condition, message):
+    global failures
+    if not condition:
+        failures += 1
+        print("FAILED: " + message)
+
+
+def quietly(function, *args, **kwargs):
+    """Calls into the scripts without their progress bars"""
+    with contextlib.redirect_stdout(io.StringIO()), contextlib.redirect_stderr(io.StringIO()):
+        return function(*args, **kwargs)
+
+
+def make_picture(width, height, alpha, seed):
+    """Gradients, flat blocks (long matches), noise (literals) and, with alpha, transparent and partly transparent areas"""
+    rng = np.random.default_rng(seed)
+    y, x = np.mgrid[0:height, 0:width]
+    channels = 4 if alpha else 3
+    pixels = np.empty((height, width, channels), dtype=np.uint8)
+    pixels[:, :, 0] = (x * 7 + y * 3) & 0xFF
+    pixels[:, :, 1] = (x * 2 + y * 11 + 40) & 0xFF
+    pixels[:, :, 2] = rng.integers(0, 256, (height, width))
+    pixels[: height // 2, : width // 2, :3] = (200, 30, 90)
+    if alpha:
+        pixels[:, :, 3] = 255
+        pixels[height // 3:, width // 3:, 3] = rng.integers(0, 256, (height - height // 3, width - width // 3))
+        pixels[: height // 4, :, 3] = 0
+    return Image.fromarray(pixels, "RGBA" if alpha else "RGB")
+
+
+def pixels_of(path):
+    image = Image.open(path)
+    image.load()
+    return np.asarray(image.convert("RGBA") if image.mode not in ("RGB", "RGBA") else image)
+
+
+def pgd_convert_decode(pgd_path):
+    png_path = pgd_path + ".native.png"
+    result = subprocess.run([pgd_convert, "decode", pgd_path, png_path], capture_output=True, text=True)
+    check(result.returncode == 0, "PgdConvert can't decode %s: %s" % (pgd_path, result.stderr.strip()))
+    return pixels_of(png_path) if result.returncode == 0 else None
+
+
+def check_same_pixels(pgd_path, reference_png):
+    native = pgd_convert_decode(pgd_path)
+    if native is None:
+        return
+
+    reference = pixels_of(reference_png)
+    same = native.shape == reference.shape and np.array_equal(native, reference)
+    if not same and native.shape == reference.shape:
+        differing = np.argwhere(np.any(native != reference, axis=-1))
+        detail = "%d pixels differ, first at %s" % (len(differing), tuple(differing[0]))
+    else:
+        detail = "shape %s instead of %s" % (native.shape, reference.shape)
+    check(same, "%s: %s" % (os.path.basename(pgd_path), detail if not same else ""))
+
+
+def test_decoder():
+    """Every format the scripts write, in even and odd sizes, with and without alpha, decoded by both"""
+    folder = os.path.join(work_dir, "decode")
+    os.makedirs(folder)
+    sizes = [(1, 1), (2, 2), (7, 5), (16, 9), (33, 17), (64, 48)]
+    count = 0
+    for index, (width, height) in enumerate(sizes):
+        for alpha in (False, True):
+            name = "pic%d%s" % (index, "a" if alpha else "")
+            png_path = os.path.join(folder, name + ".png")
+            make_picture(width, height, alpha, index).save(png_path)
+
+            for method in (1, 2, 3):
+                for preset in ("fast", "max") if method == 3 and width == 64 else ("normal",):
+                    pgd_path = os.path.join(folder, "%s_ge%d_%s.pgd" % (name, method, preset))
+                    quietly(png2pgd_ge.png2pgd_single, png_path, method, pgd_path, None, preset, (255, 255, 255))
+                    reference = quietly(pgd2png_ge.pgd_to_png, pgd_path, pgd_path + ".reference.png")
+                    check_same_pixels(pgd_path, reference)
+                    count += 1
+
+                    # The scripts only write even sizes for type 2; a smaller size in the header gives the odd
+                    # sizes that older tools wrote, where the script leaves the last row and column black
+                    if method == 2 and width >= 2:
+                        with open(pgd_path, "rb") as f:
+                            data = bytearray(f.read())
+                        even_width, even_height = struct.unpack_from("<II", data, 0xC)
+                        for odd_width, odd_height in ((even_width - 1, even_height), (even_width, even_height - 1),
+                                                      (even_width - 1, even_height - 1)):
+                            if odd_width == 0 or odd_height == 0:
+                                continue
+                            struct.pack_into("<II", data, 0xC, odd_width, odd_height)
+                            odd_path = pgd_path[:-4] + "_%dx%d.pgd" % (odd_width, odd_height)
+                            with open(odd_path, "wb") as f:
+                                f.write(data)
+                            reference = quietly(pgd2png_ge.pgd_to_png, odd_path, odd_path + ".reference.png")
+                            check_same_pixels(odd_path, reference)
+                            count += 1
+
+            # The script's 11_C writer divides by a quarter of the pixel count
+            if width * height >= 4:
+                pgd_path = os.path.join(folder, name + "_11c.pgd")
+                quietly(png2pgd_others.write_11c, png_path, pgd_path, (3, 4), "normal")
+                reference = pgd_path + ".reference.png"
+                quietly(pgd2png_others.pgd_to_png, pgd_path, reference)
+                check_same_pixels(pgd_path, reference)
+                count += 1
+
+            # An overlay changing part of the picture, XOR'ed onto a type 3 base in the same folder. The script's
+            # decoder steps through the overlay by the base's pixel size, which is always 32 bits here.
+            if width >= 7:
+                base_path = os.path.join(folder, name + "_base.pgd")
+                quietly(png2pgd_ge.png2pgd_single, png_path, 3, base_path, None, "normal", (255, 255, 255))
+                changed = np.array(Image.open(png_path).convert("RGBA"))
+                changed[height // 3: height // 3 + 3, width // 4: width // 4 + 5, :3] ^= 0x5A
+                changed_path = os.path.join(folder, name + "_changed.png")
+                Image.fromarray(changed, "RGBA").save(changed_path)
+                pgd3_path = os.path.join(folder, name + "_overlay.pgd")
+                quietly(png2pgd_others.png_to_pgd3, changed_path, base_ge=base_path, out_path=pgd3_path, bpp_mode="32")
+                reference = pgd3_path + ".reference.png"
+                quietly(pgd2png_others.pgd_to_png, pgd3_path, reference)
+                check_same_pixels(pgd3_path, reference)
+                count += 1
+
+    print("decoder: %d pictures compared" % count)
+
+
+def test_encoder():
+    """PgdConvert's pictures of every type and preset, decoded and unpacked by the scripts"""
+    folder = os.path.join(work_dir, "encode")
+    os.makedirs(folder)
+    sizes = [(1, 1), (2, 2), (7, 5), (16, 9), (33, 17), (64, 48), (150, 37)]
+    count = 0
+    for index, (width, height) in enumerate(sizes):
+        for alpha in (False, True):
+            name = "pic%d%s" % (index, "a" if alpha else "")
+            png_path = os.path.join(folder, name + ".png")
+            make_picture(width, height, alpha, 100 + index).save(png_path)
+            source = pixels_of(png_path)
+            bgra, _ = png2pgd_ge.read_png_rgba(png_path)
+
+            for method in (1, 2, 3):
+                for preset in ("fast", "normal", "max") if width == 150 else ("normal",):
+                    pgd_path = os.path.join(folder, "%s_ge%d_%s.pgd" % (name, method, preset))
+                    result = subprocess.run([pgd_convert, "encode", png_path, pgd_path, "-m", str(method),
+                                             "--preset", preset], capture_output=True, text=True)
+                    check(result.returncode == 0, "PgdConvert can't encode %s: %s" % (pgd_path, result.stderr.strip()))
+                    if result.returncode != 0:
+                        continue
+
+                    unpacked = quietly(pgd2png_ge.load_pgd, pgd_path)["unpacked"]
+                    reference = pixels_of(quietly(pgd2png_ge.pgd_to_png, pgd_path, pgd_path + ".reference.png"))
+                    count += 1
+                    if method == 1:
+                        check(unpacked == png2pgd_ge.ge1_encode_from_bgra(bgra), "%s: unpacked data differs" % pgd_path)
+                        check(np.array_equal(reference, np.asarray(Image.open(png_path).convert("RGBA"))),
+                              "%s: the script doesn't decode the original pixels" % pgd_path)
+                    elif method == 3:
+                        check(reference.shape == source.shape and np.array_equal(reference, source),
+                              "%s: the script doesn't decode the original pixels" % pgd_path)
+                    else:
+                        check_type2(pgd_path, unpacked, bgra, width, height)
+                        check_same_pixels(pgd_path, pgd_path + ".reference.png")
+
+    print("encoder: %d pictures compared" % count)
+
+
+def check_type2(pgd_path, unpacked, bgra, width, height):
+    """ge2_encode_from_bgr() works in single precision through numpy; PgdConvert does the same arithmetic, so only a
+    value landing exactly on a rounding boundary may come out one step apart"""
+    bgr = png2pgd_ge.alpha_blend_with_color(bgra, (255, 255, 255))
+    if width % 2 or height % 2:
+        bgr = np.pad(bgr, ((0, height % 2), (0, width % 2), (0, 0)), mode="edge")
+    expected = np.frombuffer(png2pgd_ge.ge2_encode_from_bgr(bgr), dtype=np.uint8)
+    actual = np.frombuffer(unpacked, dtype=np.uint8)
+    if actual.shape != expected.shape:
+        check(False, "%s: %d bytes of unpacked data instead of %d" % (pgd_path, len(actual), len(expected)))
+        return
+
+    steps = np.abs(actual.astype(np.int16) - expected.astype(np.int16))
+    steps = np.minimum(steps, 256 - steps)
+    check(steps.max(initial=0) <= 1 and np.count_nonzero(steps) <= max(1, len(expected) // 500),
+          "%s: %d bytes of unpacked data differ, by up to %d" % (pgd_path, np.count_nonzero(steps), steps.max(initial=0)))
+
+
+def main():
+    shutil.rmtree(work_dir, ignore_errors=True)
+    os.makedirs(work_dir)
+    test_decoder()
+    test_encoder()
+    if failures:
+        print("%d checks failed" % failures)
+        return 1
+    print("passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
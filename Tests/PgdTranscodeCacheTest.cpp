@@ -0,0 +1,218 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/PgdTranscodeCache.h"
+#include "../PACPacking/Common/PacArchive.h"
+#include "../PACPacking/Common/PgdCodec.h"
+#include "../PACPacking/Common/PgdEncoder.h"
+#include "../PACPacking/Common/PngFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static vector<uint8_t> MakePixels(int width, int height, int channels, mt19937& random)
+{
+    vector<uint8_t> pixels((size_t)width * height * channels);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = i % 7 == 0 ? (uint8_t)random() : (uint8_t)(i / channels);
+
+    return pixels;
+}
+
+static vector<uint8_t> MakePng(int width, int height, mt19937& random)
+{
+    vector<uint8_t> pixels = MakePixels(width, height, 4, random);
+    return PngFile::Encode(pixels.data(), width, height, 4);
+}
+
+// A GE picture drawn at the given position, as the game's own files are
+static vector<uint8_t> MakePgd(int width, int height, int x, int y, mt19937& random)
+{
+    PgdImage image;
+    image.Width = width;
+    image.Height = height;
+    image.Channels = 3;
+    image.OffsetX = x;
+    image.OffsetY = y;
+    image.Pixels = MakePixels(width, height, 3, random);
+
+    vector<uint8_t> pgd;
+    string error;
+    PgdEncoder::Encode(image, PgdEncodeOptions(), pgd, error);
+    return pgd;
+}
+
+// A "PAC " archive: directory at 0x804, then the data and "EOF "
+static void WriteArchive(const fs::path& path, const vector<pair<string, vector<uint8_t>>>& entries)
+{
+    vector<uint8_t> archive(0x804 + entries.size() * PacArchive::EntrySize);
+    memcpy(archive.data(), "PAC ", 4);
+    uint32_t count = (uint32_t)entries.size();
+    memcpy(archive.data() + 8, &count, 4);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        uint8_t* pRecord = archive.data() + 0x804 + i * PacArchive::EntrySize;
+        uint32_t size = (uint32_t)entries[i].second.size();
+        uint32_t offset = (uint32_t)archive.size();
+        memcpy(pRecord, entries[i].first.c_str(), entries[i].first.size());
+        memcpy(pRecord + PacArchive::NameSize, &size, 4);
+        memcpy(pRecord + PacArchive::NameSize + 4, &offset, 4);
+        archive.insert(archive.end(), entries[i].second.begin(), entries[i].second.end());
+    }
+    archive.insert(archive.end(), { 'E', 'O', 'F', ' ' });
+    FileUtil::WriteAll(path.u8string(), archive.data(), archive.size());
+}
+
+static void WriteFile(const fs::path& path, const vector<uint8_t>& data)
+{
+    FileUtil::WriteAll(path.u8string(), data.data(), data.size());
+}
+
+static bool Decode(const vector<uint8_t>& pgd, PgdImage& image)
+{
+    string error;
+    return PgdCodec::Decode(pgd.data(), pgd.size(), image, error);
+}
+
+static bool SamePixels(const PgdImage& image, const vector<uint8_t>& png)
+{
+    int width, height, channels;
+    vector<uint8_t> pixels;
+    string error;
+    return PngFile::Decode(png.data(), png.size(), width, height, channels, pixels, error) && image.Width == width &&
+           image.Height == height && image.Channels == channels && image.Pixels == pixels;
+}
+
+static int CountFiles(const fs::path& folder, const string& extension)
+{
+    int count = 0;
+    error_code error;
+    for (fs::directory_iterator it(folder, error), end; !error && it != end; it.increment(error))
+        count += it->path().extension() == extension;
+
+    return count;
+}
+
+static void TestCache(const fs::path& workFolder)
+{
+    mt19937 random(49);
+    fs::path dataPac = workFolder / "data.pac";
+    fs::path etcPac = workFolder / "etc.pac";
+    fs::path cacheFolder = workFolder / "pgd_cache";
+    WriteArchive(dataPac, { { "script.src", vector<uint8_t>(100, 'x') }, { "BG01.PGD", MakePgd(20, 10, 100, 200, random) },
+                            { "NOTGE.PGD", vector<uint8_t>(64, 'y') } });
+    WriteArchive(etcPac, { { "bg01.pgd", MakePgd(20, 10, 7, 8, random) }, { "ETC01.PGD", MakePgd(8, 6, 30, 40, random) } });
+
+    PgdTranscodeCache cache;
+    cache.Init(cacheFolder, { dataPac, etcPac });
+
+    // The first archive that has the entry gives the position, whatever the case of the names
+    fs::path pngPath = workFolder / "BG01.png";
+    vector<uint8_t> png = MakePng(20, 10, random);
+    WriteFile(pngPath, png);
+    vector<uint8_t> pgd;
+    bool fromCache = true;
+    string error;
+    CHECK(cache.Get(pngPath, "bg01.PGD", pgd, fromCache, error) && !fromCache);
+    PgdImage image;
+    CHECK(Decode(pgd, image) && SamePixels(image, png) && image.OffsetX == 100 && image.OffsetY == 200);
+    CHECK(pgd[0x1C] == 3 && CountFiles(cacheFolder, ".pgd") == 1 && CountFiles(cacheFolder, ".tmp") == 0);
+
+    // The second time it comes from the cache folder, byte for byte
+    vector<uint8_t> cached;
+    CHECK(cache.Get(pngPath, "BG01.PGD", cached, fromCache, error) && fromCache && cached == pgd);
+
+    // A picture of another size doesn't keep the position, and neither does one with no GE original
+    vector<uint8_t> smallPng = MakePng(8, 6, random);
+    WriteFile(pngPath, smallPng);
+    CHECK(cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && !fromCache);
+    CHECK(Decode(pgd, image) && SamePixels(image, smallPng) && image.OffsetX == 0 && image.OffsetY == 0);
+    CHECK(cache.Get(pngPath, "ETC01.PGD", pgd, fromCache, error) && !fromCache);
+    CHECK(Decode(pgd, image) && image.OffsetX == 30 && image.OffsetY == 40);
+    for (const char* pName : { "NOTGE.PGD", "MISSING.PGD" })
+    {
+        CHECK(cache.Get(pngPath, pName, pgd, fromCache, error));
+        CHECK(Decode(pgd, image) && SamePixels(image, smallPng) && image.OffsetX == 0 && image.OffsetY == 0);
+    }
+
+    // Going back to the first version of the PNG hits the cache again
+    WriteFile(pngPath, png);
+    CHECK(cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && fromCache && pgd == cached);
+
+    // A damaged cache file is transcoded again and replaced
+    for (const auto& file : fs::directory_iterator(cacheFolder))
+        fs::resize_file(file.path(), 3);
+
+    CHECK(cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && !fromCache && pgd == cached);
+    CHECK(cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && fromCache && pgd == cached);
+
+    // Unreadable and broken PNGs are errors
+    error.clear();
+    CHECK(!cache.Get(workFolder / "missing.png", "BG01.PGD", pgd, fromCache, error) && !error.empty());
+    WriteFile(pngPath, vector<uint8_t>(png.begin(), png.begin() + png.size() / 2));
+    error.clear();
+    CHECK(!cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && !error.empty());
+
+    // A cache folder that can't be created only means transcoding every time
+    WriteFile(pngPath, png);
+    WriteFile(workFolder / "file", { 1 });
+    cache.Init(workFolder / "file" / "pgd_cache", { dataPac });
+    for (int i = 0; i < 2; i++)
+        CHECK(cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && !fromCache && pgd == cached);
+
+    // Init starts over with the new archives
+    cache.Init(cacheFolder, {});
+    CHECK(cache.Get(pngPath, "BG01.PGD", pgd, fromCache, error) && !fromCache);
+    CHECK(Decode(pgd, image) && SamePixels(image, png) && image.OffsetX == 0);
+}
+
+// The proxy asks from whichever threads the game opens files on
+static void TestThreads(const fs::path& workFolder)
+{
+    mt19937 random(50);
+    fs::path dataPac = workFolder / "data.pac";
+    WriteArchive(dataPac, { { "EV01.PGD", MakePgd(64, 48, 5, 6, random) } });
+    fs::path pngPath = workFolder / "EV01.png";
+    vector<uint8_t> png = MakePng(64, 48, random);
+    WriteFile(pngPath, png);
+
+    PgdTranscodeCache cache;
+    cache.Init(workFolder / "threads_cache", { dataPac });
+    vector<vector<uint8_t>> results(8);
+    vector<int> succeeded(results.size());
+    vector<thread> threads;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        threads.emplace_back([&, i]()
+        {
+            bool fromCache;
+            string error;
+            succeeded[i] = cache.Get(pngPath, "EV01.PGD", results[i], fromCache, error);
+        });
+    }
+    for (thread& thread : threads)
+        thread.join();
+
+    PgdImage image;
+    CHECK(Decode(results[0], image) && SamePixels(image, png) && image.OffsetX == 5);
+    for (size_t i = 0; i < results.size(); i++)
+        CHECK(succeeded[i] && results[i] == results[0]);
+
+    CHECK(CountFiles(workFolder / "threads_cache", ".pgd") == 1 && CountFiles(workFolder / "threads_cache", ".tmp") == 0);
+}
+
+int main()
+{
+    fs::path workFolder = fs::temp_directory_path() / "PgdTranscodeCacheTest";
+    fs::remove_all(workFolder);
+    fs::create_directories(workFolder);
+    TestCache(workFolder);
+    TestThreads(workFolder);
+    fs::remove_all(workFolder);
+    return TEST_RESULT();
+}
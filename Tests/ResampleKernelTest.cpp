@@ -0,0 +1,173 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/ResampleKernel.h"
+
+#include <cmath>
+
+using namespace std;
+using ResampleKernel::Filter;
+
+static constexpr Filter Filters[] = { Filter::CatmullRom, Filter::Lanczos3 };
+
+static bool Near(double a, double b, double tolerance = 1e-6)
+{
+    return fabs(a - b) <= tolerance;
+}
+
+// Independent double-precision Lanczos3, normalized over the same 6 taps
+static void ReferenceLanczos3(double frac, double* pWeights)
+{
+    const double pi = 3.14159265358979323846;
+    auto sinc = [pi](double x) { return x == 0.0 ? 1.0 : sin(pi * x) / (pi * x); };
+    double sum = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        double distance = i - 2 - frac;
+        pWeights[i] = fabs(distance) < 3.0 ? sinc(distance) * sinc(distance / 3.0) : 0.0;
+        sum += pWeights[i];
+    }
+    for (int i = 0; i < 6; i++)
+        pWeights[i] /= sum;
+}
+
+static void TestTaps()
+{
+    CHECK(ResampleKernel::TapCount(Filter::CatmullRom) == 4);
+    CHECK(ResampleKernel::FirstTapOffset(Filter::CatmullRom) == 1);
+    CHECK(ResampleKernel::TapCount(Filter::Lanczos3) == 6);
+    CHECK(ResampleKernel::FirstTapOffset(Filter::Lanczos3) == 2);
+    for (Filter filter : Filters)
+        CHECK(ResampleKernel::TapCount(filter) <= ResampleKernel::MaxTaps);
+}
+
+static void TestWeightsSumToOne()
+{
+    for (Filter filter : Filters)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            float weights[ResampleKernel::MaxTaps];
+            ResampleKernel::ComputeWeights(filter, i / 1000.0f, weights);
+            double sum = 0;
+            for (int tap = 0; tap < ResampleKernel::TapCount(filter); tap++)
+                sum += weights[tap];
+
+            CHECK(Near(sum, 1.0, 1e-5));
+        }
+    }
+}
+
+// At frac 0 the sample sits on a texel center, so that texel gets all the weight
+static void TestInterpolates()
+{
+    for (Filter filter : Filters)
+    {
+        float weights[ResampleKernel::MaxTaps];
+        ResampleKernel::ComputeWeights(filter, 0.0f, weights);
+        for (int tap = 0; tap < ResampleKernel::TapCount(filter); tap++)
+            CHECK(Near(weights[tap], tap == ResampleKernel::FirstTapOffset(filter) ? 1.0 : 0.0));
+    }
+}
+
+// Weights for frac and 1 - frac are mirror images
+static void TestSymmetry()
+{
+    for (Filter filter : Filters)
+    {
+        int taps = ResampleKernel::TapCount(filter);
+        for (int i = 1; i < 100; i++)
+        {
+            float weights[ResampleKernel::MaxTaps];
+            float mirrored[ResampleKernel::MaxTaps];
+            ResampleKernel::ComputeWeights(filter, i / 100.0f, weights);
+            ResampleKernel::ComputeWeights(filter, 1.0f - i / 100.0f, mirrored);
+            for (int tap = 0; tap < taps; tap++)
+                CHECK(Near(weights[tap], mirrored[taps - 1 - tap], 1e-5));
+        }
+    }
+}
+
+// Same values as CubicWeights() in the DX11 bicubic shader, and Catmull-Rom reproduces straight lines
+static void TestCatmullRom()
+{
+    float weights[4];
+    ResampleKernel::ComputeWeights(Filter::CatmullRom, 0.5f, weights);
+    CHECK(weights[0] == -0.0625f && weights[1] == 0.5625f && weights[2] == 0.5625f && weights[3] == -0.0625f);
+
+    for (int i = 0; i < 100; i++)
+    {
+        float frac = i / 100.0f;
+        float x = frac, x2 = x * x, x3 = x2 * x;
+        ResampleKernel::ComputeWeights(Filter::CatmullRom, frac, weights);
+        CHECK(Near(weights[0], -0.5f * x3 + x2 - 0.5f * x));
+        CHECK(Near(weights[1], 1.5f * x3 - 2.5f * x2 + 1.0f));
+        CHECK(Near(weights[2], -1.5f * x3 + 2.0f * x2 + 0.5f * x));
+        CHECK(Near(weights[3], 0.5f * x3 - 0.5f * x2));
+
+        double position = 0;
+        for (int tap = 0; tap < 4; tap++)
+            position += weights[tap] * (tap - 1);
+
+        CHECK(Near(position, frac, 1e-5));
+    }
+}
+
+static void TestLanczos3()
+{
+    for (int i = 0; i < 100; i++)
+    {
+        float frac = i / 100.0f;
+        float weights[6];
+        double reference[6];
+        ResampleKernel::ComputeWeights(Filter::Lanczos3, frac, weights);
+        ReferenceLanczos3(frac, reference);
+        for (int tap = 0; tap < 6; tap++)
+            CHECK(Near(weights[tap], reference[tap], 1e-6));
+    }
+}
+
+static void TestWeightTable()
+{
+    for (Filter filter : Filters)
+    {
+        const int phases = 64;
+        vector<float> table = ResampleKernel::BuildWeightTable(filter, phases);
+        CHECK(table.size() == (size_t)phases * ResampleKernel::MaxTaps);
+        for (int phase = 0; phase < phases; phase++)
+        {
+            float weights[ResampleKernel::MaxTaps];
+            ResampleKernel::ComputeWeights(filter, (float)phase / (phases - 1), weights);
+            const float* pRow = &table[(size_t)phase * ResampleKernel::MaxTaps];
+            for (int tap = 0; tap < ResampleKernel::MaxTaps; tap++)
+                CHECK(pRow[tap] == (tap < ResampleKernel::TapCount(filter) ? weights[tap] : 0.0f));
+        }
+    }
+
+    vector<float> single = ResampleKernel::BuildWeightTable(Filter::CatmullRom, 1);
+    CHECK(single.size() == ResampleKernel::MaxTaps && single[1] == 1.0f);
+}
+
+static void TestNames()
+{
+    for (Filter filter : Filters)
+    {
+        Filter parsed;
+        CHECK(ResampleKernel::TryParse(ResampleKernel::GetName(filter), parsed) && parsed == filter);
+    }
+
+    Filter filter = Filter::Lanczos3;
+    CHECK(!ResampleKernel::TryParse("linear", filter) && filter == Filter::Lanczos3);
+    CHECK(!ResampleKernel::TryParse("", filter));
+}
+
+int main()
+{
+    TestTaps();
+    TestWeightsSumToOne();
+    TestInterpolates();
+    TestSymmetry();
+    TestCatmullRom();
+    TestLanczos3();
+    TestWeightTable();
+    TestNames();
+    return TEST_RESULT();
+}
@@ -0,0 +1,59 @@
+#include "RttiTestImage.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+template<typename TFunc>
+static double TimeMilliseconds(int rounds, TFunc func)
+{
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+        func();
+
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / rounds;
+}
+
+// Builds the index for a generated module the size of a typical game executable (4 MB of code, 2 MB each of .rdata
+// and .data, 2000 classes unless given as the argument) and compares that with the old linear walk per class looked up
+static void Run(CompilerType compilerType, int numClasses)
+{
+    RttiTestImageBuilder builder(compilerType, 0x400000, 0x200000, 0x200000, 1);
+    for (int i = 0; i < numClasses; i++)
+    {
+        string name = "class" + to_string(i);
+        builder.AddClass(compilerType == CompilerType::Msvc ? name + "@engine@babel" : "Babel::T" + name, 1 + builder.Random()() % 30);
+    }
+    const RttiTestImage& image = builder.Result();
+
+    int count = 0;
+    double buildMs = TimeMilliseconds(5, [&]
+    {
+        RttiIndex index;
+        index.Build(image.Image.data(), (uint32_t)image.Image.size(), image.Address, compilerType, image.Code, image.DataSections);
+        count = index.GetCount();
+    });
+
+    // The last class is the worst case for the walk, which has to go through nearly everything
+    const string& lastName = image.ClassNames.back();
+    uint32_t vtable = 0;
+    double linearMs = TimeMilliseconds(5, [&] { vtable = FindVTableLinear(image, compilerType, lastName); });
+
+    printf("%s, %d classes in %u KB:\n", compilerType == CompilerType::Msvc ? "MSVC" : "Borland", count,
+        (uint32_t)image.Image.size() / 1024);
+    printf("  RttiIndex::Build:     %8.3f ms\n", buildMs);
+    printf("  Linear walk (1 class): %7.3f ms, so the index pays off from %.1f lookups\n", linearMs, buildMs / linearMs);
+    if (vtable == 0)
+        printf("  MISMATCH: the linear walk didn't find %s\n", lastName.c_str());
+}
+
+int main(int argc, char** argv)
+{
+    int numClasses = argc > 1 ? atoi(argv[1]) : 2000;
+    Run(CompilerType::Msvc, numClasses);
+    Run(CompilerType::Borland, numClasses);
+    return EXIT_SUCCESS;
+}
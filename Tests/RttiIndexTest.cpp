@@ -0,0 +1,141 @@
+#include "Test.h"
+#include "RttiTestImage.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static RttiIndex BuildIndex(const RttiTestImage& image, CompilerType compilerType)
+{
+    RttiIndex index;
+    index.Build(image.Image.data(), (uint32_t)image.Image.size(), image.Address, compilerType, image.Code, image.DataSections);
+    return index;
+}
+
+// Every class (and some that aren't there) gives the same vtable through the index as through the linear walk
+static void CheckAgainstLinearWalk(const RttiTestImage& image, CompilerType compilerType, const vector<string>& extraNames)
+{
+    RttiIndex index = BuildIndex(image, compilerType);
+    int numFound = 0;
+    vector<string> names = image.ClassNames;
+    names.insert(names.end(), extraNames.begin(), extraNames.end());
+    for (const string& name : names)
+    {
+        uint32_t expected = FindVTableLinear(image, compilerType, name);
+        uint32_t vtable = index.FindVTable(name);
+        CHECK(vtable == expected);
+        if (vtable != expected)
+            fprintf(stderr, "  %s: 0x%X instead of 0x%X\n", name.c_str(), vtable, expected);
+
+        numFound += expected != 0;
+    }
+    CHECK(numFound >= (int)image.ClassNames.size());
+}
+
+static void TestMsvc()
+{
+    RttiTestImageBuilder builder(CompilerType::Msvc, 0x20000, 0x40000, 0x40000, 34);
+
+    vector<uint32_t> vtables;
+    for (const char* pName : { "engine@babel", "engine2@babel", "CScene", "task@pal@@x", "a", "renderer@gfx@babel" })
+        vtables.push_back(builder.AddClass(pName, 1 + builder.Random()() % 12));
+
+    // Classes with several vtables (multiple inheritance) resolve to the first one
+    uint32_t firstVTable = builder.AddClass("CMulti", 4);
+    builder.AddClass("CMulti", 3, false);
+    for (int i = 0; i < 300; i++)
+        builder.AddClass("class" + to_string(i) + "@ns" + to_string(i % 7), 1 + builder.Random()() % 20);
+
+    // Decoys: a locator with the wrong signature, names that aren't class type names, and a name running off
+    // the end of the image
+    builder.AddVTable(builder.AddMsvcLocator(".?AVwrongsignature@@", 1), 3);
+    builder.AddVTable(builder.AddMsvcLocator("notatypename", 0), 3);
+    builder.AddVTable(builder.AddMsvcLocator(".?AVunterminated@", 0), 3);
+    uint32_t endName = builder.PutAtEnd(".?AVtruncated@@");
+    uint32_t locator = builder.AddMsvcLocator(".?AVplaceholder@@", 0);
+    builder.Put(locator - builder.Result().Address + 12, endName - 8);
+    builder.AddVTable(locator, 2);
+
+    const RttiTestImage& image = builder.Result();
+    CheckAgainstLinearWalk(image, CompilerType::Msvc, { "wrongsignature", "notatypename", "unterminated", "truncated",
+                                                        "engine", "babel", "placeholder", "CScene@" });
+
+    RttiIndex index = BuildIndex(image, CompilerType::Msvc);
+    CHECK(index.FindVTable("engine@babel") == vtables[0] && index.FindVTable("CMulti") == firstVTable);
+    CHECK(index.FindVTable("wrongsignature") == 0 && index.FindVTable("truncated") == 0);
+    CHECK(index.GetCount() >= 307);
+}
+
+static void TestBorland()
+{
+    RttiTestImageBuilder builder(CompilerType::Borland, 0x20000, 0x40000, 0x40000, 35);
+    uint32_t vtable = builder.AddClass("TPalTask", 5);
+    builder.AddClass("Babel::TEngine", 3);
+    builder.AddClass("TPalTask2", 1);
+    uint32_t firstVTable = builder.AddClass("TMulti", 2);
+    builder.AddClass("TMulti", 2, false);
+    for (int i = 0; i < 300; i++)
+        builder.AddClass("TClass" + to_string(i), 1 + builder.Random()() % 20);
+
+    builder.PutAtEnd(string(48, 'x') + "TTruncated");
+    const RttiTestImage& image = builder.Result();
+    CheckAgainstLinearWalk(image, CompilerType::Borland, { "TPal", "TEngine", "TTruncated", "TMissing" });
+
+    RttiIndex index = BuildIndex(image, CompilerType::Borland);
+    CHECK(index.FindVTable("TPalTask") == vtable && index.FindVTable("TMulti") == firstVTable);
+    CHECK(index.FindVTable("Babel::TEngine") != 0 && index.FindVTable("TTruncated") == 0);
+
+    // Unlike the linear walk, which took any zero byte at the name's offset for an empty name
+    CHECK(index.FindVTable("") == 0);
+}
+
+// Random images with random names, and the same image read at another base address
+static void TestRandom()
+{
+    for (uint32_t seed = 0; seed < 20; seed++)
+    {
+        CompilerType compilerType = seed % 2 == 0 ? CompilerType::Msvc : CompilerType::Borland;
+        RttiTestImageBuilder builder(compilerType, 0x4000, 0x10000, 0x4000, 100 + seed);
+        int numClasses = builder.Random()() % 100;
+        for (int i = 0; i < numClasses; i++)
+        {
+            string name(1 + builder.Random()() % 12, 'x');
+            for (char& c : name)
+                c = "abcAB_@0123"[builder.Random()() % 11];
+
+            builder.AddClass(name, 1 + builder.Random()() % 6);
+        }
+        CheckAgainstLinearWalk(builder.Result(), compilerType, { "x", "@@", "ab" });
+    }
+
+    // Nothing is found when the pointers are based on another address
+    RttiTestImageBuilder builder(CompilerType::Msvc, 0x4000, 0x10000, 0x4000, 36);
+    builder.AddClass("engine@babel", 3);
+    RttiTestImage image = builder.Result();
+    RttiIndex index;
+    index.Build(image.Image.data(), (uint32_t)image.Image.size(), image.Address + 0x10000, CompilerType::Msvc, image.Code,
+                image.DataSections);
+    CHECK(index.FindVTable("engine@babel") == 0);
+
+    // Unknown compilers have no RTTI to go by
+    index = BuildIndex(image, CompilerType::Unknown);
+    CHECK(index.GetCount() == 0);
+}
+
+static void TestDecoratedNames()
+{
+    CHECK(RttiIndex::GetDecoratedName("babel::engine", CompilerType::Msvc) == "engine@babel");
+    CHECK(RttiIndex::GetDecoratedName("a::b::c", CompilerType::Msvc) == "c@b@a");
+    CHECK(RttiIndex::GetDecoratedName("CScene", CompilerType::Msvc) == "CScene");
+    CHECK(RttiIndex::GetDecoratedName("Babel::TEngine", CompilerType::Borland) == "Babel::TEngine");
+}
+
+int main()
+{
+    TestMsvc();
+    TestBorland();
+    TestRandom();
+    TestDecoratedNames();
+    return TEST_RESULT();
+}
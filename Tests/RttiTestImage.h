@@ -0,0 +1,203 @@
+#pragma once
+
+// Synthetic 32-bit module images with MSVC or Borland RTTI for RttiIndexTest and RttiIndexBench, and the
+// per-class linear walk CompilerHelper::FindVTable did before RttiIndex, as the reference to compare against.
+
+#include "../VNTextProxy/CompilerSpecific/Rtti/RttiIndex.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct RttiTestImage
+{
+    std::vector<uint8_t> Image;                     // Laid out by RVA
+    uint32_t Address = 0x00400000;
+    RttiIndex::Range Code{};
+    std::vector<RttiIndex::Range> DataSections;
+    std::vector<std::string> ClassNames;            // Decorated, as RttiIndex::FindVTable takes them
+};
+
+class RttiTestImageBuilder
+{
+public:
+    RttiTestImageBuilder(CompilerType compilerType, uint32_t codeSize, uint32_t rdataSize, uint32_t dataSize, uint32_t seed)
+        : _compilerType(compilerType), _random(seed)
+    {
+        _result.Code = { 0x1000, codeSize };
+        _result.DataSections.push_back({ 0x1000 + codeSize, rdataSize });
+        _result.DataSections.push_back({ 0x1000 + codeSize + rdataSize, dataSize });
+        _result.Image.resize(0x1000 + codeSize + rdataSize + dataSize);
+        _next = _result.DataSections[0].Rva;
+
+        // Noise everywhere: plenty of pointers into the code (so most slots have to be checked), pointers
+        // anywhere into the image (so some land on RTTI structures at the wrong offset) and zeros
+        for (uint32_t rva = 0; rva + 4 <= (uint32_t)_result.Image.size(); rva += 4)
+        {
+            uint32_t kind = _random() % 10;
+            uint32_t value = kind < 4 ? CodePointer() : kind < 6 ? _result.Address + (uint32_t)(_random() % _result.Image.size())
+                           : kind < 8 ? 0 : (uint32_t)_random();
+            Put(rva, value);
+        }
+    }
+
+    // Adds the RTTI for a class and a vtable of numFunctions after it, and returns the vtable's RVA.
+    // decoratedName is "engine@babel" for MSVC ("babel::engine") and the plain name for Borland.
+    uint32_t AddClass(const std::string& decoratedName, int numFunctions, bool listed = true)
+    {
+        uint32_t rtti = _compilerType == CompilerType::Msvc ? AddMsvcLocator(".?AV" + decoratedName + "@@", 0)
+                                                            : AddBorlandTypeDescriptor(decoratedName);
+        if (listed)
+            _result.ClassNames.push_back(decoratedName);
+
+        return AddVTable(rtti, numFunctions);
+    }
+
+    // A vtable in front of the given RTTI structure
+    uint32_t AddVTable(uint32_t rtti, int numFunctions)
+    {
+        // Borland has two more fields between the type descriptor pointer and the first function
+        int numPrefixSlots = _compilerType == CompilerType::Msvc ? 1 : 3;
+        uint32_t rva = Allocate((numPrefixSlots + numFunctions) * 4);
+        Put(rva, rtti);
+        for (int i = 1; i < numPrefixSlots; i++)
+            Put(rva + i * 4, (uint32_t)_random());
+
+        uint32_t vtableRva = rva + numPrefixSlots * 4;
+        for (int i = 0; i < numFunctions; i++)
+            Put(vtableRva + i * 4, CodePointer());
+
+        return vtableRva;
+    }
+
+    // A complete object locator (signature, offset, constructor displacement offset, type descriptor,
+    // hierarchy) for a type descriptor (vtable pointer, spare, raw name) with the given name
+    uint32_t AddMsvcLocator(const std::string& rawName, uint32_t signature)
+    {
+        uint32_t typeDescriptor = Allocate(8 + (uint32_t)rawName.size() + 1);
+        Put(typeDescriptor, CodePointer());
+        Put(typeDescriptor + 4, 0);
+        PutString(typeDescriptor + 8, rawName);
+
+        uint32_t locator = Allocate(20);
+        Put(locator, signature);
+        Put(locator + 4, 0);
+        Put(locator + 8, 0);
+        Put(locator + 12, _result.Address + typeDescriptor);
+        Put(locator + 16, 0);
+        return _result.Address + locator;
+    }
+
+    // A type descriptor: 48 bytes of fields, then the name
+    uint32_t AddBorlandTypeDescriptor(const std::string& name)
+    {
+        uint32_t typeDescriptor = Allocate(48 + (uint32_t)name.size() + 1);
+        for (uint32_t offset = 0; offset < 48; offset += 4)
+            Put(typeDescriptor + offset, 0);
+
+        PutString(typeDescriptor + 48, name);
+        return _result.Address + typeDescriptor;
+    }
+
+    // Raw bytes at the end of the image, such as a name without its NUL
+    uint32_t PutAtEnd(const std::string& bytes)
+    {
+        uint32_t rva = (uint32_t)(_result.Image.size() - bytes.size());
+        memcpy(_result.Image.data() + rva, bytes.data(), bytes.size());
+        return _result.Address + rva;
+    }
+
+    uint32_t CodePointer()
+    {
+        return _result.Address + _result.Code.Rva + (uint32_t)(_random() % (_result.Code.Size / 4)) * 4;
+    }
+
+    void Put(uint32_t rva, uint32_t value)
+    {
+        memcpy(_result.Image.data() + rva, &value, 4);
+    }
+
+    std::mt19937& Random() { return _random; }
+    RttiTestImage& Result() { return _result; }
+
+private:
+    // Structures go one after the other from the start of .rdata, with noise in between
+    uint32_t Allocate(uint32_t size)
+    {
+        _next += 4 * (uint32_t)(_random() % 8);
+        uint32_t rva = _next;
+        _next = (_next + size + 3) & ~3u;
+        if (_next > _result.DataSections[0].Rva + _result.DataSections[0].Size)
+            abort();
+
+        return rva;
+    }
+
+    void PutString(uint32_t rva, const std::string& text)
+    {
+        memcpy(_result.Image.data() + rva, text.c_str(), text.size() + 1);
+    }
+
+    CompilerType _compilerType;
+    std::mt19937 _random;
+    RttiTestImage _result;
+    uint32_t _next;
+};
+
+// CompilerHelper::FindVTable before RttiIndex: for one class, every slot of every data section that points into
+// the code is checked for the class's RTTI in front of it, with the same bounds checks against the module
+inline uint32_t FindVTableLinear(const RttiTestImage& image, CompilerType compilerType, const std::string& decoratedName)
+{
+    const uint8_t* pStart = image.Image.data();
+    const uint8_t* pEnd = pStart + image.Image.size();
+    auto read = [&](const uint8_t* p) { uint32_t value; memcpy(&value, p, 4); return value; };
+    auto resolve = [&](uint32_t address) { return pStart + (address - image.Address); };
+    auto inModule = [&](uint32_t address) { return address >= image.Address && address - image.Address < image.Image.size(); };
+
+    uint32_t codeStart = image.Address + image.Code.Rva;
+    uint32_t codeEnd = codeStart + image.Code.Size;
+    size_t nameSize = decoratedName.size();
+    for (const RttiIndex::Range& section : image.DataSections)
+    {
+        for (uint32_t slotRva = section.Rva + 3 * 4; slotRva < section.Rva + section.Size; slotRva += 4)
+        {
+            uint32_t func = read(pStart + slotRva);
+            if (func < codeStart || func >= codeEnd)
+                continue;
+
+            if (compilerType == CompilerType::Borland)
+            {
+                // The old check stepped over whole BorlandTypeDescriptors (52 bytes each) for the bound
+                uint32_t typeDescriptor = read(pStart + slotRva - 12);
+                if (!inModule(typeDescriptor) || resolve(typeDescriptor) + 52 * (1 + nameSize) > pEnd)
+                    continue;
+
+                if (memcmp(resolve(typeDescriptor) + 48, decoratedName.c_str(), nameSize + 1) == 0)
+                    return slotRva;
+            }
+            else
+            {
+                uint32_t locator = read(pStart + slotRva - 4);
+                if (!inModule(locator) || resolve(locator) + 20 > pEnd || read(resolve(locator)) != 0)
+                    continue;
+
+                uint32_t typeDescriptor = read(resolve(locator) + 12);
+                if (!inModule(typeDescriptor) || resolve(typeDescriptor) + 12 > pEnd)
+                    continue;
+
+                const uint8_t* pRawName = resolve(typeDescriptor) + 8;
+                if (pRawName + nameSize + 7 > pEnd)
+                    continue;
+
+                if (memcmp(pRawName, ".?A", 3) == 0 && memcmp(pRawName + 4, decoratedName.c_str(), nameSize) == 0 &&
+                    memcmp(pRawName + 4 + nameSize, "@@\0", 3) == 0)
+                {
+                    return slotRva;
+                }
+            }
+        }
+    }
+    return 0;
+}
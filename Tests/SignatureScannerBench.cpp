@@ -0,0 +1,156 @@
+#include "../VNTextProxy/Util/CpuFeatures.h"
+#include "../VNTextProxy/Util/HookSignatures.h"
+#include "../VNTextProxy/Util/SignatureScanner.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace std;
+using Implementation = SignatureScanner::Implementation;
+
+struct BenchPattern
+{
+    const char* Name;
+    vector<uint8_t> Bytes;
+    vector<uint8_t> Mask;
+};
+
+static bool ReadFile(const char* pPath, vector<uint8_t>& data)
+{
+    FILE* pFile = fopen(pPath, "rb");
+    if (pFile == nullptr)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    data.resize((size_t)ftell(pFile));
+    fseek(pFile, 0, SEEK_SET);
+    bool success = fread(data.data(), 1, data.size(), pFile) == data.size();
+    fclose(pFile);
+    return success;
+}
+
+// Stand-in for a module image when no PE file is given: byte frequencies skewed like x86 code, where
+// 0x00, 0xFF and a few opcodes dominate
+static vector<uint8_t> MakeSyntheticImage(size_t size)
+{
+    static const uint8_t Common[] = { 0x00, 0x00, 0x00, 0xFF, 0x8B, 0x89, 0x48, 0x24, 0x45, 0xE8, 0x0F, 0x85, 0xC0 };
+    vector<uint8_t> data(size);
+    mt19937 random(1);
+    for (uint8_t& value : data)
+        value = random() % 2 == 0 ? Common[random() % sizeof(Common)] : (uint8_t)random();
+
+    return data;
+}
+
+// The byte-by-byte scan MemoryUtil::FindData used to do
+static const uint8_t* NaiveFind(const uint8_t* pHaystack, size_t length, const BenchPattern& pattern)
+{
+    size_t patternLength = pattern.Bytes.size();
+    for (size_t i = 0; i + patternLength <= length; i++)
+    {
+        if (pattern.Mask.empty())
+        {
+            if (memcmp(pHaystack + i, pattern.Bytes.data(), patternLength) == 0)
+                return pHaystack + i;
+
+            continue;
+        }
+
+        size_t j = 0;
+        while (j < patternLength && (pHaystack[i + j] & pattern.Mask[j]) == pattern.Bytes[j])
+            j++;
+
+        if (j == patternLength)
+            return pHaystack + i;
+    }
+    return nullptr;
+}
+
+template<typename TFunction>
+static double TimeMilliseconds(int rounds, TFunction function)
+{
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+        function();
+
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / rounds;
+}
+
+static void Bench(const string& name, const vector<uint8_t>& image, const vector<BenchPattern>& patterns)
+{
+    const int rounds = 5;
+    printf("%s: %.1f MB\n", name.c_str(), image.size() / 1048576.0);
+
+    size_t found = 0;
+    double naive = TimeMilliseconds(rounds, [&]()
+    {
+        for (const BenchPattern& pattern : patterns)
+            found += NaiveFind(image.data(), image.size(), pattern) != nullptr;
+    });
+    printf("  naive, one pass per pattern: %8.2f ms (%zu found)\n", naive, found / rounds);
+
+    SignatureScanner scanner;
+    for (const BenchPattern& pattern : patterns)
+        scanner.AddPattern(pattern.Bytes.data(), pattern.Mask.empty() ? nullptr : pattern.Mask.data(), (int)pattern.Bytes.size());
+
+    const pair<Implementation, const char*> implementations[] =
+    {
+        { Implementation::Scalar, "scalar" }, { Implementation::Sse2, "SSE2" }, { Implementation::Avx2, "AVX2" }
+    };
+    for (const auto& [implementation, implementationName] : implementations)
+    {
+        if (implementation == Implementation::Avx2 && !CpuFeatures::HasAvx2())
+            continue;
+
+        vector<const uint8_t*> results;
+        double milliseconds = TimeMilliseconds(rounds, [&]() { results = scanner.Scan(image.data(), image.size(), implementation); });
+        printf("  %-6s single pass:          %8.2f ms (%.0f MB/s)\n", implementationName, milliseconds,
+            image.size() / 1048576.0 / (milliseconds / 1000));
+
+        for (size_t i = 0; i < patterns.size(); i++)
+        {
+            if (results[i] != NaiveFind(image.data(), image.size(), patterns[i]))
+                printf("  MISMATCH for %s\n", patterns[i].Name);
+        }
+    }
+    for (size_t i = 0; i < patterns.size(); i++)
+    {
+        const uint8_t* pFound = NaiveFind(image.data(), image.size(), patterns[i]);
+        printf("  %-20s %s\n", patterns[i].Name, pFound ? ("at 0x" + to_string(pFound - image.data())).c_str() : "not found");
+    }
+}
+
+// Times the signatures the proxy looks for over the given PE files (e.g. SoftPal.exe and dll\PAL.dll), or over a
+// generated 10 MB image
+int main(int argc, char** argv)
+{
+    vector<BenchPattern> patterns =
+    {
+        { "SJIS lookup table", vector<uint8_t>(begin(HookSignatures::SjisLookupTablePattern), end(HookSignatures::SjisLookupTablePattern)), {} },
+        { "Borland", vector<uint8_t>({ 'B', 'o', 'r', 'l', 'a', 'n', 'd' }), {} },
+        // mov eax, [imm32] / ret, the shape of the old PalTaskGetTaskData
+        { "masked mov/ret", { 0xA1, 0x00, 0x00, 0x00, 0x00, 0xC3, 0xCC }, { 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF } },
+    };
+
+    if (argc < 2)
+    {
+        Bench("synthetic image", MakeSyntheticImage(10 << 20), patterns);
+        return EXIT_SUCCESS;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        vector<uint8_t> image;
+        if (!ReadFile(argv[i], image))
+        {
+            fprintf(stderr, "Can't read %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        Bench(argv[i], image, patterns);
+    }
+    return EXIT_SUCCESS;
+}
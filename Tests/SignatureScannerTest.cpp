@@ -0,0 +1,140 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/CpuFeatures.h"
+#include "../VNTextProxy/Util/SignatureScanner.h"
+
+#include <cstring>
+#include <memory>
+#include <random>
+
+using namespace std;
+using Implementation = SignatureScanner::Implementation;
+
+static const uint8_t* NaiveFind(const uint8_t* pHaystack, size_t length, const uint8_t* pPattern,
+                                const uint8_t* pMask, int patternLength)
+{
+    for (size_t i = 0; i + patternLength <= length; i++)
+    {
+        bool match = true;
+        for (int j = 0; j < patternLength && match; j++)
+            match = (pHaystack[i + j] & (pMask ? pMask[j] : 0xFF)) == pPattern[j];
+
+        if (match)
+            return pHaystack + i;
+    }
+    return nullptr;
+}
+
+static vector<Implementation> GetImplementations()
+{
+    vector<Implementation> implementations = { Implementation::Scalar, Implementation::Sse2, Implementation::Auto };
+    if (CpuFeatures::HasAvx2())
+        implementations.push_back(Implementation::Avx2);
+
+    return implementations;
+}
+
+static void TestExact()
+{
+    const char haystack[] = "xxBorlandxxBorland";
+    CHECK(SignatureScanner::FindFirst(haystack, sizeof(haystack) - 1, "Borland", nullptr, 7) ==
+          (const uint8_t*)haystack + 2);
+    CHECK(SignatureScanner::FindFirst(haystack, 8, "Borland", nullptr, 7) == nullptr);
+    CHECK(SignatureScanner::FindFirst(haystack, 9, "Borland", nullptr, 7) == (const uint8_t*)haystack + 2);
+    CHECK(SignatureScanner::FindFirst(haystack, 0, "B", nullptr, 1) == nullptr);
+    CHECK(SignatureScanner::FindFirst(haystack, sizeof(haystack) - 1, "Rich", nullptr, 4) == nullptr);
+}
+
+static void TestMasked()
+{
+    // mov eax, [imm32] with any address, then ret
+    const uint8_t pattern[] = { 0xA1, 0x00, 0x00, 0x00, 0x00, 0xC3 };
+    const uint8_t mask[] = { 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF };
+    const uint8_t haystack[] = { 0x90, 0xA1, 0x12, 0x34, 0x56, 0x78, 0xC2, 0xA1, 0x9A, 0xBC, 0xDE, 0xF0, 0xC3 };
+    CHECK(SignatureScanner::FindFirst(haystack, sizeof(haystack), pattern, mask, 6) == haystack + 7);
+
+    // No fully masked byte to anchor on
+    const uint8_t loosePattern[] = { 0x40, 0x01 };
+    const uint8_t looseMask[] = { 0xF0, 0x0F };
+    CHECK(SignatureScanner::FindFirst(haystack, sizeof(haystack), loosePattern, looseMask, 2) == nullptr);
+    const uint8_t looseHaystack[] = { 0x00, 0x4F, 0xF1 };
+    CHECK(SignatureScanner::FindFirst(looseHaystack, 3, loosePattern, looseMask, 2) == looseHaystack + 1);
+}
+
+static void TestMultiplePatterns()
+{
+    const char haystack[] = "....Rich....Borland....";
+    SignatureScanner scanner;
+    CHECK(scanner.AddPattern("Borland", nullptr, 7) == 0);
+    CHECK(scanner.AddPattern("Rich", nullptr, 4) == 1);
+    CHECK(scanner.AddPattern("Missing", nullptr, 7) == 2);
+    CHECK(scanner.GetPatternCount() == 3);
+    for (Implementation implementation : GetImplementations())
+    {
+        vector<const uint8_t*> results = scanner.Scan(haystack, sizeof(haystack) - 1, implementation);
+        CHECK(results.size() == 3);
+        CHECK(results[0] == (const uint8_t*)haystack + 12);
+        CHECK(results[1] == (const uint8_t*)haystack + 4);
+        CHECK(results[2] == nullptr);
+    }
+}
+
+// Every implementation against a naive scan, on exact-size buffers so reads past the end show up under ASan.
+// The haystacks are built from few byte values so that candidates and partial matches are common.
+static void TestRandom()
+{
+    mt19937 random(1);
+    for (int iteration = 0; iteration < 3000; iteration++)
+    {
+        size_t length = random() % 300;
+        int alphabet = 2 + random() % 6;
+        unique_ptr<uint8_t[]> haystack(new uint8_t[max<size_t>(length, 1)]);
+        for (size_t i = 0; i < length; i++)
+            haystack[i] = (uint8_t)(0x80 + random() % alphabet);
+
+        SignatureScanner scanner;
+        vector<vector<uint8_t>> patterns;
+        vector<vector<uint8_t>> masks;
+        int numPatterns = 1 + random() % 4;
+        for (int p = 0; p < numPatterns; p++)
+        {
+            int patternLength = 1 + random() % 12;
+            vector<uint8_t> pattern(patternLength);
+            vector<uint8_t> mask(patternLength, 0xFF);
+            bool masked = random() % 2 == 0;
+            size_t source = length > 0 ? random() % length : 0;
+            for (int i = 0; i < patternLength; i++)
+            {
+                // Mostly taken from the haystack, so many patterns do occur
+                pattern[i] = source + i < length && random() % 8 != 0 ? haystack[source + i]
+                                                                      : (uint8_t)(0x80 + random() % alphabet);
+                if (masked && random() % 3 == 0)
+                    mask[i] = (uint8_t)(random() % 2 == 0 ? 0x00 : random());
+
+                pattern[i] &= mask[i];
+            }
+            scanner.AddPattern(pattern.data(), masked ? mask.data() : nullptr, patternLength);
+            patterns.push_back(pattern);
+            masks.push_back(masked ? mask : vector<uint8_t>());
+        }
+
+        for (Implementation implementation : GetImplementations())
+        {
+            vector<const uint8_t*> results = scanner.Scan(haystack.get(), length, implementation);
+            for (int p = 0; p < numPatterns; p++)
+            {
+                const uint8_t* pExpected = NaiveFind(haystack.get(), length, patterns[p].data(),
+                    masks[p].empty() ? nullptr : masks[p].data(), (int)patterns[p].size());
+                CHECK(results[p] == pExpected);
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestExact();
+    TestMasked();
+    TestMultiplePatterns();
+    TestRandom();
+    return TEST_RESULT();
+}
@@ -0,0 +1,386 @@
+#include "Test.h"
+#include "../VNTextProxy/Util/SjisTunnelCodec.h"
+
+#include <iconv.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Code page 932 as tables, built once with iconv: what MultiByteToWideChar and WideCharToMultiByte
+// return for every single byte, every byte pair and every BMP character
+struct Cp932Tables
+{
+    int SingleBytes[0x100];             // -1 if invalid
+    vector<int> BytePairs;              // Indexed by (lead << 8) | trail, -1 if invalid
+    vector<uint16_t> Characters;        // One-byte codes as is, two-byte codes as (lead << 8) | trail, 0 if unmapped
+
+    Cp932Tables()
+        : BytePairs(0x10000, -1), Characters(0x10000)
+    {
+        iconv_t toWide = iconv_open("WCHAR_T", "CP932");
+        iconv_t fromWide = iconv_open("CP932", "WCHAR_T");
+        for (int byte = 0; byte < 0x100; byte++)
+        {
+            char bytes[1] = { (char)byte };
+            SingleBytes[byte] = Convert(toWide, bytes, 1);
+        }
+        for (int pair = 0x8100; pair < 0x10000; pair++)
+        {
+            char bytes[2] = { (char)(pair >> 8), (char)pair };
+            BytePairs[pair] = Convert(toWide, bytes, 2);
+        }
+        for (int wc = 0x80; wc < 0x10000; wc++)
+        {
+            if (wc >= 0xD800 && wc < 0xE000)
+                continue;
+
+            wchar_t wide = wc;
+            char bytes[4];
+            char* pIn = (char*)&wide;
+            char* pOut = bytes;
+            size_t inSize = sizeof(wide);
+            size_t outSize = sizeof(bytes);
+            iconv(fromWide, nullptr, nullptr, nullptr, nullptr);
+            if (iconv(fromWide, &pIn, &inSize, &pOut, &outSize) == (size_t)-1)
+                continue;
+
+            if (pOut - bytes == 1)
+                Characters[wc] = (uint8_t)bytes[0];
+            else if (pOut - bytes == 2)
+                Characters[wc] = (uint16_t)((uint8_t)bytes[0] << 8 | (uint8_t)bytes[1]);
+        }
+        iconv_close(toWide);
+        iconv_close(fromWide);
+    }
+
+    // The character for exactly these bytes, or -1
+    static int Convert(iconv_t cd, char* pBytes, size_t size)
+    {
+        wchar_t wide[2];
+        char* pOut = (char*)wide;
+        size_t outSize = sizeof(wide);
+        iconv(cd, nullptr, nullptr, nullptr, nullptr);
+        if (iconv(cd, &pBytes, &size, &pOut, &outSize) == (size_t)-1 || size != 0 || pOut != (char*)(wide + 1))
+            return -1;
+
+        return wide[0] < 0x10000 ? wide[0] : -1;
+    }
+};
+
+static const Cp932Tables& Tables()
+{
+    static Cp932Tables tables;
+    return tables;
+}
+
+// Stands in for the Win32 calls in the proxy
+struct TableCodePage
+{
+    static bool Decode(const char* pChar, int length, wchar_t& wc)
+    {
+        int result = length == 1 ? Tables().SingleBytes[(uint8_t)pChar[0]] : Tables().BytePairs[(uint8_t)pChar[0] << 8 | (uint8_t)pChar[1]];
+        wc = (wchar_t)result;
+        return result >= 0;
+    }
+
+    static int Encode(wchar_t wc, char* pBytes)
+    {
+        uint16_t code = wc < 0x10000 ? Tables().Characters[wc] : 0;
+        if (code == 0)
+            return 0;
+
+        if (code < 0x100)
+        {
+            pBytes[0] = (char)code;
+            return 1;
+        }
+
+        pBytes[0] = (char)(code >> 8);
+        pBytes[1] = (char)code;
+        return 2;
+    }
+};
+
+// Character by character straight from the tables, building strings: how the proxy converted before
+// the span API existed
+static wstring ReferenceDecode(const string& text)
+{
+    wstring result;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        uint8_t lead = text[i];
+        int wc;
+        if (SjisTunnelCodec::IsSjisHighByte(lead) && i + 1 < text.size() && text[i + 1] != '\0')
+            wc = Tables().BytePairs[lead << 8 | (uint8_t)text[++i]];
+        else
+            wc = Tables().SingleBytes[lead];
+
+        result += wc >= 0 ? (wchar_t)wc : L'\u30FB';
+    }
+    return result;
+}
+
+static string ReferenceEncode(const wstring& text, vector<wchar_t>& mappings)
+{
+    string result;
+    for (wchar_t wc : text)
+    {
+        uint16_t code = wc < 0x80 ? wc : Tables().Characters[wc];
+        if (wc >= 0x80 && (code == 0 || code >= 0xF000))
+        {
+            size_t index = 0;
+            while (index < mappings.size() && mappings[index] != wc)
+            {
+                index++;
+            }
+            if (index == mappings.size())
+                mappings.push_back(wc);
+
+            code = SjisTunnelCodec::MappingIndexToTunnelChar((int)index);
+        }
+
+        if (code >= 0x100)
+            result += (char)(code >> 8);
+
+        result += (char)code;
+    }
+    return result;
+}
+
+static int Decode(const string& text, wchar_t* pOutput, int outputSize, const vector<wchar_t>& mappings = {})
+{
+    return SjisTunnelCodec::Decode<TableCodePage>(text.data(), (int)text.size(), pOutput, outputSize, mappings);
+}
+
+static int Encode(const wstring& text, char* pOutput, int outputSize, vector<wchar_t>& mappings)
+{
+    return SjisTunnelCodec::Encode<TableCodePage>(text.data(), (int)text.size(), pOutput, outputSize, mappings);
+}
+
+// Every output size from 0 to the full length: the full length is always returned, and exactly the
+// characters of the reference result that fit completely are written. Decode leaves tunnel chars to the code page
+// (SoftPal doesn't support tunnelling), so the mappings never change the result.
+static void CheckDecode(const string& text, const vector<wchar_t>& mappings = {})
+{
+    wstring expected = ReferenceDecode(text);
+    CHECK(Decode(text, nullptr, 0, mappings) == (int)expected.size());
+    for (size_t outputSize = 0; outputSize <= expected.size(); outputSize++)
+    {
+        wstring output(expected.size() + 1, L'\uFFFF');
+        CHECK(Decode(text, output.data(), (int)outputSize, mappings) == (int)expected.size());
+        CHECK(output.compare(0, outputSize, expected, 0, outputSize) == 0);
+        CHECK(output.find_first_not_of(L'\uFFFF', outputSize) == wstring::npos);
+    }
+}
+
+static void CheckEncode(const wstring& text)
+{
+    vector<wchar_t> referenceMappings;
+    string expected = ReferenceEncode(text, referenceMappings);
+
+    vector<wchar_t> mappings;
+    CHECK(Encode(text, nullptr, 0, mappings) == (int)expected.size());
+    CHECK(mappings == referenceMappings);
+    for (size_t outputSize = 0; outputSize <= expected.size(); outputSize++)
+    {
+        // The longest prefix of whole characters that fits
+        size_t fits = 0;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            vector<wchar_t> prefixMappings;
+            size_t length = ReferenceEncode(text.substr(0, i + 1), prefixMappings).size();
+            if (length > outputSize)
+                break;
+
+            fits = length;
+        }
+
+        string output(expected.size() + 1, '\xFE');
+        CHECK(Encode(text, output.data(), (int)outputSize, mappings) == (int)expected.size());
+        CHECK(output.compare(0, fits, expected, 0, fits) == 0);
+        CHECK(output.find_first_not_of('\xFE', fits) == string::npos);
+    }
+    CHECK(mappings == referenceMappings);
+}
+
+// Every byte and byte pair, which covers the ASCII and half-width katakana shortcuts
+static void TestDecodeAllCodes()
+{
+    string bytes;
+    for (int byte = 1; byte < 0x100; byte++)
+    {
+        bytes = string(1, (char)byte);
+        wchar_t wc;
+        CHECK(Decode(bytes, &wc, 1) == 1 && wc == ReferenceDecode(bytes)[0]);
+    }
+    for (int pair = 0x8100; pair < 0x10000; pair++)
+    {
+        bytes = { (char)(pair >> 8), (char)pair };
+        wchar_t output[2];
+        wstring expected = ReferenceDecode(bytes);
+        CHECK(Decode(bytes, output, 2) == (int)expected.size() && wstring(output, expected.size()) == expected);
+    }
+
+    CHECK(ReferenceDecode("\x82\xA0") == L"\u3042");
+    CHECK(ReferenceDecode("A\xB1\x5C") == L"A\uFF71\\");
+}
+
+static void TestDecodeEdgeCases()
+{
+    CheckDecode("");
+    CheckDecode(string("\0\0", 2));
+    CheckDecode("\x82");                            // Lead byte at the end
+    CheckDecode(string("\x82\0\xA0", 3));           // Lead byte before a NUL
+    CheckDecode("\x82\x20\x82\xA0");                // Lead byte with an invalid trail byte
+    CheckDecode("\x81\x09\xFF\xFD\x80\xA0");        // A tunnel char and bytes that are never valid
+    CheckDecode("\x93\xFA\x96\x7B\x8C\xEA\xB1\xB2 text");
+
+    // Tunnel chars with a mapping, the first past the end of the mappings, and one of each lead byte range
+    vector<wchar_t> mappings = { L'\u00E9', L'\u00E8', L'\uE000' };
+    CheckDecode("\x81\x01a\x81\x02\x81\x03\x81\x04", mappings);
+    mappings.resize(SjisTunnelCodec::MaxMappings, L'\u00C0');
+    mappings.back() = L'\u00FF';
+    uint16_t last = SjisTunnelCodec::MappingIndexToTunnelChar(SjisTunnelCodec::MaxMappings - 1);
+    CheckDecode(string{ '\x9F', '\x3F', (char)(last >> 8), (char)last, '\xE0', '\x01' }, mappings);
+}
+
+static void TestDecodeRandom()
+{
+    mt19937 random(932);
+    vector<wchar_t> mappings(200);
+    for (wchar_t& wc : mappings)
+        wc = (wchar_t)(0xC0 + random() % 0x40);
+
+    for (int iteration = 0; iteration < 3000; iteration++)
+    {
+        string text(random() % 24, '\0');
+        for (char& c : text)
+            c = random() % 4 == 0 ? (char)(0x81 + random() % 0x1F) : random() % 4 == 0 ? (char)(random() % 0x40) : (char)random();
+
+        CheckDecode(text);
+        CheckDecode(text, mappings);
+    }
+}
+
+static void TestEncodeEdgeCases()
+{
+    CheckEncode(L"");
+    CheckEncode(wstring(L"\0a\0", 3));
+    CheckEncode(L"\u65E5\u672C\u8A9E\uFF71 text");
+    CheckEncode(L"\u00E9\u00E9\u00E8\u00E9");         // Tunneled, the repeat reusing its mapping
+    CheckEncode(L"\uE000\u3042\uE757");               // User-defined area: valid in code page 932 but tunneled
+    CheckEncode(L"a\u00E9b\u3042c");
+
+    vector<wchar_t> mappings;
+    char bytes[2];
+    CHECK(Tables().Characters[0xE000] == 0xF040);
+    CHECK(Encode(L"\uE000", bytes, 2, mappings) == 2 && mappings.size() == 1 && (uint8_t)bytes[0] == 0x81);
+}
+
+static void TestEncodeRandom()
+{
+    mt19937 random(1252);
+    for (int iteration = 0; iteration < 300; iteration++)
+    {
+        wstring text(random() % 12, L'\0');
+        for (wchar_t& c : text)
+        {
+            switch (random() % 4)
+            {
+                case 0: c = (wchar_t)(random() % 0x80); break;
+                case 1: c = (wchar_t)(0x3041 + random() % 0x60); break;
+                case 2: c = (wchar_t)(0xC0 + random() % 0x40); break;
+                default: c = (wchar_t)(0x80 + random() % 0xD780); break;
+            }
+        }
+
+        CheckEncode(text);
+    }
+}
+
+// Encoding and decoding are inverses for everything code page 932 has, and the tunnel chars
+static void TestRoundTrip()
+{
+    vector<wchar_t> mappings;
+    for (int wc = 0x80; wc < 0x10000; wc++)
+    {
+        uint16_t code = Tables().Characters[wc];
+        if (code == 0 || code >= 0xF000)
+            continue;
+
+        wstring text(1, (wchar_t)wc);
+        char bytes[2];
+        int length = Encode(text, bytes, 2, mappings);
+        wchar_t decoded;
+
+        // Code page 932 maps several characters to the same code (NEC and IBM extensions); only check the canonical one
+        if (Tables().BytePairs[code] == wc || Tables().SingleBytes[code & 0xFF] == wc)
+            CHECK(Decode(string(bytes, length), &decoded, 1) == 1 && decoded == (wchar_t)wc);
+    }
+    CHECK(mappings.empty());
+
+    // Every character code page 932 lacks gets its own tunnel char, which decodes like any other byte pair
+    wstring text;
+    for (int wc = 0x80; wc < 0x10000; wc++)
+    {
+        uint16_t code = Tables().Characters[wc];
+        if ((code == 0 || code >= 0xF000) && (wc < 0xD800 || wc >= 0xE000) && text.size() < SjisTunnelCodec::MaxMappings)
+            text += (wchar_t)wc;
+    }
+    vector<char> bytes(text.size() * 2);
+    CHECK(Encode(text, bytes.data(), (int)bytes.size(), mappings) == (int)bytes.size());
+    CHECK(mappings.size() == text.size());
+
+    CheckDecode(string(bytes.begin(), bytes.end()), mappings);
+}
+
+static void TestTunnelChars()
+{
+    for (int index = 0; index < SjisTunnelCodec::MaxMappings; index++)
+    {
+        uint16_t tunnelChar = SjisTunnelCodec::MappingIndexToTunnelChar(index);
+        uint8_t lead = tunnelChar >> 8;
+        uint8_t trail = (uint8_t)tunnelChar;
+        CHECK(SjisTunnelCodec::IsSjisHighByte(lead) && trail != 0 && trail < 0x40);
+        for (uint8_t avoid : SjisTunnelCodec::LowBytesToAvoid)
+            CHECK(trail != avoid);
+
+        CHECK(SjisTunnelCodec::TunnelCharToMappingIndex(tunnelChar) == index);
+        CHECK(Tables().BytePairs[tunnelChar] < 0);
+    }
+    CHECK(SjisTunnelCodec::TunnelCharToMappingIndex(0x8240) == -1);
+    CHECK(SjisTunnelCodec::TunnelCharToMappingIndex(0x8100) == -1);
+    CHECK(SjisTunnelCodec::TunnelCharToMappingIndex(0x4101) == -1);
+
+    // Past the last tunnel char nothing is added
+    vector<wchar_t> mappings(SjisTunnelCodec::MaxMappings, L'\0');
+    char bytes[2];
+    bool threw = false;
+    try
+    {
+        Encode(L"\u00E9", bytes, 2, mappings);
+    }
+    catch (const runtime_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw && mappings.size() == (size_t)SjisTunnelCodec::MaxMappings);
+
+    mappings.back() = L'\u00E9';
+    CHECK(Encode(L"\u00E9", bytes, 2, mappings) == 2);
+    CHECK((uint16_t)((uint8_t)bytes[0] << 8 | (uint8_t)bytes[1]) == SjisTunnelCodec::MappingIndexToTunnelChar(SjisTunnelCodec::MaxMappings - 1));
+}
+
+int main()
+{
+    TestDecodeAllCodes();
+    TestDecodeEdgeCases();
+    TestDecodeRandom();
+    TestEncodeEdgeCases();
+    TestEncodeRandom();
+    TestRoundTrip();
+    TestTunnelChars();
+    return TEST_RESULT();
+}
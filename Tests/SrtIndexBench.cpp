@@ -0,0 +1,50 @@
+#include "../VNTextProxy/Subtitles/SrtIndex.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace std;
+
+// Parses a generated file of N cues (100000 by default) several times and reports the throughput, then times
+// random seeks through FindCue
+int main(int argc, char** argv)
+{
+    int numCues = argc > 1 ? atoi(argv[1]) : 100000;
+    const int rounds = 20;
+
+    string text = "\xEF\xBB\xBF";
+    char timing[64];
+    for (int i = 0; i < numCues; i++)
+    {
+        int start = i * 2000;
+        int end = start + 1500;
+        snprintf(timing, sizeof(timing), "%02d:%02d:%02d,%03d --> %02d:%02d:%02d,%03d\r\n",
+            start / 3600000, start / 60000 % 60, start / 1000 % 60, start % 1000,
+            end / 3600000, end / 60000 % 60, end / 1000 % 60, end % 1000);
+        text += to_string(i + 1) + "\r\n" + timing;
+        text += "Some translated subtitle text for this line\r\nand a second line of it\r\n\r\n";
+    }
+
+    SrtIndex index;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+        index.Parse(text.data(), text.size());
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Parse: %d cues, %.1f MB, %.2f ms per parse, %.0f MB/s\n", index.GetCount(), text.size() / 1048576.0,
+        seconds * 1000 / rounds, text.size() * (double)rounds / 1048576.0 / seconds);
+
+    const int numSeeks = 10000000;
+    mt19937 random(1);
+    long long sum = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < numSeeks; i++)
+        sum += index.FindCue((int)(random() % ((unsigned)numCues * 2000)));
+
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("FindCue: %.1f ns per seek (checksum %lld)\n", seconds * 1e9 / numSeeks, sum);
+    return index.GetCount() == numCues ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,80 @@
+#include "Test.h"
+#include "../VNTextProxy/Subtitles/SrtIndex.h"
+
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace std;
+
+// Builds SRT-like text from a mix of valid and broken pieces, then flips, drops and duplicates bytes
+static string MakeInput(mt19937& random)
+{
+    static const char* const Pieces[] =
+    {
+        "1", "42", "999999999", "", " ", "\t", "\xEF\xBB\xBF",
+        "00:00:01,000 --> 00:00:02,000", "00:00:01.000-->00:00:00,500", "9999:59:59,999 --> 9999:59:59,999",
+        "596:31:23,647 --> 596:31:23,647", "12:34:56,7 --> 12:34:56,78", "00:00:01,000 -->", "-->", "00:00",
+        "text", "more text", "<i>italic</i>", "\xE3\x81\x82", "00:00:01,000",
+    };
+    static const char* const Breaks[] = { "\n", "\r\n", "\r", "" };
+
+    string text;
+    int numLines = random() % 40;
+    for (int i = 0; i < numLines; i++)
+    {
+        text += Pieces[random() % size(Pieces)];
+        text += Breaks[random() % size(Breaks)];
+    }
+
+    int numMutations = random() % 4;
+    for (int i = 0; i < numMutations && !text.empty(); i++)
+    {
+        size_t position = random() % text.size();
+        switch (random() % 3)
+        {
+            case 0: text[position] = (char)random(); break;
+            case 1: text.erase(position, 1 + random() % 8); break;
+            default: text.insert(position, text.substr(position, random() % 16)); break;
+        }
+    }
+    return text;
+}
+
+static void CheckIndex(const SrtIndex& index, const char* pData, size_t size, int time)
+{
+    for (int i = 0; i < index.GetCount(); i++)
+    {
+        string_view text = index.GetText(i);
+        CHECK(text.data() >= pData && text.data() + text.size() <= pData + size);
+        CHECK(index.GetStartTime(i) >= 0 && index.GetEndTime(i) >= 0);
+        if (i > 0)
+            CHECK(index.GetStartTime(i - 1) <= index.GetStartTime(i));
+    }
+
+    int expected = -1;
+    for (int i = 0; i < index.GetCount() && index.GetStartTime(i) <= time; i++)
+        expected = i;
+
+    CHECK(index.FindCue(time) == expected);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 50000;
+    unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+    mt19937 random(seed);
+    SrtIndex index;
+    for (int i = 0; i < iterations; i++)
+    {
+        // Copied into a buffer of exactly the right size, so the sanitizers catch any read past the end
+        string text = MakeInput(random);
+        unique_ptr<char[]> buffer(new char[text.size()]);
+        copy(text.begin(), text.end(), buffer.get());
+
+        bool parsed = index.Parse(buffer.get(), text.size());
+        CHECK(parsed == (index.GetCount() > 0));
+        CheckIndex(index, buffer.get(), text.size(), (int)(random() % 4000));
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,152 @@
+#include "Test.h"
+#include "../VNTextProxy/Subtitles/SrtIndex.h"
+
+#include <string>
+
+using namespace std;
+
+static bool Parse(SrtIndex& index, const string& text)
+{
+    return index.Parse(text.data(), text.size());
+}
+
+static void TestBasic()
+{
+    string text =
+        "\xEF\xBB\xBF" "1\r\n"
+        "00:00:01,000 --> 00:00:02,500\r\n"
+        "First line\r\n"
+        "Second line\r\n"
+        "\r\n"
+        "2\r\n"
+        "01:02:03.004 --> 01:02:04.000\r\n"
+        "Dot separator\r\n";
+    SrtIndex index;
+    CHECK(Parse(index, text));
+    CHECK(index.GetCount() == 2);
+    CHECK(index.GetStartTime(0) == 1000 && index.GetEndTime(0) == 2500);
+    CHECK(index.GetText(0) == "First line\r\nSecond line");
+    CHECK(index.GetStartTime(1) == ((1 * 60 + 2) * 60 + 3) * 1000 + 4);
+    CHECK(index.GetText(1) == "Dot separator");
+}
+
+static void TestOptionalCueNumbers()
+{
+    string text =
+        "00:00:01,000 --> 00:00:02,000\n"
+        "No number\n"
+        "\n"
+        "7\n"
+        "00:00:03,000 --> 00:00:04,000\n"
+        "Numbered\n";
+    SrtIndex index;
+    CHECK(Parse(index, text));
+    CHECK(index.GetCount() == 2);
+    CHECK(index.GetText(0) == "No number" && index.GetText(1) == "Numbered");
+}
+
+// A blank line after a cue number used to make the parser skip into, and swallow, the next cue
+static void TestBlankLineAfterCueNumber()
+{
+    string text =
+        "1\n"
+        "\n"
+        "00:00:01,000 --> 00:00:02,000\n"
+        "One\n"
+        "\n"
+        "2\n"
+        "00:00:03,000 --> 00:00:04,000\n"
+        "Two\n"
+        "\n"
+        "3\n"
+        "00:00:05,000 --> 00:00:06,000\n"
+        "Three\n";
+    SrtIndex index;
+    CHECK(Parse(index, text));
+    CHECK(index.GetCount() == 3);
+    CHECK(index.GetText(0) == "One" && index.GetText(1) == "Two" && index.GetText(2) == "Three");
+}
+
+static void TestMalformedCues()
+{
+    string text =
+        "1\n"
+        "00:00:01,000 -> 00:00:02,000\n"
+        "Broken arrow\n"
+        "00:00:03,000 --> 00:00:04,000\n"
+        "Right after the broken cue\n"
+        "\n"
+        "2\n"
+        "3\n"
+        "00:00:05,000 --> 00:00:06,000\n"
+        "After a number with no cue\n"
+        "\n"
+        "garbage\n"
+        "more garbage\n"
+        "\n"
+        "4\n"
+        "00:00:07,000 --> 00:00:08,000\n";
+    SrtIndex index;
+    CHECK(Parse(index, text));
+    CHECK(index.GetCount() == 3);
+    CHECK(index.GetText(0) == "Right after the broken cue");
+    CHECK(index.GetText(1) == "After a number with no cue");
+    CHECK(index.GetStartTime(2) == 7000 && index.GetText(2).empty());
+}
+
+// Times past what fits in 32 bits are rejected rather than overflowing
+static void TestLargeTimestamps()
+{
+    string text =
+        "9999:59:59,999 --> 9999:59:59,999\n"
+        "Too late\n"
+        "\n"
+        "596:31:23,647 --> 596:31:23,647\n"
+        "Last representable millisecond\n";
+    SrtIndex index;
+    CHECK(Parse(index, text));
+    CHECK(index.GetCount() == 1);
+    CHECK(index.GetStartTime(0) == INT32_MAX);
+
+    CHECK(!Parse(index, "596:31:23,648 --> 596:31:23,648\nOne past\n"));
+}
+
+static void TestSortAndFind()
+{
+    string text =
+        "00:00:05,000 --> 00:00:06,000\nC\n\n"
+        "00:00:01,000 --> 00:00:02,000\nA\n\n"
+        "00:00:03,000 --> 00:00:04,000\nB\n";
+    SrtIndex index;
+    CHECK(Parse(index, text));
+    CHECK(index.GetCount() == 3);
+    CHECK(index.GetText(0) == "A" && index.GetText(1) == "B" && index.GetText(2) == "C");
+    CHECK(index.FindCue(0) == -1);
+    CHECK(index.FindCue(1000) == 0);
+    CHECK(index.FindCue(2999) == 0);
+    CHECK(index.FindCue(3000) == 1);
+    CHECK(index.FindCue(100000) == 2);
+}
+
+static void TestEmpty()
+{
+    SrtIndex index;
+    CHECK(!index.Parse(nullptr, 0));
+    CHECK(!Parse(index, "\xEF\xBB\xBF"));
+    CHECK(!Parse(index, "\n\n  \n"));
+    CHECK(!Parse(index, "1\n"));
+    CHECK(!Parse(index, "1\n\n\n"));
+    CHECK(index.GetCount() == 0);
+}
+
+int main()
+{
+    TestBasic();
+    TestOptionalCueNumbers();
+    TestBlankLineAfterCueNumber();
+    TestMalformedCues();
+    TestLargeTimestamps();
+    TestSortAndFind();
+    TestEmpty();
+    return TEST_RESULT();
+}
@@ -0,0 +1,239 @@
+#include "Test.h"
+#include "../VNTextProxy/Subtitles/SubtitleLineCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using Line = SubtitleLineCache::Line;
+
+// Stands in for the GDI rasterizer: records which lines it was asked for, in what order and on which thread,
+// checks that calls never overlap, and writes the line index into the bitmap so results can be told apart
+class StubRasterizer
+{
+public:
+    SubtitleLineCache::Rasterizer Get()
+    {
+        return [this](int lineIdx, Line& line) { return Render(lineIdx, line); };
+    }
+
+    vector<int> GetOrder()
+    {
+        lock_guard lock(_mutex);
+        return _order;
+    }
+
+    // Waits (up to a few seconds) for the worker to have rendered the given number of lines in total
+    bool WaitForCount(size_t count)
+    {
+        for (int i = 0; i < 5000; i++)
+        {
+            {
+                lock_guard lock(_mutex);
+                if (_order.size() >= count)
+                    return _order.size() == count;
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    atomic<int> DelayMs = 0;
+    int FailingLine = -1;
+    atomic<int> NumReused = 0;              // Calls that got a line with buffers from an earlier one
+    atomic<int> NumOverlapping = 0;
+    atomic<bool> Inside = false;
+    thread::id LastThread;
+
+private:
+    bool Render(int lineIdx, Line& line)
+    {
+        if (Inside.exchange(true))
+            NumOverlapping++;
+
+        if (line.Pixels.capacity() != 0)
+            NumReused++;
+
+        this_thread::sleep_for(chrono::milliseconds(DelayMs));
+        line.Y = lineIdx;
+        line.Width = 2;
+        line.Height = 1;
+        line.Pixels.assign(8, (uint8_t)lineIdx);
+        {
+            lock_guard lock(_mutex);
+            _order.push_back(lineIdx);
+            LastThread = this_thread::get_id();
+        }
+        Inside = false;
+        return lineIdx != FailingLine;
+    }
+
+    mutex _mutex;
+    vector<int> _order;
+};
+
+static bool IsLine(const Line* pLine, int lineIdx)
+{
+    return pLine != nullptr && pLine->Y == lineIdx && pLine->Pixels == vector<uint8_t>(8, (uint8_t)lineIdx);
+}
+
+// Playing through in order: the worker renders each line once, ahead of time and in order of start time (which is
+// index order), so every GetLine is a hit. Lines past the end are never asked for.
+static void TestLookaheadOrder()
+{
+    StubRasterizer rasterizer;
+    SubtitleLineCache cache;
+    cache.Start(rasterizer.Get(), 10, 3);
+
+    // Before the first GetLine the worker fills the lookahead from the start
+    CHECK(rasterizer.WaitForCount(3));
+    CHECK(rasterizer.GetOrder() == vector<int>({ 0, 1, 2 }));
+
+    set<const Line*> slots;
+    for (int lineIdx = 0; lineIdx < 10; lineIdx++)
+    {
+        const Line* pLine = cache.GetLine(lineIdx);
+        CHECK(IsLine(pLine, lineIdx));
+        slots.insert(pLine);
+        CHECK(rasterizer.WaitForCount(min(lineIdx + 4, 10)));
+    }
+
+    vector<int> expected(10);
+    for (int i = 0; i < 10; i++)
+        expected[i] = i;
+
+    CHECK(rasterizer.GetOrder() == expected);
+    CHECK(cache.GetHits() == 10 && cache.GetMisses() == 0);
+
+    // A ring of lookahead + 1 slots, whose buffers are reused once they've been evicted
+    CHECK(slots.size() == 4);
+    CHECK(rasterizer.NumReused == 6);
+    CHECK(rasterizer.NumOverlapping == 0);
+    cache.Stop();
+}
+
+// Jumping ahead or back evicts the lines that are no longer wanted and starts over from the new position
+static void TestSeek()
+{
+    StubRasterizer rasterizer;
+    SubtitleLineCache cache;
+    cache.Start(rasterizer.Get(), 100, 3);
+    CHECK(rasterizer.WaitForCount(3));
+    CHECK(IsLine(cache.GetLine(0), 0));
+    CHECK(rasterizer.WaitForCount(4));
+
+    // Forward past everything cached: rendered on the spot (or by the worker, whichever gets there first), then
+    // the worker fills in the lines after it
+    CHECK(IsLine(cache.GetLine(50), 50));
+    CHECK(rasterizer.WaitForCount(8));
+    vector<int> order = rasterizer.GetOrder();
+    CHECK(vector<int>(order.begin() + 4, order.end()) == vector<int>({ 50, 51, 52, 53 }));
+    CHECK(cache.GetMisses() == 1);
+
+    // Back to a line that was evicted meanwhile
+    CHECK(IsLine(cache.GetLine(1), 1));
+    CHECK(rasterizer.WaitForCount(12));
+    order = rasterizer.GetOrder();
+    CHECK(vector<int>(order.begin() + 8, order.end()) == vector<int>({ 1, 2, 3, 4 }));
+    CHECK(cache.GetMisses() == 2);
+
+    // Lines still in the lookahead are hits
+    CHECK(IsLine(cache.GetLine(2), 2) && IsLine(cache.GetLine(3), 3));
+    CHECK(cache.GetMisses() == 2 && cache.GetHits() == 3);
+
+    // Random jumps, some while the worker is busy, always give the right line
+    rasterizer.DelayMs = 1;
+    for (int i = 0; i < 200; i++)
+    {
+        int lineIdx = (i * 37) % 100;
+        CHECK(IsLine(cache.GetLine(lineIdx), lineIdx));
+    }
+    CHECK(cache.GetHits() + cache.GetMisses() == 205);
+    CHECK(rasterizer.NumOverlapping == 0);
+}
+
+// A line that fails stays failed in its slot: GetLine returns null for it without rendering it again
+static void TestFailure()
+{
+    StubRasterizer rasterizer;
+    rasterizer.FailingLine = 2;
+    SubtitleLineCache cache;
+    cache.Start(rasterizer.Get(), 5, 2);
+    CHECK(IsLine(cache.GetLine(0), 0));
+    CHECK(IsLine(cache.GetLine(1), 1));
+    CHECK(rasterizer.WaitForCount(4));
+    CHECK(cache.GetLine(2) == nullptr);
+    CHECK(cache.GetLine(2) == nullptr);
+    CHECK(IsLine(cache.GetLine(3), 3));
+    CHECK(rasterizer.WaitForCount(5));
+    vector<int> order = rasterizer.GetOrder();
+    CHECK(count(order.begin(), order.end(), 2) == 1);
+}
+
+// Without a lookahead there's no worker; GetLine renders on the calling thread
+static void TestNoLookahead()
+{
+    StubRasterizer rasterizer;
+    SubtitleLineCache cache;
+    cache.Start(rasterizer.Get(), 5, 0);
+    this_thread::sleep_for(chrono::milliseconds(20));
+    CHECK(rasterizer.GetOrder().empty());
+
+    CHECK(IsLine(cache.GetLine(3), 3) && IsLine(cache.GetLine(3), 3) && IsLine(cache.GetLine(1), 1));
+    CHECK(rasterizer.GetOrder() == vector<int>({ 3, 1 }));
+    CHECK(rasterizer.LastThread == this_thread::get_id());
+    CHECK(cache.GetHits() == 1 && cache.GetMisses() == 2);
+}
+
+// Stopping (or destroying the cache) while the worker is inside the rasterizer waits for that call to finish, and
+// the rasterizer is never called again afterwards. The cache can be started again after a stop.
+static void TestShutdown()
+{
+    StubRasterizer rasterizer;
+    rasterizer.DelayMs = 50;
+    {
+        SubtitleLineCache cache;
+        cache.Start(rasterizer.Get(), 100, 5);
+        while (!rasterizer.Inside)
+            this_thread::yield();
+
+        cache.Stop();
+        CHECK(!rasterizer.Inside);
+        size_t count = rasterizer.GetOrder().size();
+        CHECK(count >= 1 && count < 5);
+        this_thread::sleep_for(chrono::milliseconds(100));
+        CHECK(rasterizer.GetOrder().size() == count);
+
+        // After GetLine the worker goes on to the next lines
+        cache.Start(rasterizer.Get(), 10, 2);
+        CHECK(IsLine(cache.GetLine(4), 4));
+        CHECK(cache.GetHits() + cache.GetMisses() == 1);
+        auto start = chrono::steady_clock::now();
+        while (!rasterizer.Inside && chrono::steady_clock::now() - start < chrono::seconds(2))
+            this_thread::yield();
+
+        CHECK(rasterizer.Inside);
+    }
+
+    // Destroyed mid-render
+    CHECK(!rasterizer.Inside);
+    size_t count = rasterizer.GetOrder().size();
+    this_thread::sleep_for(chrono::milliseconds(100));
+    CHECK(rasterizer.GetOrder().size() == count);
+    CHECK(rasterizer.NumOverlapping == 0);
+}
+
+int main()
+{
+    TestLookaheadOrder();
+    TestSeek();
+    TestFailure();
+    TestNoLookahead();
+    TestShutdown();
+    return TEST_RESULT();
+}
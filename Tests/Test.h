@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal checks for the standalone tests in this folder. A failed CHECK prints its location and the
+// test keeps going; TEST_RESULT() at the end of main turns the failures into the exit code for ctest.
+inline int& TestFailureCount()
+{
+    static int count = 0;
+    return count;
+}
+
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            fprintf(stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #condition);   \
+            TestFailureCount()++;                                                           \
+        }                                                                                   \
+    } while (false)
+
+#define TEST_RESULT()                                                                       \
+    (TestFailureCount() == 0 ? (printf("passed\n"), EXIT_SUCCESS)                           \
+                             : (printf("%d checks failed\n", TestFailureCount()), EXIT_FAILURE))
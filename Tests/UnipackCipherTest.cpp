@@ -0,0 +1,225 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// Same condition as unipack.c's
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86SIMD
+#endif
+
+// From unipack.c, built into this test with its main renamed (see CMakeLists.txt)
+extern "C"
+{
+    extern int simd;
+    void cipher(char* a, unsigned len, unsigned pos, int dec);
+#ifdef X86SIMD
+    unsigned cipher_sse2(unsigned char* p, unsigned len, int dec);
+    unsigned cipher_avx2(unsigned char* p, unsigned len, int dec);
+#endif
+}
+
+// unipack.c's CHUNK: the size of the pieces it reads, encrypts and writes
+static constexpr unsigned Chunk = 1 << 20;
+
+static uint8_t Ror(uint8_t value, int n)
+{
+    n &= 7;
+    return (uint8_t)((value >> n) | (value << (8 - n)));
+}
+
+// encrypt() from the original unipack.c, which did the whole file in one go, with the unaligned dword access
+// replaced by memcpy
+static void BaselineEncrypt(uint8_t* a, int len)
+{
+    int count = (len - 0x10) / 4;
+    uint8_t* p = a + 0x10;
+    uint32_t key1 = 0x084DF873;
+    uint32_t key2 = 0xFF987DEE;
+    unsigned c = 0x04;
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t dword;
+        memcpy(&dword, p, 4);
+        dword ^= key1 ^ key2;
+        memcpy(p, &dword, 4);
+        *p = Ror(*p, c++);
+        c &= 0xff;
+        p += 4;
+    }
+}
+
+// The inverse, rotating back before the xor
+static void BaselineDecrypt(uint8_t* a, int len)
+{
+    int count = (len - 0x10) / 4;
+    uint8_t* p = a + 0x10;
+    for (int i = 0; i < count; i++)
+    {
+        p[0] = Ror(p[0], 8 - (i + 4));
+        uint32_t dword;
+        memcpy(&dword, p, 4);
+        dword ^= 0x084DF873 ^ 0xFF987DEE;
+        memcpy(p, &dword, 4);
+        p += 4;
+    }
+}
+
+static vector<uint8_t> MakeData(size_t size, mt19937& random)
+{
+    vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+        byte = (uint8_t)random();
+
+    return data;
+}
+
+// Runs cipher over the file in pieces that end at the given offsets (multiples of 4, except the end of the file),
+// each copied to an exact-size buffer at a different misalignment so the unaligned loads and stores get exercised
+static vector<uint8_t> CipherInPieces(const vector<uint8_t>& file, const vector<size_t>& ends, int dec)
+{
+    vector<uint8_t> result(file.size());
+    size_t start = 0;
+    int misalignment = 0;
+    for (size_t end : ends)
+    {
+        // Empty pieces too, which cipher has to leave alone
+        size_t size = end - start;
+        vector<uint8_t> buffer(size + misalignment);
+        uint8_t* pPiece = buffer.data() + misalignment;
+        copy(file.begin() + start, file.begin() + end, pPiece);
+        cipher((char*)pPiece, (unsigned)size, (unsigned)start, dec);
+        copy(pPiece, pPiece + size, result.begin() + start);
+        start = end;
+        misalignment = (misalignment + 1) % 4;
+    }
+    return result;
+}
+
+static vector<int> GetSimdLevels()
+{
+    vector<int> levels = { 0 };
+#ifdef X86SIMD
+    levels.push_back(1);
+    if (__builtin_cpu_supports("avx2"))
+        levels.push_back(2);
+    else
+        printf("No AVX2 on this CPU, skipping cipher_avx2\n");
+#endif
+    return levels;
+}
+
+// Every file length up to a few blocks, odd ones included, in one piece and in random pieces whose starts fall
+// below, at and above 0x10 and anywhere in the 8-dword rotation pattern, encrypted and decrypted with each kernel
+static void TestPieces()
+{
+    mt19937 random(42);
+    for (int level : GetSimdLevels())
+    {
+        simd = level;
+        for (size_t size = 0; size < 300; size++)
+        {
+            vector<uint8_t> file = MakeData(size, random);
+            vector<uint8_t> encrypted = file;
+            BaselineEncrypt(encrypted.data(), (int)size);
+            vector<uint8_t> decrypted = encrypted;
+            BaselineDecrypt(decrypted.data(), (int)size);
+            CHECK(decrypted == file);
+
+            CHECK(CipherInPieces(file, { size }, 0) == encrypted);
+            CHECK(CipherInPieces(encrypted, { size }, 1) == file);
+            for (int repeat = 0; repeat < 4; repeat++)
+            {
+                vector<size_t> ends;
+                for (size_t end = 0; ; )
+                {
+                    end += 4 * (random() % 20);
+                    if (end >= size)
+                        break;
+
+                    ends.push_back(end);
+                }
+                ends.push_back(size);
+                CHECK(CipherInPieces(file, ends, 0) == encrypted);
+                CHECK(CipherInPieces(encrypted, ends, 1) == file);
+            }
+        }
+    }
+}
+
+// Files larger than a chunk, done chunk by chunk as unipack does and in pieces that straddle the chunk boundaries
+static void TestChunks()
+{
+    mt19937 random(43);
+    for (int level : GetSimdLevels())
+    {
+        simd = level;
+        for (size_t size : { (size_t)Chunk, (size_t)Chunk + 1, 2 * (size_t)Chunk + 0x13, 3 * (size_t)Chunk - 5 })
+        {
+            vector<uint8_t> file = MakeData(size, random);
+            vector<uint8_t> encrypted = file;
+            BaselineEncrypt(encrypted.data(), (int)size);
+
+            vector<size_t> chunkEnds;
+            for (size_t end = Chunk; end < size; end += Chunk)
+                chunkEnds.push_back(end);
+
+            chunkEnds.push_back(size);
+            CHECK(CipherInPieces(file, chunkEnds, 0) == encrypted);
+            CHECK(CipherInPieces(encrypted, chunkEnds, 1) == file);
+
+            vector<size_t> straddling = { 0x0C, Chunk - 0x24, Chunk + 0x1C, size };
+            if (size <= Chunk + 0x1C)
+                straddling = { 0x0C, Chunk - 0x24, size };
+
+            CHECK(CipherInPieces(file, straddling, 0) == encrypted);
+            CHECK(CipherInPieces(encrypted, straddling, 1) == file);
+        }
+    }
+}
+
+#ifdef X86SIMD
+// The vector kernels on their own: whole 32-byte blocks at the start of the rotation pattern, nothing past them
+static void TestKernels()
+{
+    mt19937 random(44);
+    vector<unsigned (*)(unsigned char*, unsigned, int)> kernels = { cipher_sse2 };
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back(cipher_avx2);
+
+    for (auto kernel : kernels)
+    {
+        for (unsigned len = 0; len < 200; len++)
+        {
+            // A file whose data from 0x10 on is the kernel's input
+            vector<uint8_t> file = MakeData(0x10 + len, random);
+            vector<uint8_t> encrypted = file;
+            BaselineEncrypt(encrypted.data(), 0x10 + len / 32 * 32);
+
+            vector<uint8_t> buffer(file.begin() + 0x10, file.end());
+            unsigned done = kernel(buffer.data(), len, 0);
+            CHECK(done == len / 32 * 32);
+            CHECK(equal(buffer.begin(), buffer.end(), encrypted.begin() + 0x10));
+
+            done = kernel(buffer.data(), len, 1);
+            CHECK(done == len / 32 * 32);
+            CHECK(equal(buffer.begin(), buffer.end(), file.begin() + 0x10));
+        }
+    }
+}
+#endif
+
+int main()
+{
+    TestPieces();
+    TestChunks();
+#ifdef X86SIMD
+    TestKernels();
+#endif
+    return TEST_RESULT();
+}
@@ -0,0 +1,50 @@
+/* force-included into the fault-injection build of unipack.c (see CMakeLists.txt). counts the calls
+   that change files and ends the process at the one numbered UNIPACK_CRASH_AT, as if it had crashed
+   there: a write stops halfway, and whatever other streams still have buffered is lost. exits with
+   FAULT_EXIT so the test can tell a crash from a failure */
+#define _FILE_OFFSET_BITS 64
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define FAULT_EXIT 99
+
+static int faultpoint(void) {
+	static long crashat=-1,calls;
+	if(crashat<0) {
+		char *s=getenv("UNIPACK_CRASH_AT");
+		crashat=s?atol(s):0;
+	}
+	return crashat && ++calls==crashat;
+}
+
+static size_t faulty_fwrite(const void *p,size_t size,size_t n,FILE *f) {
+	if(faultpoint()) {
+		fwrite(p,size,n/2,f);
+		fflush(f);
+		_exit(FAULT_EXIT);
+	}
+	return fwrite(p,size,n,f);
+}
+
+static int faulty_remove(const char *name) {
+	if(faultpoint()) _exit(FAULT_EXIT);
+	return remove(name);
+}
+
+static int faulty_rename(const char *from,const char *to) {
+	if(faultpoint()) _exit(FAULT_EXIT);
+	return rename(from,to);
+}
+
+static int faulty_ftruncate(int fd,off_t len) {
+	if(faultpoint()) _exit(FAULT_EXIT);
+	return ftruncate(fd,len);
+}
+
+#define fwrite faulty_fwrite
+#define remove faulty_remove
+#define rename faulty_rename
+#define ftruncate faulty_ftruncate
@@ -0,0 +1,141 @@
+#include "Test.h"
+#include "UnipackTestArchive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Built from unipack.c by CMakeLists.txt
+static const string Unipack = UNIPACK_PATH;
+
+static constexpr int NumArchives = 6;
+
+// Archive k: both formats, a different number of entries, one sharing its data, and replacements that are smaller,
+// larger, encrypted and (for two of them) several chunks long
+static void MakeTestArchive(int k, const fs::path& archivePath, const fs::path& replacementFolder)
+{
+    mt19937 random(43 + k);
+    vector<ArchiveEntry> entries;
+    int numEntries = 3 + k * 5;
+    for (int i = 0; i < numEntries; i++)
+        entries.push_back({ "file" + to_string(i) + ".dat", MakeData(random() % 5000, random) });
+
+    entries.push_back({ "shared.dat", {}, 0 });
+    entries.back().Data = entries[0].Data;
+    WriteFile(archivePath, MakeArchive(entries, k % 2 == 0));
+
+    fs::create_directories(replacementFolder);
+    WriteFile(replacementFolder / entries[1].Name, MakeData(entries[1].Data.size() / 2, random));
+    WriteFile(replacementFolder / entries[2].Name, MakeData(entries[2].Data.size() + 3001, random));
+    vector<uint8_t> encrypted = MakeData(1000 + k, random);
+    encrypted[0] = '$';
+    WriteFile(replacementFolder / entries.back().Name, encrypted);
+    if (k % 3 == 1)
+        WriteFile(replacementFolder / entries[0].Name, MakeData(2500000 + k * 7, random));
+}
+
+// Each archive's lines come out together, prefixed with its name, and the summary comes last
+static bool CheckLog(const fs::path& outputPath, const vector<fs::path>& archives, int numThreads)
+{
+    vector<uint8_t> bytes = ReadFile(outputPath);
+    istringstream stream(string(bytes.begin(), bytes.end()));
+    vector<string> lines;
+    for (string line; getline(stream, line); )
+        lines.push_back(line);
+
+    vector<bool> seen(archives.size());
+    int current = -1;
+    for (size_t i = 0; i + 1 < lines.size(); i++)
+    {
+        int archive = -1;
+        for (size_t k = 0; k < archives.size(); k++)
+        {
+            if (lines[i].rfind(archives[k].string() + ": ", 0) == 0)
+                archive = (int)k;
+        }
+        if (archive < 0 || (archive != current && seen[archive]))
+            return false;
+
+        seen[archive] = true;
+        current = archive;
+    }
+
+    string summary = to_string(archives.size()) + " archives updated in ";
+    return !lines.empty() && lines.back().rfind(summary, 0) == 0 &&
+           lines.back().find(to_string(numThreads) + " at a time") != string::npos &&
+           find(seen.begin(), seen.end(), false) == seen.end();
+}
+
+// Six archives packed by a manifest on three threads come out byte for byte the same as packing each one alone
+static void TestManifest(const fs::path& workFolder)
+{
+    fs::path soloFolder = workFolder / "solo";
+    fs::path manifestFolder = workFolder / "manifest";
+    fs::create_directories(soloFolder);
+    fs::create_directories(manifestFolder);
+
+    vector<fs::path> archives;
+    vector<vector<uint8_t>> expected;
+    string manifest = "# archive<tab>replacements\n\n";
+    for (int k = 0; k < NumArchives; k++)
+    {
+        string name = "archive" + to_string(k) + ".pac";
+        fs::path replacementFolder = workFolder / ("replacements" + to_string(k));
+        MakeTestArchive(k, soloFolder / name, replacementFolder);
+        fs::copy_file(soloFolder / name, manifestFolder / name);
+
+        CHECK(Run(Unipack + " " + Quote(soloFolder / name) + " " + Quote(replacementFolder)) == 0);
+        expected.push_back(ReadFile(soloFolder / (name + ".new")));
+        CHECK(!expected.back().empty() && expected.back() != ReadFile(soloFolder / name));
+
+        archives.push_back(manifestFolder / name);
+        manifest += archives.back().string() + "\t" + replacementFolder.string() + (k == 3 ? "\r\n" : "\n");
+    }
+    fs::path manifestPath = workFolder / "manifest.txt";
+    WriteFile(manifestPath, vector<uint8_t>(manifest.begin(), manifest.end()));
+
+    // Repeated, and with one thread and as many as there are CPUs, for a chance at different interleavings
+    fs::path outputPath = workFolder / "output.txt";
+    for (int numThreads : { 3, 3, 3, 1, 0 })
+    {
+        for (const fs::path& archive : archives)
+            fs::remove(archive.string() + ".new");
+
+        CHECK(Run(Unipack + " manifest " + Quote(manifestPath) + " " + to_string(numThreads), 0, outputPath) == 0);
+        for (int k = 0; k < NumArchives; k++)
+            CHECK(ReadFile(archives[k].string() + ".new") == expected[k]);
+
+        if (numThreads != 0)
+            CHECK(CheckLog(outputPath, archives, numThreads));
+    }
+
+    // An archive listed twice, and a line without a tab, are refused before anything is written
+    fs::remove(archives[0].string() + ".new");
+    string line = archives[0].string() + "\t" + (workFolder / "replacements0").string() + "\n";
+    string twice = line + line;
+    WriteFile(manifestPath, vector<uint8_t>(twice.begin(), twice.end()));
+    CHECK(Run(Unipack + " manifest " + Quote(manifestPath)) != 0);
+    string noTab = archives[0].string() + "\n";
+    WriteFile(manifestPath, vector<uint8_t>(noTab.begin(), noTab.end()));
+    CHECK(Run(Unipack + " manifest " + Quote(manifestPath)) != 0);
+    CHECK(!fs::exists(archives[0].string() + ".new"));
+}
+
+int main()
+{
+    fs::path workFolder = fs::temp_directory_path() / ("UnipackManifestTest." + to_string(getpid()));
+    fs::remove_all(workFolder);
+    fs::create_directories(workFolder);
+    TestManifest(workFolder);
+    fs::remove_all(workFolder);
+    return TEST_RESULT();
+}
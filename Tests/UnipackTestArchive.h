@@ -0,0 +1,93 @@
+#pragma once
+
+// Synthetic PAC archives and a way to run unipack on them, for UnipackUpdateTest and UnipackManifestTest
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+
+struct ArchiveEntry
+{
+    std::string Name;
+    std::vector<uint8_t> Data;
+    int SharesDataWith = -1;        // Points at an earlier entry's data instead of having its own
+};
+
+inline std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+inline void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+{
+    std::ofstream stream(path, std::ios::binary);
+    stream.write((const char*)data.data(), data.size());
+}
+
+inline void PutInt4(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+{
+    memcpy(data.data() + offset, &value, 4);
+}
+
+// Contents that never start with '$', so unipack treats them as unencrypted
+inline std::vector<uint8_t> MakeData(size_t size, std::mt19937& random)
+{
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+        byte = (uint8_t)random();
+
+    if (size != 0)
+        data[0] = 'x';
+
+    return data;
+}
+
+// A "PAC " archive (directory at 0x804) or an old-format one (directory at 0x3FE), ending with "EOF "
+inline std::vector<uint8_t> MakeArchive(const std::vector<ArchiveEntry>& entries, bool newFormat)
+{
+    size_t directoryOffset = newFormat ? 0x804 : 0x3FE;
+    std::vector<uint8_t> archive(directoryOffset + entries.size() * 0x28);
+    if (newFormat)
+        memcpy(archive.data(), "PAC ", 4);
+
+    PutInt4(archive, newFormat ? 8 : 0, (uint32_t)entries.size());
+    std::vector<uint32_t> offsets;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const ArchiveEntry& entry = entries[i];
+        uint32_t offset = entry.SharesDataWith >= 0 ? offsets[entry.SharesDataWith] : (uint32_t)archive.size();
+        if (entry.SharesDataWith < 0)
+            archive.insert(archive.end(), entry.Data.begin(), entry.Data.end());
+
+        offsets.push_back(offset);
+        size_t record = directoryOffset + i * 0x28;
+        memcpy(archive.data() + record, entry.Name.c_str(), entry.Name.size());
+        PutInt4(archive, record + 0x20, (uint32_t)entry.Data.size());
+        PutInt4(archive, record + 0x24, offset);
+    }
+    archive.insert(archive.end(), { 'E', 'O', 'F', ' ' });
+    return archive;
+}
+
+inline std::string Quote(const std::filesystem::path& path)
+{
+    return "'" + path.string() + "'";
+}
+
+// Runs a command with its output discarded (or written to outputPath) and returns its exit code
+inline int Run(const std::string& command, long crashAt = 0, const std::filesystem::path& outputPath = "/dev/null")
+{
+    std::string line = (crashAt != 0 ? "UNIPACK_CRASH_AT=" + std::to_string(crashAt) + " " : "") + command + " > " +
+                       Quote(outputPath) + " 2>&1";
+    int status = system(line.c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
@@ -0,0 +1,173 @@
+#include "Test.h"
+#include "UnipackTestArchive.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Built from unipack.c twice by CMakeLists.txt: as is, and with UnipackFaults.h forced in
+static const string Unipack = UNIPACK_PATH;
+static const string UnipackFaults = UNIPACK_FAULTS_PATH;
+static constexpr int FaultExit = 99;
+
+// Every entry of the archive, extracted (and decrypted) by unipack itself
+static bool Unpack(const fs::path& archivePath, const fs::path& folder, const vector<ArchiveEntry>& expected)
+{
+    fs::remove_all(folder);
+    if (Run(Unipack + " unpack " + Quote(archivePath) + " " + Quote(folder)) != 0)
+        return false;
+
+    for (const ArchiveEntry& entry : expected)
+    {
+        if (ReadFile(folder / entry.Name) != entry.Data)
+            return false;
+    }
+    return true;
+}
+
+static void TestUpdate(const fs::path& workFolder, bool newFormat)
+{
+    mt19937 random(newFormat ? 44 : 45);
+    vector<ArchiveEntry> original = {
+        { "same.txt", MakeData(100, random) },
+        { "shrink.dat", MakeData(5000, random) },
+        { "grow.dat", MakeData(200, random) },
+        { "script.src", MakeData(4000, random) },
+        { "shared_a", MakeData(300, random) },
+        { "shared_b", {}, 4 },
+        { "keep.bin", MakeData(777, random) },
+        { "empty.dat", {} },
+        { "gone.dat", MakeData(64, random) },
+        { "movie.bin", MakeData(1500000, random) }
+    };
+    original[5].Data = original[4].Data;
+
+    // Replacements: unchanged, smaller (in place), larger (appended), encrypted, one of two entries sharing
+    // their data (appended, so the other keeps it), previously empty, now empty, and one spanning several chunks
+    fs::path replacementFolder = workFolder / "replacements";
+    fs::create_directories(replacementFolder);
+    vector<ArchiveEntry> expected = original;
+    auto replace = [&](int index, vector<uint8_t> data)
+    {
+        expected[index].Data = data;
+        WriteFile(replacementFolder / original[index].Name, data);
+    };
+    replace(0, original[0].Data);
+    replace(1, MakeData(3000, random));
+    replace(2, MakeData(9000, random));
+    vector<uint8_t> encrypted = MakeData(4000, random);
+    encrypted[0] = '$';
+    replace(3, encrypted);
+    replace(4, MakeData(100, random));
+    replace(7, MakeData(50, random));
+    replace(8, {});
+    replace(9, MakeData(2200000, random));
+
+    fs::path originalPath = workFolder / "original.pac";
+    fs::path archivePath = workFolder / "data.pac";
+    fs::path unpackFolder = workFolder / "unpacked";
+    fs::path emptyFolder = workFolder / "empty";
+    fs::create_directories(emptyFolder);
+    vector<uint8_t> originalBytes = MakeArchive(original, newFormat);
+    WriteFile(originalPath, originalBytes);
+    CHECK(Unpack(originalPath, unpackFolder, original));
+
+    // The reference: an update that isn't interrupted
+    fs::copy_file(originalPath, archivePath, fs::copy_options::overwrite_existing);
+    CHECK(Run(Unipack + " update " + Quote(archivePath) + " " + Quote(replacementFolder)) == 0);
+    vector<uint8_t> updatedBytes = ReadFile(archivePath);
+    CHECK(updatedBytes != originalBytes && Unpack(archivePath, unpackFolder, expected));
+    CHECK(!fs::exists(archivePath.string() + ".journal"));
+
+    // Updating again changes nothing
+    CHECK(Run(Unipack + " update " + Quote(archivePath) + " " + Quote(replacementFolder)) == 0);
+    CHECK(ReadFile(archivePath) == updatedBytes);
+
+    // --compact gives the same archive as packing the original from scratch
+    CHECK(Run(Unipack + " update " + Quote(archivePath) + " " + Quote(replacementFolder) + " --compact") == 0);
+    fs::copy_file(originalPath, workFolder / "fresh.pac", fs::copy_options::overwrite_existing);
+    CHECK(Run(Unipack + " " + Quote(workFolder / "fresh.pac") + " " + Quote(replacementFolder)) == 0);
+    CHECK(ReadFile(archivePath) == ReadFile(workFolder / "fresh.pac.new") && Unpack(archivePath, unpackFolder, expected));
+
+    // Crash at every write, remove and truncate of the update. Rolling back then leaves the archive as it was
+    // (or fully updated, if only the journal's removal was missing), and the next update finishes the job,
+    // even when the rollback itself crashes along the way.
+    int crashPoints = 0;
+    for (long crashAt = 1; ; crashAt++)
+    {
+        fs::copy_file(originalPath, archivePath, fs::copy_options::overwrite_existing);
+        int result = Run(UnipackFaults + " update " + Quote(archivePath) + " " + Quote(replacementFolder), crashAt);
+        if (result == 0)
+            break;
+
+        CHECK(result == FaultExit);
+        if (result != FaultExit)
+            break;
+
+        crashPoints++;
+        fs::path crashedPath = workFolder / "crashed.pac";
+        fs::path crashedJournal = workFolder / "crashed.pac.journal";
+        fs::path journal = archivePath.string() + ".journal";
+        fs::copy_file(archivePath, crashedPath, fs::copy_options::overwrite_existing);
+        fs::remove(crashedJournal);
+        if (fs::exists(journal))
+            fs::copy_file(journal, crashedJournal);
+
+        for (long rollbackCrashAt = 1; ; rollbackCrashAt++)
+        {
+            result = Run(UnipackFaults + " update " + Quote(archivePath) + " " + Quote(emptyFolder), rollbackCrashAt);
+            if (result == 0)
+                break;
+
+            CHECK(result == FaultExit);
+            if (result != FaultExit)
+                break;
+        }
+
+        vector<uint8_t> rolledBack = ReadFile(archivePath);
+        CHECK(rolledBack == originalBytes || rolledBack == updatedBytes);
+        CHECK(!fs::exists(journal));
+
+        CHECK(Run(Unipack + " update " + Quote(archivePath) + " " + Quote(replacementFolder)) == 0);
+        CHECK(ReadFile(archivePath) == updatedBytes);
+
+        // Straight from the crash to the next update, without a separate rollback
+        fs::copy_file(crashedPath, archivePath, fs::copy_options::overwrite_existing);
+        if (fs::exists(crashedJournal))
+            fs::copy_file(crashedJournal, journal, fs::copy_options::overwrite_existing);
+
+        CHECK(Run(Unipack + " update " + Quote(archivePath) + " " + Quote(replacementFolder)) == 0);
+        CHECK(ReadFile(archivePath) == updatedBytes);
+    }
+
+    // Journal, file writes, EOF marker, directory and the journal's removal, at the least
+    CHECK(crashPoints >= 20);
+    printf("%s format: %d crash points\n", newFormat ? "PAC" : "old", crashPoints);
+
+    // Other modes refuse an archive with a journal
+    fs::copy_file(originalPath, archivePath, fs::copy_options::overwrite_existing);
+    CHECK(Run(UnipackFaults + " update " + Quote(archivePath) + " " + Quote(replacementFolder), 5) == FaultExit);
+    CHECK(fs::exists(archivePath.string() + ".journal"));
+    CHECK(Run(Unipack + " unpack " + Quote(archivePath)) != 0);
+    CHECK(Run(Unipack + " " + Quote(archivePath) + " " + Quote(replacementFolder)) != 0);
+}
+
+int main()
+{
+    fs::path workFolder = fs::temp_directory_path() / ("UnipackUpdateTest." + to_string(getpid()));
+    for (bool newFormat : { true, false })
+    {
+        fs::remove_all(workFolder);
+        fs::create_directories(workFolder);
+        TestUpdate(workFolder, newFormat);
+    }
+    fs::remove_all(workFolder);
+    return TEST_RESULT();
+}
@@ -0,0 +1,106 @@
+#include "FrameRecorder.h"
+
+#include <cstring>
+
+using namespace std;
+
+bool FrameRecorder::Start(const string& filePath, bool compress, size_t maxQueuedFrames)
+{
+    Stop();
+
+    if (!_writer.Open(filePath, compress))
+        return false;
+
+    _maxQueuedFrames = maxQueuedFrames;
+    _framesWritten = 0;
+    _framesDropped = 0;
+    _bytesWritten = _writer.GetBytesWritten();
+    _stopRequested = false;
+    _running = true;
+    _thread = thread(&FrameRecorder::WriterThread, this);
+    return true;
+}
+
+void FrameRecorder::Stop()
+{
+    if (!_running)
+        return;
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopRequested = true;
+    }
+    _frameQueued.notify_one();
+
+    if (_thread.joinable())
+        _thread.join();
+
+    _writer.Close();
+    _queue.clear();
+    _freeBuffers.clear();
+    _running = false;
+}
+
+bool FrameRecorder::Submit(const FrameSequence::FrameHeader& header, const uint8_t* pPixels, size_t pitch)
+{
+    if (!_running)
+        return false;
+
+    size_t rowSize = (size_t)header.Width * 4;
+    vector<uint8_t> buffer;
+    {
+        lock_guard<mutex> lock(_mutex);
+        if (_queue.size() >= _maxQueuedFrames)
+        {
+            _framesDropped++;
+            return false;
+        }
+
+        if (!_freeBuffers.empty())
+        {
+            buffer = move(_freeBuffers.back());
+            _freeBuffers.pop_back();
+        }
+    }
+
+    // Copy outside the lock so the writer thread can keep compressing meanwhile
+    buffer.resize(rowSize * header.Height);
+    for (uint32_t y = 0; y < header.Height; y++)
+        memcpy(buffer.data() + y * rowSize, pPixels + y * pitch, rowSize);
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        _queue.push_back({ header, move(buffer) });
+    }
+    _frameQueued.notify_one();
+    return true;
+}
+
+void FrameRecorder::WriterThread()
+{
+    while (true)
+    {
+        PendingFrame frame;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _frameQueued.wait(lock, [this] { return _stopRequested || !_queue.empty(); });
+
+            // Drain whatever is still queued before honoring a stop request
+            if (_queue.empty())
+                return;
+
+            frame = move(_queue.front());
+            _queue.pop_front();
+        }
+
+        if (_writer.WriteFrame(frame.Header, frame.Pixels.data()))
+            _framesWritten++;
+        else
+            _framesDropped++;
+
+        _bytesWritten = _writer.GetBytesWritten();
+
+        lock_guard<mutex> lock(_mutex);
+        _freeBuffers.push_back(move(frame.Pixels));
+    }
+}
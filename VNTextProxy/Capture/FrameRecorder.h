@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "FrameSequence.h"
+
+// Records presented frames to a FrameSequence file. Submit() only copies the pixels into a pooled
+// buffer; compression and disk writes happen on a worker thread so the present path isn't stalled.
+// If the writer falls behind, frames are dropped rather than queued without bound.
+class FrameRecorder
+{
+public:
+    FrameRecorder() = default;
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    ~FrameRecorder()
+    {
+        Stop();
+    }
+
+    bool Start(const std::string& filePath, bool compress, size_t maxQueuedFrames = 8);
+    void Stop();
+    bool IsRecording() const { return _running; }
+
+    // Copies a BGRA frame (with the given row pitch) and queues it for writing.
+    // FrameIndex and TimestampUs in the header are filled in by the caller.
+    // Returns false if the frame was dropped.
+    bool Submit(const FrameSequence::FrameHeader& header, const uint8_t* pPixels, size_t pitch);
+
+    uint32_t GetFramesWritten() const { return _framesWritten; }
+    uint32_t GetFramesDropped() const { return _framesDropped; }
+    uint64_t GetBytesWritten() const { return _bytesWritten; }
+
+private:
+    struct PendingFrame
+    {
+        FrameSequence::FrameHeader Header;
+        std::vector<uint8_t> Pixels;
+    };
+
+    void WriterThread();
+
+    FrameSequence::Writer _writer;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _frameQueued;
+    std::deque<PendingFrame> _queue;
+    std::vector<std::vector<uint8_t>> _freeBuffers;
+    size_t _maxQueuedFrames = 0;
+    bool _running = false;
+    bool _stopRequested = false;
+    std::atomic<uint32_t> _framesWritten{ 0 };
+    std::atomic<uint32_t> _framesDropped{ 0 };
+    std::atomic<uint64_t> _bytesWritten{ 0 };
+};
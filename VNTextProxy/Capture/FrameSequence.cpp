@@ -0,0 +1,261 @@
+#include "FrameSequence.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace FrameSequence
+{
+    // Runs are stored as (uint32 zeroCount, uint32 literalCount, literal bytes). Short zero gaps
+    // inside changed regions are folded into the literal run since a new pair costs 8 bytes.
+    static constexpr size_t MinZeroRun = 16;
+
+    static FILE* OpenFile(const string& filePath, const char* pMode)
+    {
+#ifdef _MSC_VER
+        FILE* pFile = nullptr;
+        if (fopen_s(&pFile, filePath.c_str(), pMode) != 0)
+            return nullptr;
+
+        return pFile;
+#else
+        return fopen(filePath.c_str(), pMode);
+#endif
+    }
+
+    static void AppendUInt32(vector<uint8_t>& output, uint32_t value)
+    {
+        uint8_t bytes[4];
+        memcpy(bytes, &value, 4);
+        output.insert(output.end(), bytes, bytes + 4);
+    }
+
+    static uint8_t XorAt(const uint8_t* pCurrent, const uint8_t* pPrevious, size_t i)
+    {
+        return pPrevious ? pCurrent[i] ^ pPrevious[i] : pCurrent[i];
+    }
+
+    void EncodeXorRle(const uint8_t* pCurrent, const uint8_t* pPrevious, size_t size, vector<uint8_t>& output)
+    {
+        output.clear();
+
+        size_t pos = 0;
+        while (pos < size)
+        {
+            size_t zeroStart = pos;
+            while (pos < size && XorAt(pCurrent, pPrevious, pos) == 0)
+                pos++;
+
+            size_t zeroCount = pos - zeroStart;
+            size_t literalStart = pos;
+
+            // Extend the literal run until we hit a zero run long enough to be worth its own pair
+            while (pos < size)
+            {
+                if (XorAt(pCurrent, pPrevious, pos) != 0)
+                {
+                    pos++;
+                    continue;
+                }
+
+                size_t runEnd = pos;
+                while (runEnd < size && runEnd - pos < MinZeroRun && XorAt(pCurrent, pPrevious, runEnd) == 0)
+                    runEnd++;
+
+                if (runEnd - pos >= MinZeroRun || runEnd == size)
+                    break;
+
+                pos = runEnd;
+            }
+
+            size_t literalCount = pos - literalStart;
+            AppendUInt32(output, (uint32_t)zeroCount);
+            AppendUInt32(output, (uint32_t)literalCount);
+            for (size_t i = literalStart; i < pos; i++)
+                output.push_back(XorAt(pCurrent, pPrevious, i));
+        }
+    }
+
+    bool DecodeXorRle(const uint8_t* pInput, size_t inputSize, uint8_t* pFrame, size_t frameSize)
+    {
+        size_t in = 0;
+        size_t out = 0;
+        while (in < inputSize)
+        {
+            if (inputSize - in < 8)
+                return false;
+
+            uint32_t zeroCount;
+            uint32_t literalCount;
+            memcpy(&zeroCount, pInput + in, 4);
+            memcpy(&literalCount, pInput + in + 4, 4);
+            in += 8;
+
+            if (zeroCount > frameSize - out)
+                return false;
+
+            out += zeroCount;
+
+            if (literalCount > frameSize - out || literalCount > inputSize - in)
+                return false;
+
+            for (uint32_t i = 0; i < literalCount; i++)
+                pFrame[out + i] ^= pInput[in + i];
+
+            in += literalCount;
+            out += literalCount;
+        }
+        return true;
+    }
+
+    Writer::~Writer()
+    {
+        Close();
+    }
+
+    bool Writer::Open(const string& filePath, bool compress)
+    {
+        Close();
+
+        _pFile = OpenFile(filePath, "wb");
+        if (_pFile == nullptr)
+            return false;
+
+        _compress = compress;
+        _bytesWritten = 0;
+        _previousFrame.clear();
+
+        FileHeader header{};
+        header.Magic = Magic;
+        header.Version = Version;
+        if (fwrite(&header, sizeof(header), 1, _pFile) != 1)
+        {
+            Close();
+            return false;
+        }
+
+        _bytesWritten += sizeof(header);
+        return true;
+    }
+
+    void Writer::Close()
+    {
+        if (_pFile == nullptr)
+            return;
+
+        fclose(_pFile);
+        _pFile = nullptr;
+    }
+
+    bool Writer::WriteFrame(FrameHeader header, const uint8_t* pPixels)
+    {
+        if (_pFile == nullptr)
+            return false;
+
+        size_t frameSize = (size_t)header.Width * header.Height * 4;
+        const uint8_t* pPayload = pPixels;
+        size_t payloadSize = frameSize;
+
+        if (_compress)
+        {
+            // A size change starts a new key frame (encoded against zeros)
+            const uint8_t* pPrevious = _previousFrame.size() == frameSize ? _previousFrame.data() : nullptr;
+            EncodeXorRle(pPixels, pPrevious, frameSize, _encodeBuffer);
+            _previousFrame.assign(pPixels, pPixels + frameSize);
+
+            header.Codec = Compression::XorRle;
+            pPayload = _encodeBuffer.data();
+            payloadSize = _encodeBuffer.size();
+        }
+        else
+        {
+            header.Codec = Compression::None;
+        }
+
+        header.PayloadSize = (uint32_t)payloadSize;
+        if (fwrite(&header, sizeof(header), 1, _pFile) != 1)
+            return false;
+
+        if (payloadSize > 0 && fwrite(pPayload, payloadSize, 1, _pFile) != 1)
+            return false;
+
+        _bytesWritten += sizeof(header) + payloadSize;
+        return true;
+    }
+
+    Reader::~Reader()
+    {
+        Close();
+    }
+
+    bool Reader::Open(const string& filePath)
+    {
+        Close();
+
+        _pFile = OpenFile(filePath, "rb");
+        if (_pFile == nullptr)
+            return false;
+
+        FileHeader header;
+        if (fread(&header, sizeof(header), 1, _pFile) != 1 || header.Magic != Magic || header.Version != Version)
+        {
+            Close();
+            return false;
+        }
+
+        _previousFrame.clear();
+        return true;
+    }
+
+    void Reader::Close()
+    {
+        if (_pFile == nullptr)
+            return;
+
+        fclose(_pFile);
+        _pFile = nullptr;
+    }
+
+    ReadResult Reader::ReadFrame(FrameHeader& header, vector<uint8_t>& pixels)
+    {
+        if (_pFile == nullptr)
+            return ReadResult::Error;
+
+        // Nothing at all where the next header would be is the end; part of a header is a truncated file
+        size_t headerBytes = fread(&header, 1, sizeof(header), _pFile);
+        if (headerBytes == 0 && feof(_pFile))
+            return ReadResult::End;
+
+        if (headerBytes != sizeof(header))
+            return ReadResult::Error;
+
+        size_t frameSize = (size_t)header.Width * header.Height * 4;
+        _payload.resize(header.PayloadSize);
+        if (header.PayloadSize > 0 && fread(_payload.data(), header.PayloadSize, 1, _pFile) != 1)
+            return ReadResult::Error;
+
+        switch (header.Codec)
+        {
+            case Compression::None:
+                if (_payload.size() != frameSize)
+                    return ReadResult::Error;
+
+                pixels = _payload;
+                break;
+
+            case Compression::XorRle:
+                if (_previousFrame.size() != frameSize)
+                    _previousFrame.assign(frameSize, 0);
+
+                if (!DecodeXorRle(_payload.data(), _payload.size(), _previousFrame.data(), frameSize))
+                    return ReadResult::Error;
+
+                pixels = _previousFrame;
+                break;
+
+            default:
+                return ReadResult::Error;
+        }
+        return ReadResult::Frame;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// On-disk frame sequence written by the Present_Hook capture mode and read by the FrameReplay tool.
+// Standard library only so it builds on Linux as well as in the proxy.
+//
+// Layout (little endian):
+//   FileHeader
+//   { FrameHeader, payload[PayloadSize] } * n
+//
+// Frames are 32bpp BGRA, tightly packed (stride = Width * 4). With compression enabled, each frame
+// is XORed against the previous one and the result is stored as (zero run, literal run) pairs, which
+// collapses the mostly-static frames of a visual novel to a few hundred bytes.
+
+namespace FrameSequence
+{
+    constexpr uint32_t Magic = 0x53464E56;     // "VNFS"
+    constexpr uint32_t Version = 1;
+
+    enum class ScaleMode : uint8_t
+    {
+        Windowed = 0,       // 1:1 copy
+        Bicubic = 1,        // Bicubic upscale into the pillarboxed rect
+        CuNNy = 2           // CuNNy 2x + Lanczos downscale into the pillarboxed rect
+    };
+
+    enum class Compression : uint8_t
+    {
+        None = 0,
+        XorRle = 1
+    };
+
+    enum class ReadResult
+    {
+        Frame,              // A frame was read
+        End,                // Clean end of the file, after the last complete frame
+        Error               // Truncated or corrupt frame, or a read error; the rest of the file can't be trusted
+    };
+
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t Reserved[2];
+    };
+
+    struct FrameHeader
+    {
+        uint32_t FrameIndex;
+        uint64_t TimestampUs;       // Microseconds since capture started
+        uint16_t Width;             // Source (game) frame size
+        uint16_t Height;
+        uint16_t ScreenWidth;       // Swapchain size
+        uint16_t ScreenHeight;
+        int16_t OffsetX;            // Pillarbox placement (PillarboxedState::g_offsetX/Y)
+        int16_t OffsetY;
+        uint16_t ScaledWidth;       // PillarboxedState::g_scaledWidth/Height
+        uint16_t ScaledHeight;
+        ScaleMode Mode;
+        Compression Codec;
+        uint16_t Reserved;
+        uint32_t PayloadSize;
+    };
+#pragma pack(pop)
+
+    // Encodes the XOR of two equally sized buffers as (zero run, literal run) pairs.
+    // Passing an empty previous frame encodes against all zeros.
+    void EncodeXorRle(const uint8_t* pCurrent, const uint8_t* pPrevious, size_t size, std::vector<uint8_t>& output);
+
+    // Inverse of EncodeXorRle; pFrame holds the previous frame on entry and the decoded one on exit.
+    bool DecodeXorRle(const uint8_t* pInput, size_t inputSize, uint8_t* pFrame, size_t frameSize);
+
+    class Writer
+    {
+    public:
+        ~Writer();
+
+        bool Open(const std::string& filePath, bool compress);
+        void Close();
+        bool IsOpen() const { return _pFile != nullptr; }
+
+        // pPixels points to Width * Height tightly packed BGRA pixels.
+        bool WriteFrame(FrameHeader header, const uint8_t* pPixels);
+
+        uint64_t GetBytesWritten() const { return _bytesWritten; }
+
+    private:
+        FILE* _pFile = nullptr;
+        bool _compress = false;
+        uint64_t _bytesWritten = 0;
+        std::vector<uint8_t> _previousFrame;
+        std::vector<uint8_t> _encodeBuffer;
+    };
+
+    class Reader
+    {
+    public:
+        ~Reader();
+
+        bool Open(const std::string& filePath);
+        void Close();
+
+        // Reads the next frame into pixels (Width * Height * 4 bytes).
+        ReadResult ReadFrame(FrameHeader& header, std::vector<uint8_t>& pixels);
+
+    private:
+        FILE* _pFile = nullptr;
+        std::vector<uint8_t> _previousFrame;
+        std::vector<uint8_t> _payload;
+    };
+}
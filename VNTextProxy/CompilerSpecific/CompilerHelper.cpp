@@ -1,5 +1,7 @@
 #include "pch.h"
 
+#include "Util/Logger.h"
+
 using namespace std;
 
 void CompilerHelper::Init()
@@ -7,16 +9,20 @@ void CompilerHelper::Init()
     CompilerType = CompilerType::Unknown;
 
     HMODULE hGame = GetModuleHandle(nullptr);
-    if (MemoryUtil::FindData((void*)hGame, 0x1000, "Rich", 4) != nullptr)
+    PEImage image;
+    image.Parse((const uint8_t*)hGame, DetourGetModuleSize(hGame), PEImage::Layout::Mapped);
+    if (image.HasRichHeader())
     {
         CompilerType = CompilerType::Msvc;
         return;
     }
 
-    vector<PE::Section> gameSections = PE::GetSections(hGame);
-    const PE::Section& textSection = gameSections[0];
-    if (MemoryUtil::FindData(textSection.Start, textSection.Size, "Borland", 7) != nullptr)
-        CompilerType = CompilerType::Borland;    
+    if (image.GetSectionCount() == 0)
+        return;
+
+    PEImage::Section textSection = *image.GetSections().begin();
+    if (MemoryUtil::FindData(textSection.pData, textSection.DataSize, "Borland", 7) != nullptr)
+        CompilerType = CompilerType::Borland;
 }
 
 void** CompilerHelper::FindVTable(const string& className)
@@ -26,72 +32,38 @@ void** CompilerHelper::FindVTable(const string& className)
 
 void** CompilerHelper::FindVTable(HMODULE hModule, ::CompilerType compilerType, const std::string& className)
 {
-    void* pModuleStart = (void*)hModule;
-    void* pModuleEnd = (BYTE*)pModuleStart + DetourGetModuleSize(hModule);
-
-    vector<PE::Section> sections = PE::GetSections(hModule);
-    const PE::Section& textSection = sections[0];
-    void* pCodeStart = textSection.Start;
-    void* pCodeEnd = (BYTE*)textSection.Start + textSection.Size;
-
-    string typeDescriptorClassName;
-    switch (compilerType)
+    string cacheKey = HookSignatures::VTableKeyPrefix + className;
+    DWORD vtableRva;
+    DWORD unused;
+    if (!HookAddressCache::TryGet(hModule, cacheKey, vtableRva, unused))
     {
-        case CompilerType::Borland:
-            typeDescriptorClassName = className;
-            break;
-
-        case CompilerType::Msvc:
-            vector<string> parts = StringUtil::Split<char>(className, "::");
-            std::ranges::reverse(parts);
-            typeDescriptorClassName = StringUtil::Join<char>(parts, "@");
-            break;
+        const RttiIndex& index = GetRttiIndex(hModule, compilerType);
+        vtableRva = index.FindVTable(RttiIndex::GetDecoratedName(className, compilerType));
+        HookAddressCache::Set(hModule, cacheKey, vtableRva, 0);
     }
 
-    for (int i = 1; i < sections.size(); i++)
-    {
-        const PE::Section& section = sections[i];
-        void* pSectionStart = section.Start;
-        void* pSectionEnd = (BYTE*)section.Start + section.Size;
-        for (void** ppFunc = (void**)pSectionStart + 3; ppFunc < pSectionEnd; ppFunc++)
-        {
-            if (*ppFunc < pCodeStart || *ppFunc >= pCodeEnd)
-                continue;
-
-            if (compilerType == CompilerType::Borland && HasBorlandTypeDescriptor(ppFunc, typeDescriptorClassName, pModuleStart, pModuleEnd))
-                return ppFunc;
-
-            if (compilerType == CompilerType::Msvc && HasMsvcTypeDescriptor(ppFunc, typeDescriptorClassName, pModuleStart, pModuleEnd))
-                return ppFunc;
-        }
-    }
-    return nullptr;
+    return vtableRva != 0 ? (void**)((BYTE*)hModule + vtableRva) : nullptr;
 }
 
-bool CompilerHelper::HasBorlandTypeDescriptor(void** pVTable, const string& className, void* pModuleStart, void* pModuleEnd)
+const RttiIndex& CompilerHelper::GetRttiIndex(HMODULE hModule, ::CompilerType compilerType)
 {
-    BorlandTypeDescriptor* pTypeDescriptor = (BorlandTypeDescriptor*)pVTable[-3];
-    if (pTypeDescriptor < pModuleStart || pTypeDescriptor >= pModuleEnd || pTypeDescriptor + 1 + className.size() > pModuleEnd)
-        return false;
+    pair key(hModule, compilerType);
+    auto it = RttiIndexes.find(key);
+    if (it != RttiIndexes.end())
+        return it->second;
 
-    return memcmp(pTypeDescriptor->Name, className.c_str(), className.size() + 1) == 0;
-}
+    vector<PE::Section> sections = PE::GetSections(hModule);
+    const PE::Section& textSection = sections[0];
+    RttiIndex::Range code{ (uint32_t)(textSection.Start - (BYTE*)hModule), (uint32_t)textSection.Size };
 
-bool CompilerHelper::HasMsvcTypeDescriptor(void** pVTable, const string& className, void* pModuleStart, void* pModuleEnd)
-{
-    MsvcRttiCompleteObjectLocator* pLocator = (MsvcRttiCompleteObjectLocator*)pVTable[-1];
-    if (pLocator < pModuleStart || pLocator >= pModuleEnd || pLocator + 1 > pModuleEnd ||
-        pLocator->Signature != 0 ||
-        pLocator->pTypeDescriptor < pModuleStart || pLocator->pTypeDescriptor >= pModuleEnd || pLocator->pTypeDescriptor + 1 > pModuleEnd)
+    vector<RttiIndex::Range> dataSections;
+    for (int i = 1; i < sections.size(); i++)
     {
-        return false;
+        dataSections.push_back({ (uint32_t)(sections[i].Start - (BYTE*)hModule), (uint32_t)sections[i].Size });
     }
 
-    const char* pRttiClassName = pLocator->pTypeDescriptor->raw_name();
-    if (pRttiClassName < pModuleStart || pRttiClassName >= pModuleEnd || pRttiClassName + className.size() + 7 > pModuleEnd)
-        return false;
-
-    return memcmp(pRttiClassName, ".?A", 3) == 0 &&
-           memcmp(pRttiClassName + 4, className.c_str(), className.size()) == 0 &&
-           memcmp(pRttiClassName + 4 + className.size(), "@@\0", 3) == 0;
+    RttiIndex& index = RttiIndexes[key];
+    index.Build((const uint8_t*)hModule, DetourGetModuleSize(hModule), (uint32_t)hModule, compilerType, code, dataSections);
+    proxy_log(LogCategory::HOOKS, "RTTI index for module %p: %d classes with vtables", hModule, index.GetCount());
+    return index;
 }
@@ -11,6 +11,8 @@ public:
     static inline CompilerType CompilerType{};
 
 private:
-    static bool         HasBorlandTypeDescriptor    (void** pVTable, const std::string& className, void* pModuleStart, void* pModuleEnd);
-    static bool         HasMsvcTypeDescriptor       (void** pVTable, const std::string& className, void* pModuleStart, void* pModuleEnd);
+    static const RttiIndex& GetRttiIndex            (HMODULE hModule, ::CompilerType compilerType);
+
+    // Not synchronized: vtables are only looked up while the patches are installed on the init thread
+    static inline std::map<std::pair<HMODULE, ::CompilerType>, RttiIndex> RttiIndexes{};
 };
@@ -0,0 +1,153 @@
+#include "RttiIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// Field offsets in the 32-bit RTTI structures (see MsvcRttiCompleteObjectLocator and BorlandTypeDescriptor)
+static constexpr uint32_t MsvcLocatorTypeDescriptorOffset = 12;
+static constexpr uint32_t MsvcTypeDescriptorNameOffset = 8;
+static constexpr uint32_t BorlandTypeDescriptorNameOffset = 48;
+
+static constexpr int MaxClassNameLength = 1024;
+
+void RttiIndex::Build(const uint8_t* pImage, uint32_t imageSize, uint32_t imageAddress, CompilerType compilerType,
+                      const Range& code, const vector<Range>& dataSections)
+{
+    _pImage = pImage;
+    _imageSize = imageSize;
+    _imageAddress = imageAddress;
+    _vtables.clear();
+
+    if (compilerType != CompilerType::Msvc && compilerType != CompilerType::Borland)
+        return;
+
+    uint32_t codeStart = imageAddress + code.Rva;
+    uint32_t codeEnd = codeStart + code.Size;
+
+    string className;
+    for (const Range& section : dataSections)
+    {
+        uint32_t sectionEnd = min(section.Rva + section.Size, imageSize);
+
+        // Start at the fourth slot so the RTTI pointer in front of the vtable is inside the section
+        for (uint32_t slotRva = section.Rva + 3 * 4; slotRva + 4 <= sectionEnd; slotRva += 4)
+        {
+            uint32_t func;
+            memcpy(&func, pImage + slotRva, 4);
+            if (func < codeStart || func >= codeEnd)
+                continue;
+
+            uint32_t rtti;
+            bool found;
+            if (compilerType == CompilerType::Msvc)
+            {
+                memcpy(&rtti, pImage + slotRva - 4, 4);
+                found = TryGetMsvcClassName(rtti, className);
+            }
+            else
+            {
+                memcpy(&rtti, pImage + slotRva - 12, 4);
+                found = TryGetBorlandClassName(rtti, className);
+            }
+
+            // Slots are visited in address order, so the first vtable of a class wins
+            if (found)
+                _vtables.try_emplace(className, slotRva);
+        }
+    }
+}
+
+uint32_t RttiIndex::FindVTable(const string& decoratedName) const
+{
+    auto it = _vtables.find(decoratedName);
+    return it != _vtables.end() ? it->second : 0;
+}
+
+string RttiIndex::GetDecoratedName(const string& className, CompilerType compilerType)
+{
+    if (compilerType != CompilerType::Msvc)
+        return className;
+
+    vector<string> parts;
+    size_t start = 0;
+    while (true)
+    {
+        size_t separator = className.find("::", start);
+        parts.push_back(className.substr(start, separator - start));
+        if (separator == string::npos)
+            break;
+
+        start = separator + 2;
+    }
+
+    string decoratedName;
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it)
+    {
+        if (!decoratedName.empty())
+            decoratedName += '@';
+
+        decoratedName += *it;
+    }
+    return decoratedName;
+}
+
+bool RttiIndex::TryReadUInt32(uint32_t address, uint32_t& value) const
+{
+    uint32_t rva = address - _imageAddress;
+    if (address < _imageAddress || rva > _imageSize || _imageSize - rva < 4)
+        return false;
+
+    memcpy(&value, _pImage + rva, 4);
+    return true;
+}
+
+// Reads a NUL-terminated name made of characters that can appear in (decorated) C++ type names
+bool RttiIndex::TryReadName(uint32_t address, string& name) const
+{
+    uint32_t rva = address - _imageAddress;
+    if (address < _imageAddress || rva >= _imageSize)
+        return false;
+
+    const char* pName = (const char*)_pImage + rva;
+    uint32_t maxLength = min<uint32_t>(_imageSize - rva, MaxClassNameLength);
+    uint32_t length = 0;
+    for (; length < maxLength && pName[length] != '\0'; length++)
+    {
+        unsigned char c = (unsigned char)pName[length];
+        if (c < 0x20 || c >= 0x7F)
+            return false;
+    }
+
+    if (length == 0 || length == maxLength)
+        return false;
+
+    name.assign(pName, length);
+    return true;
+}
+
+// ".?AVengine@babel@@" yields "engine@babel"
+bool RttiIndex::TryGetMsvcClassName(uint32_t locatorAddress, string& name) const
+{
+    uint32_t signature;
+    uint32_t typeDescriptorAddress;
+    if (!TryReadUInt32(locatorAddress, signature) || signature != 0 ||
+        !TryReadUInt32(locatorAddress + MsvcLocatorTypeDescriptorOffset, typeDescriptorAddress) ||
+        !TryReadName(typeDescriptorAddress + MsvcTypeDescriptorNameOffset, name))
+    {
+        return false;
+    }
+
+    if (name.size() < 7 || name.compare(0, 3, ".?A") != 0 || name.compare(name.size() - 2, 2, "@@") != 0)
+        return false;
+
+    name.erase(name.size() - 2);
+    name.erase(0, 4);
+    return true;
+}
+
+bool RttiIndex::TryGetBorlandClassName(uint32_t typeDescriptorAddress, string& name) const
+{
+    return TryReadName(typeDescriptorAddress + BorlandTypeDescriptorNameOffset, name);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Enumerations.h"
+
+// Maps class names to vtables for a whole 32-bit module, built in one pass over its data sections.
+// A vtable is recognized by the RTTI pointer in front of it: the complete object locator at [-1] for MSVC,
+// or the type descriptor at [-3] for Borland. Reads the image as plain bytes (32-bit little-endian
+// pointers), so it also works on a module image loaded from disk. Standard library only.
+class RttiIndex
+{
+public:
+    struct Range
+    {
+        uint32_t Rva;
+        uint32_t Size;
+    };
+
+    // pImage holds the module laid out by RVA (as loaded in memory), and imageAddress is the address its
+    // absolute pointers are based on: the load address, or the preferred ImageBase for an unrelocated copy.
+    void Build(const uint8_t* pImage, uint32_t imageSize, uint32_t imageAddress, CompilerType compilerType,
+               const Range& code, const std::vector<Range>& dataSections);
+
+    // Returns the RVA of the first vtable for the class, or 0 if there is none.
+    // The name is in the RTTI's own form, see GetDecoratedName.
+    uint32_t FindVTable(const std::string& decoratedName) const;
+
+    int GetCount() const { return (int)_vtables.size(); }
+
+    // "babel::engine" becomes "engine@babel" for MSVC (the name in ".?AVengine@babel@@"); Borland keeps it as is
+    static std::string GetDecoratedName(const std::string& className, CompilerType compilerType);
+
+private:
+    bool TryReadUInt32(uint32_t address, uint32_t& value) const;
+    bool TryReadName(uint32_t address, std::string& name) const;
+    bool TryGetMsvcClassName(uint32_t locatorAddress, std::string& name) const;
+    bool TryGetBorlandClassName(uint32_t typeDescriptorAddress, std::string& name) const;
+
+    const uint8_t* _pImage = nullptr;
+    uint32_t _imageSize = 0;
+    uint32_t _imageAddress = 0;
+    std::unordered_map<std::string, uint32_t> _vtables;
+};
@@ -2,6 +2,7 @@
 #include "CuNNyScaler.h"
 #include "SharedConstants.h"
 #include "Util/Logger.h"
+#include "Util/BackgroundTask.h"
 #include <d3dcompiler.h>
 #include <sstream>
 
@@ -60,7 +61,9 @@ uint2 Rmp8x8(uint idx) { return uint2(idx % 8, idx / 8); }
     static UINT g_downscaleWidth = 0, g_downscaleHeight = 0;
 
     static UINT g_currentWidth = 0, g_currentHeight = 0;
-    static bool g_initialized = false;
+
+    // Shader compilation runs on this worker; the scaler becomes available once it succeeds
+    static BackgroundTask g_compileTask;
 
     struct Constants {
         UINT inputWidth, inputHeight, outputWidth, outputHeight;
@@ -325,48 +328,28 @@ void main(uint3 dtid : SV_DispatchThreadID) {
         return true;
     }
 
-    bool Initialize(ID3D11Device* pDevice) {
-        cunny_log("=== CuNNy Initialize starting ===");
-        g_pDevice = pDevice;
-
-        D3D11_BUFFER_DESC cbd = {};
-        cbd.ByteWidth = sizeof(Constants);
-        cbd.Usage = D3D11_USAGE_DYNAMIC;
-        cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-        cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        if (FAILED(pDevice->CreateBuffer(&cbd, nullptr, &g_pConstantBuffer))) {
-            cunny_log("Initialize: FAILED to create constant buffer");
-            return false;
-        }
-        cunny_log("Initialize: Constant buffer created");
-
-        D3D11_SAMPLER_DESC sd = {};
-        sd.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-        sd.AddressU = sd.AddressV = sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-        if (FAILED(pDevice->CreateSamplerState(&sd, &g_pPointSampler))) {
-            cunny_log("Initialize: FAILED to create point sampler");
-            return false;
-        }
-        sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-        if (FAILED(pDevice->CreateSamplerState(&sd, &g_pLinearSampler))) {
-            cunny_log("Initialize: FAILED to create linear sampler");
-            return false;
-        }
-        cunny_log("Initialize: Samplers created");
-
+    // Compiles all four CuNNy passes plus the downscale pass. Runs on the compile worker;
+    // ID3D11Device is free-threaded so shader creation is safe off the render thread.
+    static bool CompileShaders(const std::atomic<bool>& cancelRequested) {
+        ULONGLONG startTick = GetTickCount64();
         std::string shader = g_CuNNyFastNVL;
-        cunny_log("Initialize: Shader loaded from embedded data, %zu bytes", shader.length());
+        cunny_log("CompileShaders: Shader loaded from embedded data, %zu bytes", shader.length());
 
         // Extract and compile each pass
         for (int p = 1; p <= 4; p++) {
-            cunny_log("Initialize: Processing pass %d", p);
+            if (cancelRequested) {
+                cunny_log("CompileShaders: Cancelled before pass %d", p);
+                return false;
+            }
+
+            cunny_log("CompileShaders: Processing pass %d", p);
             std::string pass = ExtractPass(shader, p);
             std::string body = ExtractFunctionBody(pass, p);
             if (body.empty()) {
-                cunny_log("Initialize: FAILED - could not extract body for pass %d", p);
+                cunny_log("CompileShaders: FAILED - could not extract body for pass %d", p);
                 return false;
             }
-            cunny_log("Initialize: Extracted body for pass %d (%zu bytes)", p, body.length());
+            cunny_log("CompileShaders: Extracted body for pass %d (%zu bytes)", p, body.length());
 
             std::string fullShader;
             switch (p) {
@@ -375,7 +358,7 @@ void main(uint3 dtid : SV_DispatchThreadID) {
                 case 3: fullShader = BuildPass3(body); break;
                 case 4: fullShader = BuildPass4(body); break;
             }
-            cunny_log("Initialize: Built full shader for pass %d (%zu bytes)", p, fullShader.length());
+            cunny_log("CompileShaders: Built full shader for pass %d (%zu bytes)", p, fullShader.length());
 
             ID3D11ComputeShader** ppCS = nullptr;
             switch (p) {
@@ -387,11 +370,16 @@ void main(uint3 dtid : SV_DispatchThreadID) {
 
             *ppCS = CompileCS(fullShader, ("Pass" + std::to_string(p)).c_str());
             if (!*ppCS) {
-                cunny_log("Initialize: FAILED - could not compile pass %d", p);
+                cunny_log("CompileShaders: FAILED - could not compile pass %d", p);
                 return false;
             }
         }
 
+        if (cancelRequested) {
+            cunny_log("CompileShaders: Cancelled before downscale pass");
+            return false;
+        }
+
         // Load and compile downscale shader
         std::string downscaleSrc = g_DownscaleHLSL;
         {
@@ -405,20 +393,59 @@ void main(uint3 dtid : SV_DispatchThreadID) {
                     body.replace(returnPos, 6, "float4 result =");
                 }
                 std::string fullShader = BuildDownscalePass(functions, body);
-                cunny_log("Initialize: Built downscale shader (%zu bytes)", fullShader.length());
+                cunny_log("CompileShaders: Built downscale shader (%zu bytes)", fullShader.length());
                 g_pDownscaleCS = CompileCS(fullShader, "Downscale");
                 if (!g_pDownscaleCS) {
-                    cunny_log("Initialize: WARNING - Downscale shader failed to compile, will use direct copy");
+                    cunny_log("CompileShaders: WARNING - Downscale shader failed to compile, will use direct copy");
                 }
             }
         }
 
-        g_initialized = true;
-        cunny_log("=== CuNNy Initialize SUCCESS - all 4 passes compiled ===");
+        cunny_log("=== CuNNy shaders ready - all 4 passes compiled in %llu ms ===", GetTickCount64() - startTick);
+        return true;
+    }
+
+    bool Initialize(ID3D11Device* pDevice) {
+        cunny_log("=== CuNNy Initialize starting ===");
+        g_pDevice = pDevice;
+
+        D3D11_BUFFER_DESC cbd = {};
+        cbd.ByteWidth = sizeof(Constants);
+        cbd.Usage = D3D11_USAGE_DYNAMIC;
+        cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        if (FAILED(pDevice->CreateBuffer(&cbd, nullptr, &g_pConstantBuffer))) {
+            cunny_log("Initialize: FAILED to create constant buffer");
+            return false;
+        }
+        cunny_log("Initialize: Constant buffer created");
+
+        D3D11_SAMPLER_DESC sd = {};
+        sd.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+        sd.AddressU = sd.AddressV = sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+        if (FAILED(pDevice->CreateSamplerState(&sd, &g_pPointSampler))) {
+            cunny_log("Initialize: FAILED to create point sampler");
+            return false;
+        }
+        sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        if (FAILED(pDevice->CreateSamplerState(&sd, &g_pLinearSampler))) {
+            cunny_log("Initialize: FAILED to create linear sampler");
+            return false;
+        }
+        cunny_log("Initialize: Samplers created");
+
+        g_compileTask.Start(CompileShaders);
+        cunny_log("=== CuNNy Initialize - shader compilation started in background ===");
         return true;
     }
 
     void Cleanup() {
+        // The worker writes the shader pointers, so it has to be gone before we release them. Resetting
+        // also keeps IsAvailable() from reporting the released shaders as ready after a device reset.
+        if (g_compileTask.IsRunning())
+            cunny_log("Cleanup: Cancelling in-flight shader compilation");
+        g_compileTask.Reset();
+
         if (g_pPass1CS) { g_pPass1CS->Release(); g_pPass1CS = nullptr; }
         if (g_pPass2CS) { g_pPass2CS->Release(); g_pPass2CS = nullptr; }
         if (g_pPass3CS) { g_pPass3CS->Release(); g_pPass3CS = nullptr; }
@@ -443,13 +470,12 @@ void main(uint3 dtid : SV_DispatchThreadID) {
         g_downscaleWidth = 0;
         g_downscaleHeight = 0;
         g_pDevice = nullptr;
-        g_initialized = false;
     }
 
     ID3D11ShaderResourceView* Upscale2x(ID3D11DeviceContext* ctx,
         ID3D11ShaderResourceView* srcSRV, UINT w, UINT h)
     {
-        if (!g_initialized) return nullptr;
+        if (!IsAvailable()) return nullptr;
         if (w != g_currentWidth || h != g_currentHeight)
             if (!CreateTextures(w, h)) return nullptr;
 
@@ -516,7 +542,7 @@ void main(uint3 dtid : SV_DispatchThreadID) {
         ID3D11ShaderResourceView* srcSRV, UINT srcW, UINT srcH,
         UINT dstW, UINT dstH)
     {
-        if (!g_initialized || !g_pDownscaleCS) return nullptr;
+        if (!IsAvailable() || !g_pDownscaleCS) return nullptr;
 
         // Create/resize downscale output texture if needed
         if (dstW != g_downscaleWidth || dstH != g_downscaleHeight) {
@@ -557,8 +583,9 @@ void main(uint3 dtid : SV_DispatchThreadID) {
     ID3D11ShaderResourceView* GetUpscaledSRV() { return g_pOutputSRV; }
     ID3D11Texture2D* GetDownscaledTexture() { return g_pDownscaleOutput; }
     ID3D11ShaderResourceView* GetDownscaledSRV() { return g_pDownscaleOutputSRV; }
-    bool IsAvailable() { return g_initialized; }
-    bool IsDownscaleAvailable() { return g_initialized && g_pDownscaleCS != nullptr; }
+    bool IsAvailable() { return g_compileTask.IsReady(); }
+    bool IsCompiling() { return g_compileTask.IsRunning(); }
+    bool IsDownscaleAvailable() { return IsAvailable() && g_pDownscaleCS != nullptr; }
 
     void FatalRenderingError(const char* context)
     {
@@ -6,6 +6,8 @@ namespace CuNNyScaler
 {
     // Initialize the CuNNy neural network scaler
     // This is a 2x upscaler - output will be 2x input dimensions
+    // Creates the cheap resources immediately and compiles the shaders on a background
+    // worker; IsAvailable() turns true once compilation has finished.
     bool Initialize(ID3D11Device* pDevice);
 
     // Cleanup resources
@@ -43,6 +45,9 @@ namespace CuNNyScaler
     // Check if CuNNy is available/initialized
     bool IsAvailable();
 
+    // Check if the shaders are still being compiled in the background
+    bool IsCompiling();
+
     // Check if downscale shader is available
     bool IsDownscaleAvailable();
 
@@ -2,14 +2,20 @@
 
 #include <d3d9.h>
 #include <d3d11.h>
-#include <dxgi1_2.h>
+#include <dxgi1_3.h>
 #include <windows.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 #include "SharedConstants.h"
+#include "DX11Hooks.h"
 #include "PillarboxedState.h"
 #include "BicubicScaler.h"
 #include "CuNNyScaler.h"
 #include "PALHooks.h"
+#include "Capture/FrameRecorder.h"
+#include "Util/FramePacingStats.h"
 #include "Util/Logger.h"
 
 #pragma comment(lib, "d3d9.lib")
@@ -79,9 +85,33 @@ namespace DX11Hooks
     static UINT g_dx11GameWidth = 0;  // Staging texture/game width
     static UINT g_dx11GameHeight = 0; // Staging texture/game height
 
+    // Frame latency control (RuntimeConfig::MaxFrameLatency) and pacing statistics.
+    // Both the game thread and the DirectShow video thread present, so the stats are guarded.
+    constexpr int FRAME_PACING_REPORT_INTERVAL = 600;
+    // The video thread may be waiting on the waitable object, so it's only closed once no one is.
+    static HANDLE g_hFrameLatencyWaitable = nullptr;
+    static int g_frameLatencyWaiters = 0;
+    static std::mutex g_frameLatencyMutex;
+    static std::condition_variable g_frameLatencyIdle;
+    static FramePacingStats g_framePacingStats;
+    static std::mutex g_framePacingMutex;
+
+    // Bicubic fallback bookkeeping while CuNNy shaders compile in the background.
+    // Atomic because IsCuNNyReady is called from both Present and the video thread.
+    static std::atomic<bool> g_cunnyPresenting = false;
+    static std::atomic<bool> g_cunnyFailureLogged = false;
+    static std::atomic<int> g_fallbackFrameCount = 0;
+    static std::atomic<ULONGLONG> g_fallbackStartTick = 0;
+
     // Offscreen surface for copying render target data (D3D9)
     static IDirect3DSurface9* g_pD3D9CopySurface = nullptr;
 
+    // Frame capture (RuntimeConfig::FrameCaptureFile) for offline replay
+    static FrameRecorder g_frameRecorder;
+    static bool g_frameCaptureFinished = false;
+    static uint32_t g_capturedFrameCount = 0;
+    static ULONGLONG g_captureStartTick = 0;
+
     static void LogSurfaceInfo(const char* label, IDirect3DSurface9* pSurface)
     {
         if (!pSurface)
@@ -120,6 +150,119 @@ namespace DX11Hooks
             pp->hDeviceWindow, pp->EnableAutoDepthStencil);
     }
 
+    // Queues the frame the game just rendered, together with how it's about to be scaled
+    static void CaptureFrame(const BYTE* pPixels, UINT pitch, UINT width, UINT height)
+    {
+        if (g_frameCaptureFinished)
+            return;
+
+        if (!g_frameRecorder.IsRecording())
+        {
+            const std::string& filePath = RuntimeConfig::FrameCaptureFile();
+            if (!g_frameRecorder.Start(filePath, true))
+            {
+                dbg_log("[Capture] Failed to open %s, frame capture disabled", filePath.c_str());
+                g_frameCaptureFinished = true;
+                return;
+            }
+
+            g_capturedFrameCount = 0;
+            g_captureStartTick = GetTickCount64();
+            dbg_log("[Capture] Recording frames to %s", filePath.c_str());
+        }
+
+        FrameSequence::FrameHeader header{};
+        header.FrameIndex = g_capturedFrameCount;
+        header.TimestampUs = (GetTickCount64() - g_captureStartTick) * 1000;
+        header.Width = (uint16_t)width;
+        header.Height = (uint16_t)height;
+        header.ScreenWidth = (uint16_t)g_dx11Width;
+        header.ScreenHeight = (uint16_t)g_dx11Height;
+        if (PillarboxedState::g_pillarboxedActive)
+        {
+            header.OffsetX = (int16_t)PillarboxedState::g_offsetX;
+            header.OffsetY = (int16_t)PillarboxedState::g_offsetY;
+            header.ScaledWidth = (uint16_t)PillarboxedState::g_scaledWidth;
+            header.ScaledHeight = (uint16_t)PillarboxedState::g_scaledHeight;
+            header.Mode = CuNNyScaler::IsAvailable() ? FrameSequence::ScaleMode::CuNNy : FrameSequence::ScaleMode::Bicubic;
+        }
+        else
+        {
+            header.ScaledWidth = (uint16_t)width;
+            header.ScaledHeight = (uint16_t)height;
+            header.Mode = FrameSequence::ScaleMode::Windowed;
+        }
+
+        // Dropped frames don't count, so the indices in the file stay contiguous and the limit is on frames kept
+        if (g_frameRecorder.Submit(header, pPixels, pitch))
+            g_capturedFrameCount++;
+
+        if (g_capturedFrameCount >= (uint32_t)RuntimeConfig::FrameCaptureMaxFrames())
+        {
+            g_frameRecorder.Stop();
+            g_frameCaptureFinished = true;
+            dbg_log("[Capture] Finished: %u frames written, %u dropped, %llu bytes",
+                g_frameRecorder.GetFramesWritten(), g_frameRecorder.GetFramesDropped(), g_frameRecorder.GetBytesWritten());
+        }
+    }
+
+    static void ReportFramePacing()
+    {
+        std::lock_guard<std::mutex> lock(g_framePacingMutex);
+        if (g_framePacingStats.GetPendingPresents() == 0)
+            return;
+
+        FramePacingStats::Summary summary = g_framePacingStats.TakeSummary();
+        dbg_log("[DX11] Frame pacing: %s", FramePacingStats::Format(summary).c_str());
+    }
+
+    // Sets up the frame latency waitable object and the refresh period used for missed-vblank counting
+    static void InitializeFrameLatency()
+    {
+        IDXGISwapChain2* pSwapChain2 = nullptr;
+        HRESULT hr = g_pDXGISwapChain->QueryInterface(__uuidof(IDXGISwapChain2), (void**)&pSwapChain2);
+        if (FAILED(hr))
+        {
+            dbg_log("[DX11] IDXGISwapChain2 unavailable (hr=0x%x), presenting without latency control", hr);
+            return;
+        }
+
+        UINT maxLatency = (UINT)RuntimeConfig::MaxFrameLatency();
+        hr = pSwapChain2->SetMaximumFrameLatency(maxLatency);
+        if (FAILED(hr))
+            dbg_log("[DX11] SetMaximumFrameLatency(%u) failed, hr=0x%x", maxLatency, hr);
+
+        HANDLE hWaitable = pSwapChain2->GetFrameLatencyWaitableObject();
+        pSwapChain2->Release();
+        {
+            std::lock_guard<std::mutex> lock(g_frameLatencyMutex);
+            g_hFrameLatencyWaitable = hWaitable;
+        }
+        dbg_log("[DX11] Frame latency waitable object 0x%p, max latency %u", hWaitable, maxLatency);
+
+        DEVMODEA devMode = {};
+        devMode.dmSize = sizeof(devMode);
+        double refreshPeriodMs = 0;
+        if (EnumDisplaySettingsA(nullptr, ENUM_CURRENT_SETTINGS, &devMode) && devMode.dmDisplayFrequency > 1)
+            refreshPeriodMs = 1000.0 / devMode.dmDisplayFrequency;
+
+        std::lock_guard<std::mutex> lock(g_framePacingMutex);
+        g_framePacingStats = FramePacingStats();
+        g_framePacingStats.SetRefreshPeriod(refreshPeriodMs);
+    }
+
+    // Takes the waitable object away from new waiters, then closes it once the current ones are done.
+    // Waits time out after a second, so this doesn't block for longer than that.
+    static void CloseFrameLatencyWaitable()
+    {
+        std::unique_lock<std::mutex> lock(g_frameLatencyMutex);
+        HANDLE hWaitable = g_hFrameLatencyWaitable;
+        g_hFrameLatencyWaitable = nullptr;
+        g_frameLatencyIdle.wait(lock, [] { return g_frameLatencyWaiters == 0; });
+        if (hWaitable)
+            CloseHandle(hWaitable);
+    }
+
     static void CleanupDX11()
     {
         dbg_log("[DX11] Cleaning up DX11 resources...");
@@ -127,6 +270,8 @@ namespace DX11Hooks
         BicubicScaler::Cleanup();
         CuNNyScaler::Cleanup();
         g_dx11ScalerInitialized = false;
+        ReportFramePacing();
+        CloseFrameLatencyWaitable();
         if (g_pD3D11SourceSRV) { g_pD3D11SourceSRV->Release(); g_pD3D11SourceSRV = nullptr; }
         if (g_pD3D11SourceTexture) { g_pD3D11SourceTexture->Release(); g_pD3D11SourceTexture = nullptr; }
         if (g_pD3D11RTV) { g_pD3D11RTV->Release(); g_pD3D11RTV = nullptr; }
@@ -244,6 +389,7 @@ namespace DX11Hooks
         swapChainDesc.BufferCount = 2;
         swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
         swapChainDesc.Scaling = DXGI_SCALING_NONE;  // No automatic scaling
+        swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
         dbg_log("[DX11] Creating swapchain: %dx%d, format=%d, buffers=%d, swapEffect=%d, scaling=%d",
             swapChainDesc.Width, swapChainDesc.Height, swapChainDesc.Format,
@@ -267,6 +413,8 @@ namespace DX11Hooks
         }
         dbg_log("[DX11] Created swapchain %dx%d, ptr=0x%p", screenWidth, screenHeight, g_pDXGISwapChain);
 
+        InitializeFrameLatency();
+
         // Get backbuffer and create RTV
         hr = g_pDXGISwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)&g_pD3D11BackBuffer);
         if (FAILED(hr))
@@ -344,12 +492,17 @@ namespace DX11Hooks
         g_dx11ScalerInitialized = true;
         dbg_log("[DX11] Bicubic scaler initialized");
 
-        // Initialize CuNNy neural network scaler
+        // Initialize CuNNy neural network scaler (shaders compile in the background;
+        // Present uses the bicubic scaler until they're ready)
         if (!CuNNyScaler::Initialize(g_pD3D11Device))
         {
             CuNNyScaler::FatalRenderingError("CuNNy initialization");
         }
-        dbg_log("[DX11] CuNNy neural network scaler initialized");
+        g_cunnyPresenting = false;
+        g_cunnyFailureLogged = false;
+        g_fallbackFrameCount = 0;
+        g_fallbackStartTick = 0;
+        dbg_log("[DX11] CuNNy neural network scaler initialized, compiling shaders in background");
 
         // Initialize DirectShow video capture for DX11 rendering
         DirectShowVideoScale::InitializeDX11(g_pD3D11Device, g_pD3D11Context);
@@ -895,9 +1048,16 @@ namespace DX11Hooks
                 }
             }
 
+            if (!RuntimeConfig::FrameCaptureFile().empty())
+                CaptureFrame((const BYTE*)d3d9Locked.pBits, d3d9Locked.Pitch, srcWidth, srcHeight);
+
             g_pD3D11Context->Unmap(g_pD3D11StagingTexture, 0);
             g_pD3D9CopySurface->UnlockRect();
 
+            // Block until the swapchain can take another frame. Waiting takes a latency slot that only
+            // Present gives back, so this has to come after the last early return above.
+            WaitForFrameLatency();
+
             // Copy staging texture to source texture (for shader input)
             g_pD3D11Context->CopyResource(g_pD3D11SourceTexture, g_pD3D11StagingTexture);
 
@@ -905,7 +1065,7 @@ namespace DX11Hooks
             float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
             g_pD3D11Context->ClearRenderTargetView(g_pD3D11RTV, clearColor);
 
-            if (PillarboxedState::g_pillarboxedActive)
+            if (PillarboxedState::g_pillarboxedActive && IsCuNNyReady())
             {
                 // CuNNy 2x upscale + Lanczos downscale
                 ID3D11ShaderResourceView* cunnyOutput = CuNNyScaler::Upscale2x(
@@ -947,6 +1107,26 @@ namespace DX11Hooks
                     PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight
                 );
             }
+            else if (PillarboxedState::g_pillarboxedActive)
+            {
+                // CuNNy not ready yet: bicubic upscale straight into the pillarboxed rect
+                BicubicScaler::Scale(
+                    g_pD3D11Context,
+                    g_pD3D11SourceSRV,
+                    g_pD3D11RTV,
+                    srcWidth, srcHeight,
+                    g_dx11Width, g_dx11Height,
+                    PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
+                    PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight
+                );
+
+                if (RuntimeConfig::DebugLogging() && presentLogCount <= 10)
+                {
+                    dbg_log("  [DX11] Bicubic fallback: %dx%d -> %dx%d",
+                        srcWidth, srcHeight,
+                        PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight);
+                }
+            }
             else
             {
                 // Windowed mode: 1:1 copy (no scaling)
@@ -968,6 +1148,7 @@ namespace DX11Hooks
 
             // 4. Present via DXGI
             HRESULT hrPresent = g_pDXGISwapChain->Present(1, 0);
+            RecordPresent();
 
             if (RuntimeConfig::DebugLogging() && presentLogCount <= 10)
             {
@@ -1169,6 +1350,84 @@ namespace DX11Hooks
         return pD3D9;
     }
 
+    void WaitForFrameLatency()
+    {
+        HANDLE hWaitable;
+        {
+            std::lock_guard<std::mutex> lock(g_frameLatencyMutex);
+            hWaitable = g_hFrameLatencyWaitable;
+            if (!hWaitable)
+                return;
+
+            g_frameLatencyWaiters++;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        DWORD result = WaitForSingleObjectEx(hWaitable, 1000, TRUE);
+        double waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(g_frameLatencyMutex);
+            if (--g_frameLatencyWaiters == 0)
+                g_frameLatencyIdle.notify_all();
+        }
+
+        if (result == WAIT_TIMEOUT)
+            dbg_log("[DX11] Frame latency wait timed out");
+
+        std::lock_guard<std::mutex> lock(g_framePacingMutex);
+        g_framePacingStats.RecordWait(waitMs);
+    }
+
+    void RecordPresent()
+    {
+        FramePacingStats::Summary summary;
+        {
+            std::lock_guard<std::mutex> lock(g_framePacingMutex);
+            g_framePacingStats.RecordPresent();
+            if (g_framePacingStats.GetPendingPresents() < FRAME_PACING_REPORT_INTERVAL)
+                return;
+
+            summary = g_framePacingStats.TakeSummary();
+        }
+
+        if (RuntimeConfig::DebugLogging())
+            dbg_log("[DX11] Frame pacing: %s", FramePacingStats::Format(summary).c_str());
+    }
+
+    bool IsCuNNyReady()
+    {
+        if (CuNNyScaler::IsAvailable())
+        {
+            // Whichever thread gets here first logs the hand-off, once
+            if (!g_cunnyPresenting.exchange(true))
+            {
+                int fallbackFrameCount = g_fallbackFrameCount;
+                if (fallbackFrameCount > 0)
+                {
+                    dbg_log("[DX11] CuNNy shaders ready - switching from bicubic fallback after %d frames (%llu ms)",
+                        fallbackFrameCount, GetTickCount64() - g_fallbackStartTick);
+                }
+                else
+                {
+                    dbg_log("[DX11] CuNNy shaders ready before the first scaled frame");
+                }
+            }
+            return true;
+        }
+
+        if (g_fallbackFrameCount++ == 0)
+        {
+            g_fallbackStartTick = GetTickCount64();
+            dbg_log("[DX11] CuNNy shaders still compiling - presenting with bicubic fallback");
+        }
+
+        if (!CuNNyScaler::IsCompiling() && !g_cunnyFailureLogged.exchange(true))
+        {
+            dbg_log("[DX11] CuNNy shader compilation failed - staying on bicubic fallback");
+        }
+        return false;
+    }
+
     // DX11 resource accessors (for DX11Video)
     bool IsDX11Active() { return g_dx11Active; }
     ID3D11DeviceContext* GetDX11Context() { return g_pD3D11Context; }
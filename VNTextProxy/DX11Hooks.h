@@ -1,11 +1,22 @@
 #pragma once
 
 #include <d3d11.h>
-#include <dxgi1_2.h>
+#include <dxgi1_3.h>
 
 namespace DX11Hooks {
     bool Install();
 
+    // True once the CuNNy shaders have finished compiling in the background.
+    // Until then, callers should scale with BicubicScaler instead.
+    bool IsCuNNyReady();
+
+    // Blocks on the swapchain's frame latency waitable object. Waiting takes a latency slot that only Present gives
+    // back, so only call this when a Present is sure to follow.
+    void WaitForFrameLatency();
+
+    // Feeds the frame pacing statistics. Call right after each swapchain Present.
+    void RecordPresent();
+
     // DX11 resource accessors (for DX11Video)
     bool IsDX11Active();
     ID3D11DeviceContext* GetDX11Context();
@@ -505,6 +505,7 @@ PS_INPUT VS_Main(VS_INPUT input)
 
 // Cubic weight function (Catmull-Rom spline)
 // This gives sharper results than Mitchell-Netravali for upscaling
+// Keep in sync with ResampleKernel::ComputeWeights, which the DX9 scaler's weight table is built from
 float4 CubicWeights(float x)
 {
     float x2 = x * x;
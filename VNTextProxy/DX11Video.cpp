@@ -23,6 +23,8 @@ namespace DX11Video {
         if (!DX11Hooks::IsDX11Active() || !pSwapChain || !pContext || !pRTV || !pVideoSRV)
             return;
 
+        DX11Hooks::WaitForFrameLatency();
+
         static int videoFrameCount = 0;
         videoFrameCount++;
         if (videoFrameCount <= 5 || videoFrameCount % 100 == 0)
@@ -34,7 +36,7 @@ namespace DX11Video {
         float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
         pContext->ClearRenderTargetView(pRTV, clearColor);
 
-        if (PillarboxedState::g_pillarboxedActive)
+        if (PillarboxedState::g_pillarboxedActive && DX11Hooks::IsCuNNyReady())
         {
             // Pillarboxed mode: CuNNy upscale + Lanczos downscale with pillarboxing
             UINT scaledWidth = PillarboxedState::g_scaledWidth;
@@ -82,6 +84,19 @@ namespace DX11Video {
                 scaledWidth, scaledHeight
             );
         }
+        else if (PillarboxedState::g_pillarboxedActive)
+        {
+            // CuNNy still compiling: bicubic upscale straight into the pillarboxed rect
+            BicubicScaler::Scale(
+                pContext,
+                pVideoSRV,
+                pRTV,
+                width, height,
+                screenWidth, screenHeight,
+                PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
+                PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight
+            );
+        }
         else
         {
             // Windowed mode: 1:1 copy (no scaling)
@@ -103,6 +118,7 @@ namespace DX11Video {
 
         // Present
         HRESULT hr = pSwapChain->Present(1, 0);
+        DX11Hooks::RecordPresent();
         if (videoFrameCount <= 5)
         {
             dbg_log("[DX11] PresentVideoFrame: Present returned 0x%x", hr);
@@ -5,6 +5,7 @@
 
 #include "SharedConstants.h"
 #include "PillarboxedState.h"
+#include "DX9Scaler.h"
 #include "Util/Logger.h"
 
 #pragma comment(lib, "d3d9.lib")
@@ -51,11 +52,15 @@ namespace DX9Hooks
     static int stretchRectLogCount = 0;
     static int getBackBufferLogCount = 0;
 
-    // Render target for game rendering
+    // Render target for game rendering. Created as a texture so the scaler can sample it.
+    static IDirect3DTexture9* g_pGameRenderTexture = nullptr;
     static IDirect3DSurface9* g_pGameRenderTarget = nullptr;
     static IDirect3DSurface9* g_pOriginalBackBuffer = nullptr;
     static bool g_renderTargetActive = false;
 
+    // Shader scaler state (RuntimeConfig::DirectX9Filter); falls back to StretchRect if it can't be used
+    static bool g_scalerFailed = false;
+
     static void LogSurfaceInfo(const char* label, IDirect3DSurface9* pSurface)
     {
         if (!pSurface)
@@ -158,12 +163,18 @@ namespace DX9Hooks
         dbg_log("IDirect3DDevice9::Reset called");
         LogPresentParameters("  Before Reset", pPresentationParameters);
 
-        // Release old render target before Reset (required by D3D9)
+        // Release old render target and scaler resources before Reset (required by D3D9)
+        DX9Scaler::Cleanup();
         if (g_pGameRenderTarget)
         {
             g_pGameRenderTarget->Release();
             g_pGameRenderTarget = nullptr;
         }
+        if (g_pGameRenderTexture)
+        {
+            g_pGameRenderTexture->Release();
+            g_pGameRenderTexture = nullptr;
+        }
         if (g_pOriginalBackBuffer)
         {
             g_pOriginalBackBuffer->Release();
@@ -305,15 +316,22 @@ namespace DX9Hooks
                 g_pGameRenderTarget->Release();
                 g_pGameRenderTarget = nullptr;
             }
-            HRESULT hrCreate = pThis->CreateRenderTarget(
+            if (g_pGameRenderTexture)
+            {
+                g_pGameRenderTexture->Release();
+                g_pGameRenderTexture = nullptr;
+            }
+            HRESULT hrCreate = pThis->CreateTexture(
                 gameWidth, gameHeight,
+                1,
+                D3DUSAGE_RENDERTARGET,
                 D3DFMT_X8R8G8B8,
-                D3DMULTISAMPLE_NONE,
-                0,
-                FALSE,
-                &g_pGameRenderTarget,
+                D3DPOOL_DEFAULT,
+                &g_pGameRenderTexture,
                 nullptr
             );
+            if (SUCCEEDED(hrCreate))
+                hrCreate = g_pGameRenderTexture->GetSurfaceLevel(0, &g_pGameRenderTarget);
 
             if (SUCCEEDED(hrCreate))
             {
@@ -334,6 +352,39 @@ namespace DX9Hooks
         return hr;
     }
 
+    // Scales the game render target into the pillarboxed rect with the configured kernel.
+    // Returns false if the StretchRect path should be used instead.
+    static bool ScaleWithShader(IDirect3DDevice9* pDevice)
+    {
+        ResampleKernel::Filter filter;
+        if (g_scalerFailed || !ResampleKernel::TryParse(RuntimeConfig::DirectX9Filter(), filter))
+            return false;
+
+        // Created lazily since Reset releases it
+        if (!DX9Scaler::IsInitialized() && !DX9Scaler::Initialize(pDevice, filter))
+        {
+            dbg_log("  [DX9] Shader scaler unavailable, falling back to StretchRect linear");
+            g_scalerFailed = true;
+            return false;
+        }
+
+        if (!DX9Scaler::Scale(
+            pDevice,
+            g_pGameRenderTexture,
+            PillarboxedState::g_gameWidth, PillarboxedState::g_gameHeight,
+            g_pOriginalBackBuffer,
+            PillarboxedState::g_screenWidth, PillarboxedState::g_screenHeight,
+            PillarboxedState::g_offsetX, PillarboxedState::g_offsetY,
+            PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight))
+        {
+            dbg_log("  [DX9] Shader scaler failed, falling back to StretchRect linear");
+            g_scalerFailed = true;
+            return false;
+        }
+
+        return true;
+    }
+
     HRESULT WINAPI Present_Hook(IDirect3DDevice9* pThis, const RECT* pSourceRect, const RECT* pDestRect,
         HWND hDestWindowOverride, const RGNDATA* pDirtyRegion)
     {
@@ -347,7 +398,7 @@ namespace DX9Hooks
             presentLogCount++;
         }
 
-        // DX9 scaling path: use StretchRect for scaling with pillarboxing
+        // DX9 scaling path: shader scaler (or StretchRect) with pillarboxing
         if (g_renderTargetActive && g_pGameRenderTarget && g_pOriginalBackBuffer)
         {
             // Switch to backbuffer for our scaling operation
@@ -369,16 +420,20 @@ namespace DX9Hooks
 
                 if (RuntimeConfig::DebugLogging() && presentLogCount <= 10)
                 {
-                    dbg_log("  [DX9] StretchRect: %dx%d -> %dx%d at offset (%d,%d)",
+                    dbg_log("  [DX9] Scale (%s): %dx%d -> %dx%d at offset (%d,%d)",
+                        RuntimeConfig::DirectX9Filter().c_str(),
                         PillarboxedState::g_gameWidth, PillarboxedState::g_gameHeight,
                         PillarboxedState::g_scaledWidth, PillarboxedState::g_scaledHeight,
                         PillarboxedState::g_offsetX, PillarboxedState::g_offsetY);
                 }
 
-                HRESULT hr = oStretchRect(pThis, g_pGameRenderTarget, &srcRect, g_pOriginalBackBuffer, &dstRect, D3DTEXF_LINEAR);
-                if (FAILED(hr) && RuntimeConfig::DebugLogging() && presentLogCount <= 10)
+                if (!ScaleWithShader(pThis))
                 {
-                    dbg_log("  [DX9] StretchRect failed, hr=0x%x", hr);
+                    HRESULT hr = oStretchRect(pThis, g_pGameRenderTarget, &srcRect, g_pOriginalBackBuffer, &dstRect, D3DTEXF_LINEAR);
+                    if (FAILED(hr) && RuntimeConfig::DebugLogging() && presentLogCount <= 10)
+                    {
+                        dbg_log("  [DX9] StretchRect failed, hr=0x%x", hr);
+                    }
                 }
             }
             else
@@ -0,0 +1,302 @@
+#include "pch.h"
+#include "DX9Scaler.h"
+#include "DX9Shaders.h"
+#include "Util/Logger.h"
+#include <d3dcompiler.h>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+#define dbg_log(...) proxy_log(LogCategory::DX9, __VA_ARGS__)
+
+namespace DX9Scaler
+{
+    // Number of fractional positions in the weight texture
+    constexpr int WEIGHT_TABLE_PHASES = 256;
+
+    // Resources
+    static IDirect3DVertexShader9* g_pVertexShader = nullptr;
+    static IDirect3DPixelShader9* g_pPixelShader = nullptr;
+    static IDirect3DVertexDeclaration9* g_pVertexDeclaration = nullptr;
+    static IDirect3DTexture9* g_pWeightTexture = nullptr;
+    static IDirect3DTexture9* g_pIntermediateTexture = nullptr;
+    static IDirect3DStateBlock9* g_pStateBlock = nullptr;
+    static UINT g_intermediateWidth = 0;
+    static UINT g_intermediateHeight = 0;
+    static ResampleKernel::Filter g_filter = ResampleKernel::Filter::CatmullRom;
+
+    struct Vertex
+    {
+        float pos[2];
+        float tex[2];
+    };
+
+    static ID3DBlob* CompileShader(const char* entryPoint, const char* target, ResampleKernel::Filter filter)
+    {
+        char taps[8];
+        sprintf_s(taps, "%d", ResampleKernel::TapCount(filter));
+        D3D_SHADER_MACRO defines[] = {
+            { "TAPS", taps },
+            { nullptr, nullptr }
+        };
+
+        ID3DBlob* pBlob = nullptr;
+        ID3DBlob* pErrorBlob = nullptr;
+        HRESULT hr = D3DCompile(
+            g_ResampleShader9,
+            strlen(g_ResampleShader9),
+            "DX9Scaler",
+            defines,
+            nullptr,
+            entryPoint,
+            target,
+            D3DCOMPILE_OPTIMIZATION_LEVEL3,
+            0,
+            &pBlob,
+            &pErrorBlob
+        );
+        if (FAILED(hr))
+        {
+            if (pErrorBlob)
+            {
+                dbg_log("[DX9Scaler] %s compile failed: %s", entryPoint, (char*)pErrorBlob->GetBufferPointer());
+                pErrorBlob->Release();
+            }
+            return nullptr;
+        }
+
+        if (pErrorBlob)
+            pErrorBlob->Release();
+
+        return pBlob;
+    }
+
+    static bool CreateWeightTexture(IDirect3DDevice9* pDevice, ResampleKernel::Filter filter)
+    {
+        // One texel column per phase; row 0 holds taps 0-3, row 1 taps 4-7
+        HRESULT hr = pDevice->CreateTexture(WEIGHT_TABLE_PHASES, 2, 1, 0, D3DFMT_A32B32G32R32F,
+            D3DPOOL_MANAGED, &g_pWeightTexture, nullptr);
+        if (FAILED(hr))
+        {
+            dbg_log("[DX9Scaler] Failed to create weight texture, hr=0x%x", hr);
+            return false;
+        }
+
+        D3DLOCKED_RECT locked;
+        hr = g_pWeightTexture->LockRect(0, &locked, nullptr, 0);
+        if (FAILED(hr))
+            return false;
+
+        std::vector<float> table = ResampleKernel::BuildWeightTable(filter, WEIGHT_TABLE_PHASES);
+        for (int row = 0; row < 2; row++)
+        {
+            float* pRow = (float*)((BYTE*)locked.pBits + row * locked.Pitch);
+            for (int phase = 0; phase < WEIGHT_TABLE_PHASES; phase++)
+                memcpy(pRow + phase * 4, &table[phase * ResampleKernel::MaxTaps + row * 4], 4 * sizeof(float));
+        }
+
+        g_pWeightTexture->UnlockRect(0);
+        return true;
+    }
+
+    bool Initialize(IDirect3DDevice9* pDevice, ResampleKernel::Filter filter)
+    {
+        Cleanup();
+        g_filter = filter;
+
+        ID3DBlob* pVSBlob = CompileShader("VS_Main", "vs_3_0", filter);
+        if (!pVSBlob)
+            return false;
+
+        HRESULT hr = pDevice->CreateVertexShader((const DWORD*)pVSBlob->GetBufferPointer(), &g_pVertexShader);
+        pVSBlob->Release();
+        if (FAILED(hr))
+        {
+            Cleanup();
+            return false;
+        }
+
+        ID3DBlob* pPSBlob = CompileShader("PS_Main", "ps_3_0", filter);
+        if (!pPSBlob)
+        {
+            Cleanup();
+            return false;
+        }
+
+        hr = pDevice->CreatePixelShader((const DWORD*)pPSBlob->GetBufferPointer(), &g_pPixelShader);
+        pPSBlob->Release();
+        if (FAILED(hr))
+        {
+            Cleanup();
+            return false;
+        }
+
+        D3DVERTEXELEMENT9 elements[] = {
+            { 0, 0, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+            { 0, 8, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+            D3DDECL_END()
+        };
+        hr = pDevice->CreateVertexDeclaration(elements, &g_pVertexDeclaration);
+        if (FAILED(hr) || !CreateWeightTexture(pDevice, filter))
+        {
+            Cleanup();
+            return false;
+        }
+
+        hr = pDevice->CreateStateBlock(D3DSBT_ALL, &g_pStateBlock);
+        if (FAILED(hr))
+        {
+            Cleanup();
+            return false;
+        }
+
+        dbg_log("[DX9Scaler] Initialized (%s, %d taps)", ResampleKernel::GetName(filter), ResampleKernel::TapCount(filter));
+        return true;
+    }
+
+    void Cleanup()
+    {
+        if (g_pStateBlock) { g_pStateBlock->Release(); g_pStateBlock = nullptr; }
+        if (g_pIntermediateTexture) { g_pIntermediateTexture->Release(); g_pIntermediateTexture = nullptr; }
+        if (g_pWeightTexture) { g_pWeightTexture->Release(); g_pWeightTexture = nullptr; }
+        if (g_pVertexDeclaration) { g_pVertexDeclaration->Release(); g_pVertexDeclaration = nullptr; }
+        if (g_pPixelShader) { g_pPixelShader->Release(); g_pPixelShader = nullptr; }
+        if (g_pVertexShader) { g_pVertexShader->Release(); g_pVertexShader = nullptr; }
+        g_intermediateWidth = 0;
+        g_intermediateHeight = 0;
+    }
+
+    bool IsInitialized()
+    {
+        return g_pPixelShader != nullptr;
+    }
+
+    static bool EnsureIntermediateTexture(IDirect3DDevice9* pDevice, UINT width, UINT height)
+    {
+        if (g_pIntermediateTexture && g_intermediateWidth == width && g_intermediateHeight == height)
+            return true;
+
+        if (g_pIntermediateTexture) { g_pIntermediateTexture->Release(); g_pIntermediateTexture = nullptr; }
+
+        // Half float keeps the horizontal pass's overshoot and precision for the vertical one
+        HRESULT hr = pDevice->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A16B16G16R16F,
+            D3DPOOL_DEFAULT, &g_pIntermediateTexture, nullptr);
+        if (FAILED(hr))
+        {
+            hr = pDevice->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_X8R8G8B8,
+                D3DPOOL_DEFAULT, &g_pIntermediateTexture, nullptr);
+        }
+        if (FAILED(hr))
+        {
+            dbg_log("[DX9Scaler] Failed to create %dx%d intermediate texture, hr=0x%x", width, height, hr);
+            return false;
+        }
+
+        g_intermediateWidth = width;
+        g_intermediateHeight = height;
+        return true;
+    }
+
+    // Draws a quad covering the given pixel rectangle of the current render target
+    static void DrawPass(IDirect3DDevice9* pDevice, UINT targetWidth, UINT targetHeight,
+        UINT x, UINT y, UINT width, UINT height)
+    {
+        // Shift by half a pixel so texel centers line up with pixel centers (D3D9 rasterization rules)
+        float left = ((float)x - 0.5f) / targetWidth * 2.0f - 1.0f;
+        float right = ((float)(x + width) - 0.5f) / targetWidth * 2.0f - 1.0f;
+        float top = 1.0f - ((float)y - 0.5f) / targetHeight * 2.0f;
+        float bottom = 1.0f - ((float)(y + height) - 0.5f) / targetHeight * 2.0f;
+
+        Vertex vertices[] = {
+            { { left,  top },    { 0.0f, 0.0f } },
+            { { right, top },    { 1.0f, 0.0f } },
+            { { left,  bottom }, { 0.0f, 1.0f } },
+            { { right, bottom }, { 1.0f, 1.0f } },
+        };
+        pDevice->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(Vertex));
+    }
+
+    static void SetPassConstants(IDirect3DDevice9* pDevice, UINT inputWidth, UINT inputHeight, bool horizontal, bool finalPass)
+    {
+        float constants[3][4] = {
+            { (float)inputWidth, (float)inputHeight, 1.0f / inputWidth, 1.0f / inputHeight },
+            { horizontal ? 1.0f : 0.0f, horizontal ? 0.0f : 1.0f, finalPass ? 1.0f : 0.0f, 0.0f },
+            { (float)(WEIGHT_TABLE_PHASES - 1), 1.0f / WEIGHT_TABLE_PHASES, 0.0f, 0.0f }
+        };
+        pDevice->SetPixelShaderConstantF(0, &constants[0][0], 3);
+    }
+
+    bool Scale(
+        IDirect3DDevice9* pDevice,
+        IDirect3DTexture9* pSourceTexture,
+        UINT srcWidth, UINT srcHeight,
+        IDirect3DSurface9* pDestSurface,
+        UINT dstWidth, UINT dstHeight,
+        UINT offsetX, UINT offsetY,
+        UINT scaledWidth, UINT scaledHeight)
+    {
+        if (!IsInitialized() || !EnsureIntermediateTexture(pDevice, scaledWidth, srcHeight))
+            return false;
+
+        IDirect3DSurface9* pIntermediateSurface = nullptr;
+        if (FAILED(g_pIntermediateTexture->GetSurfaceLevel(0, &pIntermediateSurface)))
+            return false;
+
+        IDirect3DSurface9* pDepthStencil = nullptr;
+        pDevice->GetDepthStencilSurface(&pDepthStencil);
+        g_pStateBlock->Capture();
+
+        pDevice->SetDepthStencilSurface(nullptr);
+        pDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+        pDevice->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+        pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+        pDevice->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+        pDevice->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
+        pDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+        pDevice->SetRenderState(D3DRS_FOGENABLE, FALSE);
+        pDevice->SetRenderState(D3DRS_SRGBWRITEENABLE, FALSE);
+        pDevice->SetRenderState(D3DRS_COLORWRITEENABLE, 0xF);
+        for (DWORD sampler = 0; sampler < 2; sampler++)
+        {
+            pDevice->SetSamplerState(sampler, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+            pDevice->SetSamplerState(sampler, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+            pDevice->SetSamplerState(sampler, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+            pDevice->SetSamplerState(sampler, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
+            pDevice->SetSamplerState(sampler, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
+            pDevice->SetSamplerState(sampler, D3DSAMP_SRGBTEXTURE, FALSE);
+        }
+
+        pDevice->SetVertexDeclaration(g_pVertexDeclaration);
+        pDevice->SetVertexShader(g_pVertexShader);
+        pDevice->SetPixelShader(g_pPixelShader);
+        pDevice->SetTexture(1, g_pWeightTexture);
+
+        bool succeeded = SUCCEEDED(pDevice->BeginScene());
+        if (succeeded)
+        {
+            // Pass 1: horizontal, source -> intermediate (scaledWidth x srcHeight)
+            pDevice->SetRenderTarget(0, pIntermediateSurface);
+            pDevice->SetTexture(0, pSourceTexture);
+            SetPassConstants(pDevice, srcWidth, srcHeight, true, false);
+            DrawPass(pDevice, scaledWidth, srcHeight, 0, 0, scaledWidth, srcHeight);
+
+            // Pass 2: vertical, intermediate -> pillarboxed rect of the destination
+            pDevice->SetRenderTarget(0, pDestSurface);
+            pDevice->SetTexture(0, g_pIntermediateTexture);
+            SetPassConstants(pDevice, scaledWidth, srcHeight, false, true);
+            DrawPass(pDevice, dstWidth, dstHeight, offsetX, offsetY, scaledWidth, scaledHeight);
+
+            pDevice->EndScene();
+        }
+
+        pDevice->SetTexture(0, nullptr);
+        pDevice->SetTexture(1, nullptr);
+        g_pStateBlock->Apply();
+        pDevice->SetDepthStencilSurface(pDepthStencil);
+
+        if (pDepthStencil)
+            pDepthStencil->Release();
+
+        pIntermediateSurface->Release();
+        return succeeded;
+    }
+}
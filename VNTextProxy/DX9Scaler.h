@@ -0,0 +1,30 @@
+#pragma once
+
+#include <d3d9.h>
+
+#include "Util/ResampleKernel.h"
+
+namespace DX9Scaler
+{
+    // Compile the resampling shaders and create the kernel weight texture.
+    // All resources must be released with Cleanup() before IDirect3DDevice9::Reset.
+    bool Initialize(IDirect3DDevice9* pDevice, ResampleKernel::Filter filter);
+
+    // Cleanup resources
+    void Cleanup();
+
+    bool IsInitialized();
+
+    // Scale source texture into the destination rectangle of pDestSurface with two separable passes
+    // (horizontal into an intermediate texture, then vertical into the destination).
+    // Device state is saved and restored around the passes; the render target is left set to pDestSurface.
+    bool Scale(
+        IDirect3DDevice9* pDevice,
+        IDirect3DTexture9* pSourceTexture,
+        UINT srcWidth, UINT srcHeight,
+        IDirect3DSurface9* pDestSurface,
+        UINT dstWidth, UINT dstHeight,
+        UINT offsetX, UINT offsetY,
+        UINT scaledWidth, UINT scaledHeight
+    );
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Separable resampling pass for the DX9 pillarbox path (vs_3_0 / ps_3_0).
+// Compiled with TAPS defined to ResampleKernel::TapCount(). Kernel weights come from a lookup texture
+// built by ResampleKernel::BuildWeightTable: one column per phase, taps 0-3 in row 0 and 4-7 in row 1.
+static const char* g_ResampleShader9 = R"(
+float4 srcSize : register(c0);      // xy = pass input size, zw = 1 / size
+float4 direction : register(c1);    // xy = (1, 0) for the horizontal pass, (0, 1) for the vertical one; z = 1 on the final pass
+float4 tableParams : register(c2);  // x = phases - 1, y = 1 / phases
+
+sampler2D srcTexture : register(s0);    // Point sampling, clamp
+sampler2D weightTable : register(s1);   // Point sampling, clamp
+
+struct VS_OUTPUT
+{
+    float4 pos : POSITION;
+    float2 tex : TEXCOORD0;
+};
+
+// Positions arrive in clip space, already adjusted for the D3D9 half-pixel offset
+VS_OUTPUT VS_Main(float2 pos : POSITION, float2 tex : TEXCOORD0)
+{
+    VS_OUTPUT output;
+    output.pos = float4(pos, 0.0, 1.0);
+    output.tex = tex;
+    return output;
+}
+
+float4 PS_Main(float2 tex : TEXCOORD0) : COLOR0
+{
+    float2 texel = tex * srcSize.xy - 0.5;
+    float2 base = floor(texel);
+    float frac = dot(texel - base, direction.xy);
+
+    // Nearest phase in the weight table
+    float u = (floor(frac * tableParams.x + 0.5) + 0.5) * tableParams.y;
+    float4 w0 = tex2Dlod(weightTable, float4(u, 0.25, 0, 0));
+    float4 w1 = tex2Dlod(weightTable, float4(u, 0.75, 0, 0));
+    float weights[8] = { w0.x, w0.y, w0.z, w0.w, w1.x, w1.y, w1.z, w1.w };
+
+    // Step along the filter axis; the other axis keeps the interpolated coordinate,
+    // which always lands on a texel center since that axis isn't resized in this pass
+    float2 step = direction.xy * srcSize.zw;
+    float2 origin = lerp(tex, (base + 0.5) * srcSize.zw, direction.xy) - step * (TAPS / 2 - 1);
+
+    float4 result = float4(0, 0, 0, 0);
+
+    [unroll]
+    for (int i = 0; i < TAPS; i++)
+        result += tex2Dlod(srcTexture, float4(origin + step * i, 0, 0)) * weights[i];
+
+    // Keep overshoot in the intermediate texture; clamp only the final output
+    return direction.z > 0.5 ? saturate(result) : result;
+}
+)";
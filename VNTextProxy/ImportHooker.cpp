@@ -3,7 +3,7 @@
 
 using namespace std;
 
-void ImportHooker::Hook(const map<string, void*>& replacementFuncs)
+void ImportHooker::Hook(const FunctionMap& replacementFuncs)
 {
     Init();
 
@@ -14,7 +14,7 @@ void ImportHooker::Hook(const map<string, void*>& replacementFuncs)
 
     HMODULE hExe = GetModuleHandle(nullptr);
     proxy_log(LogCategory::HOOKS, "ImportHooker::Hook: patching main EXE IAT (%zu funcs)", replacementFuncs.size());
-    DetourEnumerateImportsEx(hExe, (void*)&replacementFuncs, nullptr, PatchGameImport);
+    PatchModule(hExe, replacementFuncs);
 }
 
 void ImportHooker::ApplyToModule(HMODULE hModule)
@@ -22,7 +22,7 @@ void ImportHooker::ApplyToModule(HMODULE hModule)
     char moduleName[MAX_PATH] = "<unknown>";
     GetModuleFileNameA(hModule, moduleName, sizeof(moduleName));
     proxy_log(LogCategory::HOOKS, "ImportHooker::ApplyToModule: patching IAT of %s", moduleName);
-    DetourEnumerateImportsEx(hModule, (void*)&ReplacementFuncs, nullptr, PatchGameImport);
+    PatchModule(hModule, ReplacementFuncs);
 }
 
 void ImportHooker::Init()
@@ -38,32 +38,90 @@ void ImportHooker::Init()
     );
 }
 
-BOOL ImportHooker::PatchGameImport(void* pContext, DWORD nOrdinal, LPCSTR pszFunc, void** ppvFunc)
+// Collects the IAT slots to patch first, then writes them with one VirtualProtect pair per run of pages
+void ImportHooker::PatchModule(HMODULE hModule, const FunctionMap& replacementFuncs)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    PatchContext context{ &replacementFuncs };
+    DetourEnumerateImportsEx(hModule, &context, nullptr, CollectImport);
+    int numPages = ApplyPatches(context.Patches);
+
+    QueryPerformanceCounter(&end);
+    proxy_log(LogCategory::HOOKS, "ImportHooker::PatchModule: patched %zu imports on %d pages in %.3f ms",
+        context.Patches.size(), numPages, (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+}
+
+BOOL ImportHooker::CollectImport(void* pContext, DWORD nOrdinal, LPCSTR pszFunc, void** ppvFunc)
 {
     if (pszFunc == nullptr || ppvFunc == nullptr)
         return true;
 
-    map<string, void*>* pReplacementFuncs = (map<string, void*>*)pContext;
-    auto it = pReplacementFuncs->find(pszFunc);
-    if (it != pReplacementFuncs->end())
-    {
-        void* oldValue = *ppvFunc;
-        proxy_log(LogCategory::HOOKS, "ImportHooker::PatchGameImport: patching '%s' at IAT 0x%p: old=0x%p -> new=0x%p", pszFunc, ppvFunc, oldValue, it->second);
-        MemoryUnprotector unprotect(ppvFunc, 4);
-        *ppvFunc = it->second;
-        void* verify = *ppvFunc;
-        if (verify != it->second)
-            proxy_log(LogCategory::HOOKS, "ImportHooker::PatchGameImport: WRITE FAILED for '%s': expected 0x%p, got 0x%p", pszFunc, it->second, verify);
-    }
+    PatchContext* pPatchContext = (PatchContext*)pContext;
+    auto it = pPatchContext->pReplacementFuncs->find(string_view(pszFunc));
+    if (it != pPatchContext->pReplacementFuncs->end())
+        pPatchContext->Patches.push_back({ ppvFunc, it->second, pszFunc });
 
     return true;
 }
 
+// Returns the number of pages that were unprotected
+int ImportHooker::ApplyPatches(vector<Patch>& patches)
+{
+    static const DWORD PageSize = []
+    {
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        return systemInfo.dwPageSize;
+    }();
+
+    sort(patches.begin(), patches.end(), [](const Patch& a, const Patch& b) { return a.pSlot < b.pSlot; });
+
+    int numPages = 0;
+    for (size_t runStart = 0; runStart < patches.size(); )
+    {
+        // Extend the run while the next slot is on the same page as the previous one or the page after it
+        BYTE* pRunStart = (BYTE*)((uintptr_t)patches[runStart].pSlot & ~(uintptr_t)(PageSize - 1));
+        BYTE* pRunEnd = pRunStart + PageSize;
+        size_t runEnd = runStart + 1;
+        while (runEnd < patches.size() && (BYTE*)patches[runEnd].pSlot < pRunEnd + PageSize)
+        {
+            if ((BYTE*)patches[runEnd].pSlot >= pRunEnd)
+                pRunEnd += PageSize;
+
+            runEnd++;
+        }
+
+        MemoryUnprotector unprotect(pRunStart, (int)(pRunEnd - pRunStart));
+        for (size_t i = runStart; i < runEnd; i++)
+        {
+            const Patch& patch = patches[i];
+            proxy_log(LogCategory::HOOKS, "ImportHooker::ApplyPatches: patching '%s' at IAT 0x%p: old=0x%p -> new=0x%p", patch.pszFunc, patch.pSlot, *patch.pSlot, patch.pReplacement);
+            *patch.pSlot = patch.pReplacement;
+            void* verify = *patch.pSlot;
+            if (verify != patch.pReplacement)
+                proxy_log(LogCategory::HOOKS, "ImportHooker::ApplyPatches: WRITE FAILED for '%s': expected 0x%p, got 0x%p", patch.pszFunc, patch.pReplacement, verify);
+        }
+
+        numPages += (int)((pRunEnd - pRunStart) / PageSize);
+        runStart = runEnd;
+    }
+    return numPages;
+}
+
 FARPROC ImportHooker::GetProcAddressHook(HMODULE hModule, LPCSTR lpProcName)
 {
-    auto it = ReplacementFuncs.find(lpProcName);
-    if (it != ReplacementFuncs.end())
-        return (FARPROC)it->second;
+    // Lookups by ordinal pass the ordinal in place of the name
+    if (!IS_INTRESOURCE(lpProcName))
+    {
+        auto it = ReplacementFuncs.find(string_view(lpProcName));
+        if (it != ReplacementFuncs.end())
+            return (FARPROC)it->second;
+    }
 
     return GetProcAddress(hModule, lpProcName);
 }
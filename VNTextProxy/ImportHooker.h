@@ -3,15 +3,34 @@
 class ImportHooker
 {
 public:
-    static void Hook(const std::map<std::string, void*>& replacementFuncs);
+    // Keyed with std::less<> so the ANSI names Detours and GetProcAddress hand us can be looked up
+    // without building a std::string for each one
+    using FunctionMap = std::map<std::string, void*, std::less<>>;
+
+    static void Hook(const FunctionMap& replacementFuncs);
     static void ApplyToModule(HMODULE hModule);
 
 private:
+    struct Patch
+    {
+        void**  pSlot;
+        void*   pReplacement;
+        LPCSTR  pszFunc;
+    };
+
+    struct PatchContext
+    {
+        const FunctionMap*  pReplacementFuncs;
+        std::vector<Patch>  Patches;
+    };
+
     static void Init();
-    static BOOL __stdcall PatchGameImport(void* pContext, DWORD nOrdinal, LPCSTR pszFunc, void** ppvFunc);
+    static void PatchModule(HMODULE hModule, const FunctionMap& replacementFuncs);
+    static BOOL __stdcall CollectImport(void* pContext, DWORD nOrdinal, LPCSTR pszFunc, void** ppvFunc);
+    static int ApplyPatches(std::vector<Patch>& patches);
 
     static FARPROC __stdcall GetProcAddressHook(HMODULE hModule, LPCSTR lpProcName);
 
     static inline bool Initialized{};
-    static inline std::map<std::string, void*> ReplacementFuncs{};
+    static inline FunctionMap ReplacementFuncs{};
 };
@@ -0,0 +1,419 @@
+#include "pch.h"
+#include "OverlayFileSystem.h"
+#include "Util/Logger.h"
+
+using namespace std;
+
+// Turns ASCII letters to lower case, which is how archive entries and data\ files are matched
+static string ToLowerAscii(string text)
+{
+    for (char& c : text)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+    }
+    return text;
+}
+
+static string ToUtf8(const wchar_t* pText)
+{
+    int length = WideCharToMultiByte(CP_UTF8, 0, pText, -1, nullptr, 0, nullptr, nullptr);
+    string text(length > 0 ? length - 1 : 0, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, pText, -1, text.data(), length, nullptr, nullptr);
+    return text;
+}
+
+void OverlayFileSystem::Init()
+{
+    DataFolderPath = Path::Combine(Path::GetModuleFolderPath(nullptr), L"data\\");
+    InitArchive();
+    InitPngOverride();
+}
+
+void OverlayFileSystem::InitArchive()
+{
+    const wstring& fileName = RuntimeConfig::OverlayArchive();
+    if (fileName.empty())
+        return;
+
+    HANDLE hFile = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        proxy_log(LogCategory::INIT, "OverlayFileSystem: no overlay archive at %ls", fileName.c_str());
+        return;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE hMapping = nullptr;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0 && (uint64_t)size.QuadPart <= SIZE_MAX)
+        hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    // The view keeps the mapping and the file open
+    CloseHandle(hFile);
+    if (hMapping == nullptr)
+    {
+        proxy_log(LogCategory::INIT, "OverlayFileSystem: can't map %ls (error %d)", fileName.c_str(), GetLastError());
+        return;
+    }
+
+    ArchiveView = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (ArchiveView == nullptr)
+    {
+        proxy_log(LogCategory::INIT, "OverlayFileSystem: can't map %ls (error %d)", fileName.c_str(), GetLastError());
+        return;
+    }
+
+    if (!Archive.Open(ArchiveView, (size_t)size.QuadPart))
+    {
+        proxy_log(LogCategory::INIT, "OverlayFileSystem: %ls is not a valid overlay archive", fileName.c_str());
+        UnmapViewOfFile(ArchiveView);
+        ArchiveView = nullptr;
+        return;
+    }
+
+    proxy_log(LogCategory::INIT, "OverlayFileSystem: serving %d files from %ls in place of %ls", Archive.GetCount(), fileName.c_str(), DataFolderPath.c_str());
+}
+
+void OverlayFileSystem::InitPngOverride()
+{
+    const wstring& cacheFolder = RuntimeConfig::PngOverrideCache();
+    if (cacheFolder.empty())
+        return;
+
+    // Only file names matter: a PNG that's edited in place has a new hash, so it misses the cache by itself
+    PngFolderChangeNotification = FindFirstChangeNotificationW(DataFolderPath.c_str(), false, FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (PngFolderChangeNotification == INVALID_HANDLE_VALUE)
+    {
+        proxy_log(LogCategory::INIT, "OverlayFileSystem: can't watch %ls (error %d), PNG override disabled", DataFolderPath.c_str(), GetLastError());
+        return;
+    }
+
+    wstring gameFolderPath = Path::GetModuleFolderPath(nullptr);
+    vector<filesystem::path> archivePaths;
+    WIN32_FIND_DATAW findData;
+    HANDLE hFind = FindFirstFileW(Path::Combine(gameFolderPath, L"*.pac").c_str(), &findData);
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            archivePaths.push_back(Path::Combine(gameFolderPath, findData.cFileName));
+        } while (FindNextFileW(hFind, &findData));
+        FindClose(hFind);
+    }
+
+    wstring cacheFolderPath = Path::Combine(gameFolderPath, cacheFolder);
+    Transcoder.Init(cacheFolderPath, archivePaths);
+    {
+        lock_guard lock(PngMutex);
+        ListPngs();
+        proxy_log(LogCategory::INIT, "OverlayFileSystem: %d PNG files in %ls stand in for PGD files, cached in %ls", (int)PngFileNames.size(), DataFolderPath.c_str(), cacheFolderPath.c_str());
+    }
+    PngOverrideActive = true;
+}
+
+// Call with PngMutex held
+void OverlayFileSystem::ListPngs()
+{
+    PngFileNames.clear();
+    WIN32_FIND_DATAW findData;
+    HANDLE hFind = FindFirstFileW(Path::Combine(DataFolderPath, L"*.png").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return;
+
+    do
+    {
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            PngFileNames[ToLowerAscii(ToUtf8(findData.cFileName))] = findData.cFileName;
+    } while (FindNextFileW(hFind, &findData));
+    FindClose(hFind);
+}
+
+HANDLE OverlayFileSystem::Open(const wchar_t* pPath)
+{
+    OverlayArchive::Entry entry;
+    if (!Find(pPath, entry))
+        return OpenPng(pPath);
+
+    OpenFile file{ entry.pData, entry.Size, 0 };
+    if (entry.Method != OverlayArchive::Compression::None)
+    {
+        file.Extracted.resize(entry.Size);
+        if (!OverlayArchive::Extract(entry, file.Extracted.data()))
+        {
+            proxy_log(LogCategory::HOOKS, "OverlayFileSystem::Open: %.*s is corrupt", (int)entry.Name.size(), entry.Name.data());
+            SetLastError(ERROR_FILE_CORRUPT);
+            return INVALID_HANDLE_VALUE;
+        }
+        file.pData = file.Extracted.data();
+    }
+
+    return AddOpenFile(move(file));
+}
+
+// Serves a PNG in data\ as the PGD it stands in for. If it can't be transcoded, the game gets the PGD from the
+// pac archive as if there was no PNG.
+HANDLE OverlayFileSystem::OpenPng(const wchar_t* pPath)
+{
+    string entryName;
+    wstring pngPath;
+    if (!FindPng(pPath, entryName, pngPath))
+        return INVALID_HANDLE_VALUE;
+
+    OpenFile file{ nullptr, 0, 0 };
+    bool fromCache;
+    string error;
+    DWORD startTime = GetTickCount();
+    if (!Transcoder.Get(pngPath, entryName, file.Extracted, fromCache, error))
+    {
+        proxy_log(LogCategory::HOOKS, "OverlayFileSystem: can't use %ls in place of %s: %s", pngPath.c_str(), entryName.c_str(), error.c_str());
+        return INVALID_HANDLE_VALUE;
+    }
+
+    proxy_log(LogCategory::HOOKS, "OverlayFileSystem: serving %ls as %s (%s in %d ms)", pngPath.c_str(), entryName.c_str(),
+        fromCache ? "cached" : "transcoded", (int)(GetTickCount() - startTime));
+    file.pData = file.Extracted.data();
+    file.Size = (uint32_t)file.Extracted.size();
+    return AddOpenFile(move(file));
+}
+
+HANDLE OverlayFileSystem::AddOpenFile(OpenFile&& file)
+{
+    // Signaled, so that waiting on the handle (as GetOverlappedResult may) returns right away
+    HANDLE hFile = CreateEventW(nullptr, true, true, nullptr);
+    if (hFile == nullptr)
+        return INVALID_HANDLE_VALUE;
+
+    lock_guard lock(OpenFilesMutex);
+    OpenFiles.emplace(hFile, move(file));
+    NumOpenFiles++;
+    SetLastError(NO_ERROR);
+    return hFile;
+}
+
+bool OverlayFileSystem::Contains(const wchar_t* pPath)
+{
+    OverlayArchive::Entry entry;
+    string entryName;
+    wstring pngPath;
+    return Find(pPath, entry) || FindPng(pPath, entryName, pngPath);
+}
+
+bool OverlayFileSystem::Read(HANDLE hFile, void* pBuffer, DWORD size, DWORD* pNumRead, OVERLAPPED* pOverlapped, BOOL& result)
+{
+    if (NumOpenFiles == 0)
+        return false;
+
+    lock_guard lock(OpenFilesMutex);
+    OpenFile* pFile = GetOpenFile(hFile);
+    if (pFile == nullptr)
+        return false;
+
+    uint64_t position = pFile->Position;
+    if (pOverlapped != nullptr)
+        position = ((uint64_t)pOverlapped->OffsetHigh << 32) | pOverlapped->Offset;
+
+    DWORD numRead = position < pFile->Size ? (DWORD)min<uint64_t>(size, pFile->Size - position) : 0;
+    if (numRead != 0)
+        memcpy(pBuffer, pFile->pData + position, numRead);
+
+    pFile->Position = position + numRead;
+    if (pNumRead != nullptr)
+        *pNumRead = numRead;
+
+    if (pOverlapped == nullptr)
+    {
+        result = true;
+        return true;
+    }
+
+    // Overlapped reads complete immediately, and report end of file as an error like real ones do
+    pOverlapped->Internal = 0;
+    pOverlapped->InternalHigh = numRead;
+    if (pOverlapped->hEvent != nullptr)
+        SetEvent(pOverlapped->hEvent);
+
+    result = numRead != 0 || size == 0;
+    if (!result)
+        SetLastError(ERROR_HANDLE_EOF);
+
+    return true;
+}
+
+bool OverlayFileSystem::GetSize(HANDLE hFile, uint64_t& size)
+{
+    if (NumOpenFiles == 0)
+        return false;
+
+    lock_guard lock(OpenFilesMutex);
+    OpenFile* pFile = GetOpenFile(hFile);
+    if (pFile == nullptr)
+        return false;
+
+    size = pFile->Size;
+    return true;
+}
+
+bool OverlayFileSystem::Seek(HANDLE hFile, int64_t distance, DWORD moveMethod, uint64_t& newPosition, BOOL& result)
+{
+    if (NumOpenFiles == 0)
+        return false;
+
+    lock_guard lock(OpenFilesMutex);
+    OpenFile* pFile = GetOpenFile(hFile);
+    if (pFile == nullptr)
+        return false;
+
+    int64_t origin;
+    switch (moveMethod)
+    {
+    case FILE_BEGIN:    origin = 0; break;
+    case FILE_CURRENT:  origin = (int64_t)pFile->Position; break;
+    case FILE_END:      origin = pFile->Size; break;
+    default:
+        SetLastError(ERROR_INVALID_PARAMETER);
+        result = false;
+        return true;
+    }
+
+    // Like on a real file, seeking past the end is allowed; reads there return nothing
+    if (distance < -origin)
+    {
+        SetLastError(ERROR_NEGATIVE_SEEK);
+        result = false;
+        return true;
+    }
+
+    pFile->Position = (uint64_t)(origin + distance);
+    newPosition = pFile->Position;
+    result = true;
+    return true;
+}
+
+bool OverlayFileSystem::IsOverlayHandle(HANDLE hFile)
+{
+    if (NumOpenFiles == 0)
+        return false;
+
+    lock_guard lock(OpenFilesMutex);
+    return GetOpenFile(hFile) != nullptr;
+}
+
+// An overlay file has no file object to map, so this hands out a pagefile-backed copy of its contents
+bool OverlayFileSystem::CreateMapping(HANDLE hFile, LPSECURITY_ATTRIBUTES pAttributes, const wchar_t* pName, HANDLE& hMapping)
+{
+    if (NumOpenFiles == 0)
+        return false;
+
+    lock_guard lock(OpenFilesMutex);
+    OpenFile* pFile = GetOpenFile(hFile);
+    if (pFile == nullptr)
+        return false;
+
+    hMapping = nullptr;
+    if (pFile->Size == 0)
+    {
+        SetLastError(ERROR_FILE_INVALID);
+        return true;
+    }
+
+    hMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, pAttributes, PAGE_READWRITE, 0, pFile->Size, pName);
+    if (hMapping == nullptr)
+        return true;
+
+    void* pView = MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, pFile->Size);
+    if (pView == nullptr)
+    {
+        DWORD error = GetLastError();
+        CloseHandle(hMapping);
+        hMapping = nullptr;
+        SetLastError(error);
+        return true;
+    }
+
+    memcpy(pView, pFile->pData, pFile->Size);
+    UnmapViewOfFile(pView);
+    SetLastError(NO_ERROR);
+    return true;
+}
+
+bool OverlayFileSystem::Close(HANDLE hFile)
+{
+    // Most handles the hooks see aren't overlay files; skip the lock unless any are open
+    if (NumOpenFiles == 0)
+        return false;
+
+    {
+        lock_guard lock(OpenFilesMutex);
+        if (GetOpenFile(hFile) == nullptr)
+            return false;
+
+        OpenFiles.erase(hFile);
+        NumOpenFiles--;
+    }
+
+    CloseHandle(hFile);
+    return true;
+}
+
+// Turns a path inside data\ into the archive's name for it, e.g. "C:\Game\data\script.src" into "script.src"
+bool OverlayFileSystem::GetEntryName(const wchar_t* pPath, string& name)
+{
+    wchar_t fullPath[MAX_PATH];
+    DWORD length = GetFullPathNameW(pPath, MAX_PATH, fullPath, nullptr);
+    if (length == 0 || length >= MAX_PATH || length <= DataFolderPath.size() ||
+        _wcsnicmp(fullPath, DataFolderPath.c_str(), DataFolderPath.size()) != 0)
+    {
+        return false;
+    }
+
+    const wchar_t* pRelativePath = fullPath + DataFolderPath.size();
+    int relativeLength = (int)(length - DataFolderPath.size());
+    int nameLength = WideCharToMultiByte(CP_UTF8, 0, pRelativePath, relativeLength, nullptr, 0, nullptr, nullptr);
+    name.resize(nameLength);
+    WideCharToMultiByte(CP_UTF8, 0, pRelativePath, relativeLength, name.data(), nameLength, nullptr, nullptr);
+    return true;
+}
+
+bool OverlayFileSystem::Find(const wchar_t* pPath, OverlayArchive::Entry& entry)
+{
+    if (!IsActive())
+        return false;
+
+    string name;
+    return GetEntryName(pPath, name) && Archive.Find(name, entry);
+}
+
+// Finds the PNG standing in for a PGD directly in data\, which is where the engine looks for loose pictures
+bool OverlayFileSystem::FindPng(const wchar_t* pPath, string& entryName, wstring& pngPath)
+{
+    if (!PngOverrideActive)
+        return false;
+
+    lock_guard lock(PngMutex);
+    if (WaitForSingleObject(PngFolderChangeNotification, 0) == WAIT_OBJECT_0)
+    {
+        ListPngs();
+        FindNextChangeNotification(PngFolderChangeNotification);
+    }
+
+    if (PngFileNames.empty() || !GetEntryName(pPath, entryName) || entryName.size() <= 4 ||
+        entryName.find('\\') != string::npos || ToLowerAscii(entryName.substr(entryName.size() - 4)) != ".pgd")
+    {
+        return false;
+    }
+
+    auto it = PngFileNames.find(ToLowerAscii(entryName.substr(0, entryName.size() - 4)) + ".png");
+    if (it == PngFileNames.end())
+        return false;
+
+    pngPath = DataFolderPath + it->second;
+    return true;
+}
+
+// Call with OpenFilesMutex held
+OverlayFileSystem::OpenFile* OverlayFileSystem::GetOpenFile(HANDLE hFile)
+{
+    auto it = OpenFiles.find(hFile);
+    return it != OpenFiles.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Serves the files of the game's data\ folder from the overlay archive named in the config, which is mapped
+// into memory once at startup. Win32AToWAdapter's file hooks ask this class first. A file opened from the
+// overlay gets an unnamed event as its handle, so calls that don't know about the overlay (CloseHandle,
+// WaitForSingleObject) still work on it. The file APIs the hooks cover read straight from the mapping, or
+// from a copy extracted on open for compressed entries.
+// The same handles also serve PNG overrides: if data\ has X.png, a request for data\X.PGD gets the PNG transcoded
+// to a GE picture (see PgdTranscodeCache), so translated images can be tried out without rebuilding the pac files.
+class OverlayFileSystem
+{
+public:
+    static void Init();
+    static bool IsActive() { return Archive.IsOpen(); }
+
+    // Looks the path up in the overlay; returns INVALID_HANDLE_VALUE if it's not there
+    static HANDLE Open(const wchar_t* pPath);
+    static bool Contains(const wchar_t* pPath);
+
+    // These return false if the handle isn't an overlay file, in which case the caller passes the call on
+    static bool Read(HANDLE hFile, void* pBuffer, DWORD size, DWORD* pNumRead, OVERLAPPED* pOverlapped, BOOL& result);
+    static bool GetSize(HANDLE hFile, uint64_t& size);
+    static bool Seek(HANDLE hFile, int64_t distance, DWORD moveMethod, uint64_t& newPosition, BOOL& result);
+    static bool IsOverlayHandle(HANDLE hFile);
+    static bool CreateMapping(HANDLE hFile, LPSECURITY_ATTRIBUTES pAttributes, const wchar_t* pName, HANDLE& hMapping);
+    static bool Close(HANDLE hFile);
+
+private:
+    struct OpenFile
+    {
+        const uint8_t*          pData;
+        uint32_t                Size;
+        uint64_t                Position;
+        std::vector<uint8_t>    Extracted;      // Contents of a compressed entry
+    };
+
+    static void InitArchive();
+    static void InitPngOverride();
+    static void ListPngs();
+
+    static bool GetEntryName(const wchar_t* pPath, std::string& name);
+    static bool Find(const wchar_t* pPath, OverlayArchive::Entry& entry);
+    static bool FindPng(const wchar_t* pPath, std::string& entryName, std::wstring& pngPath);
+    static HANDLE OpenPng(const wchar_t* pPath);
+    static HANDLE AddOpenFile(OpenFile&& file);
+    static OpenFile* GetOpenFile(HANDLE hFile);
+
+    static inline OverlayArchive Archive{};
+    static inline const uint8_t* ArchiveView{};
+    static inline std::wstring DataFolderPath{};
+
+    static inline PgdTranscodeCache Transcoder{};
+    static inline bool PngOverrideActive = false;
+    static inline HANDLE PngFolderChangeNotification = INVALID_HANDLE_VALUE;
+    static inline std::mutex PngMutex{};
+    static inline std::map<std::string, std::wstring> PngFileNames{};      // By lower case UTF-8 name
+
+    static inline std::mutex OpenFilesMutex{};
+    static inline std::map<HANDLE, OpenFile> OpenFiles{};
+    static inline std::atomic<int> NumOpenFiles{};
+};
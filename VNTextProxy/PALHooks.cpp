@@ -129,17 +129,23 @@ namespace PALGrabCurrentText
         // Hook PAL functions related to save/choice mode for state detection and logging.
         PALStateDetection::Install(hMod);
 
-        oPalTaskGetData = (decltype(oPalTaskGetData))GetProcAddress(hMod, "PalTaskGetTaskData");
+        oPalTaskGetData = (decltype(oPalTaskGetData))GetProcAddress(hMod, HookSignatures::PalTaskGetTaskDataName);
         if (oPalTaskGetData)
         {
-            // Detect which version of PalTaskGetTaskData we have:
-            // Old SoftPAL: starts with A1 (mov eax, [addr]) - no frame, no args, text at 0x204
-            // New SoftPAL: starts with 55 (push ebp) - has frame, takes 1 arg, text at 0x1544
+            // Detect which version of PalTaskGetTaskData we have (see HookSignatures::GetPalTaskTextOffset)
             unsigned char firstByte = *(unsigned char*)oPalTaskGetData;
-            if (firstByte == 0x55) // push ebp - Yureaka style
-                textOffset = 0x1544;
+            DWORD functionRva = (DWORD)((BYTE*)oPalTaskGetData - (BYTE*)hMod);
+            DWORD cachedRva;
+            DWORD cachedTextOffset;
+            if (HookAddressCache::TryGet(hMod, HookSignatures::PalTaskTextOffsetKey, cachedRva, cachedTextOffset) && cachedRva == functionRva)
+            {
+                textOffset = cachedTextOffset;
+            }
             else
-                textOffset = 0x204;
+            {
+                textOffset = HookSignatures::GetPalTaskTextOffset(firstByte);
+                HookAddressCache::Set(hMod, HookSignatures::PalTaskTextOffsetKey, functionRva, textOffset);
+            }
             dbg_log("PalGrabCurrentText::Install: using PalTaskGetTaskData at 0x%p, firstByte=0x%02x, offset 0x%x",
                 oPalTaskGetData, firstByte, textOffset);
         }
@@ -4,20 +4,21 @@ using namespace std;
 
 vector<PE::Section> PE::GetSections(HMODULE hModule)
 {
-    IMAGE_DOS_HEADER* pDosHeader = (IMAGE_DOS_HEADER*)hModule;
-    IMAGE_NT_HEADERS* pNtHeaders = (IMAGE_NT_HEADERS*)((BYTE*)hModule + pDosHeader->e_lfanew);
-    IMAGE_SECTION_HEADER* pSectionHeaders = IMAGE_FIRST_SECTION(pNtHeaders);
+    PEImage image;
+    image.Parse((const uint8_t*)hModule, DetourGetModuleSize(hModule), PEImage::Layout::Mapped);
 
     vector<Section> sections;
-    for (int i = 0; i < pNtHeaders->FileHeader.NumberOfSections; i++)
+    sections.reserve(image.GetSectionCount());
+    for (const PEImage::Section& imageSection : image.GetSections())
     {
         Section section
         {
-            .Start = (BYTE*)hModule + pSectionHeaders[i].VirtualAddress,
-            .Size = (int)pSectionHeaders[i].SizeOfRawData,
-            .Characteristics = pSectionHeaders[i].Characteristics
+            .Start = (BYTE*)hModule + imageSection.Rva,
+            .Size = (int)imageSection.RawSize,
+            .Characteristics = imageSection.Characteristics
         };
-        memcpy(section.Name, pSectionHeaders[i].Name, 8);
+        memset(section.Name, 0, sizeof(section.Name));
+        memcpy(section.Name, imageSection.Name.data(), imageSection.Name.size());
         sections.push_back(section);
     }
     return sections;
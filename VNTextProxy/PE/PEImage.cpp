@@ -0,0 +1,514 @@
+#include "PEImage.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// Offsets and constants from winnt.h, spelled out so this file doesn't need it
+static constexpr uint16_t DosSignature = 0x5A4D;                // "MZ"
+static constexpr uint32_t NtSignature = 0x00004550;             // "PE\0\0"
+static constexpr uint16_t OptionalHeader32Magic = 0x10B;
+static constexpr uint16_t OptionalHeader64Magic = 0x20B;
+static constexpr uint32_t FileHeaderSize = 20;
+static constexpr uint32_t SectionHeaderSize = 40;
+static constexpr uint32_t ImportDescriptorSize = 20;
+static constexpr uint32_t ExportDirectorySize = 40;
+static constexpr uint32_t MaxDataDirectories = 16;
+static constexpr uint32_t RichSignature = 0x68636952;           // "Rich"
+static constexpr uint32_t DanSSignature = 0x536E6144;           // "DanS"
+
+static constexpr int ExportDirectoryIndex = 0;
+static constexpr int ImportDirectoryIndex = 1;
+static constexpr int RelocationDirectoryIndex = 5;
+
+template<typename T>
+T PEImage::ReadAt(const uint8_t* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+bool PEImage::Parse(const uint8_t* pData, size_t size, Layout layout)
+{
+    *this = PEImage();
+
+    if (size < 0x40 || ReadAt<uint16_t>(pData) != DosSignature)
+        return false;
+
+    uint32_t ntHeadersOffset = ReadAt<uint32_t>(pData + 0x3C);
+    if (ntHeadersOffset > size || size - ntHeadersOffset < 4 + FileHeaderSize + 2 ||
+        ReadAt<uint32_t>(pData + ntHeadersOffset) != NtSignature)
+    {
+        return false;
+    }
+
+    const uint8_t* pFileHeader = pData + ntHeadersOffset + 4;
+    uint16_t numSections = ReadAt<uint16_t>(pFileHeader + 2);
+    uint16_t optionalHeaderSize = ReadAt<uint16_t>(pFileHeader + 16);
+
+    uint32_t optionalHeaderOffset = ntHeadersOffset + 4 + FileHeaderSize;
+    uint32_t sectionTableOffset = optionalHeaderOffset + optionalHeaderSize;
+    if ((uint64_t)sectionTableOffset + (uint64_t)numSections * SectionHeaderSize > size)
+        return false;
+
+    const uint8_t* pOptionalHeader = pData + optionalHeaderOffset;
+    uint16_t magic = ReadAt<uint16_t>(pOptionalHeader);
+    bool is64Bit = magic == OptionalHeader64Magic;
+    if (!is64Bit && magic != OptionalHeader32Magic)
+        return false;
+
+    // The fixed part of the optional header, up to and including NumberOfRvaAndSizes
+    uint32_t fixedSize = is64Bit ? 112 : 96;
+    if (optionalHeaderSize < fixedSize)
+        return false;
+
+    _pData = pData;
+    _size = size;
+    _layout = layout;
+    _is64Bit = is64Bit;
+    _machine = ReadAt<uint16_t>(pFileHeader);
+    _timestamp = ReadAt<uint32_t>(pFileHeader + 4);
+    _entryPointRva = ReadAt<uint32_t>(pOptionalHeader + 16);
+    _imageBase = is64Bit ? ReadAt<uint64_t>(pOptionalHeader + 24) : ReadAt<uint32_t>(pOptionalHeader + 28);
+    _sizeOfImage = ReadAt<uint32_t>(pOptionalHeader + 56);
+    _sizeOfHeaders = ReadAt<uint32_t>(pOptionalHeader + 60);
+    _sectionTableOffset = sectionTableOffset;
+    _numSections = numSections;
+
+    _dataDirectoryOffset = optionalHeaderOffset + fixedSize;
+    _numDataDirectories = ReadAt<uint32_t>(pOptionalHeader + fixedSize - 4);
+    if (_numDataDirectories > MaxDataDirectories)
+        _numDataDirectories = MaxDataDirectories;
+    if (_numDataDirectories > (optionalHeaderSize - fixedSize) / 8)
+        _numDataDirectories = (optionalHeaderSize - fixedSize) / 8;
+
+    // Resolve the export tables once so lookups and iteration can index them directly
+    uint32_t exportRva;
+    uint32_t exportSize;
+    const uint8_t* pExportDirectory;
+    if (GetDataDirectory(ExportDirectoryIndex, exportRva, exportSize) &&
+        (pExportDirectory = GetPointer(exportRva, ExportDirectorySize)) != nullptr)
+    {
+        _exportDirectoryRva = exportRva;
+        _exportDirectorySize = exportSize;
+        _exportOrdinalBase = ReadAt<uint32_t>(pExportDirectory + 16);
+
+        uint32_t numFunctions = ReadAt<uint32_t>(pExportDirectory + 20);
+        uint32_t numNames = ReadAt<uint32_t>(pExportDirectory + 24);
+        if (numFunctions < 0x40000000 && numNames < 0x40000000)
+        {
+            _pExportFunctions = GetPointer(ReadAt<uint32_t>(pExportDirectory + 28), numFunctions * 4);
+            _pExportNames = GetPointer(ReadAt<uint32_t>(pExportDirectory + 32), numNames * 4);
+            _pExportNameOrdinals = GetPointer(ReadAt<uint32_t>(pExportDirectory + 36), numNames * 2);
+        }
+
+        if (_pExportFunctions != nullptr)
+            _numExportFunctions = numFunctions;
+
+        if (_pExportNames != nullptr && _pExportNameOrdinals != nullptr)
+            _numExportNames = numNames;
+    }
+
+    ParseRichHeader(ntHeadersOffset);
+    return true;
+}
+
+// The Rich header sits between the DOS stub and the PE header: "DanS", three padding dwords and the
+// (comp.id, count) pairs, all XORed with a key, followed by "Rich" and the key in plain text.
+void PEImage::ParseRichHeader(uint32_t ntHeadersOffset)
+{
+    uint32_t richOffset = 0;
+    for (uint32_t offset = (ntHeadersOffset & ~3u); offset >= 0x80 + 4; offset -= 4)
+    {
+        if (offset + 8 <= ntHeadersOffset && ReadAt<uint32_t>(_pData + offset) == RichSignature)
+        {
+            richOffset = offset;
+            break;
+        }
+    }
+
+    if (richOffset == 0)
+        return;
+
+    uint32_t key = ReadAt<uint32_t>(_pData + richOffset + 4);
+    for (uint32_t offset = richOffset - 4; offset >= 0x80; offset -= 4)
+    {
+        if ((ReadAt<uint32_t>(_pData + offset) ^ key) == DanSSignature)
+        {
+            if (offset + 16 > richOffset)
+                return;
+
+            _richKey = key;
+            _richEntriesOffset = offset + 16;
+            _richEndOffset = richOffset;
+            return;
+        }
+    }
+}
+
+bool PEImage::GetDataDirectory(int index, uint32_t& rva, uint32_t& size) const
+{
+    if (index < 0 || (uint32_t)index >= _numDataDirectories)
+        return false;
+
+    const uint8_t* pDirectory = _pData + _dataDirectoryOffset + index * 8;
+    rva = ReadAt<uint32_t>(pDirectory);
+    size = ReadAt<uint32_t>(pDirectory + 4);
+    return rva != 0 && size != 0;
+}
+
+// Maps an RVA to the buffer and reports how many bytes from there on belong to the same region
+// (the rest of the headers or of the section's raw data for files, the rest of the buffer for loaded images)
+const uint8_t* PEImage::Resolve(uint32_t rva, size_t& available) const
+{
+    available = 0;
+    if (_pData == nullptr)
+        return nullptr;
+
+    if (_layout == Layout::Mapped)
+    {
+        if (rva >= _size)
+            return nullptr;
+
+        available = _size - rva;
+        return _pData + rva;
+    }
+
+    if (rva < _sizeOfHeaders)
+    {
+        if (rva >= _size)
+            return nullptr;
+
+        available = min<size_t>(_sizeOfHeaders, _size) - rva;
+        return _pData + rva;
+    }
+
+    for (int i = 0; i < _numSections; i++)
+    {
+        const uint8_t* pHeader = _pData + _sectionTableOffset + i * SectionHeaderSize;
+        uint32_t sectionRva = ReadAt<uint32_t>(pHeader + 12);
+        uint32_t rawSize = ReadAt<uint32_t>(pHeader + 16);
+        uint32_t rawOffset = ReadAt<uint32_t>(pHeader + 20);
+        if (rva < sectionRva || rva - sectionRva >= rawSize)
+            continue;
+
+        uint64_t offset = (uint64_t)rawOffset + (rva - sectionRva);
+        if (offset >= _size)
+            return nullptr;
+
+        available = (size_t)min<uint64_t>((uint64_t)rawOffset + rawSize, _size) - (size_t)offset;
+        return _pData + offset;
+    }
+    return nullptr;
+}
+
+const uint8_t* PEImage::GetPointer(uint32_t rva, uint32_t size) const
+{
+    size_t available;
+    const uint8_t* p = Resolve(rva, available);
+    return p != nullptr && available >= size ? p : nullptr;
+}
+
+string_view PEImage::GetString(uint32_t rva) const
+{
+    size_t available;
+    const char* p = (const char*)Resolve(rva, available);
+    if (p == nullptr)
+        return {};
+
+    const char* pEnd = (const char*)memchr(p, '\0', available);
+    return pEnd != nullptr ? string_view(p, pEnd - p) : string_view();
+}
+
+PEImage::Section PEImage::GetSection(int index) const
+{
+    const uint8_t* pHeader = _pData + _sectionTableOffset + index * SectionHeaderSize;
+
+    Section section;
+    const char* pName = (const char*)pHeader;
+    section.Name = string_view(pName, strnlen(pName, 8));
+    section.VirtualSize = ReadAt<uint32_t>(pHeader + 8);
+    section.Rva = ReadAt<uint32_t>(pHeader + 12);
+    section.RawSize = ReadAt<uint32_t>(pHeader + 16);
+    section.RawOffset = ReadAt<uint32_t>(pHeader + 20);
+    section.Characteristics = ReadAt<uint32_t>(pHeader + 36);
+
+    // Loaded sections span their virtual size, file sections only their raw data
+    uint64_t start = _layout == Layout::Mapped ? section.Rva : section.RawOffset;
+    uint64_t size = _layout == Layout::Mapped ? section.VirtualSize : section.RawSize;
+    if (_layout == Layout::Mapped && size == 0)
+        size = section.RawSize;
+
+    if (start < _size)
+    {
+        section.pData = _pData + start;
+        section.DataSize = (uint32_t)min<uint64_t>(size, _size - start);
+    }
+    else
+    {
+        section.pData = nullptr;
+        section.DataSize = 0;
+    }
+    return section;
+}
+
+bool PEImage::FindSection(string_view name, Section& section) const
+{
+    for (int i = 0; i < _numSections; i++)
+    {
+        Section candidate = GetSection(i);
+        if (candidate.Name == name)
+        {
+            section = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+PEImage::Export PEImage::GetExport(uint32_t index, string_view name) const
+{
+    Export result;
+    result.Name = name;
+    result.Ordinal = _exportOrdinalBase + index;
+    result.Rva = ReadAt<uint32_t>(_pExportFunctions + index * 4);
+
+    // Addresses inside the export directory point to a forwarder string instead of code
+    if (result.Rva >= _exportDirectoryRva && result.Rva - _exportDirectoryRva < _exportDirectorySize)
+        result.Forwarder = GetString(result.Rva);
+
+    return result;
+}
+
+bool PEImage::FindExport(string_view name, Export& result) const
+{
+    uint32_t low = 0;
+    uint32_t high = _numExportNames;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        string_view midName = GetString(ReadAt<uint32_t>(_pExportNames + mid * 4));
+        int comparison = midName.compare(name);
+        if (comparison == 0)
+        {
+            uint16_t index = ReadAt<uint16_t>(_pExportNameOrdinals + mid * 2);
+            if (index >= _numExportFunctions)
+                return false;
+
+            result = GetExport(index, midName);
+            return true;
+        }
+
+        if (comparison < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return false;
+}
+
+bool PEImage::SectionCursor::Valid() const
+{
+    return _index < _pImage->_numSections;
+}
+
+PEImage::Section PEImage::SectionCursor::Current() const
+{
+    return _pImage->GetSection(_index);
+}
+
+PEImage::ImportedModuleCursor::ImportedModuleCursor(const PEImage* pImage)
+    : _pImage(pImage), _rva(0)
+{
+    uint32_t size;
+    if (pImage->GetDataDirectory(ImportDirectoryIndex, _rva, size))
+        Load();
+}
+
+// The descriptor list ends with an all-zero entry
+void PEImage::ImportedModuleCursor::Load()
+{
+    _pDescriptor = _pImage->GetPointer(_rva, ImportDescriptorSize);
+    if (_pDescriptor != nullptr && ReadAt<uint32_t>(_pDescriptor + 12) == 0 && ReadAt<uint32_t>(_pDescriptor + 16) == 0)
+        _pDescriptor = nullptr;
+}
+
+PEImage::ImportedModule PEImage::ImportedModuleCursor::Current() const
+{
+    uint32_t originalFirstThunk = ReadAt<uint32_t>(_pDescriptor);
+    uint32_t firstThunk = ReadAt<uint32_t>(_pDescriptor + 16);
+
+    ImportedModule module;
+    module.Name = _pImage->GetString(ReadAt<uint32_t>(_pDescriptor + 12));
+    module.LookupRva = originalFirstThunk != 0 ? originalFirstThunk : firstThunk;
+    module.IatRva = firstThunk;
+    return module;
+}
+
+void PEImage::ImportedModuleCursor::Next()
+{
+    _rva += ImportDescriptorSize;
+    Load();
+}
+
+PEImage::ImportedFunctionCursor::ImportedFunctionCursor(const PEImage* pImage, const ImportedModule& module)
+    : _pImage(pImage), _lookupRva(module.LookupRva), _iatRva(module.IatRva)
+{
+    Load();
+}
+
+void PEImage::ImportedFunctionCursor::Load()
+{
+    uint32_t thunkSize = _pImage->_is64Bit ? 8 : 4;
+    const uint8_t* pThunk = _pImage->GetPointer(_lookupRva, thunkSize);
+    if (pThunk == nullptr)
+        _thunk = 0;
+    else
+        _thunk = _pImage->_is64Bit ? ReadAt<uint64_t>(pThunk) : ReadAt<uint32_t>(pThunk);
+}
+
+PEImage::ImportedFunction PEImage::ImportedFunctionCursor::Current() const
+{
+    uint64_t ordinalFlag = _pImage->_is64Bit ? 0x8000000000000000 : 0x80000000;
+
+    ImportedFunction function{};
+    function.IatRva = _iatRva;
+    if (_thunk & ordinalFlag)
+    {
+        function.ByOrdinal = true;
+        function.Ordinal = (uint16_t)_thunk;
+        return function;
+    }
+
+    // Hint/name entry: a uint16 hint into the exporter's name table, then the name
+    uint32_t hintNameRva = (uint32_t)_thunk;
+    const uint8_t* pHint = _pImage->GetPointer(hintNameRva, 2);
+    if (pHint != nullptr)
+    {
+        function.Hint = ReadAt<uint16_t>(pHint);
+        function.Name = _pImage->GetString(hintNameRva + 2);
+    }
+    return function;
+}
+
+void PEImage::ImportedFunctionCursor::Next()
+{
+    uint32_t thunkSize = _pImage->_is64Bit ? 8 : 4;
+    _lookupRva += thunkSize;
+    _iatRva += thunkSize;
+    Load();
+}
+
+PEImage::ExportCursor::ExportCursor(const PEImage* pImage)
+    : _pImage(pImage)
+{
+    SkipUnused();
+}
+
+bool PEImage::ExportCursor::Valid() const
+{
+    return _index < _pImage->_numExportFunctions;
+}
+
+// Finds the export's name by its index in the ordinal table. Export tables are small enough
+// that a linear scan beats building a reverse map.
+PEImage::Export PEImage::ExportCursor::Current() const
+{
+    string_view name;
+    for (uint32_t i = 0; i < _pImage->_numExportNames; i++)
+    {
+        if (ReadAt<uint16_t>(_pImage->_pExportNameOrdinals + i * 2) == _index)
+        {
+            name = _pImage->GetString(ReadAt<uint32_t>(_pImage->_pExportNames + i * 4));
+            break;
+        }
+    }
+    return _pImage->GetExport(_index, name);
+}
+
+void PEImage::ExportCursor::Next()
+{
+    _index++;
+    SkipUnused();
+}
+
+// Ordinals without a function have an address of 0
+void PEImage::ExportCursor::SkipUnused()
+{
+    while (_index < _pImage->_numExportFunctions && ReadAt<uint32_t>(_pImage->_pExportFunctions + _index * 4) == 0)
+    {
+        _index++;
+    }
+}
+
+PEImage::RelocationCursor::RelocationCursor(const PEImage* pImage)
+    : _pImage(pImage), _blockRva(0), _remaining(0)
+{
+    if (!pImage->GetDataDirectory(RelocationDirectoryIndex, _blockRva, _remaining))
+        return;
+
+    LoadBlock();
+    SkipPadding();
+}
+
+// Each block is a page RVA and the block's size, followed by uint16 entries holding the type
+// in the top four bits and the offset into the page in the rest
+void PEImage::RelocationCursor::LoadBlock()
+{
+    _pBlock = nullptr;
+    if (_remaining < 8)
+        return;
+
+    const uint8_t* pHeader = _pImage->GetPointer(_blockRva, 8);
+    if (pHeader == nullptr)
+        return;
+
+    uint32_t blockSize = ReadAt<uint32_t>(pHeader + 4);
+    if (blockSize < 8 || blockSize > _remaining)
+        return;
+
+    _pBlock = _pImage->GetPointer(_blockRva, blockSize);
+    _blockSize = blockSize;
+    _entryOffset = 8;
+}
+
+// Moves past IMAGE_REL_BASED_ABSOLUTE entries (used to pad blocks to four bytes) and exhausted blocks
+void PEImage::RelocationCursor::SkipPadding()
+{
+    while (_pBlock != nullptr)
+    {
+        if (_entryOffset + 2 > _blockSize)
+        {
+            _blockRva += _blockSize;
+            _remaining -= _blockSize;
+            LoadBlock();
+            continue;
+        }
+
+        if ((ReadAt<uint16_t>(_pBlock + _entryOffset) >> 12) != 0)
+            return;
+
+        _entryOffset += 2;
+    }
+}
+
+PEImage::Relocation PEImage::RelocationCursor::Current() const
+{
+    uint16_t entry = ReadAt<uint16_t>(_pBlock + _entryOffset);
+    return { ReadAt<uint32_t>(_pBlock) + (entry & 0xFFF), (uint8_t)(entry >> 12) };
+}
+
+void PEImage::RelocationCursor::Next()
+{
+    _entryOffset += 2;
+    SkipPadding();
+}
+
+PEImage::RichEntry PEImage::RichEntryCursor::Current() const
+{
+    uint32_t compId = ReadAt<uint32_t>(_pImage->_pData + _offset) ^ _pImage->_richKey;
+    uint32_t count = ReadAt<uint32_t>(_pImage->_pData + _offset + 4) ^ _pImage->_richKey;
+    return { (uint16_t)(compId >> 16), (uint16_t)compId, count };
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Zero-copy reader for 32- and 64-bit PE/COFF images. Works on a file read or mapped from disk (Layout::File)
+// as well as on a module loaded in memory (Layout::Mapped). Names are string_views into the buffer and lists
+// are decoded lazily while iterating, so nothing is copied or allocated. Every read is bounds checked against
+// the buffer: a malformed image yields empty or shortened lists rather than out-of-bounds reads.
+// Standard library only.
+class PEImage
+{
+public:
+    enum class Layout
+    {
+        File,       // Sections at their PointerToRawData offsets
+        Mapped      // Sections at their RVAs, as laid out by the loader
+    };
+
+    struct Section
+    {
+        std::string_view    Name;
+        uint32_t            Rva;
+        uint32_t            VirtualSize;
+        uint32_t            RawOffset;
+        uint32_t            RawSize;
+        uint32_t            Characteristics;
+        const uint8_t*      pData;          // Section contents in the buffer, or nullptr if they lie outside it
+        uint32_t            DataSize;
+    };
+
+    struct ImportedModule
+    {
+        std::string_view    Name;
+        uint32_t            LookupRva;      // Import lookup table (OriginalFirstThunk, or FirstThunk if absent)
+        uint32_t            IatRva;         // Import address table (FirstThunk)
+    };
+
+    struct ImportedFunction
+    {
+        std::string_view    Name;           // Empty for imports by ordinal
+        uint16_t            Hint;
+        uint16_t            Ordinal;        // Only set for imports by ordinal
+        bool                ByOrdinal;
+        uint32_t            IatRva;         // The IAT slot the loader writes the function's address to
+    };
+
+    struct Export
+    {
+        std::string_view    Name;           // Empty for exports by ordinal only
+        std::string_view    Forwarder;      // "DLL.Function" for forwarded exports, otherwise empty
+        uint32_t            Ordinal;
+        uint32_t            Rva;
+    };
+
+    struct Relocation
+    {
+        uint32_t            Rva;
+        uint8_t             Type;           // IMAGE_REL_BASED_*
+    };
+
+    // One "@comp.id" record of the Rich header the MSVC linker leaves between the DOS stub and the PE header
+    struct RichEntry
+    {
+        uint16_t            ProductId;
+        uint16_t            Build;
+        uint32_t            Count;
+    };
+
+    class SectionCursor
+    {
+    public:
+        SectionCursor(const PEImage* pImage) : _pImage(pImage) {}
+        bool Valid() const;
+        Section Current() const;
+        void Next() { _index++; }
+
+    private:
+        const PEImage* _pImage;
+        int _index = 0;
+    };
+
+    class ImportedModuleCursor
+    {
+    public:
+        ImportedModuleCursor(const PEImage* pImage);
+        bool Valid() const { return _pDescriptor != nullptr; }
+        ImportedModule Current() const;
+        void Next();
+
+    private:
+        void Load();
+
+        const PEImage* _pImage;
+        uint32_t _rva;
+        const uint8_t* _pDescriptor = nullptr;
+    };
+
+    class ImportedFunctionCursor
+    {
+    public:
+        ImportedFunctionCursor(const PEImage* pImage, const ImportedModule& module);
+        bool Valid() const { return _thunk != 0; }
+        ImportedFunction Current() const;
+        void Next();
+
+    private:
+        void Load();
+
+        const PEImage* _pImage;
+        uint32_t _lookupRva;
+        uint32_t _iatRva;
+        uint64_t _thunk = 0;
+    };
+
+    class ExportCursor
+    {
+    public:
+        ExportCursor(const PEImage* pImage);
+        bool Valid() const;
+        Export Current() const;
+        void Next();
+
+    private:
+        void SkipUnused();
+
+        const PEImage* _pImage;
+        uint32_t _index = 0;
+    };
+
+    class RelocationCursor
+    {
+    public:
+        RelocationCursor(const PEImage* pImage);
+        bool Valid() const { return _pBlock != nullptr; }
+        Relocation Current() const;
+        void Next();
+
+    private:
+        void LoadBlock();
+        void SkipPadding();
+
+        const PEImage* _pImage;
+        uint32_t _blockRva;
+        uint32_t _remaining;
+        const uint8_t* _pBlock = nullptr;
+        uint32_t _blockSize = 0;
+        uint32_t _entryOffset = 0;
+    };
+
+    class RichEntryCursor
+    {
+    public:
+        RichEntryCursor(const PEImage* pImage) : _pImage(pImage), _offset(pImage->_richEntriesOffset) {}
+        bool Valid() const { return _offset + 8 <= _pImage->_richEndOffset; }
+        RichEntry Current() const;
+        void Next() { _offset += 8; }
+
+    private:
+        const PEImage* _pImage;
+        uint32_t _offset;
+    };
+
+    // Single-pass range over one of the cursors above, for use in range-based for loops
+    template<typename TCursor>
+    class Range
+    {
+    public:
+        struct Sentinel {};
+
+        class Iterator
+        {
+        public:
+            Iterator(const TCursor& cursor) : _cursor(cursor) {}
+            auto operator*() const { return _cursor.Current(); }
+            Iterator& operator++() { _cursor.Next(); return *this; }
+            bool operator!=(Sentinel) const { return _cursor.Valid(); }
+            bool operator==(Sentinel) const { return !_cursor.Valid(); }
+
+        private:
+            TCursor _cursor;
+        };
+
+        Range(const TCursor& cursor) : _cursor(cursor) {}
+        Iterator begin() const { return Iterator(_cursor); }
+        Sentinel end() const { return {}; }
+
+    private:
+        TCursor _cursor;
+    };
+
+    // Returns false if the buffer doesn't start with valid DOS and PE headers
+    bool Parse(const uint8_t* pData, size_t size, Layout layout);
+
+    bool                IsValid             () const { return _pData != nullptr; }
+    bool                Is64Bit             () const { return _is64Bit; }
+    uint16_t            GetMachine          () const { return _machine; }
+    uint32_t            GetTimestamp        () const { return _timestamp; }
+    uint64_t            GetImageBase        () const { return _imageBase; }
+    uint32_t            GetSizeOfImage      () const { return _sizeOfImage; }
+    uint32_t            GetSizeOfHeaders    () const { return _sizeOfHeaders; }
+    uint32_t            GetEntryPointRva    () const { return _entryPointRva; }
+    int                 GetSectionCount     () const { return _numSections; }
+    bool                HasRichHeader       () const { return _richEndOffset != 0; }
+
+    // Returns false if the image has no such directory (IMAGE_DIRECTORY_ENTRY_*)
+    bool                GetDataDirectory    (int index, uint32_t& rva, uint32_t& size) const;
+
+    // Returns nullptr unless all size bytes at rva are present in the buffer
+    const uint8_t*      GetPointer          (uint32_t rva, uint32_t size) const;
+
+    // Returns the NUL-terminated string at rva, or an empty view if it's missing or runs off the end of the buffer
+    std::string_view    GetString           (uint32_t rva) const;
+
+    Range<SectionCursor>            GetSections         () const { return SectionCursor(this); }
+    Range<ImportedModuleCursor>     GetImports          () const { return ImportedModuleCursor(this); }
+    Range<ExportCursor>             GetExports          () const { return ExportCursor(this); }
+    Range<RelocationCursor>         GetRelocations      () const { return RelocationCursor(this); }
+    Range<RichEntryCursor>          GetRichEntries      () const { return RichEntryCursor(this); }
+
+    // Function names are only available through the import lookup table. Loaded images whose imports
+    // have no separate lookup table (OriginalFirstThunk is 0) list their functions with empty names.
+    Range<ImportedFunctionCursor>   GetImportedFunctions(const ImportedModule& module) const { return ImportedFunctionCursor(this, module); }
+
+    bool                FindSection         (std::string_view name, Section& section) const;
+
+    // Binary search over the export name table, which the linker keeps sorted
+    bool                FindExport          (std::string_view name, Export& result) const;
+
+private:
+    const uint8_t*      Resolve             (uint32_t rva, size_t& available) const;
+    Section             GetSection          (int index) const;
+    Export              GetExport           (uint32_t index, std::string_view name) const;
+    void                ParseRichHeader     (uint32_t ntHeadersOffset);
+
+    template<typename T>
+    static T            ReadAt              (const uint8_t* p);
+
+    const uint8_t*  _pData = nullptr;
+    size_t          _size = 0;
+    Layout          _layout = Layout::File;
+
+    bool            _is64Bit = false;
+    uint16_t        _machine = 0;
+    uint32_t        _timestamp = 0;
+    uint64_t        _imageBase = 0;
+    uint32_t        _sizeOfImage = 0;
+    uint32_t        _sizeOfHeaders = 0;
+    uint32_t        _entryPointRva = 0;
+
+    uint32_t        _sectionTableOffset = 0;
+    int             _numSections = 0;
+
+    uint32_t        _dataDirectoryOffset = 0;
+    uint32_t        _numDataDirectories = 0;
+
+    uint32_t        _exportDirectoryRva = 0;
+    uint32_t        _exportDirectorySize = 0;
+    uint32_t        _exportOrdinalBase = 0;
+    uint32_t        _numExportFunctions = 0;
+    uint32_t        _numExportNames = 0;
+    const uint8_t*  _pExportFunctions = nullptr;
+    const uint8_t*  _pExportNames = nullptr;
+    const uint8_t*  _pExportNameOrdinals = nullptr;
+
+    uint32_t        _richKey = 0;
+    uint32_t        _richEntriesOffset = 0;
+    uint32_t        _richEndOffset = 0;
+};
@@ -2,41 +2,35 @@
 
 using namespace std;
 
-wstring SjisTunnelEncoding::Decode(const char* pText, int count)
+namespace
 {
-    Init();
-
-    wstring result;
-    if (pText == nullptr)
-        return result;
-
-    int i = 0;
-    while (count < 0 ? pText[i] != '\0' : i < count)
+    struct CodePage932
     {
-        BYTE highByte = pText[i++];
-        BYTE lowByte = 0;
+        static bool Decode(const char* pChar, int length, wchar_t& wc)
+        {
+            return MultiByteToWideChar(932, 0, pChar, length, &wc, 1) == 1;
+        }
 
-        if (IsSjisHighByte(highByte))
+        static int Encode(wchar_t wc, char* pBytes)
         {
-            lowByte = pText[i++];
-            if (lowByte == 0)
-                break;
-
-#if 0
-            int mappingIdx = TunnelCharToMappingIndex((WORD)((highByte << 8) | lowByte));
-            if (mappingIdx >= 0)
-            {
-                result += Mappings[mappingIdx];
-                continue;
-            }
-#endif
+            BOOL failed;
+            int length = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &wc, 1, pBytes, 2, nullptr, &failed);
+            return failed ? 0 : length;
         }
+    };
+}
 
-        int charLength = lowByte == 0 ? 1 : 2;
-        wchar_t wc;
-        MultiByteToWideChar(932, 0, pText + i - charLength, charLength, &wc, 1);
-        result += wc;
-    }
+wstring SjisTunnelEncoding::Decode(const char* pText, int count)
+{
+    if (pText == nullptr)
+        return wstring();
+
+    if (count < 0)
+        count = (int)strlen(pText);
+
+    // Every character takes at least one byte
+    wstring result(count, L'\0');
+    result.resize(Decode(pText, count, result.data(), (int)result.size()));
     return result;
 }
 
@@ -45,44 +39,23 @@ wstring SjisTunnelEncoding::Decode(const string& str)
     return Decode(str.c_str());
 }
 
-string SjisTunnelEncoding::Encode(const wchar_t* pText, int count)
+int SjisTunnelEncoding::Decode(const char* pText, int count, wchar_t* pOutput, int outputSize)
 {
     Init();
+    return SjisTunnelCodec::Decode<CodePage932>(pText, count, pOutput, outputSize, Mappings);
+}
 
-    string result;
+string SjisTunnelEncoding::Encode(const wchar_t* pText, int count)
+{
     if (pText == nullptr)
-        return result;
+        return string();
 
-    int i = 0;
-    while (count < 0 ? pText[i] != L'\0' : i < count)
-    {
-        wchar_t widechar = pText[i++];
-        char multibyte[2];
-        BOOL failed;
-        int multibyteLength = WideCharToMultiByte(932, WC_NO_BEST_FIT_CHARS, &widechar, 1, multibyte, sizeof(multibyte), nullptr, &failed);
-        if (failed || multibyte[0] >= 0xF0)
-        {
-            auto it = find(Mappings.begin(), Mappings.end(), widechar);
-            int mappingIdx;
-            if (it == Mappings.end())
-            {
-                Mappings.push_back(widechar);
-                mappingIdx = Mappings.size() - 1;
-                if (mappingIdx == 0x3B * (0x40 - sizeof(LowBytesToAvoid) - 1))
-                    throw exception("SJIS tunnel limit exceeded");
-            }
-            else
-            {
-                mappingIdx = distance(Mappings.begin(), it);
-            }
-
-            WORD tunnelChar = MappingIndexToTunnelChar(mappingIdx);
-            multibyte[0] = (char)(tunnelChar >> 8);
-            multibyte[1] = (char)(tunnelChar);
-            multibyteLength = 2;
-        }
-        result.append(multibyte, multibyteLength);
-    }
+    if (count < 0)
+        count = (int)wcslen(pText);
+
+    // Every character takes at most two bytes
+    string result(count * 2, '\0');
+    result.resize(Encode(pText, count, result.data(), (int)result.size()));
     return result;
 }
 
@@ -91,6 +64,12 @@ string SjisTunnelEncoding::Encode(const wstring& str)
     return Encode(str.c_str());
 }
 
+int SjisTunnelEncoding::Encode(const wchar_t* pText, int count, char* pOutput, int outputSize)
+{
+    Init();
+    return SjisTunnelCodec::Encode<CodePage932>(pText, count, pOutput, outputSize, Mappings);
+}
+
 void SjisTunnelEncoding::PatchGameLookupTable()
 {
     // Certain SJIS engines actually convert text to UTF16 before rendering it, but do so using an internal lookup table
@@ -100,12 +79,22 @@ void SjisTunnelEncoding::PatchGameLookupTable()
     if (Mappings.empty())
         return;
 
-    void* pImageStart = GetModuleHandle(nullptr);
+    HMODULE hGame = GetModuleHandle(nullptr);
     DWORD imageSize = DetourGetModuleSize(nullptr);
-    wchar_t* pLookupTable = (wchar_t*)MemoryUtil::FindData(pImageStart, imageSize, LookupTableSearchPattern, sizeof(LookupTableSearchPattern));
-    if (pLookupTable == nullptr)
+    DWORD patternRva;
+    DWORD unused;
+    if (!HookAddressCache::TryGet(hGame, HookSignatures::SjisLookupTableKey, patternRva, unused))
+    {
+        BYTE* pPattern = (BYTE*)MemoryUtil::FindData(hGame, imageSize, HookSignatures::SjisLookupTablePattern, sizeof(HookSignatures::SjisLookupTablePattern));
+        patternRva = pPattern != nullptr ? pPattern - (BYTE*)hGame : 0;
+        HookAddressCache::Set(hGame, HookSignatures::SjisLookupTableKey, patternRva, 0);
+    }
+
+    if (patternRva == 0)
         return;
 
+    wchar_t* pLookupTable = (wchar_t*)((BYTE*)hGame + patternRva);
+
     // The pattern we found corresponds to the first valid entries in the lookup table (0x8140, 0x8141, ...).
     // Subtract 0x8140 to get its base.
     pLookupTable -= 0x8140;
@@ -113,7 +102,7 @@ void SjisTunnelEncoding::PatchGameLookupTable()
     map<void*, MemoryUnprotector> unprotectors;
     for (int mappingIdx = 0; mappingIdx < Mappings.size(); mappingIdx++)
     {
-        WORD tunnelChar = MappingIndexToTunnelChar(mappingIdx);
+        WORD tunnelChar = SjisTunnelCodec::MappingIndexToTunnelChar(mappingIdx);
         wchar_t* pLookupEntry = &pLookupTable[tunnelChar];
 
         void* pLookupEntryPage = (void*)((DWORD)pLookupEntry & ~0xFFF);
@@ -143,44 +132,3 @@ void SjisTunnelEncoding::Init()
     fread(Mappings.data(), sizeof(wchar_t), Mappings.size(), pFile);
     fclose(pFile);
 }
-
-WORD SjisTunnelEncoding::MappingIndexToTunnelChar(int index)
-{
-    int highIdx = index / (0x40 - sizeof(LowBytesToAvoid) - 1);
-    int lowIdx = index % (0x40 - sizeof(LowBytesToAvoid) - 1);
-    BYTE highByte = highIdx < 0x1F ? 0x81 + highIdx : 0xE0 + (highIdx - 0x1F);
-    BYTE lowByte = 1 + lowIdx;
-    for (int i = 0; i < sizeof(LowBytesToAvoid); i++)
-    {
-        if (lowByte >= LowBytesToAvoid[i])
-            lowByte++;
-    }
-
-    return (WORD)((highByte << 8) | lowByte);
-}
-
-int SjisTunnelEncoding::TunnelCharToMappingIndex(WORD tunnelChar)
-{
-    BYTE highByte = (BYTE)(tunnelChar >> 8);
-    BYTE lowByte = (BYTE)tunnelChar;
-
-    if (!IsSjisHighByte(highByte) || lowByte == 0 || lowByte >= 0x40)
-        return -1;
-
-    int highIdx = highByte < 0xA0 ? highByte - 0x81 : 0x1F + (highByte - 0xE0);
-
-    int lowIdx = lowByte;
-    for (int i = sizeof(LowBytesToAvoid) - 1; i >= 0; i--)
-    {
-        if (lowIdx > LowBytesToAvoid[i])
-            lowIdx--;
-    }
-    lowIdx--;
-    
-    return highIdx * (0x40 - sizeof(LowBytesToAvoid) - 1) + lowIdx;
-}
-
-bool SjisTunnelEncoding::IsSjisHighByte(BYTE byte)
-{
-    return (byte >= 0x81 && byte < 0xA0) || (byte >= 0xE0 && byte < 0xFD);
-}
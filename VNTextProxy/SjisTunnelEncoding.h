@@ -9,21 +9,17 @@ public:
     static std::string Encode(const wchar_t* pText, int count = -1);
     static std::string Encode(const std::wstring& str);
 
+    // Convert count characters (NULs included) straight into the caller's buffer without allocating.
+    // Returns the length of the complete result; only the characters that fit in outputSize are written,
+    // and a character is never split. Pass outputSize 0 to only measure.
+    static int Decode(const char* pText, int count, wchar_t* pOutput, int outputSize);
+    static int Encode(const wchar_t* pText, int count, char* pOutput, int outputSize);
+
     static void PatchGameLookupTable();
 
 private:
     static void Init();
 
-    static WORD MappingIndexToTunnelChar(int index);
-    static int TunnelCharToMappingIndex(WORD tunnelChar);
-    static bool IsSjisHighByte(BYTE byte);
-
     static inline bool Initialized{};
     static inline std::vector<wchar_t> Mappings{};
-
-    static inline BYTE LowBytesToAvoid[] = { '\t', '\n', '\r', ' ', ',' };
-    static inline BYTE LookupTableSearchPattern[] = {
-        0x00, 0x30, 0x01, 0x30, 0x02, 0x30, 0x0C, 0xFF, 0x0E, 0xFF, 0xFB, 0x30, 0x1A, 0xFF, 0x1B, 0xFF,
-        0x1F, 0xFF, 0x01, 0xFF, 0x9B, 0x30, 0x9C, 0x30, 0xB4, 0x00, 0x40, 0xFF, 0xA8, 0x00, 0x3E, 0xFF
-    };
 };
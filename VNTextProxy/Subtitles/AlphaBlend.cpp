@@ -0,0 +1,138 @@
+#include "AlphaBlend.h"
+#include "../Util/CpuFeatures.h"
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+namespace AlphaBlend
+{
+    // round(x / 255) for 0 <= x <= 255 * 255
+    static inline uint32_t Div255(uint32_t x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    void PremultiplyRow(const uint8_t* pSrc, uint8_t* pDst, int width, int overallAlpha)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t alpha = Div255(pSrc[x * 4 + 3] * (uint32_t)overallAlpha);
+            pDst[x * 4 + 0] = (uint8_t)Div255(pSrc[x * 4 + 0] * alpha);
+            pDst[x * 4 + 1] = (uint8_t)Div255(pSrc[x * 4 + 1] * alpha);
+            pDst[x * 4 + 2] = (uint8_t)Div255(pSrc[x * 4 + 2] * alpha);
+            pDst[x * 4 + 3] = (uint8_t)alpha;
+        }
+    }
+
+    bool FindOpaqueSpan(const uint8_t* pRow, int width, int& first, int& end)
+    {
+        first = 0;
+        while (first < width && pRow[first * 4 + 3] == 0)
+            first++;
+
+        end = width;
+        while (end > first && pRow[(end - 1) * 4 + 3] == 0)
+            end--;
+
+        return first < end;
+    }
+
+    void BlendRowScalar(const uint8_t* pSrc, uint8_t* pDst, int width)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t inverseAlpha = 255 - pSrc[x * 4 + 3];
+            for (int i = 0; i < 3; i++)
+                pDst[x * 4 + i] = (uint8_t)(pSrc[x * 4 + i] + Div255(pDst[x * 4 + i] * inverseAlpha));
+        }
+    }
+
+    // 16-bit lane versions of Div255
+    static inline __m128i Div255Epu16(__m128i x)
+    {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    TARGET_AVX2 static inline __m256i Div255Epu16(__m256i x)
+    {
+        x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    }
+
+    // dst * (255 - alpha) / 255 for two pixels widened to 16 bits per channel
+    static inline __m128i ScaleByInverseAlpha(__m128i src16, __m128i dst16)
+    {
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src16, 0xFF), 0xFF);
+        __m128i inverseAlpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+        return Div255Epu16(_mm_mullo_epi16(dst16, inverseAlpha));
+    }
+
+    TARGET_AVX2 static inline __m256i ScaleByInverseAlpha(__m256i src16, __m256i dst16)
+    {
+        __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src16, 0xFF), 0xFF);
+        __m256i inverseAlpha = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+        return Div255Epu16(_mm256_mullo_epi16(dst16, inverseAlpha));
+    }
+
+    void BlendRowSse2(const uint8_t* pSrc, uint8_t* pDst, int width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i src = _mm_loadu_si128((const __m128i*)(pSrc + x * 4));
+
+            // Fully transparent pixels leave the destination unchanged
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(src, alphaMask), zero)) == 0xFFFF)
+                continue;
+
+            __m128i dst = _mm_loadu_si128((const __m128i*)(pDst + x * 4));
+            __m128i low = ScaleByInverseAlpha(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+            __m128i high = ScaleByInverseAlpha(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+            __m128i blended = _mm_adds_epu8(src, _mm_packus_epi16(low, high));
+
+            blended = _mm_or_si128(_mm_andnot_si128(alphaMask, blended), _mm_and_si128(alphaMask, dst));
+            _mm_storeu_si128((__m128i*)(pDst + x * 4), blended);
+        }
+
+        BlendRowScalar(pSrc + x * 4, pDst + x * 4, width - x);
+    }
+
+    TARGET_AVX2 void BlendRowAvx2(const uint8_t* pSrc, uint8_t* pDst, int width)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i src = _mm256_loadu_si256((const __m256i*)(pSrc + x * 4));
+
+            if (_mm256_testz_si256(src, alphaMask))
+                continue;
+
+            // unpack/pack work within 128-bit lanes, so the pixel order survives the round trip
+            __m256i dst = _mm256_loadu_si256((const __m256i*)(pDst + x * 4));
+            __m256i low = ScaleByInverseAlpha(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero));
+            __m256i high = ScaleByInverseAlpha(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero));
+            __m256i blended = _mm256_adds_epu8(src, _mm256_packus_epi16(low, high));
+
+            blended = _mm256_blendv_epi8(blended, dst, alphaMask);
+            _mm256_storeu_si256((__m256i*)(pDst + x * 4), blended);
+        }
+
+        BlendRowSse2(pSrc + x * 4, pDst + x * 4, width - x);
+    }
+
+    void BlendRow(const uint8_t* pSrc, uint8_t* pDst, int width)
+    {
+        if (CpuFeatures::HasAvx2())
+            BlendRowAvx2(pSrc, pDst, width);
+        else
+            BlendRowSse2(pSrc, pDst, width);
+    }
+}
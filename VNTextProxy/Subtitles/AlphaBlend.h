@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Compositing kernels for SubtitleRenderer. Pixels are 32bpp BGRA. Standard library and SSE2/AVX2
+// intrinsics only, so the kernels can be checked against each other off-target.
+//
+// The subtitle bitmap is converted to premultiplied alpha once (with the fade alpha folded in),
+// after which blending a pixel is  dst = src + dst * (255 - srcAlpha) / 255  per color channel.
+// Division by 255 rounds to nearest everywhere, so every implementation gives identical results.
+namespace AlphaBlend
+{
+    // Converts a row of straight-alpha pixels to premultiplied alpha, scaling alpha by overallAlpha (0-255) first
+    void PremultiplyRow(const uint8_t* pSrc, uint8_t* pDst, int width, int overallAlpha);
+
+    // Finds the range [first, end) of pixels with non-zero alpha. Returns false if the row is fully transparent.
+    bool FindOpaqueSpan(const uint8_t* pRow, int width, int& first, int& end);
+
+    // Blends a row of premultiplied pixels over pDst. The destination alpha channel is left untouched.
+    // BlendRow picks the fastest implementation the CPU supports.
+    void BlendRow(const uint8_t* pSrc, uint8_t* pDst, int width);
+    void BlendRowScalar(const uint8_t* pSrc, uint8_t* pDst, int width);
+    void BlendRowSse2(const uint8_t* pSrc, uint8_t* pDst, int width);
+    void BlendRowAvx2(const uint8_t* pSrc, uint8_t* pDst, int width);
+}
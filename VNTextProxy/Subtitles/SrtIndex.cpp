@@ -0,0 +1,248 @@
+#include "SrtIndex.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+using namespace std;
+
+namespace
+{
+    // Cursor over the buffer; every read is bounds-checked against end
+    struct Cursor
+    {
+        const char* p;
+        const char* end;
+
+        bool AtEnd() const { return p >= end; }
+
+        // Returns the current line (without its line break) and moves past it
+        string_view ReadLine()
+        {
+            const char* start = p;
+            while (p < end && *p != '\n')
+                p++;
+
+            const char* lineEnd = p;
+            if (p < end)
+                p++;
+
+            if (lineEnd > start && lineEnd[-1] == '\r')
+                lineEnd--;
+
+            return string_view(start, lineEnd - start);
+        }
+    };
+
+    bool IsBlank(string_view line)
+    {
+        for (char c : line)
+        {
+            if (c != ' ' && c != '\t')
+                return false;
+        }
+        return true;
+    }
+
+    void SkipSpaces(string_view& s)
+    {
+        while (!s.empty() && (s[0] == ' ' || s[0] == '\t'))
+            s.remove_prefix(1);
+    }
+
+    bool ParseNumber(string_view& s, int maxDigits, int& value)
+    {
+        int digits = 0;
+        value = 0;
+        while (!s.empty() && s[0] >= '0' && s[0] <= '9' && digits < maxDigits)
+        {
+            value = value * 10 + (s[0] - '0');
+            s.remove_prefix(1);
+            digits++;
+        }
+        return digits > 0;
+    }
+
+    bool Expect(string_view& s, char c)
+    {
+        if (s.empty() || s[0] != c)
+            return false;
+
+        s.remove_prefix(1);
+        return true;
+    }
+
+    // HH:MM:SS,mmm (a '.' before the milliseconds is accepted too)
+    bool ParseTimestamp(string_view& s, int& time)
+    {
+        int hours, minutes, seconds, milliseconds;
+        SkipSpaces(s);
+        if (!ParseNumber(s, 4, hours) || !Expect(s, ':') ||
+            !ParseNumber(s, 2, minutes) || !Expect(s, ':') ||
+            !ParseNumber(s, 2, seconds))
+        {
+            return false;
+        }
+
+        if (!Expect(s, ',') && !Expect(s, '.'))
+            return false;
+
+        if (!ParseNumber(s, 3, milliseconds))
+            return false;
+
+        // Up to 4 digits of hours can go past what the index stores
+        int64_t total = (((int64_t)hours * 60 + minutes) * 60 + seconds) * 1000 + milliseconds;
+        if (total > INT32_MAX)
+            return false;
+
+        time = (int)total;
+        return true;
+    }
+
+    bool ParseTimeRange(string_view s, int& start, int& end)
+    {
+        if (!ParseTimestamp(s, start))
+            return false;
+
+        SkipSpaces(s);
+        if (s.substr(0, 3) != "-->")
+            return false;
+
+        s.remove_prefix(3);
+        return ParseTimestamp(s, end);
+    }
+
+    bool IsTimeRange(string_view s)
+    {
+        int start, end;
+        return ParseTimeRange(s, start, end);
+    }
+
+    bool IsCueNumber(string_view s)
+    {
+        SkipSpaces(s);
+        int number;
+        if (!ParseNumber(s, 9, number))
+            return false;
+
+        return IsBlank(s);
+    }
+}
+
+bool SrtIndex::Parse(const char* pData, size_t size)
+{
+    Clear();
+    _pData = pData;
+
+    Cursor cursor{ pData, pData + size };
+    if (size >= 3 && (uint8_t)pData[0] == 0xEF && (uint8_t)pData[1] == 0xBB && (uint8_t)pData[2] == 0xBF)
+        cursor.p += 3;
+
+    // A line that was read ahead while skipping and still has to be looked at
+    string_view line;
+    bool pending = false;
+    while (pending || !cursor.AtEnd())
+    {
+        if (!pending)
+            line = cursor.ReadLine();
+
+        pending = false;
+        if (IsBlank(line))
+            continue;
+
+        // The cue number is optional in practice; accept a timestamp line straight away. Blank lines
+        // between the number and the timestamps are tolerated.
+        if (IsCueNumber(line))
+        {
+            line = string_view();
+            while (!cursor.AtEnd() && IsBlank(line))
+                line = cursor.ReadLine();
+
+            if (IsBlank(line))
+                break;
+
+            // A number with no cue after it: the new number starts the next cue
+            if (IsCueNumber(line))
+            {
+                pending = true;
+                continue;
+            }
+        }
+
+        int start, end;
+        if (!ParseTimeRange(line, start, end))
+        {
+            // Malformed cue: skip to the next blank line, stopping early at the timestamps of the next cue
+            while (!cursor.AtEnd())
+            {
+                line = cursor.ReadLine();
+                if (IsBlank(line))
+                    break;
+
+                if (IsTimeRange(line))
+                {
+                    pending = true;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        const char* textStart = cursor.p;
+        const char* textEnd = textStart;
+        while (!cursor.AtEnd())
+        {
+            string_view textLine = cursor.ReadLine();
+            if (IsBlank(textLine))
+                break;
+
+            textEnd = textLine.data() + textLine.size();
+        }
+
+        _startTimes.push_back(start);
+        _endTimes.push_back(end);
+        _textOffsets.push_back((uint32_t)(textStart - pData));
+        _textLengths.push_back((uint32_t)(textEnd - textStart));
+    }
+
+    SortByStartTime();
+    return !_startTimes.empty();
+}
+
+void SrtIndex::SortByStartTime()
+{
+    if (is_sorted(_startTimes.begin(), _startTimes.end()))
+        return;
+
+    vector<int> order(_startTimes.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [this](int a, int b) { return _startTimes[a] < _startTimes[b]; });
+
+    auto permute = [&order](auto& values)
+    {
+        auto sorted = values;
+        for (size_t i = 0; i < order.size(); i++)
+            sorted[i] = values[order[i]];
+
+        values.swap(sorted);
+    };
+    permute(_startTimes);
+    permute(_endTimes);
+    permute(_textOffsets);
+    permute(_textLengths);
+}
+
+void SrtIndex::Clear()
+{
+    _pData = nullptr;
+    _startTimes.clear();
+    _endTimes.clear();
+    _textOffsets.clear();
+    _textLengths.clear();
+}
+
+int SrtIndex::FindCue(int time) const
+{
+    auto it = upper_bound(_startTimes.begin(), _startTimes.end(), time);
+    return (int)(it - _startTimes.begin()) - 1;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Index over a UTF-8 SRT file held in memory. Parsing copies no text: each cue is stored as
+// start time, end time and the offset/length of its text within the original buffer, which
+// must therefore outlive the index. Standard library only.
+class SrtIndex
+{
+public:
+    // Returns false if the buffer contains no valid cue. Malformed cues are skipped.
+    bool Parse(const char* pData, size_t size);
+    void Clear();
+
+    int GetCount() const { return (int)_startTimes.size(); }
+    int GetStartTime(int index) const { return _startTimes[index]; }
+    int GetEndTime(int index) const { return _endTimes[index]; }
+
+    // Text of a cue, with its lines separated by the file's own line breaks
+    std::string_view GetText(int index) const { return std::string_view(_pData + _textOffsets[index], _textLengths[index]); }
+
+    // Index of the last cue starting at or before `time` (ms), or -1 if none has started yet.
+    // Cues are sorted by start time, so this works for arbitrary seeks.
+    int FindCue(int time) const;
+
+private:
+    void SortByStartTime();
+
+    const char* _pData = nullptr;
+    std::vector<int32_t> _startTimes;
+    std::vector<int32_t> _endTimes;
+    std::vector<uint32_t> _textOffsets;
+    std::vector<uint32_t> _textLengths;
+};
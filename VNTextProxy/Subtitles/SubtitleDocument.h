@@ -3,12 +3,18 @@
 class SubtitleDocument
 {
 public:
+    // The document indexes the resource data in place; resources stay mapped for the lifetime of the module
     void LoadFromResource(const wchar_t* type, const wchar_t* name);
-    void LoadFromStream(std::wistream& stream);
     void Unload();
 
-    std::vector<SubtitleLine> Lines;
+    int GetLineCount() const { return Index.GetCount(); }
+    int GetStartTime(int lineIdx) const { return Index.GetStartTime(lineIdx); }
+    int GetEndTime(int lineIdx) const { return Index.GetEndTime(lineIdx); }
+    std::wstring GetText(int lineIdx) const;
+
+    // Index of the line that should be showing at the given time (ms), or -1 before the first line
+    int FindLine(int time) const { return Index.FindCue(time); }
 
 private:
-    static std::wstring ReadLine(std::wistream& stream);
+    SrtIndex Index;
 };
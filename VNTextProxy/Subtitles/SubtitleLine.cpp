@@ -1,7 +0,0 @@
-#include "pch.h"
-
-SubtitleLine::SubtitleLine(int startTime, int endTime)
-{
-    StartTime = startTime;
-    EndTime = endTime;
-}
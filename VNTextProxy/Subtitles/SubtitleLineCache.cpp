@@ -0,0 +1,169 @@
+#include "SubtitleLineCache.h"
+
+using namespace std;
+
+SubtitleLineCache::~SubtitleLineCache()
+{
+    Stop();
+}
+
+void SubtitleLineCache::Start(Rasterizer rasterizer, int lineCount, int lookahead)
+{
+    Stop();
+
+    _rasterizer = move(rasterizer);
+    _lineCount = lineCount;
+    _lookahead = lookahead;
+    _currentLineIdx = -1;
+    _stopRequested = false;
+    _hits = 0;
+    _misses = 0;
+    _slots.assign(lookahead + 1, Slot());
+
+    if (lookahead > 0)
+        _worker = thread(&SubtitleLineCache::WorkerMain, this);
+}
+
+void SubtitleLineCache::Stop()
+{
+    {
+        lock_guard lock(_mutex);
+        _stopRequested = true;
+    }
+    _workAvailable.notify_all();
+
+    if (_worker.joinable())
+        _worker.join();
+
+    _slots.clear();
+    _rasterizer = nullptr;
+}
+
+const SubtitleLineCache::Line* SubtitleLineCache::GetLine(int lineIdx)
+{
+    unique_lock lock(_mutex);
+    _currentLineIdx = lineIdx;
+
+    // Right after a seek, every slot may be taken by wanted lines plus one the worker is still
+    // rendering for the old position; that one becomes evictable as soon as it finishes
+    int slotIdx = -1;
+    _lineRendered.wait(lock, [&] { return (slotIdx = FindSlot(lineIdx)) >= 0 || FindFreeSlot() >= 0; });
+
+    if (slotIdx < 0)
+    {
+        _misses++;
+        slotIdx = FindFreeSlot();
+        Render(lock, slotIdx, lineIdx);
+    }
+    else if (_slots[slotIdx].State == SlotState::Rendering)
+    {
+        // The worker is on it already; waiting is never slower than starting over
+        _misses++;
+        _lineRendered.wait(lock, [&] { return _slots[slotIdx].State != SlotState::Rendering; });
+    }
+    else
+    {
+        _hits++;
+    }
+
+    Slot& slot = _slots[slotIdx];
+    const Line* pLine = slot.State == SlotState::Ready ? &slot.Rendered : nullptr;
+
+    // Only wake the worker once the current line is done so it doesn't compete for the rasterizer
+    lock.unlock();
+    _workAvailable.notify_one();
+    return pLine;
+}
+
+void SubtitleLineCache::WorkerMain()
+{
+    unique_lock lock(_mutex);
+    while (true)
+    {
+        int lineIdx = -1;
+        int slotIdx = -1;
+        _workAvailable.wait(
+            lock,
+            [&]
+            {
+                if (_stopRequested)
+                    return true;
+
+                lineIdx = FindNextUnrenderedLine();
+                if (lineIdx < 0)
+                    return false;
+
+                slotIdx = FindFreeSlot();
+                return slotIdx >= 0;
+            }
+        );
+        if (_stopRequested)
+            break;
+
+        Render(lock, slotIdx, lineIdx);
+    }
+}
+
+// Renders into the given slot with the lock released; the slot is marked as Rendering meanwhile
+// so it's neither evicted nor picked up twice.
+bool SubtitleLineCache::Render(unique_lock<mutex>& lock, int slotIdx, int lineIdx)
+{
+    Slot& slot = _slots[slotIdx];
+    slot.LineIdx = lineIdx;
+    slot.State = SlotState::Rendering;
+    lock.unlock();
+
+    bool succeeded;
+    {
+        lock_guard rasterizerLock(_rasterizerMutex);
+        succeeded = _rasterizer(lineIdx, slot.Rendered);
+    }
+
+    lock.lock();
+    slot.State = succeeded ? SlotState::Ready : SlotState::Failed;
+    _lineRendered.notify_all();
+    return succeeded;
+}
+
+bool SubtitleLineCache::IsWanted(int lineIdx) const
+{
+    return lineIdx >= _currentLineIdx && lineIdx <= _currentLineIdx + _lookahead;
+}
+
+int SubtitleLineCache::FindSlot(int lineIdx) const
+{
+    for (int i = 0; i < (int)_slots.size(); i++)
+    {
+        if (_slots[i].LineIdx == lineIdx && _slots[i].State != SlotState::Empty)
+            return i;
+    }
+    return -1;
+}
+
+// Returns an empty slot, or else one holding a line that's no longer current or upcoming
+int SubtitleLineCache::FindFreeSlot() const
+{
+    int staleIdx = -1;
+    for (int i = 0; i < (int)_slots.size(); i++)
+    {
+        const Slot& slot = _slots[i];
+        if (slot.State == SlotState::Empty)
+            return i;
+
+        if (slot.State != SlotState::Rendering && !IsWanted(slot.LineIdx) && staleIdx < 0)
+            staleIdx = i;
+    }
+    return staleIdx;
+}
+
+int SubtitleLineCache::FindNextUnrenderedLine() const
+{
+    int first = max(_currentLineIdx, 0);
+    int last = min(_currentLineIdx + _lookahead, _lineCount - 1);
+    for (int lineIdx = first; lineIdx <= last; lineIdx++)
+    {
+        if (FindSlot(lineIdx) < 0)
+            return lineIdx;
+    }
+    return -1;
+}
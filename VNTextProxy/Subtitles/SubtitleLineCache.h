@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Renders subtitle lines ahead of time on a worker thread. Lines are identified by their index in the
+// document, which is sorted by start time, so "the next N lines" are simply the next N indices.
+// The cache holds a fixed ring of lookahead + 1 slots: the current line plus the lines after it.
+// Standard library only - the rasterizer is supplied by the caller.
+class SubtitleLineCache
+{
+public:
+    struct Line
+    {
+        int Y = 0;                      // Top of the bitmap within the subtitle area
+        int Width = 0;
+        int Height = 0;
+        std::vector<uint8_t> Pixels;    // Straight-alpha BGRA, Width * Height * 4 bytes
+    };
+
+    // Renders line lineIdx into line, reusing its buffers. Returns false if the line couldn't be rendered.
+    // Calls are serialized, so the rasterizer may share state between lines.
+    using Rasterizer = std::function<bool(int lineIdx, Line& line)>;
+
+    SubtitleLineCache() = default;
+    SubtitleLineCache(const SubtitleLineCache&) = delete;
+    SubtitleLineCache& operator=(const SubtitleLineCache&) = delete;
+    ~SubtitleLineCache();
+
+    // A lookahead of 0 starts no worker; every line is then rendered by GetLine.
+    void Start(Rasterizer rasterizer, int lineCount, int lookahead);
+    void Stop();
+
+    // Makes lineIdx the current line and returns it, rendering it on the calling thread if the worker
+    // hasn't got to it yet. Returns nullptr if rendering failed. The result stays valid until the
+    // next call to GetLine or Stop.
+    const Line* GetLine(int lineIdx);
+
+    // Number of GetLine calls that found their line already rendered, and those that had to wait or render it.
+    // Safe to call from any thread.
+    int GetHits() const { return _hits; }
+    int GetMisses() const { return _misses; }
+
+private:
+    enum class SlotState
+    {
+        Empty,
+        Rendering,
+        Ready,
+        Failed
+    };
+
+    struct Slot
+    {
+        int LineIdx = -1;
+        SlotState State = SlotState::Empty;
+        Line Rendered;
+    };
+
+    void WorkerMain();
+    bool IsWanted(int lineIdx) const;
+    int FindSlot(int lineIdx) const;
+    int FindFreeSlot() const;
+    int FindNextUnrenderedLine() const;
+    bool Render(std::unique_lock<std::mutex>& lock, int slotIdx, int lineIdx);
+
+    Rasterizer _rasterizer;
+    std::vector<Slot> _slots;
+    int _lineCount = 0;
+    int _lookahead = 0;
+    int _currentLineIdx = -1;
+    bool _stopRequested = false;
+    std::atomic<int> _hits = 0;
+    std::atomic<int> _misses = 0;
+
+    std::mutex _mutex;
+    std::mutex _rasterizerMutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _lineRendered;
+    std::thread _worker;
+};
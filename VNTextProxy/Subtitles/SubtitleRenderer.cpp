@@ -1,5 +1,7 @@
 #include "pch.h"
 
+#include "Util/Logger.h"
+
 using namespace std;
 
 constexpr int SubtitleAreaY = 50;
@@ -27,6 +29,17 @@ void SubtitleRenderer::PlayFromResource(const wchar_t* type, const wchar_t* name
         Stop();
 
     Document.LoadFromResource(type, name);
+
+    // The font is picked up once per movie so the rasterizer thread never reads state the game thread writes
+    if (Initializer.FontCollection == nullptr)
+    {
+        Initializer.FontCollection = new Gdiplus::PrivateFontCollection();
+        if (!Proportionalizer::CustomFontFilePath.empty())
+            Initializer.FontCollection->AddFontFile(Proportionalizer::CustomFontFilePath.c_str());
+    }
+    FontName = Proportionalizer::LastFontName;
+
+    LineCache.Start(RasterizeLine, Document.GetLineCount(), RuntimeConfig::SubtitleLookahead());
     Playing = true;
     StartTime = GetTime();
     CurrentLineIdx = -1;
@@ -40,8 +53,10 @@ void SubtitleRenderer::Stop()
     Playing = false;
     StartTime = 0;
     CurrentLineIdx = -1;
+    ReleaseCurrentLine();
+    proxy_log(LogCategory::TEXT, "Subtitles: %d lines ready in time, %d rendered late", LineCache.GetHits(), LineCache.GetMisses());
+    LineCache.Stop();
     Document.Unload();
-    DeleteCurrentLineBitmap();
 }
 
 void SubtitleRenderer::Render(BYTE* pScreenBuffer, int screenWidth)
@@ -51,79 +66,90 @@ void SubtitleRenderer::Render(BYTE* pScreenBuffer, int screenWidth)
 
     DWORD time = GetTime() - StartTime;
     UpdateCurrentLine(time);
-    if (CurrentLineIdx < 0)
+    if (CurrentLine == nullptr)
         return;
 
-    SubtitleLine& line = Document.Lines[CurrentLineIdx];
+    DWORD lineStartTime = Document.GetStartTime(CurrentLineIdx);
+    DWORD lineEndTime = Document.GetEndTime(CurrentLineIdx);
     int overallAlpha;
-    if (time < line.StartTime + SubtitleFadeDuration)
-        overallAlpha = (time - line.StartTime) * 255 / SubtitleFadeDuration;
-    else if (time < line.EndTime - SubtitleFadeDuration)
+    if (time < lineStartTime + SubtitleFadeDuration)
+        overallAlpha = (time - lineStartTime) * 255 / SubtitleFadeDuration;
+    else if (time < lineEndTime - SubtitleFadeDuration)
         overallAlpha = 255;
-    else if (time < line.EndTime)
-        overallAlpha = (line.EndTime - time) * 255 / SubtitleFadeDuration;
+    else if (time < lineEndTime)
+        overallAlpha = (lineEndTime - time) * 255 / SubtitleFadeDuration;
     else
         return;
 
-    int boxX = (screenWidth - (int)CurrentLineBoundingBox.Width) / 2;
-    int boxY = SubtitleAreaY + (int)CurrentLineBoundingBox.Y;
-    int boxWidth = (int)CurrentLineBoundingBox.Width;
-    int boxHeight = (int)CurrentLineBoundingBox.Height;
+    if (overallAlpha != PremultipliedAlpha)
+        PremultiplyCurrentLine(overallAlpha);
+
+    int boxX = (screenWidth - CurrentLine->Width) / 2;
+    int boxY = SubtitleAreaY + CurrentLine->Y;
+    int boxWidth = CurrentLine->Width;
     BYTE* pScreenBufferRow = pScreenBuffer + ((boxY * screenWidth) + boxX) * 4;
-    BYTE* pBitmapRow = (BYTE*)CurrentLineBitmapData.Scan0 + (int)CurrentLineBoundingBox.Y * CurrentLineBitmapData.Stride + (int)CurrentLineBoundingBox.X * 4;
-    for (int y = 0; y < boxHeight; y++)
+    const BYTE* pLineRow = PremultipliedLine.data();
+    for (const RowSpan& span : PremultipliedRowSpans)
     {
-        for (int x = 0; x < boxWidth; x++)
-        {
-            int pixelAlpha = pBitmapRow[x * 4 + 3] * overallAlpha / 255;
-            for (int i = 0; i < 3; i++)
-            {
-                pScreenBufferRow[x * 4 + i] = (pScreenBufferRow[x * 4 + i] * (255 - pixelAlpha) + pBitmapRow[x * 4 + i] * pixelAlpha) / 255;
-            }
-        }
+        if (span.First < span.End)
+            AlphaBlend::BlendRow(pLineRow + span.First * 4, pScreenBufferRow + span.First * 4, span.End - span.First);
+
         pScreenBufferRow += screenWidth * 4;
-        pBitmapRow += CurrentLineBitmapData.Stride;
+        pLineRow += boxWidth * 4;
     }
 }
 
-void SubtitleRenderer::UpdateCurrentLine(DWORD time)
+void SubtitleRenderer::PremultiplyCurrentLine(int overallAlpha)
 {
-    if (time >= Document.Lines.back().EndTime)
+    int boxWidth = CurrentLine->Width;
+    int boxHeight = CurrentLine->Height;
+    PremultipliedLine.resize(boxWidth * boxHeight * 4);
+    PremultipliedRowSpans.resize(boxHeight);
+
+    const BYTE* pBitmapRow = CurrentLine->Pixels.data();
+    BYTE* pLineRow = PremultipliedLine.data();
+    for (int y = 0; y < boxHeight; y++)
     {
-        Stop();
-        return;
+        AlphaBlend::PremultiplyRow(pBitmapRow, pLineRow, boxWidth, overallAlpha);
+
+        RowSpan& span = PremultipliedRowSpans[y];
+        if (!AlphaBlend::FindOpaqueSpan(pLineRow, boxWidth, span.First, span.End))
+            span.First = span.End = 0;
+
+        pBitmapRow += boxWidth * 4;
+        pLineRow += boxWidth * 4;
     }
 
-    bool lineChanged = false;
-    while (CurrentLineIdx + 1 < Document.Lines.size() && Document.Lines[CurrentLineIdx + 1].StartTime <= time)
+    PremultipliedAlpha = overallAlpha;
+}
+
+void SubtitleRenderer::UpdateCurrentLine(DWORD time)
+{
+    int lineCount = Document.GetLineCount();
+    if (lineCount == 0 || time >= (DWORD)Document.GetEndTime(lineCount - 1))
     {
-        CurrentLineIdx++;
-        lineChanged = true;
+        Stop();
+        return;
     }
 
-    if (!lineChanged)
+    int lineIdx = Document.FindLine(time);
+    if (lineIdx == CurrentLineIdx)
         return;
 
-    CreateCurrentLineBitmap();
+    ReleaseCurrentLine();
+    CurrentLineIdx = lineIdx;
+    if (CurrentLineIdx >= 0)
+        CurrentLine = LineCache.GetLine(CurrentLineIdx);
 }
 
-void SubtitleRenderer::CreateCurrentLineBitmap()
+// Runs on the line cache's worker thread (or the render thread if the worker fell behind)
+bool SubtitleRenderer::RasterizeLine(int lineIdx, SubtitleLineCache::Line& line)
 {
-    if (CurrentLineBitmap != nullptr)
-        DeleteCurrentLineBitmap();
-
-    if (Initializer.FontCollection == nullptr)
-    {
-        Initializer.FontCollection = new Gdiplus::PrivateFontCollection();
-        if (!Proportionalizer::CustomFontFilePath.empty())
-            Initializer.FontCollection->AddFontFile(Proportionalizer::CustomFontFilePath.c_str());
-    }
-
-    CurrentLineBitmap = new Gdiplus::Bitmap(SubtitleAreaWidth, SubtitleAreaHeight, PixelFormat32bppARGB);
+    Gdiplus::Bitmap bitmap(SubtitleAreaWidth, SubtitleAreaHeight, PixelFormat32bppARGB);
 
-    Gdiplus::Graphics graphics(CurrentLineBitmap);
+    Gdiplus::Graphics graphics(&bitmap);
     Gdiplus::Font font(
-        Proportionalizer::LastFontName.c_str(),
+        FontName.c_str(),
         24,
         Gdiplus::FontStyleRegular,
         Gdiplus::UnitPixel,
@@ -136,27 +162,49 @@ void SubtitleRenderer::CreateCurrentLineBitmap()
     Gdiplus::SolidBrush backgroundBrush(Gdiplus::Color(150, 0, 0, 0));
     Gdiplus::SolidBrush textBrush(Gdiplus::Color(255, 255, 255, 255));
 
-    wstring& text = Document.Lines[CurrentLineIdx].Text;
+    wstring text = Document.GetText(lineIdx);
 
-    graphics.MeasureString(text.c_str(), -1, &font, layoutRect, &format, &CurrentLineBoundingBox);
-    CurrentLineBoundingBox.Inflate(3, 3);
-    graphics.FillRectangle(&backgroundBrush, CurrentLineBoundingBox);
+    Gdiplus::RectF boundingBox;
+    graphics.MeasureString(text.c_str(), -1, &font, layoutRect, &format, &boundingBox);
+    boundingBox.Inflate(3, 3);
+    graphics.FillRectangle(&backgroundBrush, boundingBox);
 
     graphics.SetTextRenderingHint(Gdiplus::TextRenderingHintAntiAlias);
     graphics.DrawString(text.c_str(), -1, &font, layoutRect, &format, &textBrush);
+    graphics.Flush(Gdiplus::FlushIntentionSync);
+
+    // Keep only the bounding box, clipped to the subtitle area
+    int left = max((int)boundingBox.X, 0);
+    int top = max((int)boundingBox.Y, 0);
+    int right = min((int)boundingBox.X + (int)boundingBox.Width, SubtitleAreaWidth);
+    int bottom = min((int)boundingBox.Y + (int)boundingBox.Height, SubtitleAreaHeight);
+    if (right <= left || bottom <= top)
+        return false;
+
+    Gdiplus::BitmapData bitmapData;
+    Gdiplus::Rect lockRect(left, top, right - left, bottom - top);
+    if (bitmap.LockBits(&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppARGB, &bitmapData) != Gdiplus::Ok)
+        return false;
+
+    line.Y = top;
+    line.Width = right - left;
+    line.Height = bottom - top;
+    line.Pixels.resize(line.Width * line.Height * 4);
+    for (int y = 0; y < line.Height; y++)
+    {
+        memcpy(line.Pixels.data() + y * line.Width * 4, (BYTE*)bitmapData.Scan0 + y * bitmapData.Stride, line.Width * 4);
+    }
 
-    Gdiplus::Rect lockRect(0, 0, SubtitleAreaWidth, SubtitleAreaHeight);
-    CurrentLineBitmap->LockBits(&lockRect, Gdiplus::ImageLockModeRead, PixelFormat32bppARGB, &CurrentLineBitmapData);
+    bitmap.UnlockBits(&bitmapData);
+    return true;
 }
 
-void SubtitleRenderer::DeleteCurrentLineBitmap()
+void SubtitleRenderer::ReleaseCurrentLine()
 {
-    if (CurrentLineBitmap == nullptr)
-        return;
-
-    CurrentLineBitmap->UnlockBits(&CurrentLineBitmapData);
-    delete CurrentLineBitmap;
-    CurrentLineBitmap = nullptr;
+    CurrentLine = nullptr;
+    PremultipliedLine.clear();
+    PremultipliedRowSpans.clear();
+    PremultipliedAlpha = -1;
 }
 
 DWORD SubtitleRenderer::GetTime()
@@ -25,15 +25,29 @@ private:
     static inline GdiPlusInitializer Initializer{};
 
     static void UpdateCurrentLine(DWORD time);
-    static void CreateCurrentLineBitmap();
-    static void DeleteCurrentLineBitmap();
-    
+    static bool RasterizeLine(int lineIdx, SubtitleLineCache::Line& line);
+    static void ReleaseCurrentLine();
+    static void PremultiplyCurrentLine(int overallAlpha);
+
 
     static inline bool Playing = false;
     static inline DWORD StartTime = 0;
     static inline SubtitleDocument Document{};
+    static inline std::wstring FontName{};
     static inline int CurrentLineIdx = -1;
-    static inline Gdiplus::Bitmap* CurrentLineBitmap = nullptr;
-    static inline Gdiplus::BitmapData CurrentLineBitmapData{};
-    static inline Gdiplus::RectF CurrentLineBoundingBox{};
+
+    // Lines are rasterized ahead of time on the cache's worker thread; CurrentLine points into the cache
+    static inline SubtitleLineCache LineCache{};
+    static inline const SubtitleLineCache::Line* CurrentLine = nullptr;
+
+    // The current line in premultiplied alpha with the fade alpha applied,
+    // plus the non-transparent span of each row. Rebuilt only when the line or fade alpha changes.
+    struct RowSpan
+    {
+        int First;
+        int End;
+    };
+    static inline std::vector<BYTE> PremultipliedLine{};
+    static inline std::vector<RowSpan> PremultipliedRowSpans{};
+    static inline int PremultipliedAlpha = -1;
 };
@@ -0,0 +1,411 @@
+// FrameReplay: offline benchmark for the dx11 present pipeline.
+//
+// Replays a frame sequence recorded by the proxy (frameCaptureFile in VNTranslationToolsConstants.json)
+// through a CPU implementation of a scaler, reporting throughput and, optionally, PSNR against a golden
+// sequence. Golden sequences are ordinary frame sequences holding the scaled output of each frame and
+// are produced with --write-golden, so a change to a scaler can be compared against the previous version.
+//
+// Build (Windows or Linux):
+//   g++ -O2 -std=c++17 -o FrameReplay FrameReplay.cpp ../../Capture/FrameSequence.cpp ../../Util/ResampleKernel.cpp
+//
+// Usage:
+//   FrameReplay <capture.vnfs> [--scaler bicubic|lanczos|bilinear|nearest] [--repeat N]
+//               [--golden golden.vnfs] [--write-golden golden.vnfs]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../Capture/FrameSequence.h"
+#include "../../Util/ResampleKernel.h"
+
+using namespace std;
+
+// A scaler backend resizes a tightly packed BGRA image. New backends only need to implement Scale().
+class Scaler
+{
+public:
+    virtual ~Scaler() = default;
+    virtual const char* Name() const = 0;
+    virtual void Scale(const uint8_t* pSrc, int srcWidth, int srcHeight, uint8_t* pDst, int dstWidth, int dstHeight) = 0;
+};
+
+class NearestScaler : public Scaler
+{
+public:
+    const char* Name() const override { return "nearest"; }
+
+    void Scale(const uint8_t* pSrc, int srcWidth, int srcHeight, uint8_t* pDst, int dstWidth, int dstHeight) override
+    {
+        for (int y = 0; y < dstHeight; y++)
+        {
+            int sy = min((int)((y + 0.5) * srcHeight / dstHeight), srcHeight - 1);
+            for (int x = 0; x < dstWidth; x++)
+            {
+                int sx = min((int)((x + 0.5) * srcWidth / dstWidth), srcWidth - 1);
+                memcpy(pDst + ((size_t)y * dstWidth + x) * 4, pSrc + ((size_t)sy * srcWidth + sx) * 4, 4);
+            }
+        }
+    }
+};
+
+// Separable resampler: precomputes the taps for every destination row and column once per size,
+// then filters horizontally into a float buffer and vertically into the output.
+class SeparableScaler : public Scaler
+{
+public:
+    void Scale(const uint8_t* pSrc, int srcWidth, int srcHeight, uint8_t* pDst, int dstWidth, int dstHeight) override
+    {
+        if (srcWidth != _srcWidth || srcHeight != _srcHeight || dstWidth != _dstWidth || dstHeight != _dstHeight)
+        {
+            BuildTaps(srcWidth, dstWidth, _columnTaps);
+            BuildTaps(srcHeight, dstHeight, _rowTaps);
+            _srcWidth = srcWidth;
+            _srcHeight = srcHeight;
+            _dstWidth = dstWidth;
+            _dstHeight = dstHeight;
+        }
+
+        int radius = TapCount();
+        _horizontal.resize((size_t)srcHeight * dstWidth * 4);
+        for (int y = 0; y < srcHeight; y++)
+        {
+            const uint8_t* pRow = pSrc + (size_t)y * srcWidth * 4;
+            float* pOut = _horizontal.data() + (size_t)y * dstWidth * 4;
+            for (int x = 0; x < dstWidth; x++)
+            {
+                const Tap* pTaps = &_columnTaps[(size_t)x * radius];
+                float b = 0, g = 0, r = 0, a = 0;
+                for (int i = 0; i < radius; i++)
+                {
+                    const uint8_t* pPixel = pRow + pTaps[i].Index * 4;
+                    b += pPixel[0] * pTaps[i].Weight;
+                    g += pPixel[1] * pTaps[i].Weight;
+                    r += pPixel[2] * pTaps[i].Weight;
+                    a += pPixel[3] * pTaps[i].Weight;
+                }
+                pOut[x * 4 + 0] = b;
+                pOut[x * 4 + 1] = g;
+                pOut[x * 4 + 2] = r;
+                pOut[x * 4 + 3] = a;
+            }
+        }
+
+        for (int y = 0; y < dstHeight; y++)
+        {
+            const Tap* pTaps = &_rowTaps[(size_t)y * radius];
+            uint8_t* pOut = pDst + (size_t)y * dstWidth * 4;
+            for (int x = 0; x < dstWidth * 4; x++)
+            {
+                float sum = 0;
+                for (int i = 0; i < radius; i++)
+                    sum += _horizontal[((size_t)pTaps[i].Index * dstWidth * 4) + x] * pTaps[i].Weight;
+
+                pOut[x] = (uint8_t)clamp((int)lrintf(sum), 0, 255);
+            }
+        }
+    }
+
+protected:
+    struct Tap
+    {
+        int Index;
+        float Weight;
+    };
+
+    virtual int TapCount() const = 0;
+
+    // Fills TapCount() taps for an output sample at source position srcPos (in texel units, texel centers at n + 0.5)
+    virtual void ComputeTaps(float srcPos, int srcSize, Tap* pTaps) const = 0;
+
+private:
+    void BuildTaps(int srcSize, int dstSize, vector<Tap>& taps) const
+    {
+        taps.resize((size_t)dstSize * TapCount());
+        for (int i = 0; i < dstSize; i++)
+        {
+            // Same mapping as the pixel shaders: destination pixel center -> normalized texcoord -> source texels
+            float srcPos = (i + 0.5f) * srcSize / dstSize;
+            ComputeTaps(srcPos, srcSize, &taps[(size_t)i * TapCount()]);
+        }
+    }
+
+    int _srcWidth = 0;
+    int _srcHeight = 0;
+    int _dstWidth = 0;
+    int _dstHeight = 0;
+    vector<Tap> _columnTaps;
+    vector<Tap> _rowTaps;
+    vector<float> _horizontal;
+};
+
+class BilinearScaler : public SeparableScaler
+{
+public:
+    const char* Name() const override { return "bilinear"; }
+
+protected:
+    int TapCount() const override { return 2; }
+
+    void ComputeTaps(float srcPos, int srcSize, Tap* pTaps) const override
+    {
+        float texel = srcPos - 0.5f;
+        float base = floorf(texel);
+        float frac = texel - base;
+        pTaps[0] = { clamp((int)base, 0, srcSize - 1), 1.0f - frac };
+        pTaps[1] = { clamp((int)base + 1, 0, srcSize - 1), frac };
+    }
+};
+
+// Uses the same kernel weights as the DX9 scaler and g_BicubicShader (ResampleKernel)
+class KernelScaler : public SeparableScaler
+{
+public:
+    explicit KernelScaler(ResampleKernel::Filter filter)
+        : _filter(filter)
+    {
+    }
+
+    const char* Name() const override { return ResampleKernel::GetName(_filter); }
+
+protected:
+    int TapCount() const override { return ResampleKernel::TapCount(_filter); }
+
+    void ComputeTaps(float srcPos, int srcSize, Tap* pTaps) const override
+    {
+        float texel = srcPos - 0.5f;
+        float base = floorf(texel);
+        float weights[ResampleKernel::MaxTaps];
+        ResampleKernel::ComputeWeights(_filter, texel - base, weights);
+
+        int first = (int)base - ResampleKernel::FirstTapOffset(_filter);
+        for (int i = 0; i < TapCount(); i++)
+            pTaps[i] = { clamp(first + i, 0, srcSize - 1), weights[i] };
+    }
+
+private:
+    ResampleKernel::Filter _filter;
+};
+
+static unique_ptr<Scaler> CreateScaler(const string& name)
+{
+    ResampleKernel::Filter filter;
+    if (ResampleKernel::TryParse(name, filter))
+        return make_unique<KernelScaler>(filter);
+
+    if (name == "bilinear")
+        return make_unique<BilinearScaler>();
+
+    if (name == "nearest")
+        return make_unique<NearestScaler>();
+
+    return nullptr;
+}
+
+// PSNR over the color channels; alpha is ignored since the swapchain discards it
+static double ComputePsnr(const vector<uint8_t>& a, const vector<uint8_t>& b)
+{
+    double sumSquares = 0;
+    size_t samples = 0;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            double diff = (double)a[i + c] - b[i + c];
+            sumSquares += diff * diff;
+        }
+        samples += 3;
+    }
+
+    if (sumSquares == 0)
+        return INFINITY;
+
+    double mse = sumSquares / samples;
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+static const char* ModeName(FrameSequence::ScaleMode mode)
+{
+    switch (mode)
+    {
+        case FrameSequence::ScaleMode::Windowed: return "windowed";
+        case FrameSequence::ScaleMode::Bicubic: return "bicubic";
+        case FrameSequence::ScaleMode::CuNNy: return "cunny";
+        default: return "unknown";
+    }
+}
+
+static void PrintUsage()
+{
+    printf("Usage: FrameReplay <capture.vnfs> [--scaler bicubic|lanczos|bilinear|nearest] [--repeat N]\n");
+    printf("                   [--golden golden.vnfs] [--write-golden golden.vnfs]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    string capturePath = argv[1];
+    string scalerName = "bicubic";
+    string goldenPath;
+    string writeGoldenPath;
+    int repeat = 1;
+
+    for (int i = 2; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--scaler" && i + 1 < argc)
+            scalerName = argv[++i];
+        else if (arg == "--golden" && i + 1 < argc)
+            goldenPath = argv[++i];
+        else if (arg == "--write-golden" && i + 1 < argc)
+            writeGoldenPath = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = max(1, atoi(argv[++i]));
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    unique_ptr<Scaler> pScaler = CreateScaler(scalerName);
+    if (!pScaler)
+    {
+        fprintf(stderr, "Unknown scaler: %s\n", scalerName.c_str());
+        return 1;
+    }
+
+    FrameSequence::Reader reader;
+    if (!reader.Open(capturePath))
+    {
+        fprintf(stderr, "Failed to open frame sequence: %s\n", capturePath.c_str());
+        return 1;
+    }
+
+    FrameSequence::Reader golden;
+    if (!goldenPath.empty() && !golden.Open(goldenPath))
+    {
+        fprintf(stderr, "Failed to open golden sequence: %s\n", goldenPath.c_str());
+        return 1;
+    }
+
+    FrameSequence::Writer goldenWriter;
+    if (!writeGoldenPath.empty() && !goldenWriter.Open(writeGoldenPath, true))
+    {
+        fprintf(stderr, "Failed to create golden sequence: %s\n", writeGoldenPath.c_str());
+        return 1;
+    }
+
+    FrameSequence::FrameHeader header;
+    vector<uint8_t> source;
+    vector<uint8_t> scaled;
+    FrameSequence::FrameHeader goldenHeader;
+    vector<uint8_t> goldenPixels;
+
+    int frameCount = 0;
+    int modeCounts[3] = {};
+    double scaleSeconds = 0;
+    double outputPixels = 0;
+    double psnrSum = 0;
+    double psnrMin = INFINITY;
+    int psnrFrames = 0;
+    int identicalFrames = 0;
+
+    FrameSequence::ReadResult result;
+    while ((result = reader.ReadFrame(header, source)) == FrameSequence::ReadResult::Frame)
+    {
+        int dstWidth = header.ScaledWidth;
+        int dstHeight = header.ScaledHeight;
+        scaled.resize((size_t)dstWidth * dstHeight * 4);
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+            pScaler->Scale(source.data(), header.Width, header.Height, scaled.data(), dstWidth, dstHeight);
+
+        scaleSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        outputPixels += (double)dstWidth * dstHeight * repeat;
+
+        if ((size_t)header.Mode < 3)
+            modeCounts[(size_t)header.Mode]++;
+
+        if (goldenWriter.IsOpen())
+        {
+            FrameSequence::FrameHeader outHeader = header;
+            outHeader.Width = (uint16_t)dstWidth;
+            outHeader.Height = (uint16_t)dstHeight;
+            goldenWriter.WriteFrame(outHeader, scaled.data());
+        }
+
+        if (!goldenPath.empty())
+        {
+            if (golden.ReadFrame(goldenHeader, goldenPixels) != FrameSequence::ReadResult::Frame ||
+                goldenHeader.Width != dstWidth || goldenHeader.Height != dstHeight)
+            {
+                fprintf(stderr, "Golden sequence doesn't match capture at frame %u\n", header.FrameIndex);
+                return 1;
+            }
+
+            double psnr = ComputePsnr(scaled, goldenPixels);
+            if (isinf(psnr))
+            {
+                identicalFrames++;
+            }
+            else
+            {
+                psnrSum += psnr;
+                psnrFrames++;
+            }
+            psnrMin = min(psnrMin, psnr);
+        }
+
+        frameCount++;
+    }
+
+    // A damaged capture would otherwise report results for only the frames before the damage
+    if (result == FrameSequence::ReadResult::Error)
+    {
+        fprintf(stderr, "Corrupt or truncated frame after %d frames in %s\n", frameCount, capturePath.c_str());
+        return 1;
+    }
+
+    if (frameCount == 0)
+    {
+        fprintf(stderr, "No frames in %s\n", capturePath.c_str());
+        return 1;
+    }
+
+    printf("Scaler:        %s\n", pScaler->Name());
+    printf("Frames:        %d (%d windowed, %d bicubic, %d cunny at capture time)\n",
+        frameCount, modeCounts[0], modeCounts[1], modeCounts[2]);
+    printf("Last frame:    %ux%u -> %ux%u at (%d, %d) on %ux%u, captured as %s\n",
+        header.Width, header.Height, header.ScaledWidth, header.ScaledHeight,
+        header.OffsetX, header.OffsetY, header.ScreenWidth, header.ScreenHeight, ModeName(header.Mode));
+    printf("Scale time:    %.1f ms total, %.3f ms/frame\n",
+        scaleSeconds * 1000.0, scaleSeconds * 1000.0 / ((double)frameCount * repeat));
+    printf("Throughput:    %.1f fps, %.1f MPixel/s\n",
+        frameCount * repeat / scaleSeconds, outputPixels / scaleSeconds / 1e6);
+
+    if (!goldenPath.empty())
+    {
+        if (psnrFrames == 0)
+            printf("PSNR:          all %d frames identical to golden\n", identicalFrames);
+        else
+            printf("PSNR:          %.2f dB average, %.2f dB min (%d frames identical)\n",
+                psnrSum / psnrFrames, psnrMin, identicalFrames);
+    }
+
+    if (goldenWriter.IsOpen())
+        printf("Golden:        wrote %s (%llu bytes)\n", writeGoldenPath.c_str(), (unsigned long long)goldenWriter.GetBytesWritten());
+
+    return 0;
+}
@@ -0,0 +1 @@
+g++ -o FrameReplay.exe FrameReplay.cpp ../../Capture/FrameSequence.cpp ../../Util/ResampleKernel.cpp -O2 -std=c++17 -Wall
@@ -0,0 +1,354 @@
+// HookPrecompute: offline PE analysis for the proxy's hooks.
+//
+// "dump" lists the headers, sections, imports, exports, relocations and Rich header of an executable or DLL.
+// "precompute" runs the proxy's module searches (SJIS lookup table, PalTaskGetTaskData variant, RTTI vtables)
+// on the files on disk and writes the results to VNTextProxy.addresses, the HookAddressCache file the proxy
+// loads at startup, so even the first launch can skip the searches. Entries are validated by the proxy like
+// the ones it records itself, so a cache built for another version of the game is simply ignored.
+//
+// Build (Windows or Linux):
+//   g++ -O2 -std=c++17 -o HookPrecompute HookPrecompute.cpp ../../PE/PEImage.cpp ../../Util/AddressCache.cpp
+//       ../../Util/SignatureScanner.cpp ../../Util/CpuFeatures.cpp ../../CompilerSpecific/Rtti/RttiIndex.cpp
+//
+// Usage:
+//   HookPrecompute dump <file>
+//   HookPrecompute precompute <game.exe> [--pal dll/PAL.dll] [--vtable ClassName]... [--output VNTextProxy.addresses]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../PE/PEImage.h"
+#include "../../Util/AddressCache.h"
+#include "../../Util/HookSignatures.h"
+#include "../../Util/SignatureScanner.h"
+#include "../../CompilerSpecific/Rtti/RttiIndex.h"
+
+using namespace std;
+
+static const char* AddressCacheFileName = "VNTextProxy.addresses";
+
+static FILE* OpenFile(const string& filePath, const char* pMode)
+{
+#ifdef _MSC_VER
+    FILE* pFile = nullptr;
+    if (fopen_s(&pFile, filePath.c_str(), pMode) != 0)
+        return nullptr;
+
+    return pFile;
+#else
+    return fopen(filePath.c_str(), pMode);
+#endif
+}
+
+static bool ReadFile(const string& filePath, vector<uint8_t>& data)
+{
+    FILE* pFile = OpenFile(filePath, "rb");
+    if (pFile == nullptr)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    data.resize(size > 0 ? size : 0);
+    bool success = fread(data.data(), 1, data.size(), pFile) == data.size();
+    fclose(pFile);
+    return success;
+}
+
+static bool WriteFile(const string& filePath, const vector<uint8_t>& data)
+{
+    FILE* pFile = OpenFile(filePath, "wb");
+    if (pFile == nullptr)
+        return false;
+
+    bool success = fwrite(data.data(), 1, data.size(), pFile) == data.size();
+    fclose(pFile);
+    return success;
+}
+
+static string GetDirectory(const string& filePath)
+{
+    size_t separator = filePath.find_last_of("/\\");
+    return separator != string::npos ? filePath.substr(0, separator + 1) : string();
+}
+
+// A module as the loader lays it out at its preferred base: headers and section data at their RVAs.
+// This is what the proxy hashes and scans at runtime, so results computed on it carry over.
+struct LoadedModule
+{
+    vector<uint8_t> File;
+    vector<uint8_t> Image;
+    PEImage Headers;
+    uint64_t Hash = 0;
+
+    bool Load(const string& filePath)
+    {
+        if (!ReadFile(filePath, File))
+            return false;
+
+        PEImage fileImage;
+        if (!fileImage.Parse(File.data(), File.size(), PEImage::Layout::File) || fileImage.GetSizeOfImage() == 0)
+            return false;
+
+        Image.assign(fileImage.GetSizeOfImage(), 0);
+        memcpy(Image.data(), File.data(), min<size_t>({ fileImage.GetSizeOfHeaders(), File.size(), Image.size() }));
+        for (const PEImage::Section& section : fileImage.GetSections())
+        {
+            if (section.pData == nullptr || section.Rva >= Image.size())
+                continue;
+
+            uint32_t size = section.VirtualSize != 0 ? min(section.DataSize, section.VirtualSize) : section.DataSize;
+            size = (uint32_t)min<size_t>(size, Image.size() - section.Rva);
+            memcpy(Image.data() + section.Rva, section.pData, size);
+        }
+
+        Headers.Parse(Image.data(), Image.size(), PEImage::Layout::Mapped);
+        Hash = AddressCache::HashModule(Image.data(), Image.size());
+        return Hash != 0;
+    }
+};
+
+static const char* MachineName(uint16_t machine)
+{
+    switch (machine)
+    {
+        case 0x014C: return "x86";
+        case 0x8664: return "x64";
+        case 0xAA64: return "arm64";
+        case 0x01C4: return "arm";
+        default: return "unknown";
+    }
+}
+
+static int Dump(const string& filePath)
+{
+    vector<uint8_t> data;
+    PEImage image;
+    if (!ReadFile(filePath, data) || !image.Parse(data.data(), data.size(), PEImage::Layout::File))
+    {
+        fprintf(stderr, "Not a PE file: %s\n", filePath.c_str());
+        return 1;
+    }
+
+    printf("%s: %s, %s, timestamp 0x%08X\n", filePath.c_str(), image.Is64Bit() ? "PE32+" : "PE32", MachineName(image.GetMachine()), image.GetTimestamp());
+    printf("ImageBase 0x%llX, SizeOfImage 0x%X, entry point 0x%X\n",
+        (unsigned long long)image.GetImageBase(), image.GetSizeOfImage(), image.GetEntryPointRva());
+
+    printf("\nSections:\n");
+    for (const PEImage::Section& section : image.GetSections())
+    {
+        printf("  %-8.*s  rva 0x%08X  vsize 0x%08X  raw 0x%08X+0x%08X  flags 0x%08X\n",
+            (int)section.Name.size(), section.Name.data(), section.Rva, section.VirtualSize,
+            section.RawOffset, section.RawSize, section.Characteristics);
+    }
+
+    printf("\nImports:\n");
+    for (const PEImage::ImportedModule& module : image.GetImports())
+    {
+        printf("  %.*s\n", (int)module.Name.size(), module.Name.data());
+        for (const PEImage::ImportedFunction& function : image.GetImportedFunctions(module))
+        {
+            if (function.ByOrdinal)
+                printf("    iat 0x%08X  #%u\n", function.IatRva, function.Ordinal);
+            else
+                printf("    iat 0x%08X  %.*s\n", function.IatRva, (int)function.Name.size(), function.Name.data());
+        }
+    }
+
+    printf("\nExports:\n");
+    for (const PEImage::Export& entry : image.GetExports())
+    {
+        printf("  #%-5u 0x%08X  %.*s", entry.Ordinal, entry.Rva, (int)entry.Name.size(), entry.Name.data());
+        if (!entry.Forwarder.empty())
+            printf(" -> %.*s", (int)entry.Forwarder.size(), entry.Forwarder.data());
+
+        printf("\n");
+    }
+
+    int numRelocations = 0;
+    int numRelocationsByType[16] = {};
+    for (const PEImage::Relocation& relocation : image.GetRelocations())
+    {
+        numRelocations++;
+        numRelocationsByType[relocation.Type & 15]++;
+    }
+
+    printf("\nRelocations: %d", numRelocations);
+    for (int type = 0; type < 16; type++)
+    {
+        if (numRelocationsByType[type] != 0)
+            printf(", type %d: %d", type, numRelocationsByType[type]);
+    }
+    printf("\n");
+
+    if (image.HasRichHeader())
+    {
+        printf("\nRich header:\n");
+        for (const PEImage::RichEntry& entry : image.GetRichEntries())
+        {
+            printf("  product %3u  build %5u  count %u\n", entry.ProductId, entry.Build, entry.Count);
+        }
+    }
+    return 0;
+}
+
+// Same detection as CompilerHelper::Init
+static CompilerType DetectCompiler(const LoadedModule& module)
+{
+    if (module.Headers.HasRichHeader())
+        return CompilerType::Msvc;
+
+    if (module.Headers.GetSectionCount() == 0)
+        return CompilerType::Unknown;
+
+    PEImage::Section textSection = *module.Headers.GetSections().begin();
+    return SignatureScanner::FindFirst(textSection.pData, textSection.DataSize, "Borland", nullptr, 7) != nullptr
+        ? CompilerType::Borland
+        : CompilerType::Unknown;
+}
+
+static void PrecomputeGame(const LoadedModule& game, const vector<string>& vtableClassNames, AddressCache& cache)
+{
+    const uint8_t* pTable = SignatureScanner::FindFirst(
+        game.Image.data(), game.Image.size(),
+        HookSignatures::SjisLookupTablePattern, nullptr, sizeof(HookSignatures::SjisLookupTablePattern)
+    );
+    uint32_t tableRva = pTable != nullptr ? (uint32_t)(pTable - game.Image.data()) : 0;
+    cache.Set(game.Hash, HookSignatures::SjisLookupTableKey, tableRva, 0, game.Image.data(), game.Image.size());
+    printf("SJIS lookup table: %s (0x%X)\n", pTable != nullptr ? "found" : "not found", tableRva);
+
+    if (vtableClassNames.empty())
+        return;
+
+    // Same ranges as CompilerHelper::GetRttiIndex: the first section is code, the others may hold vtables
+    CompilerType compilerType = DetectCompiler(game);
+    RttiIndex::Range code{};
+    vector<RttiIndex::Range> dataSections;
+    bool first = true;
+    for (const PEImage::Section& section : game.Headers.GetSections())
+    {
+        if (first)
+            code = { section.Rva, section.RawSize };
+        else
+            dataSections.push_back({ section.Rva, section.RawSize });
+
+        first = false;
+    }
+
+    RttiIndex index;
+    index.Build(game.Image.data(), (uint32_t)game.Image.size(), (uint32_t)game.Headers.GetImageBase(), compilerType, code, dataSections);
+    printf("RTTI index: %d classes with vtables\n", index.GetCount());
+
+    for (const string& className : vtableClassNames)
+    {
+        uint32_t vtableRva = index.FindVTable(RttiIndex::GetDecoratedName(className, compilerType));
+        cache.Set(game.Hash, HookSignatures::VTableKeyPrefix + className, vtableRva, 0, game.Image.data(), game.Image.size());
+        printf("VTable %s: %s (0x%X)\n", className.c_str(), vtableRva != 0 ? "found" : "not found", vtableRva);
+    }
+}
+
+static void PrecomputePal(const LoadedModule& pal, AddressCache& cache)
+{
+    PEImage::Export palTaskGetTaskData;
+    if (!pal.Headers.FindExport(HookSignatures::PalTaskGetTaskDataName, palTaskGetTaskData) ||
+        palTaskGetTaskData.Rva >= pal.Image.size())
+    {
+        printf("%s: not exported\n", HookSignatures::PalTaskGetTaskDataName);
+        return;
+    }
+
+    int textOffset = HookSignatures::GetPalTaskTextOffset(pal.Image[palTaskGetTaskData.Rva]);
+    cache.Set(pal.Hash, HookSignatures::PalTaskTextOffsetKey, palTaskGetTaskData.Rva, textOffset, pal.Image.data(), pal.Image.size());
+    printf("%s: 0x%X, text offset 0x%X\n", HookSignatures::PalTaskGetTaskDataName, palTaskGetTaskData.Rva, textOffset);
+}
+
+static int Precompute(const string& gamePath, string palPath, const vector<string>& vtableClassNames, string outputPath)
+{
+    LoadedModule game;
+    if (!game.Load(gamePath))
+    {
+        fprintf(stderr, "Failed to load %s\n", gamePath.c_str());
+        return 1;
+    }
+
+    bool defaultPalPath = palPath.empty();
+    if (defaultPalPath)
+        palPath = GetDirectory(gamePath) + "dll/PAL.dll";
+
+    if (outputPath.empty())
+        outputPath = GetDirectory(gamePath) + AddressCacheFileName;
+
+    // Add to an existing cache rather than dropping what the proxy recorded for other modules
+    AddressCache cache;
+    vector<uint8_t> existing;
+    if (ReadFile(outputPath, existing) && !cache.Deserialize(existing))
+        printf("Replacing invalid cache file %s\n", outputPath.c_str());
+
+    PrecomputeGame(game, vtableClassNames, cache);
+
+    LoadedModule pal;
+    if (pal.Load(palPath))
+        PrecomputePal(pal, cache);
+    else if (!defaultPalPath)
+        fprintf(stderr, "Failed to load %s\n", palPath.c_str());
+
+    if (!WriteFile(outputPath, cache.Serialize()))
+    {
+        fprintf(stderr, "Failed to write %s\n", outputPath.c_str());
+        return 1;
+    }
+
+    printf("Wrote %d entries to %s\n", cache.GetCount(), outputPath.c_str());
+    return 0;
+}
+
+static void PrintUsage()
+{
+    printf("Usage: HookPrecompute dump <file>\n");
+    printf("       HookPrecompute precompute <game.exe> [--pal dll/PAL.dll] [--vtable ClassName]...\n");
+    printf("                                 [--output VNTextProxy.addresses]\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    string command = argv[1];
+    if (command == "dump" && argc == 3)
+        return Dump(argv[2]);
+
+    if (command != "precompute")
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    string palPath;
+    string outputPath;
+    vector<string> vtableClassNames;
+    for (int i = 3; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--pal" && i + 1 < argc)
+            palPath = argv[++i];
+        else if (arg == "--vtable" && i + 1 < argc)
+            vtableClassNames.push_back(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    return Precompute(argv[2], palPath, vtableClassNames, outputPath);
+}
@@ -0,0 +1 @@
+g++ -o HookPrecompute.exe HookPrecompute.cpp ../../PE/PEImage.cpp ../../Util/AddressCache.cpp ../../Util/SignatureScanner.cpp ../../Util/CpuFeatures.cpp ../../CompilerSpecific/Rtti/RttiIndex.cpp -O2 -std=c++17 -Wall
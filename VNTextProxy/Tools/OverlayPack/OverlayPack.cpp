@@ -0,0 +1,247 @@
+// OverlayPack: builds and inspects overlay archives, the single file the proxy serves translated data\ files from
+// (see OverlayFileSystem). "pack" stores every file under a folder, usually the game's data\ folder, by its path
+// relative to that folder. With --compress, each file is compressed if that makes it at least 1/16 smaller;
+// compressed files are extracted in memory when the game opens them, stored ones are read straight from the
+// mapped archive, so compression suits text (script.src, TEXT.DAT) more than already-compressed images.
+//
+// Build (Windows or Linux):
+//   g++ -O2 -std=c++17 -o OverlayPack OverlayPack.cpp ../../Util/OverlayArchive.cpp
+//
+// Usage:
+//   OverlayPack pack <folder> <output.overlay> [--compress]
+//   OverlayPack list <archive.overlay>
+//   OverlayPack extract <archive.overlay> <folder>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../../Util/OverlayArchive.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Paths are wide on Windows, so non-ASCII file names survive
+static FILE* OpenFile(const fs::path& filePath, const char* pMode)
+{
+#ifdef _WIN32
+    FILE* pFile = nullptr;
+    wstring mode(pMode, pMode + strlen(pMode));
+    if (_wfopen_s(&pFile, filePath.c_str(), mode.c_str()) != 0)
+        return nullptr;
+
+    return pFile;
+#else
+    return fopen(filePath.c_str(), pMode);
+#endif
+}
+
+static bool ReadFile(const fs::path& filePath, vector<uint8_t>& data)
+{
+    FILE* pFile = OpenFile(filePath, "rb");
+    if (pFile == nullptr)
+        return false;
+
+    fseek(pFile, 0, SEEK_END);
+    long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    // An empty vector's data() may be null, which fread and fwrite don't accept even for a size of 0
+    data.resize(size > 0 ? size : 0);
+    bool success = data.empty() || fread(data.data(), 1, data.size(), pFile) == data.size();
+    fclose(pFile);
+    return success;
+}
+
+static bool WriteFile(const fs::path& filePath, const uint8_t* pData, size_t size)
+{
+    FILE* pFile = OpenFile(filePath, "wb");
+    if (pFile == nullptr)
+        return false;
+
+    bool success = size == 0 || fwrite(pData, 1, size, pFile) == size;
+    fclose(pFile);
+    return success;
+}
+
+// u8string() returns std::string before C++20 and std::u8string after
+static string ToUtf8(const fs::path& path)
+{
+    auto utf8 = path.u8string();
+    return string(utf8.begin(), utf8.end());
+}
+
+// Archive names use '\' as separator, like the paths the game passes to CreateFileA
+static string GetEntryName(const fs::path& relativePath)
+{
+    string name;
+    for (const fs::path& part : relativePath)
+    {
+        if (!name.empty())
+            name += '\\';
+
+        name += ToUtf8(part);
+    }
+    return name;
+}
+
+static bool OpenArchive(const string& archivePath, vector<uint8_t>& data, OverlayArchive& archive)
+{
+    if (!ReadFile(fs::u8path(archivePath), data) || !archive.Open(data.data(), data.size()))
+    {
+        fprintf(stderr, "Not a valid overlay archive: %s\n", archivePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+static int Pack(const string& folderPath, const string& outputPath, bool compress)
+{
+    fs::path folder = fs::u8path(folderPath);
+    error_code error;
+    vector<fs::path> filePaths;
+    for (fs::recursive_directory_iterator it(folder, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file())
+            filePaths.push_back(it->path());
+    }
+
+    if (error)
+    {
+        fprintf(stderr, "Can't list %s: %s\n", folderPath.c_str(), error.message().c_str());
+        return 1;
+    }
+
+    sort(filePaths.begin(), filePaths.end());
+
+    OverlayArchiveWriter writer;
+    uint64_t totalSize = 0;
+    vector<uint8_t> data;
+    for (const fs::path& filePath : filePaths)
+    {
+        string name = GetEntryName(filePath.lexically_relative(folder));
+        if (!ReadFile(filePath, data))
+        {
+            fprintf(stderr, "Can't read %s\n", ToUtf8(filePath).c_str());
+            return 1;
+        }
+
+        if (!writer.Add(name, data.data(), data.size(), compress))
+        {
+            fprintf(stderr, "Can't add %s: name differs only in case from another file, or file is over 4 GB\n", name.c_str());
+            return 1;
+        }
+        totalSize += data.size();
+    }
+
+    vector<uint8_t> archiveData = writer.Serialize();
+    if (!WriteFile(fs::u8path(outputPath), archiveData.data(), archiveData.size()))
+    {
+        fprintf(stderr, "Can't write %s\n", outputPath.c_str());
+        return 1;
+    }
+
+    printf("Packed %d files (%llu bytes) into %s (%zu bytes)\n",
+        writer.GetCount(), (unsigned long long)totalSize, outputPath.c_str(), archiveData.size());
+    return 0;
+}
+
+static int List(const string& archivePath)
+{
+    vector<uint8_t> data;
+    OverlayArchive archive;
+    if (!OpenArchive(archivePath, data, archive))
+        return 1;
+
+    // Sorted by name rather than in index (hash) order
+    vector<OverlayArchive::Entry> entries;
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        entries.push_back(archive.GetEntry(i));
+    }
+    sort(entries.begin(), entries.end(), [](const OverlayArchive::Entry& entry1, const OverlayArchive::Entry& entry2) { return entry1.Name < entry2.Name; });
+
+    for (const OverlayArchive::Entry& entry : entries)
+    {
+        printf("%10u  %10u  %-4s  %.*s\n", entry.Size, entry.StoredSize,
+            entry.Method == OverlayArchive::Compression::Lz ? "lz" : "", (int)entry.Name.size(), entry.Name.data());
+    }
+    printf("%d files\n", archive.GetCount());
+    return 0;
+}
+
+static int Extract(const string& archivePath, const string& folderPath)
+{
+    vector<uint8_t> data;
+    OverlayArchive archive;
+    if (!OpenArchive(archivePath, data, archive))
+        return 1;
+
+    fs::path folder = fs::u8path(folderPath);
+    vector<uint8_t> contents;
+    for (int i = 0; i < archive.GetCount(); i++)
+    {
+        OverlayArchive::Entry entry = archive.GetEntry(i);
+        string name(entry.Name);
+        replace(name.begin(), name.end(), '\\', '/');
+
+        // Don't let a crafted name write outside the output folder
+        fs::path relativePath = fs::u8path(name).lexically_normal();
+        if (relativePath.is_absolute() || relativePath.has_root_name() || (!relativePath.empty() && *relativePath.begin() == ".."))
+        {
+            fprintf(stderr, "Skipping %s: path leaves the output folder\n", name.c_str());
+            continue;
+        }
+
+        contents.resize(entry.Size);
+        if (!OverlayArchive::Extract(entry, contents.data()))
+        {
+            fprintf(stderr, "%s is corrupt\n", name.c_str());
+            return 1;
+        }
+
+        fs::path filePath = folder / relativePath;
+        error_code error;
+        fs::create_directories(filePath.parent_path(), error);
+        if (!WriteFile(filePath, contents.data(), contents.size()))
+        {
+            fprintf(stderr, "Can't write %s\n", ToUtf8(filePath).c_str());
+            return 1;
+        }
+    }
+
+    printf("Extracted %d files to %s\n", archive.GetCount(), folderPath.c_str());
+    return 0;
+}
+
+static void PrintUsage()
+{
+    printf("Usage: OverlayPack pack <folder> <output.overlay> [--compress]\n");
+    printf("       OverlayPack list <archive.overlay>\n");
+    printf("       OverlayPack extract <archive.overlay> <folder>\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    string command = argv[1];
+    if (command == "pack" && (argc == 4 || (argc == 5 && string(argv[4]) == "--compress")))
+        return Pack(argv[2], argv[3], argc == 5);
+
+    if (command == "list" && argc == 3)
+        return List(argv[2]);
+
+    if (command == "extract" && argc == 4)
+        return Extract(argv[2], argv[3]);
+
+    PrintUsage();
+    return 1;
+}
@@ -0,0 +1 @@
+g++ -o OverlayPack.exe OverlayPack.cpp ../../Util/OverlayArchive.cpp -O2 -std=c++17 -Wall
@@ -0,0 +1,293 @@
+#include "AddressCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// File layout (little-endian):
+//   char[4] magic, uint32 version, uint32 entry count
+//   per entry: uint64 module hash, uint32 rva, uint32 value, uint8 key length, uint8 signature length, key, signature
+//   uint64 FNV-1a hash of everything before it
+static constexpr char Magic[4] = { 'V', 'N', 'A', 'C' };
+static constexpr uint32_t Version = 2;          // 2: relocated pointers in signatures are stored as RVAs
+static constexpr int MaxSignatureLength = 255;
+
+static constexpr uint64_t FnvOffsetBasis = 0xCBF29CE484222325;
+static constexpr uint64_t FnvPrime = 0x100000001B3;
+
+static uint64_t Fnv1a(const uint8_t* pData, size_t size, uint64_t hash = FnvOffsetBasis)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pData[i];
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+template<typename T>
+static void Append(vector<uint8_t>& output, T value)
+{
+    uint8_t bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    output.insert(output.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool Read(const vector<uint8_t>& data, size_t& pos, size_t end, T& value)
+{
+    if (end - pos < sizeof(T))
+        return false;
+
+    memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+struct PeHeaders
+{
+    size_t NtHeadersOffset;
+    size_t OptionalHeaderOffset;
+    size_t OptionalHeaderSize;
+    size_t HeadersEnd;          // End of the section table
+    bool Pe32Plus;
+};
+
+static bool ReadPeHeaders(const uint8_t* pImage, size_t imageSize, PeHeaders& headers)
+{
+    uint32_t ntHeadersOffset;
+    if (imageSize < 0x40 || pImage[0] != 'M' || pImage[1] != 'Z')
+        return false;
+
+    memcpy(&ntHeadersOffset, pImage + 0x3C, 4);
+    if (ntHeadersOffset > imageSize || imageSize - ntHeadersOffset < 24 || memcmp(pImage + ntHeadersOffset, "PE\0\0", 4) != 0)
+        return false;
+
+    uint16_t numSections;
+    uint16_t optionalHeaderSize;
+    memcpy(&numSections, pImage + ntHeadersOffset + 6, 2);
+    memcpy(&optionalHeaderSize, pImage + ntHeadersOffset + 20, 2);
+
+    headers.NtHeadersOffset = ntHeadersOffset;
+    headers.OptionalHeaderOffset = ntHeadersOffset + 24;
+    headers.OptionalHeaderSize = optionalHeaderSize;
+    headers.HeadersEnd = headers.OptionalHeaderOffset + optionalHeaderSize + numSections * 40;
+    if (optionalHeaderSize < 2 || headers.HeadersEnd > imageSize)
+        return false;
+
+    uint16_t optionalHeaderMagic;
+    memcpy(&optionalHeaderMagic, pImage + headers.OptionalHeaderOffset, 2);
+    headers.Pe32Plus = optionalHeaderMagic == 0x20B;
+    return true;
+}
+
+uint64_t AddressCache::HashModule(const uint8_t* pImage, size_t imageSize)
+{
+    PeHeaders headers;
+    if (!ReadPeHeaders(pImage, imageSize, headers))
+        return 0;
+
+    // ImageBase is a uint32 at offset 28 in PE32 optional headers and a uint64 at offset 24 in PE32+
+    size_t imageBaseOffset = headers.OptionalHeaderOffset + (headers.Pe32Plus ? 24 : 28);
+    size_t imageBaseSize = headers.Pe32Plus ? 8 : 4;
+    if (imageBaseOffset + imageBaseSize > headers.OptionalHeaderOffset + headers.OptionalHeaderSize)
+        return 0;
+
+    uint64_t hash = Fnv1a(pImage + headers.NtHeadersOffset, imageBaseOffset - headers.NtHeadersOffset);
+    return Fnv1a(pImage + imageBaseOffset + imageBaseSize, headers.HeadersEnd - imageBaseOffset - imageBaseSize, hash);
+}
+
+// Copies the bytes at rva, with every pointer the loader relocates (those in the base relocation table) turned
+// into an offset from ImageBase. The loader updates ImageBase in the headers when it relocates the module, so
+// the result is the same wherever the module is loaded, and for the file on disk.
+static vector<uint8_t> ReadSignature(const uint8_t* pImage, size_t imageSize, uint32_t rva, size_t length)
+{
+    vector<uint8_t> signature(pImage + rva, pImage + rva + length);
+    PeHeaders headers;
+    if (length == 0 || !ReadPeHeaders(pImage, imageSize, headers))
+        return signature;
+
+    // NumberOfRvaAndSizes is followed by the data directories, of which the base relocation table is the 6th
+    size_t optionalHeaderEnd = headers.OptionalHeaderOffset + headers.OptionalHeaderSize;
+    size_t imageBaseOffset = headers.OptionalHeaderOffset + (headers.Pe32Plus ? 24 : 28);
+    size_t directoryCountOffset = headers.OptionalHeaderOffset + (headers.Pe32Plus ? 108 : 92);
+    size_t relocationDirectoryOffset = directoryCountOffset + 4 + 5 * 8;
+    uint32_t numDirectories;
+    uint32_t relocationsRva;
+    uint32_t relocationsSize;
+    uint64_t imageBase = 0;
+    if (relocationDirectoryOffset + 8 > optionalHeaderEnd)
+        return signature;
+
+    memcpy(&numDirectories, pImage + directoryCountOffset, 4);
+    memcpy(&relocationsRva, pImage + relocationDirectoryOffset, 4);
+    memcpy(&relocationsSize, pImage + relocationDirectoryOffset + 4, 4);
+    memcpy(&imageBase, pImage + imageBaseOffset, headers.Pe32Plus ? 8 : 4);
+    if (numDirectories < 6 || relocationsRva > imageSize || imageSize - relocationsRva < relocationsSize)
+        return signature;
+
+    // Each block lists the relocated fields of one 4K page as 16-bit entries: type in the top 4 bits, offset below
+    uint64_t signatureEnd = (uint64_t)rva + length;
+    const uint8_t* pBlock = pImage + relocationsRva;
+    const uint8_t* pEnd = pBlock + relocationsSize;
+    while (pEnd - pBlock >= 8)
+    {
+        uint32_t pageRva;
+        uint32_t blockSize;
+        memcpy(&pageRva, pBlock, 4);
+        memcpy(&blockSize, pBlock + 4, 4);
+        if (blockSize < 8 || blockSize > (size_t)(pEnd - pBlock))
+            break;
+
+        // A field at the end of the page can reach up to 7 bytes into the next one
+        if (pageRva < signatureEnd && (uint64_t)pageRva + 0x1000 + 8 > rva)
+        {
+            for (uint32_t i = 8; i + 2 <= blockSize; i += 2)
+            {
+                uint16_t relocation;
+                memcpy(&relocation, pBlock + i, 2);
+                int type = relocation >> 12;
+                size_t fieldSize = type == 3 ? 4 : type == 10 ? 8 : 0;      // HIGHLOW, DIR64
+                uint64_t fieldRva = (uint64_t)pageRva + (relocation & 0xFFF);
+                if (fieldSize == 0 || fieldRva + fieldSize <= rva || fieldRva >= signatureEnd ||
+                    fieldRva + fieldSize > imageSize)
+                {
+                    continue;
+                }
+
+                uint64_t value = 0;
+                memcpy(&value, pImage + fieldRva, fieldSize);
+                value -= imageBase;
+
+                uint8_t bytes[8];
+                memcpy(bytes, &value, 8);
+                for (size_t j = 0; j < fieldSize; j++)
+                {
+                    if (fieldRva + j >= rva && fieldRva + j < signatureEnd)
+                        signature[fieldRva + j - rva] = bytes[j];
+                }
+            }
+        }
+        pBlock += blockSize;
+    }
+    return signature;
+}
+
+const AddressCache::Entry* AddressCache::Find(uint64_t moduleHash, const string& key, const uint8_t* pImage, size_t imageSize) const
+{
+    auto it = _entries.find({ moduleHash, key });
+    if (it == _entries.end())
+        return nullptr;
+
+    const Entry& entry = it->second;
+    if (entry.Rva > imageSize || imageSize - entry.Rva < entry.Signature.size())
+        return nullptr;
+
+    if (!entry.Signature.empty() && ReadSignature(pImage, imageSize, entry.Rva, entry.Signature.size()) != entry.Signature)
+        return nullptr;
+
+    return &entry;
+}
+
+void AddressCache::Set(uint64_t moduleHash, const string& key, uint32_t rva, uint32_t value,
+                       const uint8_t* pImage, size_t imageSize, int signatureLength)
+{
+    // Key lengths are stored in a byte
+    if (key.size() > 255)
+        return;
+
+    Entry entry;
+    entry.Rva = rva;
+    entry.Value = value;
+    if (rva != 0 && rva < imageSize)
+    {
+        size_t length = min<size_t>({ (size_t)signatureLength, (size_t)MaxSignatureLength, imageSize - rva });
+        entry.Signature = ReadSignature(pImage, imageSize, rva, length);
+    }
+
+    auto [it, inserted] = _entries.try_emplace({ moduleHash, key });
+    Entry& existing = it->second;
+    if (!inserted && existing.Rva == entry.Rva && existing.Value == entry.Value && existing.Signature == entry.Signature)
+        return;
+
+    existing = move(entry);
+    _dirty = true;
+}
+
+void AddressCache::Clear()
+{
+    _entries.clear();
+    _dirty = false;
+}
+
+bool AddressCache::Deserialize(const vector<uint8_t>& data)
+{
+    Clear();
+
+    if (data.size() < sizeof(Magic) + 8 + 8 || memcmp(data.data(), Magic, sizeof(Magic)) != 0)
+        return false;
+
+    size_t end = data.size() - 8;
+    uint64_t storedHash;
+    memcpy(&storedHash, data.data() + end, 8);
+    if (storedHash != Fnv1a(data.data(), end))
+        return false;
+
+    size_t pos = sizeof(Magic);
+    uint32_t version;
+    uint32_t count;
+    if (!Read(data, pos, end, version) || version != Version || !Read(data, pos, end, count))
+        return false;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t moduleHash;
+        Entry entry;
+        uint8_t keyLength;
+        uint8_t signatureLength;
+        if (!Read(data, pos, end, moduleHash) || !Read(data, pos, end, entry.Rva) || !Read(data, pos, end, entry.Value) ||
+            !Read(data, pos, end, keyLength) || !Read(data, pos, end, signatureLength) ||
+            end - pos < (size_t)keyLength + signatureLength)
+        {
+            Clear();
+            return false;
+        }
+
+        string key((const char*)data.data() + pos, keyLength);
+        pos += keyLength;
+        entry.Signature.assign(data.data() + pos, data.data() + pos + signatureLength);
+        pos += signatureLength;
+
+        _entries[{ moduleHash, move(key) }] = move(entry);
+    }
+
+    if (pos != end)
+    {
+        Clear();
+        return false;
+    }
+    return true;
+}
+
+vector<uint8_t> AddressCache::Serialize()
+{
+    vector<uint8_t> data(Magic, Magic + sizeof(Magic));
+    Append<uint32_t>(data, Version);
+    Append<uint32_t>(data, (uint32_t)_entries.size());
+    for (const auto& [id, entry] : _entries)
+    {
+        const auto& [moduleHash, key] = id;
+        Append<uint64_t>(data, moduleHash);
+        Append<uint32_t>(data, entry.Rva);
+        Append<uint32_t>(data, entry.Value);
+        Append<uint8_t>(data, (uint8_t)key.size());
+        Append<uint8_t>(data, (uint8_t)entry.Signature.size());
+        data.insert(data.end(), key.begin(), key.end());
+        data.insert(data.end(), entry.Signature.begin(), entry.Signature.end());
+    }
+    Append<uint64_t>(data, Fnv1a(data.data(), data.size()));
+
+    _dirty = false;
+    return data;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Addresses found by scanning modules (lookup tables, vtables, engine variants), keyed by module and name,
+// so later launches can skip the scans. Each entry stores an RVA, a free-form value (e.g. which variant
+// was detected) and the bytes found at the RVA, with relocated pointers stored relative to the image base so
+// that ASLR doesn't change them. An entry is only returned if those bytes still match the image it's looked up
+// in, so a stale or mismatched cache can't hand out a wrong address.
+// Standard library only; the caller does the file I/O.
+class AddressCache
+{
+public:
+    struct Entry
+    {
+        uint32_t Rva = 0;
+        uint32_t Value = 0;
+        std::vector<uint8_t> Signature;
+    };
+
+    static constexpr int DefaultSignatureLength = 16;
+
+    // Identifies a module build by hashing its PE headers and section table (linker timestamp, checksum,
+    // sizes, entry point). ImageBase is left out since the loader rewrites it when relocating.
+    // Returns 0 if the image has no valid PE header.
+    static uint64_t HashModule(const uint8_t* pImage, size_t imageSize);
+
+    // Returns nullptr if there is no entry or its signature no longer matches the image
+    const Entry* Find(uint64_t moduleHash, const std::string& key, const uint8_t* pImage, size_t imageSize) const;
+
+    // Records the bytes at rva as the entry's signature. Pass rva 0 for entries that have no address
+    // (e.g. "not found"); those are validated by the module hash alone.
+    void Set(uint64_t moduleHash, const std::string& key, uint32_t rva, uint32_t value,
+             const uint8_t* pImage, size_t imageSize, int signatureLength = DefaultSignatureLength);
+
+    void Clear();
+    int GetCount() const { return (int)_entries.size(); }
+    bool IsDirty() const { return _dirty; }
+
+    // Returns false, leaving the cache empty, if the data is truncated, corrupt or from another version
+    bool Deserialize(const std::vector<uint8_t>& data);
+    std::vector<uint8_t> Serialize();
+
+private:
+    std::map<std::pair<uint64_t, std::string>, Entry> _entries;
+    bool _dirty = false;
+};
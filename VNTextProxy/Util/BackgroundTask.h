@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+// Runs a single job on a worker thread and publishes its result through an atomic state,
+// so the thread that started it can poll for completion without ever blocking.
+// Standard library only - no Win32 dependencies.
+class BackgroundTask
+{
+public:
+    enum class State
+    {
+        Idle,
+        Running,
+        Succeeded,
+        Failed,
+        Cancelled
+    };
+
+    // The job receives a cancellation flag it should check between expensive steps,
+    // and returns true on success.
+    using Job = std::function<bool(const std::atomic<bool>& cancelRequested)>;
+
+    BackgroundTask() = default;
+    BackgroundTask(const BackgroundTask&) = delete;
+    BackgroundTask& operator=(const BackgroundTask&) = delete;
+
+    ~BackgroundTask()
+    {
+        Cancel();
+    }
+
+    // Starts the job. Any previous job is cancelled and joined first.
+    void Start(Job job)
+    {
+        Cancel();
+
+        _cancelRequested.store(false);
+        _state.store(State::Running);
+        _startTime = Clock::now();
+        _finishTime = _startTime;
+        _thread = std::thread(
+            [this, job = std::move(job)]()
+            {
+                bool succeeded = job(_cancelRequested);
+                _finishTime = Clock::now();
+
+                State result = succeeded ? State::Succeeded : State::Failed;
+                if (_cancelRequested.load())
+                    result = State::Cancelled;
+
+                _state.store(result, std::memory_order_release);
+            }
+        );
+    }
+
+    // Requests cancellation and waits for the worker to exit.
+    void Cancel()
+    {
+        _cancelRequested.store(true);
+        Wait();
+    }
+
+    // Cancels any job and goes back to Idle, so a result that has since been thrown away
+    // (e.g. resources released on device loss) no longer reads as ready.
+    void Reset()
+    {
+        Cancel();
+        _state.store(State::Idle, std::memory_order_release);
+    }
+
+    // Waits for the worker to exit without requesting cancellation.
+    void Wait()
+    {
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    State GetState() const
+    {
+        return _state.load(std::memory_order_acquire);
+    }
+
+    bool IsRunning() const
+    {
+        return GetState() == State::Running;
+    }
+
+    // True once the job finished successfully. Everything the job wrote before returning
+    // is visible to the caller after this returns true.
+    bool IsReady() const
+    {
+        return GetState() == State::Succeeded;
+    }
+
+    // Time the job took, or has taken so far if it's still running.
+    double GetElapsedMilliseconds() const
+    {
+        Clock::time_point end = IsRunning() ? Clock::now() : _finishTime;
+        return std::chrono::duration<double, std::milli>(end - _startTime).count();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::thread _thread;
+    std::atomic<State> _state{ State::Idle };
+    std::atomic<bool> _cancelRequested{ false };
+    Clock::time_point _startTime{};
+    Clock::time_point _finishTime{};
+};
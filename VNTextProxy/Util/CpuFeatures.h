@@ -0,0 +1,16 @@
+#pragma once
+
+// Runtime instruction set detection for the SIMD code paths. Standard library and intrinsics only.
+
+// MSVC allows AVX2 intrinsics in any function; GCC and Clang need the function to be compiled for it
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace CpuFeatures
+{
+    // True if both the CPU and the OS (saved YMM state) support AVX2. The result is cached.
+    bool HasAvx2();
+}
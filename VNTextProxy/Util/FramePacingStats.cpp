@@ -0,0 +1,81 @@
+#include "FramePacingStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+void FramePacingStats::RecordWait(double waitMs)
+{
+    _waits.push_back(waitMs);
+}
+
+void FramePacingStats::RecordPresent()
+{
+    Clock::time_point now = Clock::now();
+    if (_hasLastPresent)
+        _intervals.push_back(Milliseconds(now - _lastPresent));
+
+    _lastPresent = now;
+    _hasLastPresent = true;
+}
+
+static double Percentile(const vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+
+    size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+FramePacingStats::Summary FramePacingStats::TakeSummary()
+{
+    Summary summary{};
+    summary.Presents = (int)_intervals.size();
+
+    vector<double> sorted = _intervals;
+    sort(sorted.begin(), sorted.end());
+
+    double total = 0;
+    for (double interval : _intervals)
+    {
+        total += interval;
+        if (_refreshPeriodMs > 0)
+            summary.MissedVblanks += max(0, (int)lround(interval / _refreshPeriodMs) - 1);
+    }
+
+    if (!sorted.empty())
+    {
+        summary.MeanIntervalMs = total / sorted.size();
+        summary.P50IntervalMs = Percentile(sorted, 0.50);
+        summary.P95IntervalMs = Percentile(sorted, 0.95);
+        summary.P99IntervalMs = Percentile(sorted, 0.99);
+        summary.MaxIntervalMs = sorted.back();
+    }
+
+    double totalWait = 0;
+    for (double wait : _waits)
+    {
+        totalWait += wait;
+        summary.MaxWaitMs = max(summary.MaxWaitMs, wait);
+    }
+
+    if (!_waits.empty())
+        summary.MeanWaitMs = totalWait / _waits.size();
+
+    _intervals.clear();
+    _waits.clear();
+    return summary;
+}
+
+string FramePacingStats::Format(const Summary& summary)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+        "%d presents, interval mean %.2f ms, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f, %d missed vblanks, latency wait mean %.2f ms, max %.2f",
+        summary.Presents, summary.MeanIntervalMs, summary.P50IntervalMs, summary.P95IntervalMs,
+        summary.P99IntervalMs, summary.MaxIntervalMs, summary.MissedVblanks, summary.MeanWaitMs, summary.MaxWaitMs);
+    return buffer;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Collects present-to-present intervals and frame-latency wait times for the DX11 presenter,
+// and summarizes them periodically. Not thread-safe; callers serialize access. Standard library only.
+class FramePacingStats
+{
+public:
+    struct Summary
+    {
+        int Presents;
+        double MeanIntervalMs;
+        double P50IntervalMs;
+        double P95IntervalMs;
+        double P99IntervalMs;
+        double MaxIntervalMs;
+        int MissedVblanks;          // Refreshes that passed without a new frame, assuming one frame per refresh
+        double MeanWaitMs;          // Time blocked on the frame latency waitable object
+        double MaxWaitMs;
+    };
+
+    // Refresh period of the output, used to count missed vblanks. 0 disables that count.
+    void SetRefreshPeriod(double refreshPeriodMs) { _refreshPeriodMs = refreshPeriodMs; }
+
+    void RecordWait(double waitMs);
+    void RecordPresent();
+
+    int GetPendingPresents() const { return (int)_intervals.size(); }
+
+    // Summarizes everything recorded since the last call and starts a new window
+    Summary TakeSummary();
+
+    static std::string Format(const Summary& summary);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static double Milliseconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    double _refreshPeriodMs = 0;
+    bool _hasLastPresent = false;
+    Clock::time_point _lastPresent{};
+    std::vector<double> _intervals;
+    std::vector<double> _waits;
+};
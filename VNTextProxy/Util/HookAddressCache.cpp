@@ -0,0 +1,97 @@
+#include "pch.h"
+
+#include "Util/Logger.h"
+
+using namespace std;
+
+void HookAddressCache::Load()
+{
+    FILE* pFile;
+    _wfopen_s(&pFile, GetFilePath().c_str(), L"rb");
+    if (pFile == nullptr)
+        return;
+
+    fseek(pFile, 0, SEEK_END);
+    long fileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    vector<uint8_t> data(fileSize > 0 ? fileSize : 0);
+    size_t bytesRead = fread(data.data(), 1, data.size(), pFile);
+    fclose(pFile);
+
+    if (bytesRead != data.size() || !Cache.Deserialize(data))
+    {
+        proxy_log(LogCategory::INIT, "HookAddressCache: ignoring invalid cache file");
+        return;
+    }
+
+    proxy_log(LogCategory::INIT, "HookAddressCache: loaded %d entries", Cache.GetCount());
+}
+
+void HookAddressCache::Save()
+{
+    if (!Cache.IsDirty())
+        return;
+
+    vector<uint8_t> data = Cache.Serialize();
+
+    // Write to a temporary file first so an interrupted write never leaves a truncated cache behind
+    wstring filePath = GetFilePath();
+    wstring tempFilePath = filePath + L".tmp";
+    FILE* pFile;
+    _wfopen_s(&pFile, tempFilePath.c_str(), L"wb");
+    if (pFile == nullptr)
+        return;
+
+    bool written = fwrite(data.data(), 1, data.size(), pFile) == data.size();
+    fclose(pFile);
+
+    if (!written || !MoveFileExW(tempFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileW(tempFilePath.c_str());
+        proxy_log(LogCategory::INIT, "HookAddressCache: failed to save cache file");
+        return;
+    }
+
+    proxy_log(LogCategory::INIT, "HookAddressCache: saved %d entries", Cache.GetCount());
+}
+
+bool HookAddressCache::TryGet(HMODULE hModule, const string& key, DWORD& rva, DWORD& value)
+{
+    uint64_t moduleHash = GetModuleHash(hModule);
+    if (moduleHash == 0)
+        return false;
+
+    const AddressCache::Entry* pEntry = Cache.Find(moduleHash, key, (const uint8_t*)hModule, DetourGetModuleSize(hModule));
+    if (pEntry == nullptr)
+        return false;
+
+    rva = pEntry->Rva;
+    value = pEntry->Value;
+    return true;
+}
+
+void HookAddressCache::Set(HMODULE hModule, const string& key, DWORD rva, DWORD value)
+{
+    uint64_t moduleHash = GetModuleHash(hModule);
+    if (moduleHash == 0)
+        return;
+
+    Cache.Set(moduleHash, key, rva, value, (const uint8_t*)hModule, DetourGetModuleSize(hModule));
+}
+
+wstring HookAddressCache::GetFilePath()
+{
+    return Path::Combine(Path::GetModuleFolderPath(nullptr), L"VNTextProxy.addresses");
+}
+
+uint64_t HookAddressCache::GetModuleHash(HMODULE hModule)
+{
+    auto it = ModuleHashes.find(hModule);
+    if (it != ModuleHashes.end())
+        return it->second;
+
+    uint64_t moduleHash = AddressCache::HashModule((const uint8_t*)hModule, DetourGetModuleSize(hModule));
+    ModuleHashes[hModule] = moduleHash;
+    return moduleHash;
+}
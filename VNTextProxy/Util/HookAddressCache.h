@@ -0,0 +1,22 @@
+#pragma once
+
+// The process-wide AddressCache, stored next to the game executable. Lets the hooks that have to search
+// a module (lookup tables, vtables, engine variants) skip the search on later launches.
+// Only used during initialization, from a single thread.
+class HookAddressCache
+{
+public:
+    static void         Load                ();
+    static void         Save                ();
+
+    // Returns false if there is no entry for this build of the module or its signature bytes don't match
+    static bool         TryGet              (HMODULE hModule, const std::string& key, DWORD& rva, DWORD& value);
+    static void         Set                 (HMODULE hModule, const std::string& key, DWORD rva, DWORD value);
+
+private:
+    static std::wstring GetFilePath         ();
+    static uint64_t     GetModuleHash       (HMODULE hModule);
+
+    static inline AddressCache Cache{};
+    static inline std::map<HMODULE, uint64_t> ModuleHashes{};
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// What the hooks search modules for and the HookAddressCache keys they store the results under.
+// Shared with the HookPrecompute tool so the entries it computes offline match the proxy's own.
+namespace HookSignatures
+{
+    // The first entries (0x8140, 0x8141, ...) of the game's SJIS to UTF-16 lookup table
+    inline constexpr uint8_t SjisLookupTablePattern[] = {
+        0x00, 0x30, 0x01, 0x30, 0x02, 0x30, 0x0C, 0xFF, 0x0E, 0xFF, 0xFB, 0x30, 0x1A, 0xFF, 0x1B, 0xFF,
+        0x1F, 0xFF, 0x01, 0xFF, 0x9B, 0x30, 0x9C, 0x30, 0xB4, 0x00, 0x40, 0xFF, 0xA8, 0x00, 0x3E, 0xFF
+    };
+    inline constexpr const char* SjisLookupTableKey = "SjisLookupTable";
+
+    inline constexpr const char* PalTaskGetTaskDataName = "PalTaskGetTaskData";
+    inline constexpr const char* PalTaskTextOffsetKey = "PalTaskGetTaskData.textOffset";
+
+    // Old SoftPAL: starts with A1 (mov eax, [addr]) - no frame, no args, text at 0x204
+    // New SoftPAL: starts with 55 (push ebp) - has frame, takes 1 arg, text at 0x1544
+    inline int GetPalTaskTextOffset(uint8_t firstByte)
+    {
+        return firstByte == 0x55 ? 0x1544 : 0x204;
+    }
+
+    // Followed by the class name as passed to CompilerHelper::FindVTable
+    inline constexpr const char* VTableKeyPrefix = "VTable:";
+}
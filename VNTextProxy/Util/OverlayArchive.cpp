@@ -0,0 +1,437 @@
+#include "OverlayArchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// File layout (little-endian):
+//   char[4] magic, uint32 version, uint32 entry count, uint32 name table size,
+//   uint64 FNV-1a hash of the index and name table, uint64 reserved
+//   index: per entry, sorted by name hash: uint64 name hash, uint32 name offset, uint32 name length,
+//          uint64 data offset, uint32 stored size, uint32 size, uint32 compression, uint32 reserved
+//   name table (UTF-8, not terminated), then the entries' data
+static constexpr char Magic[4] = { 'V', 'N', 'O', 'V' };
+static constexpr uint32_t Version = 1;
+static constexpr size_t HeaderSize = 32;
+static constexpr size_t IndexEntrySize = 40;
+
+static constexpr uint64_t FnvOffsetBasis = 0xCBF29CE484222325;
+static constexpr uint64_t FnvPrime = 0x100000001B3;
+
+// LZ77 codec: a sequence of (literal run, match) pairs, each starting with a token byte that holds the literal
+// length in its high nibble and the match length minus MinMatch in its low nibble. A nibble of 15 means more
+// length bytes follow, each added to it, until one is below 255. The literals come next, then the match as a
+// 16-bit distance back into the output. The final sequence has literals only.
+static constexpr int MinMatch = 4;
+static constexpr int MaxDistance = 0xFFFF;
+static constexpr int HashBits = 14;
+
+struct OverlayArchive::IndexEntry
+{
+    uint64_t NameHash;
+    uint32_t NameOffset;
+    uint32_t NameLength;
+    uint64_t DataOffset;
+    uint32_t StoredSize;
+    uint32_t Size;
+    uint32_t Method;
+
+    static IndexEntry Read(const uint8_t* pEntry)
+    {
+        IndexEntry entry;
+        memcpy(&entry.NameHash, pEntry, 8);
+        memcpy(&entry.NameOffset, pEntry + 8, 4);
+        memcpy(&entry.NameLength, pEntry + 12, 4);
+        memcpy(&entry.DataOffset, pEntry + 16, 8);
+        memcpy(&entry.StoredSize, pEntry + 24, 4);
+        memcpy(&entry.Size, pEntry + 28, 4);
+        memcpy(&entry.Method, pEntry + 32, 4);
+        return entry;
+    }
+};
+
+static uint64_t Fnv1a(const uint8_t* pData, size_t size, uint64_t hash = FnvOffsetBasis)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pData[i];
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+template<typename T>
+static void Append(vector<uint8_t>& output, T value)
+{
+    uint8_t bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    output.insert(output.end(), bytes, bytes + sizeof(T));
+}
+
+static char NormalizeNameChar(char c)
+{
+    if (c == '/')
+        return '\\';
+
+    if (c >= 'A' && c <= 'Z')
+        return (char)(c + ('a' - 'A'));
+
+    return c;
+}
+
+static bool NamesEqual(string_view name1, string_view name2)
+{
+    if (name1.size() != name2.size())
+        return false;
+
+    for (size_t i = 0; i < name1.size(); i++)
+    {
+        if (NormalizeNameChar(name1[i]) != NormalizeNameChar(name2[i]))
+            return false;
+    }
+    return true;
+}
+
+uint64_t OverlayArchive::HashName(string_view name)
+{
+    uint64_t hash = FnvOffsetBasis;
+    for (char c : name)
+    {
+        hash ^= (uint8_t)NormalizeNameChar(c);
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+bool OverlayArchive::Open(const uint8_t* pData, size_t size)
+{
+    Close();
+
+    if (size < HeaderSize || memcmp(pData, Magic, sizeof(Magic)) != 0)
+        return false;
+
+    uint32_t version;
+    uint32_t count;
+    uint32_t namesSize;
+    uint64_t indexHash;
+    memcpy(&version, pData + 4, 4);
+    memcpy(&count, pData + 8, 4);
+    memcpy(&namesSize, pData + 12, 4);
+    memcpy(&indexHash, pData + 16, 8);
+    if (version != Version || count > (size - HeaderSize) / IndexEntrySize)
+        return false;
+
+    size_t namesOffset = HeaderSize + (size_t)count * IndexEntrySize;
+    if (namesSize > size - namesOffset || Fnv1a(pData + HeaderSize, namesOffset - HeaderSize + namesSize) != indexHash)
+        return false;
+
+    uint64_t previousHash = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        IndexEntry entry = IndexEntry::Read(pData + HeaderSize + (size_t)i * IndexEntrySize);
+        if (entry.NameHash < previousHash ||
+            entry.NameOffset > namesSize || namesSize - entry.NameOffset < entry.NameLength ||
+            entry.DataOffset > size || size - entry.DataOffset < entry.StoredSize)
+        {
+            return false;
+        }
+
+        string_view name((const char*)pData + namesOffset + entry.NameOffset, entry.NameLength);
+        if (entry.NameHash != HashName(name))
+            return false;
+
+        if (entry.Method == (uint32_t)Compression::None ? entry.StoredSize != entry.Size : entry.Method != (uint32_t)Compression::Lz)
+            return false;
+
+        previousHash = entry.NameHash;
+    }
+
+    _pData = pData;
+    _pIndex = pData + HeaderSize;
+    _count = count;
+    return true;
+}
+
+void OverlayArchive::Close()
+{
+    _pData = nullptr;
+    _pIndex = nullptr;
+    _count = 0;
+}
+
+OverlayArchive::Entry OverlayArchive::GetEntry(int index) const
+{
+    return ToEntry(IndexEntry::Read(_pIndex + (size_t)index * IndexEntrySize));
+}
+
+bool OverlayArchive::Find(string_view name, Entry& entry) const
+{
+    uint64_t hash = HashName(name);
+
+    // Binary search for the first entry with this hash, then compare names in case of collisions
+    uint32_t low = 0;
+    uint32_t high = _count;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        uint64_t midHash;
+        memcpy(&midHash, _pIndex + (size_t)mid * IndexEntrySize, 8);
+        if (midHash < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    for (uint32_t i = low; i < _count; i++)
+    {
+        IndexEntry indexEntry = IndexEntry::Read(_pIndex + (size_t)i * IndexEntrySize);
+        if (indexEntry.NameHash != hash)
+            break;
+
+        Entry candidate = ToEntry(indexEntry);
+        if (NamesEqual(candidate.Name, name))
+        {
+            entry = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+OverlayArchive::Entry OverlayArchive::ToEntry(const IndexEntry& indexEntry) const
+{
+    const char* pNames = (const char*)_pIndex + (size_t)_count * IndexEntrySize;
+
+    Entry entry;
+    entry.Name = string_view(pNames + indexEntry.NameOffset, indexEntry.NameLength);
+    entry.Method = (Compression)indexEntry.Method;
+    entry.pData = _pData + indexEntry.DataOffset;
+    entry.StoredSize = indexEntry.StoredSize;
+    entry.Size = indexEntry.Size;
+    return entry;
+}
+
+bool OverlayArchive::Extract(const Entry& entry, uint8_t* pOutput)
+{
+    if (entry.Method == Compression::None)
+    {
+        copy(entry.pData, entry.pData + entry.Size, pOutput);
+        return true;
+    }
+
+    return DecompressLz(entry.pData, entry.StoredSize, pOutput, entry.Size);
+}
+
+static void AppendLength(vector<uint8_t>& output, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        output.push_back(255);
+    }
+    output.push_back((uint8_t)length);
+}
+
+static void AppendSequence(vector<uint8_t>& output, const uint8_t* pLiterals, size_t literalLength, size_t distance, size_t matchLength)
+{
+    size_t matchCode = matchLength != 0 ? matchLength - MinMatch : 0;
+    output.push_back((uint8_t)((min<size_t>(literalLength, 15) << 4) | min<size_t>(matchCode, 15)));
+    if (literalLength >= 15)
+        AppendLength(output, literalLength - 15);
+
+    output.insert(output.end(), pLiterals, pLiterals + literalLength);
+    if (matchLength == 0)
+        return;
+
+    output.push_back((uint8_t)distance);
+    output.push_back((uint8_t)(distance >> 8));
+    if (matchCode >= 15)
+        AppendLength(output, matchCode - 15);
+}
+
+vector<uint8_t> OverlayArchive::CompressLz(const uint8_t* pData, size_t size)
+{
+    vector<uint8_t> output;
+    output.reserve(size / 2 + 16);
+
+    // Greedy matching against the most recent position with the same four-byte hash
+    vector<int64_t> table((size_t)1 << HashBits, -1);
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (size - pos >= MinMatch)
+    {
+        uint32_t value;
+        memcpy(&value, pData + pos, 4);
+        uint32_t hash = (value * 2654435761u) >> (32 - HashBits);
+        int64_t candidate = table[hash];
+        table[hash] = (int64_t)pos;
+
+        if (candidate < 0 || pos - (size_t)candidate > MaxDistance || memcmp(pData + candidate, pData + pos, MinMatch) != 0)
+        {
+            pos++;
+            continue;
+        }
+
+        size_t length = MinMatch;
+        while (pos + length < size && pData[candidate + length] == pData[pos + length])
+        {
+            length++;
+        }
+
+        AppendSequence(output, pData + anchor, pos - anchor, pos - (size_t)candidate, length);
+        pos += length;
+        anchor = pos;
+    }
+
+    AppendSequence(output, pData + anchor, size - anchor, 0, 0);
+    return output;
+}
+
+static bool ReadLength(const uint8_t*& pInput, const uint8_t* pInputEnd, size_t& length)
+{
+    uint8_t byte;
+    do
+    {
+        if (pInput == pInputEnd)
+            return false;
+
+        byte = *pInput++;
+        length += byte;
+
+        // Lengths are checked against the buffers afterwards; this only keeps the sum from wrapping around
+        if (length > SIZE_MAX / 2)
+            return false;
+    } while (byte == 255);
+    return true;
+}
+
+bool OverlayArchive::DecompressLz(const uint8_t* pInput, size_t inputSize, uint8_t* pOutput, size_t outputSize)
+{
+    const uint8_t* pInputEnd = pInput + inputSize;
+    uint8_t* pOutputStart = pOutput;
+    uint8_t* pOutputEnd = pOutput + outputSize;
+    while (pInput < pInputEnd)
+    {
+        uint8_t token = *pInput++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(pInput, pInputEnd, literalLength))
+            return false;
+
+        if (literalLength > (size_t)(pInputEnd - pInput) || literalLength > (size_t)(pOutputEnd - pOutput))
+            return false;
+
+        copy(pInput, pInput + literalLength, pOutput);
+        pInput += literalLength;
+        pOutput += literalLength;
+        if (pInput == pInputEnd)
+            return pOutput == pOutputEnd;
+
+        if (pInputEnd - pInput < 2)
+            return false;
+
+        size_t distance = pInput[0] | (pInput[1] << 8);
+        pInput += 2;
+        if (distance == 0 || distance > (size_t)(pOutput - pOutputStart))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(pInput, pInputEnd, matchLength))
+            return false;
+
+        matchLength += MinMatch;
+        if (matchLength > (size_t)(pOutputEnd - pOutput))
+            return false;
+
+        // Byte by byte, since the match may overlap the bytes it produces
+        const uint8_t* pMatch = pOutput - distance;
+        for (size_t i = 0; i < matchLength; i++)
+        {
+            pOutput[i] = pMatch[i];
+        }
+        pOutput += matchLength;
+    }
+    return false;
+}
+
+bool OverlayArchiveWriter::Add(const string& name, const uint8_t* pData, size_t size, bool compress)
+{
+    if (size > UINT32_MAX)
+        return false;
+
+    uint64_t hash = OverlayArchive::HashName(name);
+    for (const PendingEntry& entry : _entries)
+    {
+        if (entry.Hash == hash && NamesEqual(entry.Name, name))
+            return false;
+    }
+
+    PendingEntry entry;
+    entry.Name = name;
+    entry.Hash = hash;
+    entry.Method = OverlayArchive::Compression::None;
+    entry.Size = (uint32_t)size;
+    if (compress)
+    {
+        entry.StoredData = OverlayArchive::CompressLz(pData, size);
+        if (entry.StoredData.size() <= size - size / 16)
+            entry.Method = OverlayArchive::Compression::Lz;
+    }
+
+    if (entry.Method == OverlayArchive::Compression::None)
+        entry.StoredData.assign(pData, pData + size);
+
+    _entries.push_back(move(entry));
+    return true;
+}
+
+vector<uint8_t> OverlayArchiveWriter::Serialize() const
+{
+    vector<const PendingEntry*> entries;
+    for (const PendingEntry& entry : _entries)
+    {
+        entries.push_back(&entry);
+    }
+    stable_sort(entries.begin(), entries.end(), [](const PendingEntry* pEntry1, const PendingEntry* pEntry2) { return pEntry1->Hash < pEntry2->Hash; });
+
+    string names;
+    for (const PendingEntry* pEntry : entries)
+    {
+        names += pEntry->Name;
+    }
+
+    vector<uint8_t> data(Magic, Magic + sizeof(Magic));
+    Append<uint32_t>(data, Version);
+    Append<uint32_t>(data, (uint32_t)entries.size());
+    Append<uint32_t>(data, (uint32_t)names.size());
+    Append<uint64_t>(data, 0);
+    Append<uint64_t>(data, 0);
+
+    uint64_t dataOffset = HeaderSize + entries.size() * IndexEntrySize + names.size();
+    uint32_t nameOffset = 0;
+    for (const PendingEntry* pEntry : entries)
+    {
+        Append<uint64_t>(data, pEntry->Hash);
+        Append<uint32_t>(data, nameOffset);
+        Append<uint32_t>(data, (uint32_t)pEntry->Name.size());
+        Append<uint64_t>(data, dataOffset);
+        Append<uint32_t>(data, (uint32_t)pEntry->StoredData.size());
+        Append<uint32_t>(data, pEntry->Size);
+        Append<uint32_t>(data, (uint32_t)pEntry->Method);
+        Append<uint32_t>(data, 0);
+
+        nameOffset += (uint32_t)pEntry->Name.size();
+        dataOffset += pEntry->StoredData.size();
+    }
+    data.insert(data.end(), names.begin(), names.end());
+
+    uint64_t indexHash = Fnv1a(data.data() + HeaderSize, data.size() - HeaderSize);
+    memcpy(data.data() + 16, &indexHash, 8);
+
+    data.reserve(dataOffset);
+    for (const PendingEntry* pEntry : entries)
+    {
+        data.insert(data.end(), pEntry->StoredData.begin(), pEntry->StoredData.end());
+    }
+    return data;
+}
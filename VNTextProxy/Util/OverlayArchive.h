@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reader for overlay archives: one file holding the translated assets the proxy serves in place of the loose
+// files in the game's data\ folder. Meant to be read from a memory mapping: the index is a table sorted by
+// name hash that's binary searched in place, and stored entries are handed out as pointers into the buffer.
+// Entries can optionally be compressed with a small LZ77 codec, in which case they have to be extracted.
+// Every offset and size is checked when the archive is opened, so lookups and reads can't leave the buffer.
+// Names are UTF-8 paths relative to data\, with '\' as separator, matched without regard to ASCII case.
+// Standard library only.
+class OverlayArchive
+{
+public:
+    enum class Compression : uint32_t
+    {
+        None = 0,
+        Lz = 1
+    };
+
+    struct Entry
+    {
+        std::string_view    Name;
+        Compression         Method;
+        const uint8_t*      pData;          // Stored bytes; only the file contents if Method is None
+        uint32_t            StoredSize;
+        uint32_t            Size;           // Size of the file contents
+    };
+
+    // Returns false if the data isn't an overlay archive, is from another version, or is corrupt
+    bool Open(const uint8_t* pData, size_t size);
+    void Close();
+    bool IsOpen() const { return _pIndex != nullptr; }
+
+    int GetCount() const { return (int)_count; }
+    Entry GetEntry(int index) const;
+    bool Find(std::string_view name, Entry& entry) const;
+
+    // Writes the file contents to pOutput, which must hold entry.Size bytes.
+    // Returns false if a compressed entry turns out to be corrupt.
+    static bool Extract(const Entry& entry, uint8_t* pOutput);
+
+    // FNV-1a of the name with '/' turned into '\' and ASCII letters lowercased
+    static uint64_t HashName(std::string_view name);
+
+    static std::vector<uint8_t> CompressLz(const uint8_t* pData, size_t size);
+    // Returns false unless the compressed data decodes to exactly outputSize bytes
+    static bool DecompressLz(const uint8_t* pInput, size_t inputSize, uint8_t* pOutput, size_t outputSize);
+
+private:
+    struct IndexEntry;
+
+    Entry ToEntry(const IndexEntry& indexEntry) const;
+
+    const uint8_t* _pData = nullptr;
+    const uint8_t* _pIndex = nullptr;
+    uint32_t _count = 0;
+};
+
+// Builds an overlay archive in memory. Entries are compressed as they're added, so only the stored bytes are kept.
+class OverlayArchiveWriter
+{
+public:
+    // Compressed entries fall back to being stored if compression doesn't save at least 1/16 of their size.
+    // Returns false if the name is already taken or the file is too large for the format.
+    bool Add(const std::string& name, const uint8_t* pData, size_t size, bool compress);
+
+    std::vector<uint8_t> Serialize() const;
+
+    int GetCount() const { return (int)_entries.size(); }
+
+private:
+    struct PendingEntry
+    {
+        std::string             Name;
+        uint64_t                Hash;
+        OverlayArchive::Compression Method;
+        uint32_t                Size;
+        std::vector<uint8_t>    StoredData;
+    };
+
+    std::vector<PendingEntry> _entries;
+};
@@ -0,0 +1,120 @@
+#include "PathCache.h"
+
+#include <cstring>
+
+using namespace std;
+
+PathCache::PathCache(int capacity)
+{
+    _numSets = capacity > Ways ? (capacity + Ways - 1) / Ways : 1;
+    _entries.resize((size_t)_numSets * Ways);
+}
+
+uint64_t PathCache::Hash(string_view path)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (char c : path)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+PathCache::Entry* PathCache::Find(string_view path, uint64_t hash)
+{
+    Entry* pSet = &_entries[(hash % _numSets) * Ways];
+    for (int i = 0; i < Ways; i++)
+    {
+        Entry& entry = pSet[i];
+        if (entry.Used && entry.Hash == hash && entry.Path == path)
+        {
+            entry.LastUse = ++_useCounter;
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+int PathCache::Get(string_view path, uint64_t hash, wchar_t* pOutput, int outputSize, bool& knownMissing)
+{
+    lock_guard lock(_mutex);
+
+    knownMissing = false;
+    Entry* pEntry = Find(path, hash);
+    if (pEntry == nullptr || (int)pEntry->DecodedPath.size() >= outputSize)
+    {
+        _stats.Misses++;
+        return -1;
+    }
+
+    _stats.Hits++;
+    if (pEntry->Missing)
+        _stats.MissingHits++;
+
+    knownMissing = pEntry->Missing;
+    memcpy(pOutput, pEntry->DecodedPath.data(), pEntry->DecodedPath.size() * sizeof(wchar_t));
+    pOutput[pEntry->DecodedPath.size()] = L'\0';
+    return (int)pEntry->DecodedPath.size();
+}
+
+void PathCache::Add(string_view path, uint64_t hash, wstring_view decodedPath)
+{
+    lock_guard lock(_mutex);
+
+    if (Find(path, hash) != nullptr)
+        return;
+
+    Entry* pSet = &_entries[(hash % _numSets) * Ways];
+    Entry* pVictim = &pSet[0];
+    for (int i = 0; i < Ways; i++)
+    {
+        if (!pSet[i].Used)
+        {
+            pVictim = &pSet[i];
+            break;
+        }
+
+        if (pSet[i].LastUse < pVictim->LastUse)
+            pVictim = &pSet[i];
+    }
+
+    if (pVictim->Used)
+        _stats.Evictions++;
+
+    // assign() reuses the evicted entry's string buffers
+    pVictim->Used = true;
+    pVictim->Missing = false;
+    pVictim->Hash = hash;
+    pVictim->LastUse = ++_useCounter;
+    pVictim->Path.assign(path);
+    pVictim->DecodedPath.assign(decodedPath);
+}
+
+bool PathCache::SetMissing(string_view path, uint64_t hash, bool missing)
+{
+    lock_guard lock(_mutex);
+
+    Entry* pEntry = Find(path, hash);
+    if (pEntry == nullptr)
+        return false;
+
+    pEntry->Missing = missing;
+    return true;
+}
+
+void PathCache::ClearMissing()
+{
+    lock_guard lock(_mutex);
+
+    for (Entry& entry : _entries)
+    {
+        entry.Missing = false;
+    }
+}
+
+PathCache::Stats PathCache::GetStats()
+{
+    lock_guard lock(_mutex);
+    return _stats;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bounded, thread-safe map from SJIS path bytes to the decoded UTF-16 path, for the file API hooks that
+// get the same few hundred paths over and over. Entries can also remember that the file doesn't exist.
+// Four-way set associative with least-recently-used replacement within a set, so memory stays fixed and
+// a lookup compares at most four stored hashes. Standard library only.
+class PathCache
+{
+public:
+    struct Stats
+    {
+        uint64_t Hits;
+        uint64_t Misses;
+        uint64_t MissingHits;       // Lookups answered with "known not to exist"
+        uint64_t Evictions;
+    };
+
+    // Capacity is rounded up to a multiple of the associativity
+    explicit PathCache(int capacity = 1024);
+
+    // FNV-1a of the path bytes, computed once per hook call and passed to the other methods
+    static uint64_t Hash(std::string_view path);
+
+    // Copies the cached path into pOutput and NUL-terminates it. Returns its length without the terminator,
+    // or -1 if the path isn't cached or doesn't fit. knownMissing reports the entry's missing flag.
+    int Get(std::string_view path, uint64_t hash, wchar_t* pOutput, int outputSize, bool& knownMissing);
+
+    void Add(std::string_view path, uint64_t hash, std::wstring_view decodedPath);
+
+    // Only affects a cached path; returns false if it isn't cached
+    bool SetMissing(std::string_view path, uint64_t hash, bool missing);
+    void ClearMissing();
+
+    Stats GetStats();
+
+private:
+    static constexpr int Ways = 4;
+
+    struct Entry
+    {
+        bool Used = false;
+        bool Missing = false;
+        uint64_t Hash = 0;
+        uint32_t LastUse = 0;
+        std::string Path;
+        std::wstring DecodedPath;
+    };
+
+    Entry* Find(std::string_view path, uint64_t hash);
+
+    std::mutex _mutex;
+    std::vector<Entry> _entries;
+    int _numSets;
+    uint32_t _useCounter = 0;
+    Stats _stats{};
+};
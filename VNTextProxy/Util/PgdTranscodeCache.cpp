@@ -0,0 +1,161 @@
+#include "PgdTranscodeCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "../../PACPacking/Common/PacArchive.h"
+#include "../../PACPacking/Common/PgdEncoder.h"
+#include "../../PACPacking/Common/PngFile.h"
+#include "../../PACPacking/Common/Xxh64.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Part of every key, so that files from an encoder with other settings aren't picked up
+static constexpr char CacheVersion[] = "GE3-fast-1";
+static constexpr size_t HeaderSize = 0x20;
+
+static uint32_t Read32(const uint8_t* p) { uint32_t value; memcpy(&value, p, 4); return value; }
+
+static string ToLower(string text)
+{
+    transform(text.begin(), text.end(), text.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+    return text;
+}
+
+void PgdTranscodeCache::Init(const fs::path& cacheFolder, const vector<fs::path>& archivePaths)
+{
+    lock_guard lock(_originalsMutex);
+    _cacheFolder = cacheFolder;
+    _archivePaths = archivePaths;
+    _originalsLoaded = false;
+    _originals.clear();
+}
+
+bool PgdTranscodeCache::Get(const fs::path& pngPath, const string& entryName, vector<uint8_t>& pgd, bool& fromCache,
+                            string& error)
+{
+    vector<uint8_t> png;
+    if (!FileUtil::ReadAll(pngPath.u8string(), png))
+    {
+        error = "can't read the file";
+        return false;
+    }
+
+    vector<uint8_t> header;
+    ReadOriginalHeader(entryName, header);
+
+    Xxh64 hasher;
+    uint8_t headerSize = (uint8_t)header.size();
+    hasher.Update(CacheVersion, sizeof(CacheVersion));
+    hasher.Update(&headerSize, 1);
+    if (!header.empty())
+        hasher.Update(header.data(), header.size());
+
+    hasher.Update(png.data(), png.size());
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "%016llx.pgd", (unsigned long long)hasher.Final());
+    fs::path cachePath = _cacheFolder / fileName;
+
+    if (FileUtil::ReadAll(cachePath.u8string(), pgd) && pgd.size() >= HeaderSize && memcmp(pgd.data(), "GE", 2) == 0)
+    {
+        fromCache = true;
+        return true;
+    }
+
+    fromCache = false;
+    if (!Transcode(png, header, pgd, error))
+        return false;
+
+    // Written under a temporary name and renamed, so that a cache file is never seen half written. Failing to
+    // write it only means transcoding again next time.
+    static atomic<uint32_t> NumTemporaryFiles{};
+    error_code errorCode;
+    fs::create_directories(_cacheFolder, errorCode);
+    fs::path temporaryPath = cachePath;
+    temporaryPath += "." + to_string(NumTemporaryFiles++) + ".tmp";
+    if (!FileUtil::WriteAll(temporaryPath.u8string(), pgd.data(), pgd.size()))
+        return true;
+
+    fs::rename(temporaryPath, cachePath, errorCode);
+    if (errorCode)
+        fs::remove(temporaryPath, errorCode);
+
+    return true;
+}
+
+// Indexes the directories of the archives; the data stays on disk
+void PgdTranscodeCache::LoadOriginals()
+{
+    for (int i = 0; i < (int)_archivePaths.size(); i++)
+    {
+        PacArchive archive;
+        if (!archive.Open(_archivePaths[i].u8string()))
+            continue;
+
+        for (int j = 0; j < archive.GetCount(); j++)
+        {
+            const PacArchive::Entry& entry = archive.GetEntry(j);
+            _originals.emplace(ToLower(entry.Name), Original{ i, entry.Offset, entry.Size });
+        }
+    }
+    _originalsLoaded = true;
+}
+
+// Gets the header of the original picture, if there is one and it's a GE picture
+bool PgdTranscodeCache::ReadOriginalHeader(const string& entryName, vector<uint8_t>& header)
+{
+    Original original;
+    fs::path archivePath;
+    {
+        lock_guard lock(_originalsMutex);
+        if (!_originalsLoaded)
+            LoadOriginals();
+
+        auto it = _originals.find(ToLower(entryName));
+        if (it == _originals.end())
+            return false;
+
+        original = it->second;
+        archivePath = _archivePaths[original.Archive];
+    }
+
+    if (original.Size < HeaderSize)
+        return false;
+
+    FILE* pFile = FileUtil::Open(archivePath.u8string(), "rb");
+    if (pFile == nullptr)
+        return false;
+
+    header.resize(HeaderSize);
+    bool success = FileUtil::ReadAt(pFile, original.Offset, header.data(), HeaderSize) &&
+                   memcmp(header.data(), "GE", 2) == 0;
+    fclose(pFile);
+    if (!success)
+        header.clear();
+
+    return success;
+}
+
+bool PgdTranscodeCache::Transcode(const vector<uint8_t>& png, const vector<uint8_t>& header, vector<uint8_t>& pgd,
+                                  string& error)
+{
+    PgdImage image;
+    if (!PngFile::Decode(png.data(), png.size(), image.Width, image.Height, image.Channels, image.Pixels, error))
+        return false;
+
+    // The game waits for the picture, so its bands are compressed on all cores
+    PgdEncodeOptions options;
+    options.Method = 3;
+    options.Preset = PgdPreset::Fast;
+    options.NumThreads = max(1, (int)thread::hardware_concurrency());
+    if (!header.empty() && Read32(header.data() + 0xC) == (uint32_t)image.Width &&
+        Read32(header.data() + 0x10) == (uint32_t)image.Height)
+    {
+        options.pTemplate = header.data();
+    }
+    return PgdEncoder::Encode(image, options, pgd, error);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Turns the PNGs a translator puts in data\ into GE pictures (type 3, fast preset) for the proxy to serve in place
+// of the PGDs they replace, so an edited image shows up without a repack. Each picture keeps the position of the
+// original in the game's pac archives when the size is the same, as PacBuild does. Results are stored in a cache
+// folder under the hash of the PNG's bytes and the original's header, so a picture is only transcoded again after
+// it changes. Standard library only, apart from the PNG decoder and GE encoder in PACPacking\Common.
+class PgdTranscodeCache
+{
+public:
+    // Nothing is read until the first Get
+    void Init(const std::filesystem::path& cacheFolder, const std::vector<std::filesystem::path>& archivePaths);
+
+    // Returns the GE picture for a PNG standing in for the archive entry of the given name (e.g. "ETC_TEGAMI01.PGD").
+    // fromCache tells whether it was found in the cache folder or transcoded now.
+    bool Get(const std::filesystem::path& pngPath, const std::string& entryName, std::vector<uint8_t>& pgd,
+             bool& fromCache, std::string& error);
+
+private:
+    struct Original
+    {
+        int         Archive;
+        uint32_t    Offset;
+        uint32_t    Size;
+    };
+
+    void LoadOriginals();
+    bool ReadOriginalHeader(const std::string& entryName, std::vector<uint8_t>& header);
+    bool Transcode(const std::vector<uint8_t>& png, const std::vector<uint8_t>& header, std::vector<uint8_t>& pgd,
+                   std::string& error);
+
+    std::filesystem::path _cacheFolder;
+    std::vector<std::filesystem::path> _archivePaths;
+
+    std::mutex _originalsMutex;
+    bool _originalsLoaded = false;
+    std::map<std::string, Original> _originals;         // By lower case name; the first archive that has it wins
+};
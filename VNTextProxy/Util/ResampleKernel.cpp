@@ -0,0 +1,113 @@
+#include "ResampleKernel.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace ResampleKernel
+{
+    static constexpr double Pi = 3.14159265358979323846;
+
+    static double Sinc(double x)
+    {
+        if (x == 0.0)
+            return 1.0;
+
+        return sin(Pi * x) / (Pi * x);
+    }
+
+    int TapCount(Filter filter)
+    {
+        switch (filter)
+        {
+            case Filter::Lanczos3:
+                return 6;
+
+            default:
+                return 4;
+        }
+    }
+
+    int FirstTapOffset(Filter filter)
+    {
+        return TapCount(filter) / 2 - 1;
+    }
+
+    void ComputeWeights(Filter filter, float frac, float* pWeights)
+    {
+        switch (filter)
+        {
+            case Filter::CatmullRom:
+            {
+                // Written out the same way as the shader so rounding matches too
+                float x = frac;
+                float x2 = x * x;
+                float x3 = x2 * x;
+                pWeights[0] = -0.5f * x3 + x2 - 0.5f * x;
+                pWeights[1] = 1.5f * x3 - 2.5f * x2 + 1.0f;
+                pWeights[2] = -1.5f * x3 + 2.0f * x2 + 0.5f * x;
+                pWeights[3] = 0.5f * x3 - 0.5f * x2;
+                break;
+            }
+
+            case Filter::Lanczos3:
+            {
+                int taps = TapCount(filter);
+                int first = FirstTapOffset(filter);
+                double sum = 0;
+                double weights[6];
+                for (int i = 0; i < taps; i++)
+                {
+                    double distance = (double)(i - first) - frac;
+                    weights[i] = fabs(distance) < 3.0 ? Sinc(distance) * Sinc(distance / 3.0) : 0.0;
+                    sum += weights[i];
+                }
+
+                for (int i = 0; i < taps; i++)
+                    pWeights[i] = (float)(weights[i] / sum);
+
+                break;
+            }
+        }
+    }
+
+    vector<float> BuildWeightTable(Filter filter, int phases)
+    {
+        vector<float> table((size_t)phases * MaxTaps, 0.0f);
+        for (int i = 0; i < phases; i++)
+        {
+            float frac = phases > 1 ? (float)i / (float)(phases - 1) : 0.0f;
+            ComputeWeights(filter, frac, &table[(size_t)i * MaxTaps]);
+        }
+        return table;
+    }
+
+    bool TryParse(const string& name, Filter& filter)
+    {
+        if (name == "bicubic")
+        {
+            filter = Filter::CatmullRom;
+            return true;
+        }
+
+        if (name == "lanczos")
+        {
+            filter = Filter::Lanczos3;
+            return true;
+        }
+
+        return false;
+    }
+
+    const char* GetName(Filter filter)
+    {
+        switch (filter)
+        {
+            case Filter::Lanczos3:
+                return "lanczos";
+
+            default:
+                return "bicubic";
+        }
+    }
+}
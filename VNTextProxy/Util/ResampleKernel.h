@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Resampling kernel coefficients shared by the DX9 pixel-shader scaler, the DX11 bicubic shader and the
+// FrameReplay CPU scalers, so all of them weight the same source texels the same way.
+// Standard library only.
+//
+// A sample at source position p (texel centers at n + 0.5) uses the TapCount() texels starting at
+// floor(p - 0.5) - FirstTapOffset(), weighted by ComputeWeights(frac(p - 0.5)).
+namespace ResampleKernel
+{
+    enum class Filter
+    {
+        CatmullRom,     // Bicubic, a = -0.5. Same polynomial as CubicWeights() in g_BicubicShader.
+        Lanczos3
+    };
+
+    // Widest kernel supported; weight tables always store this many weights per phase
+    constexpr int MaxTaps = 8;
+
+    int TapCount(Filter filter);
+    int FirstTapOffset(Filter filter);
+
+    // Fills TapCount() weights for the given fractional position (0 <= frac < 1). Weights sum to 1.
+    void ComputeWeights(Filter filter, float frac, float* pWeights);
+
+    // Table of `phases` rows of MaxTaps weights, row i holding the weights for frac = i / (phases - 1).
+    // Unused taps are zero. This is the layout of the DX9 scaler's weight texture.
+    std::vector<float> BuildWeightTable(Filter filter, int phases);
+
+    // "bicubic" or "lanczos"
+    bool TryParse(const std::string& name, Filter& filter);
+    const char* GetName(Filter filter);
+}
@@ -62,6 +62,10 @@ void RuntimeConfig::Load()
         _proportionalLineWidth = config.at("proportionalLineWidth").get<int>();
         _maxLineWidth = config.at("maxLineWidth").get<int>();
         _numLinesWarnThreshold = config.at("numLinesWarnThreshold").get<int>();
+        _frameCaptureFile = config.value("frameCaptureFile", std::string());
+        _frameCaptureMaxFrames = config.value("frameCaptureMaxFrames", 3600);
+        _overlayArchive = Utf8ToWstring(config.value("overlayArchive", std::string("data.overlay")));
+        _pngOverrideCache = Utf8ToWstring(config.value("pngOverrideCache", std::string()));
 
         // Read graphicsMode string (required, no default)
         if (!config.contains("graphicsMode")) {
@@ -84,6 +88,24 @@ void RuntimeConfig::Load()
             ShowErrorAndExit(L"Invalid graphicsMode value: \"" + Utf8ToWstring(graphicsMode) + L"\"\n\n"
                 L"Valid values: \"raw\", \"dx9\", \"dx11\"");
         }
+
+        _directX9Filter = config.value("dx9Filter", std::string("bicubic"));
+        if (_directX9Filter != "linear" && _directX9Filter != "bicubic" && _directX9Filter != "lanczos") {
+            ShowErrorAndExit(L"Invalid dx9Filter value: \"" + Utf8ToWstring(_directX9Filter) + L"\"\n\n"
+                L"Valid values: \"linear\", \"bicubic\", \"lanczos\"");
+        }
+
+        _maxFrameLatency = config.value("maxFrameLatency", 1);
+        if (_maxFrameLatency < 1 || _maxFrameLatency > 16) {
+            ShowErrorAndExit(L"Invalid maxFrameLatency value: " + std::to_wstring(_maxFrameLatency) + L"\n\n"
+                L"Valid values: 1 to 16");
+        }
+
+        _subtitleLookahead = config.value("subtitleLookahead", 2);
+        if (_subtitleLookahead < 0 || _subtitleLookahead > 16) {
+            ShowErrorAndExit(L"Invalid subtitleLookahead value: " + std::to_wstring(_subtitleLookahead) + L"\n\n"
+                L"Valid values: 0 to 16");
+        }
     }
     catch (const json::exception& e)
     {
@@ -104,6 +126,9 @@ void RuntimeConfig::Load()
         _pillarboxedFullscreen ? (_directX11Upscaling ? "dx11" : "dx9") : "raw",
         _pillarboxedFullscreen ? "true" : "false",
         _directX11Upscaling ? "true" : "false");
+    proxy_log(LogCategory::INIT, "  dx9Filter: %s", _directX9Filter.c_str());
+    proxy_log(LogCategory::INIT, "  maxFrameLatency: %d", _maxFrameLatency);
+    proxy_log(LogCategory::INIT, "  subtitleLookahead: %d", _subtitleLookahead);
     proxy_log(LogCategory::INIT, "  customFontFilename: %ls", _customFontFilename.c_str());
     proxy_log(LogCategory::INIT, "  monospaceFontFilename: %ls", _monospaceFontFilename.c_str());
     proxy_log(LogCategory::INIT, "  fontHeightIncrease: %d", _fontHeightIncrease);
@@ -112,6 +137,10 @@ void RuntimeConfig::Load()
     proxy_log(LogCategory::INIT, "  proportionalLineWidth: %d", _proportionalLineWidth);
     proxy_log(LogCategory::INIT, "  maxLineWidth: %d", _maxLineWidth);
     proxy_log(LogCategory::INIT, "  numLinesWarnThreshold: %d", _numLinesWarnThreshold);
+    if (!_frameCaptureFile.empty())
+        proxy_log(LogCategory::INIT, "  frameCaptureFile: %s (max %d frames)", _frameCaptureFile.c_str(), _frameCaptureMaxFrames);
+    proxy_log(LogCategory::INIT, "  overlayArchive: %ls", _overlayArchive.c_str());
+    proxy_log(LogCategory::INIT, "  pngOverrideCache: %ls", _pngOverrideCache.c_str());
 }
 
 bool RuntimeConfig::DebugLogging() { return _debugLogging; }
@@ -119,6 +148,9 @@ bool RuntimeConfig::EnableFontSubstitution() { return _enableFontSubstitution; }
 bool RuntimeConfig::JapaneseFontFallback() { return _japaneseFontFallback; }
 bool RuntimeConfig::PillarboxedFullscreen() { return _pillarboxedFullscreen; }
 bool RuntimeConfig::DirectX11Upscaling() { return _directX11Upscaling; }
+const std::string& RuntimeConfig::DirectX9Filter() { return _directX9Filter; }
+int RuntimeConfig::MaxFrameLatency() { return _maxFrameLatency; }
+int RuntimeConfig::SubtitleLookahead() { return _subtitleLookahead; }
 void RuntimeConfig::OverrideToRaw()
 {
     if (!_pillarboxedFullscreen)
@@ -135,3 +167,7 @@ int RuntimeConfig::FontYTopPosDecrease() { return _fontYTopPosDecrease; }
 int RuntimeConfig::ProportionalLineWidth() { return _proportionalLineWidth; }
 int RuntimeConfig::MaxLineWidth() { return _maxLineWidth; }
 int RuntimeConfig::NumLinesWarnThreshold() { return _numLinesWarnThreshold; }
+const std::string& RuntimeConfig::FrameCaptureFile() { return _frameCaptureFile; }
+int RuntimeConfig::FrameCaptureMaxFrames() { return _frameCaptureMaxFrames; }
+const std::wstring& RuntimeConfig::OverlayArchive() { return _overlayArchive; }
+const std::wstring& RuntimeConfig::PngOverrideCache() { return _pngOverrideCache; }
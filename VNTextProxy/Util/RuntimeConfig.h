@@ -16,6 +16,9 @@ public:
     static bool JapaneseFontFallback();
     static bool PillarboxedFullscreen();
     static bool DirectX11Upscaling();
+    static const std::string& DirectX9Filter();
+    static int MaxFrameLatency();
+    static int SubtitleLookahead();
     static void OverrideToRaw();
     static const std::wstring& CustomFontFilename();
     static const std::wstring& MonospaceFontFilename();
@@ -25,6 +28,10 @@ public:
     static int ProportionalLineWidth();
     static int MaxLineWidth();
     static int NumLinesWarnThreshold();
+    static const std::string& FrameCaptureFile();
+    static int FrameCaptureMaxFrames();
+    static const std::wstring& OverlayArchive();
+    static const std::wstring& PngOverrideCache();
 
 private:
     static inline bool _loaded = false;
@@ -33,6 +40,9 @@ private:
     static inline bool _japaneseFontFallback;
     static inline bool _pillarboxedFullscreen;
     static inline bool _directX11Upscaling;
+    static inline std::string _directX9Filter;
+    static inline int _maxFrameLatency;
+    static inline int _subtitleLookahead;
     static inline std::wstring _customFontFilename;
     static inline std::wstring _monospaceFontFilename;
     static inline int _fontHeightIncrease;
@@ -41,4 +51,8 @@ private:
     static inline int _proportionalLineWidth;
     static inline int _maxLineWidth;
     static inline int _numLinesWarnThreshold;
+    static inline std::string _frameCaptureFile;
+    static inline int _frameCaptureMaxFrames;
+    static inline std::wstring _overlayArchive;
+    static inline std::wstring _pngOverrideCache;
 };
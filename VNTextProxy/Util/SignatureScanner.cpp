@@ -0,0 +1,266 @@
+#include "SignatureScanner.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+static inline int CountTrailingZeros(uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+// Bitmask with the lowest `count` bits set, for 0 <= count <= 32
+static inline uint32_t LowBits(int count)
+{
+    return count >= 32 ? 0xFFFFFFFF : (1u << count) - 1;
+}
+
+struct SignatureScanner::ScalarCandidateFinder
+{
+    static constexpr int Width = 32;
+
+    static uint32_t Find(const Pattern& pattern, const uint8_t* pBlock)
+    {
+        return FindCandidatesScalar(pattern, pBlock, Width);
+    }
+};
+
+struct SignatureScanner::Sse2CandidateFinder
+{
+    // Two 16-byte halves per block, so the per-block work in ScanWith is shared by as many positions as with AVX2
+    static constexpr int Width = 32;
+
+    static uint32_t Find(const Pattern& pattern, const uint8_t* pBlock)
+    {
+        return FindHalf(pattern, pBlock) | (FindHalf(pattern, pBlock + 16) << 16);
+    }
+
+    static uint32_t FindHalf(const Pattern& pattern, const uint8_t* pBlock)
+    {
+        __m128i first = _mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i*)(pBlock + pattern.Anchor1)),
+            _mm_set1_epi8((char)pattern.Bytes[pattern.Anchor1])
+        );
+        __m128i second = _mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i*)(pBlock + pattern.Anchor2)),
+            _mm_set1_epi8((char)pattern.Bytes[pattern.Anchor2])
+        );
+        return (uint32_t)_mm_movemask_epi8(_mm_and_si128(first, second));
+    }
+};
+
+struct SignatureScanner::Avx2CandidateFinder
+{
+    static constexpr int Width = 32;
+
+    TARGET_AVX2 static uint32_t Find(const Pattern& pattern, const uint8_t* pBlock)
+    {
+        __m256i first = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)(pBlock + pattern.Anchor1)),
+            _mm256_set1_epi8((char)pattern.Bytes[pattern.Anchor1])
+        );
+        __m256i second = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)(pBlock + pattern.Anchor2)),
+            _mm256_set1_epi8((char)pattern.Bytes[pattern.Anchor2])
+        );
+        return (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(first, second));
+    }
+};
+
+int SignatureScanner::AddPattern(const void* pPattern, const void* pMask, int length)
+{
+    Pattern pattern;
+    pattern.Bytes.assign((const uint8_t*)pPattern, (const uint8_t*)pPattern + length);
+    if (pMask != nullptr)
+        pattern.Mask.assign((const uint8_t*)pMask, (const uint8_t*)pMask + length);
+    else
+        pattern.Mask.assign(length, 0xFF);
+
+    pattern.Exact = true;
+    pattern.Anchor1 = -1;
+    pattern.Anchor2 = -1;
+    for (int i = 0; i < length; i++)
+    {
+        if (pattern.Mask[i] != 0xFF)
+        {
+            pattern.Exact = false;
+            continue;
+        }
+
+        int rank = GetByteFrequencyRank(pattern.Bytes[i]);
+        if (pattern.Anchor1 < 0 || rank > GetByteFrequencyRank(pattern.Bytes[pattern.Anchor1]))
+        {
+            pattern.Anchor2 = pattern.Anchor1;
+            pattern.Anchor1 = i;
+        }
+        else if (pattern.Anchor2 < 0 || rank > GetByteFrequencyRank(pattern.Bytes[pattern.Anchor2]))
+        {
+            pattern.Anchor2 = i;
+        }
+    }
+
+    // With a single fully masked byte, both compares test the same position
+    if (pattern.Anchor2 < 0)
+        pattern.Anchor2 = pattern.Anchor1;
+
+    pattern.AnchorReach = max(pattern.Anchor1, pattern.Anchor2) + 1;
+    _patterns.push_back(move(pattern));
+    return (int)_patterns.size() - 1;
+}
+
+vector<const uint8_t*> SignatureScanner::Scan(const void* pHaystack, size_t length, Implementation implementation) const
+{
+    if (implementation == Implementation::Auto)
+        implementation = CpuFeatures::HasAvx2() ? Implementation::Avx2 : Implementation::Sse2;
+
+    switch (implementation)
+    {
+        case Implementation::Scalar:
+            return ScanWith<ScalarCandidateFinder>((const uint8_t*)pHaystack, length);
+
+        case Implementation::Sse2:
+            return ScanWith<Sse2CandidateFinder>((const uint8_t*)pHaystack, length);
+
+        default:
+            return ScanWith<Avx2CandidateFinder>((const uint8_t*)pHaystack, length);
+    }
+}
+
+const uint8_t* SignatureScanner::FindFirst(const void* pHaystack, size_t length, const void* pPattern, const void* pMask, int patternLength)
+{
+    SignatureScanner scanner;
+    scanner.AddPattern(pPattern, pMask, patternLength);
+    return scanner.Scan(pHaystack, length)[0];
+}
+
+// Walks the haystack once in blocks of TCandidateFinder::Width positions. For each pattern that hasn't
+// been found yet, the finder returns a bitmask of positions in the block whose anchor bytes match.
+template<typename TCandidateFinder>
+vector<const uint8_t*> SignatureScanner::ScanWith(const uint8_t* pHaystack, size_t length) const
+{
+    constexpr int Width = TCandidateFinder::Width;
+
+    vector<const uint8_t*> results(_patterns.size(), nullptr);
+    vector<bool> done(_patterns.size(), false);
+    int remaining = (int)_patterns.size();
+
+    for (size_t blockStart = 0; blockStart < length && remaining > 0; blockStart += Width)
+    {
+        const uint8_t* pBlock = pHaystack + blockStart;
+        for (size_t i = 0; i < _patterns.size(); i++)
+        {
+            if (done[i])
+                continue;
+
+            const Pattern& pattern = _patterns[i];
+            size_t patternLength = pattern.Bytes.size();
+            if (patternLength == 0 || patternLength > length || blockStart > length - patternLength)
+            {
+                // Past the last position the pattern can start at
+                done[i] = true;
+                remaining--;
+                continue;
+            }
+
+            // Positions in this block the pattern can start at without running off the end
+            size_t lastStart = length - patternLength;
+            int count = (int)min<size_t>(Width, lastStart - blockStart + 1);
+
+            uint32_t candidates;
+            if (pattern.Anchor1 < 0)
+                candidates = LowBits(count);
+            else if (blockStart + pattern.AnchorReach + Width - 1 <= length)
+                candidates = TCandidateFinder::Find(pattern, pBlock) & LowBits(count);
+            else
+                candidates = FindCandidatesScalar(pattern, pBlock, count);
+
+            while (candidates != 0)
+            {
+                const uint8_t* pCandidate = pBlock + CountTrailingZeros(candidates);
+                if (Verify(pattern, pCandidate))
+                {
+                    results[i] = pCandidate;
+                    done[i] = true;
+                    remaining--;
+                    break;
+                }
+                candidates &= candidates - 1;
+            }
+        }
+    }
+    return results;
+}
+
+// Checks the anchors of up to 32 positions one by one
+uint32_t SignatureScanner::FindCandidatesScalar(const Pattern& pattern, const uint8_t* pBlock, int count)
+{
+    if (pattern.Anchor1 < 0)
+        return LowBits(count);
+
+    uint8_t anchor1 = pattern.Bytes[pattern.Anchor1];
+    uint8_t anchor2 = pattern.Bytes[pattern.Anchor2];
+    uint32_t candidates = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (pBlock[i + pattern.Anchor1] == anchor1 && pBlock[i + pattern.Anchor2] == anchor2)
+            candidates |= 1u << i;
+    }
+    return candidates;
+}
+
+bool SignatureScanner::Verify(const Pattern& pattern, const uint8_t* pData)
+{
+    int length = (int)pattern.Bytes.size();
+    if (pattern.Exact)
+        return memcmp(pData, pattern.Bytes.data(), length) == 0;
+
+    int i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i data = _mm_loadu_si128((const __m128i*)(pData + i));
+        __m128i mask = _mm_loadu_si128((const __m128i*)(pattern.Mask.data() + i));
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(pattern.Bytes.data() + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(data, mask), bytes)) != 0xFFFF)
+            return false;
+    }
+
+    for (; i < length; i++)
+    {
+        if ((pData[i] & pattern.Mask[i]) != pattern.Bytes[i])
+            return false;
+    }
+    return true;
+}
+
+// Higher is rarer. The list holds the bytes that dominate x86 code and data sections,
+// most common first; anything not listed is considered rare.
+int SignatureScanner::GetByteFrequencyRank(uint8_t value)
+{
+    static constexpr uint8_t CommonBytes[] =
+    {
+        0x00, 0xFF, 0xCC, 0x8B, 0x89, 0x24, 0x45, 0xE8, 0x01, 0x0F, 0x04, 0x08, 0x83, 0x85, 0x74, 0x10,
+        0x8D, 0x75, 0x50, 0x40, 0x20, 0xC0, 0x80, 0x02, 0x0C, 0x4D, 0x55, 0x56, 0x6A, 0xC3, 0x5D, 0x33,
+        0xEC, 0x90, 0x03, 0x57, 0x5E, 0x5F, 0x53, 0x5B, 0xEB, 0x18, 0x14, 0x1C, 0x46, 0xFE, 0x44, 0x06
+    };
+
+    for (int i = 0; i < (int)sizeof(CommonBytes); i++)
+    {
+        if (CommonBytes[i] == value)
+            return i;
+    }
+    return (int)sizeof(CommonBytes);
+}
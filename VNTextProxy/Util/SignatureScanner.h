@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Finds byte signatures in memory, e.g. a module image. A position matches a pattern if
+// (haystack[i] & mask[i]) == pattern[i] for every byte of the pattern; without a mask every byte must match.
+//
+// Each pattern is anchored on the two bytes (with a full 0xFF mask) that are least likely to occur in
+// x86 code and data. A 16/32-byte SSE2/AVX2 compare of both anchors produces a bitmask of candidate
+// positions, and only those are verified against the full pattern. Several patterns can be searched
+// in a single pass over the haystack. Standard library and intrinsics only.
+class SignatureScanner
+{
+public:
+    enum class Implementation
+    {
+        Auto,
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    // Returns the pattern's index in the results of Scan. The data is copied.
+    int AddPattern(const void* pPattern, const void* pMask, int length);
+    int GetPatternCount() const { return (int)_patterns.size(); }
+
+    // Returns the first occurrence of each pattern, or nullptr for patterns that weren't found
+    std::vector<const uint8_t*> Scan(const void* pHaystack, size_t length, Implementation implementation = Implementation::Auto) const;
+
+    static const uint8_t* FindFirst(const void* pHaystack, size_t length, const void* pPattern, const void* pMask, int patternLength);
+
+private:
+    struct Pattern
+    {
+        std::vector<uint8_t> Bytes;
+        std::vector<uint8_t> Mask;
+        bool Exact;
+        int Anchor1;        // Offsets of the anchor bytes, or -1 if no byte is fully masked
+        int Anchor2;
+        int AnchorReach;    // Highest anchor offset + 1
+    };
+
+    template<typename TCandidateFinder>
+    std::vector<const uint8_t*> ScanWith(const uint8_t* pHaystack, size_t length) const;
+
+    static uint32_t FindCandidatesScalar(const Pattern& pattern, const uint8_t* pBlock, int count);
+    static bool Verify(const Pattern& pattern, const uint8_t* pData);
+    static int GetByteFrequencyRank(uint8_t value);
+
+    struct ScalarCandidateFinder;
+    struct Sse2CandidateFinder;
+    struct Avx2CandidateFinder;
+
+    std::vector<Pattern> _patterns;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// The character conversion behind SjisTunnelEncoding: SJIS with tunneled characters to UTF-16 and back.
+// Characters that SJIS can't represent are assigned unused two-byte codes (a lead byte followed by a
+// trail byte below 0x40) in the order they're first encoded; the mappings list holds them by index.
+// Standard library only; TCodePage supplies the single-character code page 932 conversions:
+//   static bool Decode(const char* pChar, int length, wchar_t& wc);     // false if not a valid character
+//   static int Encode(wchar_t wc, char* pBytes);                        // bytes written (1 or 2), 0 if none
+namespace SjisTunnelCodec
+{
+    inline constexpr uint8_t LowBytesToAvoid[] = { '\t', '\n', '\r', ' ', ',' };
+    inline constexpr int TunnelCharsPerLeadByte = 0x40 - sizeof(LowBytesToAvoid) - 1;
+    inline constexpr int MaxMappings = 0x3B * TunnelCharsPerLeadByte;
+
+    inline bool IsSjisHighByte(uint8_t byte)
+    {
+        return (byte >= 0x81 && byte < 0xA0) || (byte >= 0xE0 && byte < 0xFD);
+    }
+
+    inline uint16_t MappingIndexToTunnelChar(int index)
+    {
+        int highIdx = index / TunnelCharsPerLeadByte;
+        int lowIdx = index % TunnelCharsPerLeadByte;
+        uint8_t highByte = highIdx < 0x1F ? 0x81 + highIdx : 0xE0 + (highIdx - 0x1F);
+        uint8_t lowByte = 1 + lowIdx;
+        for (uint8_t avoid : LowBytesToAvoid)
+        {
+            if (lowByte >= avoid)
+                lowByte++;
+        }
+
+        return (uint16_t)((highByte << 8) | lowByte);
+    }
+
+    inline int TunnelCharToMappingIndex(uint16_t tunnelChar)
+    {
+        uint8_t highByte = (uint8_t)(tunnelChar >> 8);
+        uint8_t lowByte = (uint8_t)tunnelChar;
+
+        if (!IsSjisHighByte(highByte) || lowByte == 0 || lowByte >= 0x40)
+            return -1;
+
+        int highIdx = highByte < 0xA0 ? highByte - 0x81 : 0x1F + (highByte - 0xE0);
+
+        int lowIdx = lowByte;
+        for (int i = sizeof(LowBytesToAvoid) - 1; i >= 0; i--)
+        {
+            if (lowIdx > LowBytesToAvoid[i])
+                lowIdx--;
+        }
+        lowIdx--;
+
+        return highIdx * TunnelCharsPerLeadByte + lowIdx;
+    }
+
+    // Converts count bytes (NULs included) into pOutput. Returns the length of the complete result;
+    // only the characters that fit in outputSize are written.
+    template<typename TCodePage>
+    int Decode(const char* pText, int count, wchar_t* pOutput, int outputSize, const std::vector<wchar_t>& mappings)
+    {
+        int outputLength = 0;
+        int i = 0;
+        while (i < count)
+        {
+            uint8_t highByte = pText[i];
+            wchar_t wc;
+            if (highByte < 0x80)
+            {
+                // Code page 932 matches ASCII here
+                wc = highByte;
+                i++;
+            }
+            else if (highByte >= 0xA1 && highByte <= 0xDF)
+            {
+                // Half-width katakana
+                wc = 0xFF61 + (highByte - 0xA1);
+                i++;
+            }
+            else
+            {
+                // A lead byte without a valid trail byte (end of input or NUL) is converted on its own
+                int charLength = IsSjisHighByte(highByte) && i + 1 < count && pText[i + 1] != '\0' ? 2 : 1;
+
+#if 0
+                int mappingIdx = charLength == 2 ? TunnelCharToMappingIndex((uint16_t)((highByte << 8) | (uint8_t)pText[i + 1])) : -1;
+                if (mappingIdx >= 0 && mappingIdx < (int)mappings.size())
+                {
+                    if (outputLength < outputSize)
+                        pOutput[outputLength] = mappings[mappingIdx];
+
+                    outputLength++;
+                    i += charLength;
+                    continue;
+                }
+#endif
+
+                if (!TCodePage::Decode(pText + i, charLength, wc))
+                    wc = L'\u30FB';
+
+                i += charLength;
+            }
+
+            if (outputLength < outputSize)
+                pOutput[outputLength] = wc;
+
+            outputLength++;
+        }
+        return outputLength;
+    }
+
+    // Converts count UTF-16 characters into pOutput, adding a mapping for every character that needs
+    // a tunnel and doesn't have one yet. Returns the length of the complete result; only the
+    // characters that fit in outputSize are written, and a two-byte character is never split.
+    template<typename TCodePage>
+    int Encode(const wchar_t* pText, int count, char* pOutput, int outputSize, std::vector<wchar_t>& mappings)
+    {
+        int outputLength = 0;
+        for (int i = 0; i < count; i++)
+        {
+            wchar_t widechar = pText[i];
+            char multibyte[2];
+            int multibyteLength;
+            if (widechar < 0x80)
+            {
+                multibyte[0] = (char)widechar;
+                multibyteLength = 1;
+            }
+            else
+            {
+                // Characters in the user-defined area (lead bytes 0xF0-0xF9) aren't in the game's font
+                multibyteLength = TCodePage::Encode(widechar, multibyte);
+                if (multibyteLength == 0 || (uint8_t)multibyte[0] >= 0xF0)
+                {
+                    int mappingIdx = (int)(std::find(mappings.begin(), mappings.end(), widechar) - mappings.begin());
+                    if (mappingIdx == (int)mappings.size())
+                    {
+                        if (mappingIdx == MaxMappings)
+                            throw std::runtime_error("SJIS tunnel limit exceeded");
+
+                        mappings.push_back(widechar);
+                    }
+
+                    uint16_t tunnelChar = MappingIndexToTunnelChar(mappingIdx);
+                    multibyte[0] = (char)(tunnelChar >> 8);
+                    multibyte[1] = (char)tunnelChar;
+                    multibyteLength = 2;
+                }
+            }
+
+            if (outputLength + multibyteLength <= outputSize)
+                memcpy(pOutput + outputLength, multibyte, multibyteLength);
+
+            outputLength += multibyteLength;
+        }
+        return outputLength;
+    }
+}
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "SharedConstants.h"
 #include "PillarboxedState.h"
+#include "OverlayFileSystem.h"
 #include "Util/Logger.h"
 
 using namespace std;
@@ -34,6 +35,14 @@ void Win32AToWAdapter::Init()
             { "SearchPathA", SearchPathAHook },
             { "GetFileAttributesA", GetFileAttributesAHook },
             { "CreateFileA", CreateFileAHook },
+            { "CreateFileMappingA", CreateFileMappingAHook },
+            { "ReadFile", ReadFileHook },
+            { "GetFileSize", GetFileSizeHook },
+            { "GetFileSizeEx", GetFileSizeExHook },
+            { "SetFilePointer", SetFilePointerHook },
+            { "SetFilePointerEx", SetFilePointerExHook },
+            { "GetFileType", GetFileTypeHook },
+            { "CloseHandle", CloseHandleHook },
             { "DeleteFileA", DeleteFileAHook },
             { "CreateDirectoryA", CreateDirectoryAHook },
             { "RemoveDirectoryA", RemoveDirectoryA },
@@ -89,24 +98,29 @@ BOOL Win32AToWAdapter::IsDBCSLeadByteHook(BYTE TestChar)
     return (TestChar >= 0x81 && TestChar < 0xA0) || (TestChar >= 0xE0 && TestChar < 0xFD);
 }
 
+// Validates the arguments and handles the buffer the way kernel32 does: a negative source length means
+// "up to and including the NUL terminator", an output size of 0 only measures, and a buffer that's too
+// small is filled as far as whole characters fit before failing with ERROR_INSUFFICIENT_BUFFER.
 int Win32AToWAdapter::MultiByteToWideCharHook(UINT codePage, DWORD flags, LPCCH lpMultiByteStr, int cbMultiByte, LPWSTR lpWideCharStr, int cchWideChar)
 {
     if (codePage != CP_ACP && codePage != CP_THREAD_ACP && codePage != 932)
         return MultiByteToWideChar(codePage, flags, lpMultiByteStr, cbMultiByte, lpWideCharStr, cchWideChar);
 
-    wstring wstr = SjisTunnelEncoding::Decode(lpMultiByteStr, cbMultiByte);
-    int numWchars = wstr.size();
+    if (lpMultiByteStr == nullptr || cbMultiByte == 0 || cchWideChar < 0 ||
+        (cchWideChar != 0 && (lpWideCharStr == nullptr || (const void*)lpMultiByteStr == (const void*)lpWideCharStr)))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+
     if (cbMultiByte < 0)
-        numWchars++;
+        cbMultiByte = (int)strlen(lpMultiByteStr) + 1;
 
-    if (cchWideChar > 0)
+    int numWchars = SjisTunnelEncoding::Decode(lpMultiByteStr, cbMultiByte, lpWideCharStr, cchWideChar);
+    if (cchWideChar != 0 && cchWideChar < numWchars)
     {
-        memcpy(lpWideCharStr, wstr.c_str(), min(numWchars, cchWideChar) * sizeof(wchar_t));
-        if (cchWideChar < numWchars)
-        {
-            SetLastError(ERROR_INSUFFICIENT_BUFFER);
-            return 0;
-        }
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
     }
 
     return numWchars;
@@ -117,22 +131,25 @@ int Win32AToWAdapter::WideCharToMultiByteHook(UINT codePage, DWORD flags, LPCWCH
     if (codePage != CP_ACP && codePage != 932)
         return WideCharToMultiByte(codePage, flags, lpWideCharStr, cchWideChar, lpMultiByteStr, cbMultiByte, lpDefaultChar, lpUsedDefaultChar);
 
+    if (lpWideCharStr == nullptr || cchWideChar == 0 || cbMultiByte < 0 ||
+        (cbMultiByte != 0 && (lpMultiByteStr == nullptr || (const void*)lpWideCharStr == (const void*)lpMultiByteStr)))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+
+    // Characters without an SJIS equivalent are tunneled rather than replaced, so the default character is never used
     if (lpUsedDefaultChar != nullptr)
         *lpUsedDefaultChar = false;
 
-    string str = SjisTunnelEncoding::Encode(lpWideCharStr, cchWideChar);
-    int numChars = str.size();
     if (cchWideChar < 0)
-        numChars++;
+        cchWideChar = (int)wcslen(lpWideCharStr) + 1;
 
-    if (cbMultiByte > 0)
+    int numChars = SjisTunnelEncoding::Encode(lpWideCharStr, cchWideChar, lpMultiByteStr, cbMultiByte);
+    if (cbMultiByte != 0 && cbMultiByte < numChars)
     {
-        memcpy(lpMultiByteStr, str.c_str(), min(numChars, cbMultiByte));
-        if (cbMultiByte < numChars)
-        {
-            SetLastError(ERROR_INSUFFICIENT_BUFFER);
-            return 0;
-        }
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
     }
 
     return numChars;
@@ -204,9 +221,12 @@ HMODULE Win32AToWAdapter::LoadLibraryExAHook(LPCSTR lpLibFileName, HANDLE hFile,
 
 DWORD Win32AToWAdapter::GetFullPathNameAHook(LPCSTR lpFileName, DWORD nBufferLength, LPSTR lpBuffer, LPSTR* lpFilePart)
 {
+    DecodedPath fileName;
+    DecodePath(lpFileName, fileName);
+
     wstring bufferW;
     bufferW.resize(nBufferLength);
-    DWORD result = GetFullPathNameW(SjisTunnelEncoding::Decode(lpFileName).c_str(), bufferW.size(), bufferW.data(), nullptr);
+    DWORD result = GetFullPathNameW(fileName.c_str(), bufferW.size(), bufferW.data(), nullptr);
     if (result == 0)
         return 0;
 
@@ -233,8 +253,11 @@ DWORD Win32AToWAdapter::GetFullPathNameAHook(LPCSTR lpFileName, DWORD nBufferLen
 
 HANDLE Win32AToWAdapter::FindFirstFileAHook(LPCSTR lpFileName, LPWIN32_FIND_DATAA lpFindFileData)
 {
+    DecodedPath fileName;
+    DecodePath(lpFileName, fileName);
+
     WIN32_FIND_DATAW findDataW;
-    HANDLE hFind = FindFirstFileW(SjisTunnelEncoding::Decode(lpFileName).c_str(), &findDataW);
+    HANDLE hFind = FindFirstFileW(fileName.c_str(), &findDataW);
     if (hFind == INVALID_HANDLE_VALUE)
         return INVALID_HANDLE_VALUE;
 
@@ -255,11 +278,14 @@ BOOL Win32AToWAdapter::FindNextFileAHook(HANDLE hFindFile, LPWIN32_FIND_DATAA lp
 
 DWORD Win32AToWAdapter::SearchPathAHook(LPCSTR lpPath, LPCSTR lpFileName, LPCSTR lpExtension, DWORD nBufferLength, LPSTR lpBuffer, LPSTR* lpFilePart)
 {
+    DecodedPath fileName;
+    DecodePath(lpFileName, fileName);
+
     wstring bufferW;
     bufferW.resize(nBufferLength);
     DWORD result = SearchPathW(
         lpPath != nullptr ? SjisTunnelEncoding::Decode(lpPath).c_str() : nullptr,
-        SjisTunnelEncoding::Decode(lpFileName).c_str(),
+        fileName.c_str(),
         lpExtension != nullptr ? SjisTunnelEncoding::Decode(lpExtension).c_str() : nullptr,
         bufferW.size(),
         bufferW.data(),
@@ -291,33 +317,172 @@ DWORD Win32AToWAdapter::SearchPathAHook(LPCSTR lpPath, LPCSTR lpFileName, LPCSTR
 
 DWORD Win32AToWAdapter::GetFileAttributesAHook(LPCSTR lpFileName)
 {
-    return GetFileAttributesW(SjisTunnelEncoding::Decode(lpFileName).c_str());
+    DecodedPath fileName;
+    DecodePath(lpFileName, fileName);
+    if (OverlayFileSystem::Contains(fileName.c_str()))
+    {
+        SetLastError(NO_ERROR);
+        return FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_ARCHIVE;
+    }
+
+    if (fileName.KnownMissing)
+    {
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return INVALID_FILE_ATTRIBUTES;
+    }
+
+    DWORD attributes = GetFileAttributesW(fileName.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES)
+        RecordMissing(fileName, GetLastError());
+
+    return attributes;
 }
 
 HANDLE Win32AToWAdapter::CreateFileAHook(LPCSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile)
 {
-    return CreateFileW(SjisTunnelEncoding::Decode(lpFileName).c_str(), dwDesiredAccess, dwShareMode, lpSecurityAttributes, dwCreationDisposition, dwFlagsAndAttributes, hTemplateFile);
+    DecodedPath fileName;
+    DecodePath(lpFileName, fileName);
+
+    // The overlay is read-only, so files opened for writing go to disk even if the overlay has them
+    bool forReading = (dwDesiredAccess & (GENERIC_WRITE | GENERIC_ALL | FILE_WRITE_DATA | FILE_APPEND_DATA)) == 0 &&
+                      (dwCreationDisposition == OPEN_EXISTING || dwCreationDisposition == OPEN_ALWAYS);
+    if (forReading)
+    {
+        HANDLE hOverlayFile = OverlayFileSystem::Open(fileName.c_str());
+        if (hOverlayFile != INVALID_HANDLE_VALUE)
+            return hOverlayFile;
+    }
+
+    // Only dispositions that fail for a missing file can be answered from the cache
+    bool mustExist = dwCreationDisposition == OPEN_EXISTING || dwCreationDisposition == TRUNCATE_EXISTING;
+    if (mustExist && fileName.KnownMissing)
+    {
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE hFile = CreateFileW(fileName.c_str(), dwDesiredAccess, dwShareMode, lpSecurityAttributes, dwCreationDisposition, dwFlagsAndAttributes, hTemplateFile);
+    if (hFile == INVALID_HANDLE_VALUE && mustExist)
+        RecordMissing(fileName, GetLastError());
+
+    return hFile;
 }
 
 HANDLE Win32AToWAdapter::CreateFileMappingAHook(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileMappingAttributes, DWORD flProtect, DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCSTR lpName)
 {
+    wstring name = lpName != nullptr ? SjisTunnelEncoding::Decode(lpName) : wstring();
+    HANDLE hMapping;
+    if (OverlayFileSystem::CreateMapping(hFile, lpFileMappingAttributes, lpName != nullptr ? name.c_str() : nullptr, hMapping))
+        return hMapping;
+
     return CreateFileMappingW(hFile, lpFileMappingAttributes, flProtect, dwMaximumSizeHigh, dwMaximumSizeLow,
-        lpName != nullptr ? SjisTunnelEncoding::Decode(lpName).c_str() : nullptr);
+        lpName != nullptr ? name.c_str() : nullptr);
+}
+
+BOOL Win32AToWAdapter::ReadFileHook(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped)
+{
+    BOOL result;
+    if (OverlayFileSystem::Read(hFile, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead, lpOverlapped, result))
+        return result;
+
+    return ReadFile(hFile, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead, lpOverlapped);
+}
+
+DWORD Win32AToWAdapter::GetFileSizeHook(HANDLE hFile, LPDWORD lpFileSizeHigh)
+{
+    uint64_t size;
+    if (!OverlayFileSystem::GetSize(hFile, size))
+        return GetFileSize(hFile, lpFileSizeHigh);
+
+    if (lpFileSizeHigh != nullptr)
+        *lpFileSizeHigh = (DWORD)(size >> 32);
+
+    SetLastError(NO_ERROR);
+    return (DWORD)size;
+}
+
+BOOL Win32AToWAdapter::GetFileSizeExHook(HANDLE hFile, PLARGE_INTEGER lpFileSize)
+{
+    uint64_t size;
+    if (!OverlayFileSystem::GetSize(hFile, size))
+        return GetFileSizeEx(hFile, lpFileSize);
+
+    lpFileSize->QuadPart = (LONGLONG)size;
+    return true;
+}
+
+DWORD Win32AToWAdapter::SetFilePointerHook(HANDLE hFile, LONG lDistanceToMove, PLONG lpDistanceToMoveHigh, DWORD dwMoveMethod)
+{
+    // Without the high part, the distance is a signed 32-bit value
+    int64_t distance = lpDistanceToMoveHigh != nullptr ? (int64_t)(((uint64_t)*lpDistanceToMoveHigh << 32) | (DWORD)lDistanceToMove) : lDistanceToMove;
+    uint64_t newPosition;
+    BOOL result;
+    if (!OverlayFileSystem::Seek(hFile, distance, dwMoveMethod, newPosition, result))
+        return SetFilePointer(hFile, lDistanceToMove, lpDistanceToMoveHigh, dwMoveMethod);
+
+    if (!result)
+        return INVALID_SET_FILE_POINTER;
+
+    if (lpDistanceToMoveHigh != nullptr)
+        *lpDistanceToMoveHigh = (LONG)(newPosition >> 32);
+
+    // Callers check the last error to tell a position of 0xFFFFFFFF from a failure
+    SetLastError(NO_ERROR);
+    return (DWORD)newPosition;
+}
+
+BOOL Win32AToWAdapter::SetFilePointerExHook(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod)
+{
+    uint64_t newPosition;
+    BOOL result;
+    if (!OverlayFileSystem::Seek(hFile, liDistanceToMove.QuadPart, dwMoveMethod, newPosition, result))
+        return SetFilePointerEx(hFile, liDistanceToMove, lpNewFilePointer, dwMoveMethod);
+
+    if (result && lpNewFilePointer != nullptr)
+        lpNewFilePointer->QuadPart = (LONGLONG)newPosition;
+
+    return result;
+}
+
+// The CRT's open() rejects handles that don't report being disk files
+DWORD Win32AToWAdapter::GetFileTypeHook(HANDLE hFile)
+{
+    if (OverlayFileSystem::IsOverlayHandle(hFile))
+    {
+        SetLastError(NO_ERROR);
+        return FILE_TYPE_DISK;
+    }
+
+    return GetFileType(hFile);
+}
+
+BOOL Win32AToWAdapter::CloseHandleHook(HANDLE hObject)
+{
+    if (OverlayFileSystem::Close(hObject))
+        return true;
+
+    return CloseHandle(hObject);
 }
 
 BOOL Win32AToWAdapter::DeleteFileAHook(LPCSTR lpFileName)
 {
-    return DeleteFileW(SjisTunnelEncoding::Decode(lpFileName).c_str());
+    DecodedPath pathName;
+    DecodePath(lpFileName, pathName);
+    return DeleteFileW(pathName.c_str());
 }
 
 BOOL Win32AToWAdapter::CreateDirectoryAHook(LPCSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes)
 {
-    return CreateDirectoryW(SjisTunnelEncoding::Decode(lpPathName).c_str(), lpSecurityAttributes);
+    DecodedPath pathName;
+    DecodePath(lpPathName, pathName);
+    return CreateDirectoryW(pathName.c_str(), lpSecurityAttributes);
 }
 
 BOOL Win32AToWAdapter::RemoveDirectoryAHook(LPCSTR lpPathName)
 {
-    return RemoveDirectoryW(SjisTunnelEncoding::Decode(lpPathName).c_str());
+    DecodedPath pathName;
+    DecodePath(lpPathName, pathName);
+    return RemoveDirectoryW(pathName.c_str());
 }
 
 DWORD Win32AToWAdapter::GetCurrentDirectoryAHook(DWORD nBufferLength, LPSTR lpBuffer)
@@ -1041,6 +1206,114 @@ BOOL Win32AToWAdapter::DirectSoundEnumerateCallback(LPGUID lpGuid, LPCWSTR lpcst
     );
 }
 
+// SoftPal probes the loose file in data\ before falling back to data.pac for every asset it loads,
+// so the file hooks see the same few hundred paths over and over. Decoded paths come from PathConversions,
+// which also remembers the data\ files that turned out not to exist.
+void Win32AToWAdapter::DecodePath(LPCSTR lpPath, DecodedPath& path)
+{
+    path.pPath = path.Buffer;
+    path.Buffer[0] = L'\0';
+    path.Hash = 0;
+    path.DataFolderGeneration = 0;
+    path.Cached = false;
+    path.KnownMissing = false;
+    if (lpPath == nullptr)
+        return;
+
+    path.PathA = string_view(lpPath);
+    if (path.PathA.size() >= MAX_PATH)
+    {
+        path.LongPath = SjisTunnelEncoding::Decode(lpPath, (int)path.PathA.size());
+        path.pPath = path.LongPath.c_str();
+        return;
+    }
+
+    if ((++PathLookups & 0xFFF) == 0)
+        LogPathCacheStats();
+
+    path.Cached = true;
+    path.Hash = PathCache::Hash(path.PathA);
+    if (PathConversions.Get(path.PathA, path.Hash, path.Buffer, MAX_PATH, path.KnownMissing) >= 0)
+    {
+        if (path.KnownMissing && CheckDataFolderChanges())
+            path.KnownMissing = false;
+    }
+    else
+    {
+        // Decoding never produces more characters than there are bytes
+        int length = SjisTunnelEncoding::Decode(lpPath, (int)path.PathA.size(), path.Buffer, MAX_PATH - 1);
+        path.Buffer[length] = L'\0';
+        PathConversions.Add(path.PathA, path.Hash, wstring_view(path.Buffer, length));
+    }
+
+    path.DataFolderGeneration = DataFolderGeneration.load(memory_order_acquire);
+}
+
+// Only "file not found" in data\ is remembered: those are the probes that fail on every asset load.
+// The flags are dropped as soon as a file or folder in data\ is created, deleted or renamed.
+// A change between the caller's lookup and this call (the file being created just after the lookup failed)
+// either still has the notification signaled or has moved the generation on, and then nothing is recorded.
+void Win32AToWAdapter::RecordMissing(const DecodedPath& path, DWORD error)
+{
+    if (!path.Cached || error != ERROR_FILE_NOT_FOUND || !IsInDataFolder(path))
+        return;
+
+    if (DataFolderChangeNotification != INVALID_HANDLE_VALUE)
+    {
+        lock_guard lock(DataFolderChangeMutex);
+        if (!ConsumeDataFolderChange() && DataFolderGeneration.load(memory_order_relaxed) == path.DataFolderGeneration)
+            PathConversions.SetMissing(path.PathA, path.Hash, true);
+    }
+
+    SetLastError(error);
+}
+
+// Assumes the game doesn't change its working directory after resolving a relative path once
+bool Win32AToWAdapter::IsInDataFolder(const DecodedPath& path)
+{
+    call_once(DataFolderWatchInit, []
+    {
+        DataFolderPath = Path::Combine(Path::GetModuleFolderPath(nullptr), L"data\\");
+        DataFolderChangeNotification = FindFirstChangeNotificationW(DataFolderPath.c_str(), true, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+        if (DataFolderChangeNotification == INVALID_HANDLE_VALUE)
+            winapi_log("Win32AToWAdapter: can't watch %ls (error %d), not caching missing files", DataFolderPath.c_str(), GetLastError());
+    });
+
+    wchar_t fullPath[MAX_PATH];
+    DWORD length = GetFullPathNameW(path.c_str(), MAX_PATH, fullPath, nullptr);
+    if (length == 0 || length >= MAX_PATH)
+        return false;
+
+    return _wcsnicmp(fullPath, DataFolderPath.c_str(), DataFolderPath.size()) == 0;
+}
+
+// Returns true if data\ changed since the last check, in which case all missing flags have been dropped
+bool Win32AToWAdapter::CheckDataFolderChanges()
+{
+    lock_guard lock(DataFolderChangeMutex);
+    return ConsumeDataFolderChange();
+}
+
+// Called with DataFolderChangeMutex held
+bool Win32AToWAdapter::ConsumeDataFolderChange()
+{
+    if (WaitForSingleObject(DataFolderChangeNotification, 0) != WAIT_OBJECT_0)
+        return false;
+
+    DataFolderGeneration.fetch_add(1, memory_order_release);
+    PathConversions.ClearMissing();
+    FindNextChangeNotification(DataFolderChangeNotification);
+    return true;
+}
+
+void Win32AToWAdapter::LogPathCacheStats()
+{
+    PathCache::Stats stats = PathConversions.GetStats();
+    uint64_t lookups = stats.Hits + stats.Misses;
+    winapi_log("Win32AToWAdapter: path cache %llu lookups, %.1f%% hits, %llu known missing, %llu evictions",
+        lookups, lookups != 0 ? stats.Hits * 100.0 / lookups : 0.0, stats.MissingHits, stats.Evictions);
+}
+
 WIN32_FIND_DATAA Win32AToWAdapter::ConvertFindDataWToA(const WIN32_FIND_DATAW& findDataW)
 {
     WIN32_FIND_DATAA findDataA;
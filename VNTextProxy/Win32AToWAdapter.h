@@ -27,6 +27,13 @@ private:
     static DWORD __stdcall GetFileAttributesAHook(LPCSTR lpFileName);
     static HANDLE __stdcall CreateFileAHook(LPCSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
     static HANDLE __stdcall CreateFileMappingAHook(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileMappingAttributes, DWORD flProtect, DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCSTR lpName);
+    static BOOL __stdcall ReadFileHook(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped);
+    static DWORD __stdcall GetFileSizeHook(HANDLE hFile, LPDWORD lpFileSizeHigh);
+    static BOOL __stdcall GetFileSizeExHook(HANDLE hFile, PLARGE_INTEGER lpFileSize);
+    static DWORD __stdcall SetFilePointerHook(HANDLE hFile, LONG lDistanceToMove, PLONG lpDistanceToMoveHigh, DWORD dwMoveMethod);
+    static BOOL __stdcall SetFilePointerExHook(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod);
+    static DWORD __stdcall GetFileTypeHook(HANDLE hFile);
+    static BOOL __stdcall CloseHandleHook(HANDLE hObject);
     static BOOL __stdcall DeleteFileAHook(LPCSTR lpFileName);
     static BOOL __stdcall CreateDirectoryAHook(LPCSTR lpPathName, LPSECURITY_ATTRIBUTES lpSecurityAttributes);
     static BOOL __stdcall RemoveDirectoryAHook(LPCSTR lpPathName);
@@ -74,6 +81,28 @@ private:
     static HRESULT __stdcall DirectSoundEnumerateAHook(LPDSENUMCALLBACKA pDSEnumCallback, LPVOID pContext);
     static BOOL __stdcall DirectSoundEnumerateCallback(LPGUID lpGuid, LPCWSTR lpcstrDescription, LPCWSTR lpcstrModule, LPVOID lpContext);
 
+    // A path argument decoded to UTF-16: in the stack buffer unless it's unusually long
+    struct DecodedPath
+    {
+        wchar_t Buffer[MAX_PATH];
+        std::wstring LongPath;
+        const wchar_t* pPath;
+        std::string_view PathA;
+        uint64_t Hash;
+        uint32_t DataFolderGeneration;      // Read before the caller looks the file up on disk
+        bool Cached;
+        bool KnownMissing;
+
+        const wchar_t* c_str() const { return pPath; }
+    };
+
+    static void DecodePath(LPCSTR lpPath, DecodedPath& path);
+    static void RecordMissing(const DecodedPath& path, DWORD error);
+    static bool IsInDataFolder(const DecodedPath& path);
+    static bool CheckDataFolderChanges();
+    static bool ConsumeDataFolderChange();
+    static void LogPathCacheStats();
+
     static WIN32_FIND_DATAA ConvertFindDataWToA(const WIN32_FIND_DATAW& findDataW);
     static DEVMODEA ConvertDevModeWToA(const DEVMODEW& devModeW);
     static DEVMODEW ConvertDevModeAToW(const DEVMODEA& devModeA);
@@ -96,6 +125,14 @@ private:
         LPVOID OriginalContext;
     };
 
+    static inline PathCache PathConversions{};
+    static inline std::atomic<uint32_t> PathLookups{};
+    static inline std::once_flag DataFolderWatchInit{};
+    static inline std::wstring DataFolderPath{};
+    static inline HANDLE DataFolderChangeNotification = INVALID_HANDLE_VALUE;
+    static inline std::mutex DataFolderChangeMutex{};
+    static inline std::atomic<uint32_t> DataFolderGeneration{};     // Bumped for every change to data\ that is noticed
+
     static inline std::map<HWND, WNDPROC> WindowProcs{};
     static inline std::wstring PendingImeCompositionChars{};
     static inline std::vector<MSG> PendingWindowMessages{};
@@ -2,6 +2,7 @@
 
 #include "SharedConstants.h"
 #include "PALHooks.h"
+#include "OverlayFileSystem.h"
 #include "DX9Hooks.h"
 #include "DX11Hooks.h"
 #include "Util/Logger.h"
@@ -237,6 +238,7 @@ void Initialize()
 
     SetCurrentDirectoryW(Path::GetModuleFolderPath(nullptr).c_str());
     RuntimeConfig::Load();
+    HookAddressCache::Load();
     AddVectoredExceptionHandler(0, VectoredCrashHandler);
 
     proxy_log(LogCategory::INIT, "VNTextProxy built: " __DATE__ " " __TIME__);
@@ -269,6 +271,7 @@ void Initialize()
     }
 
     CompilerHelper::Init();
+    OverlayFileSystem::Init();
     Win32AToWAdapter::Init();
 //    SjisTunnelEncoding::PatchGameLookupTable();
 //    D2DProportionalizer::Init();
@@ -291,6 +294,8 @@ void Initialize()
     else {
         PALVideoFix::Install();
     }
+
+    HookAddressCache::Save();
 }
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
@@ -16,11 +16,12 @@
 #include <msctf.h>
 #include <MSAcm.h>
 
-#include <codecvt>
 #include <cstdlib>
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <ranges>
 #include <set>
 #include <string>
@@ -31,21 +32,33 @@
 
 #include "Util/ComPtr.h"
 #include "Util/Path.h"
+#include "Util/PathCache.h"
+#include "Util/OverlayArchive.h"
+#include "Util/PgdTranscodeCache.h"
 #include "Util/membuf.h"
+#include "Util/SignatureScanner.h"
+#include "Util/SjisTunnelCodec.h"
 #include "Util/MemoryUtil.h"
 #include "Util/MemoryUnprotector.h"
 #include "Util/StringUtil.h"
 #include "Util/RuntimeConfig.h"
+#include "Util/AddressCache.h"
+#include "Util/HookAddressCache.h"
+#include "Util/HookSignatures.h"
 
+#include "PE/PEImage.h"
 #include "PE/PE.h"
 
 #include "CompilerSpecific/Enumerations.h"
 #include "CompilerSpecific/CompilerHelper.h"
 #include "CompilerSpecific/Rtti/BorlandTypeDescriptor.h"
 #include "CompilerSpecific/Rtti/MsvcRttiCompleteObjectLocator.h"
+#include "CompilerSpecific/Rtti/RttiIndex.h"
 
-#include "Subtitles/SubtitleLine.h"
+#include "Subtitles/SrtIndex.h"
 #include "Subtitles/SubtitleDocument.h"
+#include "Subtitles/AlphaBlend.h"
+#include "Subtitles/SubtitleLineCache.h"
 #include "Subtitles/SubtitleRenderer.h"
 
 #include "Patches/BabelPatch.h"
@@ -38,6 +38,18 @@ Copy-Item "Build\convert_saves.exe" -Destination $utilDir
 Write-Host "Copying unipack.exe..."
 Copy-Item "PACPacking\Unipac\unipack.exe" -Destination $utilDir
 
+# Copy PacDelta.exe
+Write-Host "Copying PacDelta.exe..."
+Copy-Item "PACPacking\PacDelta\PacDelta.exe" -Destination $utilDir
+
+# Copy PgdConvert.exe
+Write-Host "Copying PgdConvert.exe..."
+Copy-Item "PACPacking\PgdConvert\PgdConvert.exe" -Destination $utilDir
+
+# Copy PacBuild.exe
+Write-Host "Copying PacBuild.exe..."
+Copy-Item "PACPacking\PacBuild\PacBuild.exe" -Destination $utilDir
+
 # Copy png2pgd_ge.exe
 Write-Host "Copying png2pgd_ge.exe..."
 Copy-Item "PACPacking\Softpal_PGD_Toolkit\dist\png2pgd_ge.exe" -Destination $utilDir
@@ -4,12 +4,10 @@
 
 $ErrorActionPreference = "Stop"
 
-$unipack = ".\util\unipack.exe"
-$png2pgd = ".\util\png2pgd_ge.exe"
+$pacBuild = ".\util\PacBuild.exe"
 
 # Verify utilities exist
-if (-not (Test-Path $unipack)) { throw "unipack.exe not found in util\" }
-if (-not (Test-Path $png2pgd)) { throw "png2pgd_ge.exe not found in util\" }
+if (-not (Test-Path $pacBuild)) { throw "PacBuild.exe not found in util\" }
 
 # Verify base files exist
 foreach ($f in @("data.pac", "winmm.dll", "VNTranslationToolsConstants.json")) {
@@ -22,95 +20,36 @@ if (-not (Test-Path "data\TEXT.DAT")) { throw "data\TEXT.DAT not found" }
 if (-not (Test-Path "data\script.src")) { throw "data\script.src not found" }
 $pngFiles = Get-ChildItem -Path "data" -Filter "*.png" -ErrorAction SilentlyContinue
 
-# 1) Create release directory and tmp
+# 1) Create release directory
 $timestamp = Get-Date -Format "yyyyMMdd_HHmmss"
 $release = "translation_patch_release_$timestamp"
-$tmpDir = Join-Path $release "tmp"
-New-Item -ItemType Directory -Path $tmpDir | Out-Null
+New-Item -ItemType Directory -Path $release | Out-Null
 Write-Host "Created $release"
 
-# 2) Copy all pac files into tmp/
+# 2) Build the patched pac files straight into the release directory. PacBuild replaces the entries of data.pac
+# that have a file with the same name in data\ (TEXT.DAT and script.src) and encodes data\*.png to PGD in memory
+# for the matching PGD entries, writing only the pac files it changed. It fails if a PNG has no PGD in any pac file.
 $pacFiles = Get-ChildItem -Filter "*.pac"
 if (-not $pacFiles) { throw "No .pac files found in current directory" }
-foreach ($pac in $pacFiles) {
-    Copy-Item $pac.FullName $tmpDir
-}
-Write-Host "Copied $($pacFiles.Count) pac files to tmp/"
-
-# 3) Convert data/*.png to PGD and insert into pac archives
-$insertedIn = @{}  # track which pacs had successful insertions
-
-if ($pngFiles) {
-    $pgdDir = Join-Path $tmpDir "pgd"
-    New-Item -ItemType Directory -Path $pgdDir | Out-Null
-
-    foreach ($png in $pngFiles) {
-        $outPgd = Join-Path $pgdDir ($png.BaseName + ".PGD")
-        Write-Host "Converting $($png.Name) -> PGD"
-        & $png2pgd -m 3 $png.FullName $outPgd
-        if ($LASTEXITCODE -ne 0) { throw "png2pgd_ge failed on $($png.Name)" }
-    }
-
-    # Try inserting PGD files into each pac
-    # unipack prints "update archive with <name>" for each file it replaces
-    $pgdNames = (Get-ChildItem -Path $pgdDir -Filter "*.PGD") | ForEach-Object { $_.Name }
-    $pgdInserted = @{}  # track which PGDs were successfully inserted
-
-    foreach ($pac in Get-ChildItem -Path $tmpDir -Filter "*.pac") {
-        $output = & $unipack $pac.FullName $pgdDir 2>&1 | Out-String
-        if ($LASTEXITCODE -ne 0) { throw "unipack failed on $($pac.Name)" }
-
-        $hadUpdate = $false
-        foreach ($pgdName in $pgdNames) {
-            $baseName = [System.IO.Path]::GetFileNameWithoutExtension($pgdName)
-            if ($output -match "update archive with $baseName") {
-                $hadUpdate = $true
-                $pgdInserted[$pgdName] = $true
-            }
-        }
-
-        $newPac = "$($pac.FullName).new"
-        if ($hadUpdate) {
-            Move-Item $newPac $pac.FullName -Force
-            $insertedIn[$pac.Name] = $true
-            Write-Host "Inserted PGD files into $($pac.Name)"
-        } elseif (Test-Path $newPac) {
-            Remove-Item $newPac
-        }
-    }
-
-    # Error out if any PGD was not inserted into any pac
-    $missing = $pgdNames | Where-Object { -not $pgdInserted[$_] }
-    if ($missing) {
-        throw "The following PGD files were not found in any pac archive: $($missing -join ', ')"
-    }
-}
-
-# 5) Insert data/TEXT.DAT and data/script.src into data.pac (in tmp)
-$dataPac = Join-Path $tmpDir "data.pac"
-Write-Host "Inserting TEXT.DAT and script.src into data.pac"
-& $unipack $dataPac "data"
-if ($LASTEXITCODE -ne 0) { throw "unipack failed on data.pac" }
-Move-Item "$dataPac.new" $dataPac -Force
+Write-Host "Building pac files from $($pacFiles.Count) archives and $(@($pngFiles).Count) PNG files"
+& $pacBuild "data" $release ($pacFiles | ForEach-Object { $_.Name }) -m 3
+if ($LASTEXITCODE -ne 0) { throw "PacBuild failed" }
 
-# 6) Copy required files into release directory
+# 3) Copy required files into release directory
 Copy-Item "winmm.dll" $release
 Copy-Item "VNTranslationToolsConstants.json" $release
 Get-ChildItem -Filter "*.ttf" | ForEach-Object {
     Copy-Item $_.FullName $release
 }
-# Copy data.pac (always needed) and any pac where PGDs were inserted
-Copy-Item $dataPac $release
-foreach ($pacName in $insertedIn.Keys) {
-    if ($pacName -ne "data.pac") {
-        Copy-Item (Join-Path $tmpDir $pacName) $release
-    }
+# data.pac is always needed, even if PacBuild had nothing to replace in it
+if (-not (Test-Path (Join-Path $release "data.pac"))) {
+    Copy-Item "data.pac" $release
 }
 Write-Host "Copied patched files to release"
 
-# 7) Create zip (contents at root level, exclude tmp/)
+# 4) Create zip (contents at root level)
 $zipName = "$release.zip"
 Write-Host "Creating $zipName"
-$filesToZip = Get-ChildItem -Path $release | Where-Object { $_.Name -ne "tmp" }
+$filesToZip = Get-ChildItem -Path $release
 Compress-Archive -Path $filesToZip.FullName -DestinationPath $zipName
 Write-Host "Done: $zipName"